@@ -24,6 +24,7 @@
 
 #include <cassert>
 #include <functional>
+#include <span>
 
 #include "inout.h"
 #include "support.h"
@@ -45,6 +46,9 @@ using DMA_ReservationCallback = std::function<void(Section*)>;
 class DmaChannel;
 using DMA_Callback = std::function<void(const DmaChannel* chan, DmaEvent event)>;
 
+// Receives a read-only view of the guest memory being transferred
+using DmaSpanReader = std::function<void(std::span<const uint8_t> bytes)>;
+
 class DmaChannel {
 public:
 	// Defaults at the time of initialization
@@ -79,6 +83,12 @@ public:
 	void ClearRequest();
 	size_t Read(size_t words, uint8_t* const dest_buffer);
 	size_t Write(size_t words, uint8_t* const src_buffer);
+
+	// Reads like Read() but without copying: the reader is handed the
+	// guest memory directly, one contiguous piece at a time and in
+	// transfer order. A transfer is split into several pieces where it
+	// crosses a page or wraps around in auto-init mode.
+	size_t ReadSpans(size_t words, const DmaSpanReader& reader);
 	void LogDetails() const;
 
 	// Reset the channel back to defaults, without callbacks or reservations.
@@ -93,8 +103,8 @@ public:
 private:
 	void EvictReserver();
 	bool HasReservation() const;
-	size_t ReadOrWrite(DmaDirection direction, size_t words,
-	                   uint8_t* const buffer);
+	template <typename Transfer>
+	size_t ReadOrWrite(size_t words, Transfer&& transfer);
 
 	DMA_ReservationCallback reservation_callback = {};
 	std::string reservation_owner                = {};
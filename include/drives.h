@@ -21,6 +21,8 @@
 
 #include "dosbox.h"
 
+#include <array>
+#include <list>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -369,7 +371,58 @@ struct isoDirEntry {
 #define IS_ASSOC(fileFlags)	(!!(fileFlags & ISO_ASSOCIATED))
 #define IS_DIR(fileFlags)	(!!(fileFlags & ISO_DIRECTORY))
 #define IS_HIDDEN(fileFlags)	(!!(fileFlags & ISO_HIDDEN))
-#define ISO_MAX_HASH_TABLE_SIZE 	100
+
+// Default number of sectors held in each ISO drive's sector cache, and the
+// number of sectors fetched ahead of sequential file and directory reads
+constexpr uint32_t IsoDefaultSectorCacheSize = 256;
+constexpr uint32_t IsoMaxReadAheadSectors    = 16;
+
+// Least-recently-used cache of cooked 2 KB sectors read from a CD-ROM image
+class IsoSectorCache {
+public:
+	explicit IsoSectorCache(const size_t num_sectors);
+
+	// Returns the cached sector's data and marks it as most-recently used,
+	// or nullptr if the sector isn't in the cache
+	uint8_t* Find(const uint32_t sector);
+
+	// Stores a copy of the sector's data, evicting the least-recently used
+	// sector if the cache is full. Returns the cached copy.
+	uint8_t* Insert(const uint32_t sector, const uint8_t* data);
+
+	void Resize(const size_t num_sectors);
+
+	size_t GetCapacity() const
+	{
+		return capacity;
+	}
+	size_t GetSize() const
+	{
+		return entries.size();
+	}
+	uint64_t GetHits() const
+	{
+		return hits;
+	}
+	uint64_t GetMisses() const
+	{
+		return misses;
+	}
+
+private:
+	struct Entry {
+		uint32_t sector = 0;
+		std::array<uint8_t, ISO_FRAMESIZE> data = {};
+	};
+
+	// Front is the most-recently used entry, back the least
+	std::list<Entry> entries = {};
+	std::unordered_map<uint32_t, std::list<Entry>::iterator> index = {};
+
+	size_t capacity = 0;
+	uint64_t hits   = 0;
+	uint64_t misses = 0;
+};
 
 // Must be constructed with a shared_ptr or it will throw an exception on internal call to shared_from_this()
 class isoDrive final : public DOS_Drive, public std::enable_shared_from_this<isoDrive> {
@@ -400,6 +453,12 @@ public:
 	bool IsRemovable(void) override;
 	Bits UnMount(void) override;
 	bool readSector(uint8_t* buffer, uint32_t sector);
+	bool ReadCachedSector(uint8_t** buffer, const uint32_t sector,
+	                      const uint32_t num_read_ahead = 0);
+	const IsoSectorCache& GetSectorCache() const
+	{
+		return sectorCache;
+	}
 	const char* GetLabel() override
 	{
 		return discLabel;
@@ -415,7 +474,6 @@ private:
 	int  GetDirIterator(const isoDirEntry* de);
 	bool GetNextDirEntry(const int dirIterator, isoDirEntry* de);
 	void FreeDirIterator(const int dirIterator);
-	bool ReadCachedSector(uint8_t** buffer, const uint32_t sector);
 	
 	struct DirIterator {
 		bool valid;
@@ -427,11 +485,8 @@ private:
 	
 	int nextFreeDirIterator;
 	
-	struct SectorHashEntry {
-		bool valid;
-		uint32_t sector;
-		uint8_t data[ISO_FRAMESIZE];
-	} sectorHashEntries[ISO_MAX_HASH_TABLE_SIZE];
+	IsoSectorCache sectorCache;
+	std::vector<uint8_t> sectorFillBuffer = {};
 
 	bool iso;
 	bool dataCD;
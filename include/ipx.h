@@ -68,6 +68,8 @@
 #pragma pack(1)
 #endif
 
+#include <functional>
+
 // For Uint8 type
 #include <SDL_net.h>
 
@@ -155,6 +157,13 @@ public:
 void UnpackIP(PackedIP ipPack, IPaddress * ipAddr);
 void PackIP(IPaddress ipAddr, PackedIP *ipPack);
 
+// Receives the datagrams already waiting on the socket, up to max_packets,
+// and passes each to on_packet. Stops early if on_packet returns false.
+// Never blocks. Returns the number of datagrams received.
+int IPX_ReceivePendingPackets(UDPsocket socket, int channel, uint8_t* buffer,
+                              int buffer_size, int max_packets,
+                              const std::function<bool(uint8_t*, int)>& on_packet);
+
 #ifdef _MSC_VER
 #pragma pack()
 #endif
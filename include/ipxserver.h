@@ -21,6 +21,9 @@
 
 #if C_IPX
 
+#include <cstdint>
+#include <vector>
+
 #include <SDL_net.h>
 
 struct packetBuffer {
@@ -32,14 +35,39 @@ struct packetBuffer {
 	bool waitsize;
 };
 
-#define SOCKETTABLESIZE 16
 #define CONVIP(hostvar) hostvar & 0xff, (hostvar >> 8) & 0xff, (hostvar >> 16) & 0xff, (hostvar >> 24) & 0xff
 #define CONVIPX(hostvar) hostvar[0], hostvar[1], hostvar[2], hostvar[3], hostvar[4], hostvar[5]
 
 
+struct IpxServerPeerStatus {
+	IPaddress address = {};
+
+	// Packets received from this client
+	uint64_t num_packets = 0;
+
+	// Time from a packet's arrival at the server until it's been passed on
+	// to each of its recipients
+	double average_latency_ms = 0.0;
+	double max_latency_ms     = 0.0;
+};
+
+struct IpxServerStatus {
+	uint64_t num_received = 0;
+	uint64_t num_sent     = 0;
+
+	// Packets for unknown clients, malformed ones, and ones that couldn't
+	// be sent
+	uint64_t num_dropped = 0;
+
+	// Received over roughly the last second
+	double packets_per_second = 0.0;
+
+	std::vector<IpxServerPeerStatus> peers = {};
+};
+
 void IPX_StopServer();
 bool IPX_StartServer(uint16_t portnum);
-bool IPX_isConnectedToServer(Bits tableNum, IPaddress ** ptrAddr);
+IpxServerStatus IPX_GetServerStatus();
 
 uint8_t packetCRC(uint8_t *buffer, uint16_t bufSize);
 
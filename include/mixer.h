@@ -37,6 +37,7 @@
 
 #include "../audio/envelope.h"
 #include "../audio/noise_gate.h"
+#include "../audio/polyphase_resampler.h"
 #include "audio_frame.h"
 #include "control.h"
 #include "math_utils.h"
@@ -148,10 +149,12 @@ enum class ResampleMethod {
 	// faithfully emulates the metallic, crunchy sound of old DACs.
 	ZeroOrderHoldAndResample,
 
-	// Resample from the channel sample rate to the mixer rate with Speex.
-	// This is mathematically correct, high-quality resampling that cuts all
-	// frequencies below the Nyquist frequency using a brickwall filter
-	// (everything below half the channel's sample rate is cut).
+	// Resample from the channel sample rate to the mixer rate with Speex
+	// or the built-in polyphase resampler, depending on the 'resampler'
+	// setting. This is mathematically correct, high-quality resampling
+	// that cuts all frequencies below the Nyquist frequency using a
+	// brickwall filter (everything below half the channel's sample rate is
+	// cut).
 	Resample
 };
 
@@ -238,6 +241,9 @@ public:
 	void SetResampleMethod(const ResampleMethod method);
 	void SetZeroOrderHoldUpsamplerTargetRate(const int target_rate_hz);
 
+	// Switches to the resampler selected by the 'resampler' setting
+	void ResetResampler();
+
 	// The crossfeed strength is a perceptually linear scale from 0.0
 	// to 1.0. A value of 0.0 means no crossfeed, and 1.0 means the stereo
 	// signal is collapsed into mono.
@@ -428,6 +434,10 @@ private:
 		SpeexResamplerState* state = nullptr;
 	} speex_resampler = {};
 
+	// Replaces the Speex resampler when one of the polyphase qualities is
+	// selected
+	std::unique_ptr<PolyphaseResampler> polyphase_resampler = {};
+
 	struct {
 		NoiseGate processor;
 
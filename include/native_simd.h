@@ -0,0 +1,36 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2025  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_NATIVE_SIMD_H
+#define DOSBOX_NATIVE_SIMD_H
+
+#include "simde/x86/sse2.h"
+
+// Whether SIMDe's SSE2 intrinsics compile to vector instructions on the
+// target: SSE2 itself on x86, or NEON on ARM. Elsewhere SIMDe emulates them
+// one element at a time, which is slower than a plain scalar loop, so code
+// with both versions should only pick the SIMDe one when this is true.
+#if defined(SIMDE_X86_SSE2_NATIVE) || defined(SIMDE_ARM_NEON_A32V7_NATIVE)
+constexpr bool has_native_sse2 = true;
+#else
+constexpr bool has_native_sse2 = false;
+#endif
+
+#endif
@@ -109,6 +109,10 @@ struct Render_t {
 		uint32_t inHeight   = 0;
 		uint32_t inLine     = 0;
 		uint32_t outLine    = 0;
+
+		// True if every line of the last frame went through the line
+		// handlers, so the source cache holds the complete frame
+		bool cacheComplete = false;
 	} scale = {};
 
 	RenderPal_t pal = {};
@@ -117,6 +121,10 @@ struct Render_t {
 	bool active    = false;
 	bool fullFrame = true;
 
+	// True if lines identical to the previous frame may be passed to
+	// RENDER_DrawLine as nullptr in the current frame
+	bool canSkipLines = false;
+
 	std::string current_shader_name = {};
 	bool force_reload_shader        = false;
 };
@@ -209,6 +217,11 @@ void RENDER_SetSize(const ImageInfo& image_info, const double frames_per_second)
 bool RENDER_StartUpdate();
 void RENDER_EndUpdate(bool abort);
 
+// Returns true if the lines of the frame being drawn that are known to be
+// identical to the previous frame may be passed to RENDER_DrawLine as nullptr.
+// The renderer then reuses its cached copy of the line without reading it.
+bool RENDER_CanSkipUnchangedLines();
+
 void RENDER_SetPalette(const uint8_t entry, const uint8_t red,
                        const uint8_t green, const uint8_t blue);
 
@@ -0,0 +1,64 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2025  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_RENDER_SPAN_CONVERTERS_H
+#define DOSBOX_RENDER_SPAN_CONVERTERS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// The pixel conversions of the simple scalers for the most common
+// combinations, all of which output 32-bit pixels. The scalers hand them the
+// spans of changed pixels of each line.
+//
+// A span can start at any pixel, so the converters take unaligned pointers,
+// and they write exactly the span's pixels (or twice as many when doubling)
+// so the unchanged pixels on either side are left alone. The vectorised
+// versions convert whole vectors and finish the span with the scalar loops.
+
+struct RenderSpanConverters {
+	// Looks up 8-bit palette indices in a 256-entry table of 32-bit pixels.
+	void (*palette_to_32)(const uint8_t* src, size_t num_pixels,
+	                      const uint32_t* lut, uint32_t* dest);
+
+	// Same as above, but every pixel is written twice.
+	void (*palette_to_32_doubled)(const uint8_t* src, size_t num_pixels,
+	                              const uint32_t* lut, uint32_t* dest);
+
+	// Expands RGB565 pixels to XRGB8888. The top bits of each component
+	// are repeated in the new low bits, so full intensity stays full.
+	void (*rgb565_to_32)(const uint16_t* src, size_t num_pixels, uint32_t* dest);
+
+	// Same as above, but every pixel is written twice.
+	void (*rgb565_to_32_doubled)(const uint16_t* src, size_t num_pixels,
+	                             uint32_t* dest);
+
+	// Writes every 32-bit pixel twice.
+	void (*double_32)(const uint32_t* src, size_t num_pixels, uint32_t* dest);
+};
+
+const RenderSpanConverters& RENDER_GetScalarSpanConverters();
+const RenderSpanConverters& RENDER_GetSimdSpanConverters();
+
+// Returns the fastest converters the host CPU supports. Unlike the other
+// two, the choice is made at runtime.
+const RenderSpanConverters& RENDER_GetSpanConverters();
+
+#endif
@@ -164,6 +164,13 @@ public:
 	// The caller is responsible for sizing the target's array to accomodate
 	// the number requested.
 	size_t BulkDequeue(T* const into_target, const size_t num_requested);
+
+	// Never blocks. Dequeues up to the requested number of items that are
+	// already queued into the given container, even if queuing has
+	// stopped, and returns the quantity dequeued. On return, the vector's
+	// size matches the number dequeued.
+	size_t NonblockingBulkDequeue(std::vector<T>& into_target,
+	                              const size_t num_requested);
 };
 
 #endif
@@ -0,0 +1,157 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2025  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_SPSC_RING_H
+#define DOSBOX_SPSC_RING_H
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+
+/*  SPSC (Single-Producer Single-Consumer) Ring
+ *  -------------------------------------------
+ *  A fixed-size lock-free queue between exactly one producer thread and one
+ *  consumer thread. Neither side ever blocks; a full ring refuses new items
+ *  and an empty ring has nothing to give, so the caller decides whether to
+ *  drop, retry, or wait on something else.
+ *
+ *  Items are constructed in place in their slots, so large items (such as
+ *  network packets) can be written and read without an intermediate copy:
+ *
+ *    Producer: if (auto slot = ring.BeginPush()) { fill(*slot); ring.CommitPush(); }
+ *    Consumer: while (auto slot = ring.Front()) { use(*slot); ring.Pop(); }
+ */
+
+template <typename T, size_t N>
+class SpscRing {
+	static_assert(std::has_single_bit(N), "SpscRing size must be power of two");
+
+	static constexpr size_t IndexMask = N - 1;
+
+	// Keeps the indices written by the producer and the consumer on
+	// separate cache lines
+	static constexpr size_t CacheLineSize = 64;
+
+public:
+	SpscRing() = default;
+
+	SpscRing(const SpscRing&)            = delete;
+	SpscRing& operator=(const SpscRing&) = delete;
+
+	// Producer side
+	// ~~~~~~~~~~~~~
+
+	// Returns the next free slot, or nullptr if the ring is full. The item
+	// isn't visible to the consumer until CommitPush() is called.
+	T* BeginPush()
+	{
+		const auto head = head_index.load(std::memory_order_relaxed);
+		if (head - cached_tail_index == N) {
+			cached_tail_index = tail_index.load(std::memory_order_acquire);
+			if (head - cached_tail_index == N) {
+				return nullptr;
+			}
+		}
+		return &slots[head & IndexMask];
+	}
+
+	void CommitPush()
+	{
+		const auto head = head_index.load(std::memory_order_relaxed);
+		head_index.store(head + 1, std::memory_order_release);
+	}
+
+	bool TryPush(const T& item)
+	{
+		const auto slot = BeginPush();
+		if (!slot) {
+			return false;
+		}
+		*slot = item;
+		CommitPush();
+		return true;
+	}
+
+	// Consumer side
+	// ~~~~~~~~~~~~~
+
+	// Returns the oldest item, or nullptr if the ring is empty. The slot
+	// stays valid until Pop() is called.
+	T* Front()
+	{
+		const auto tail = tail_index.load(std::memory_order_relaxed);
+		if (tail == cached_head_index) {
+			cached_head_index = head_index.load(std::memory_order_acquire);
+			if (tail == cached_head_index) {
+				return nullptr;
+			}
+		}
+		return &slots[tail & IndexMask];
+	}
+
+	void Pop()
+	{
+		const auto tail = tail_index.load(std::memory_order_relaxed);
+		tail_index.store(tail + 1, std::memory_order_release);
+	}
+
+	bool TryPop(T& item)
+	{
+		const auto slot = Front();
+		if (!slot) {
+			return false;
+		}
+		item = *slot;
+		Pop();
+		return true;
+	}
+
+	// Either side
+	// ~~~~~~~~~~~
+
+	// Only a snapshot; the other side may change it at any time
+	size_t Size() const
+	{
+		// Reading the tail first means the head can't be behind it
+		const auto tail = tail_index.load(std::memory_order_acquire);
+		const auto head = head_index.load(std::memory_order_acquire);
+		return head - tail;
+	}
+
+	static constexpr size_t Capacity()
+	{
+		return N;
+	}
+
+private:
+	// Owned by the producer, along with its last look at the consumer's
+	// index, so it only touches the other cache line when it seems full
+	alignas(CacheLineSize) std::atomic<size_t> head_index = 0;
+	size_t cached_tail_index                              = 0;
+
+	// Owned by the consumer, likewise
+	alignas(CacheLineSize) std::atomic<size_t> tail_index = 0;
+	size_t cached_head_index                              = 0;
+
+	alignas(CacheLineSize) std::array<T, N> slots = {};
+};
+
+#endif // DOSBOX_SPSC_RING_H
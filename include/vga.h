@@ -26,6 +26,7 @@
 
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "bgrx8888.h"
 #include "bit_view.h"
@@ -35,9 +36,9 @@
 #include "rgb666.h"
 #include "video.h"
 
-//Don't enable keeping changes and mapping lfb probably...
 #define VGA_LFB_MAPPED
-//#define VGA_KEEP_CHANGES
+
+// Video memory writes are tracked in blocks of (1 << VGA_CHANGE_SHIFT) bytes
 #define VGA_CHANGE_SHIFT	9
 
 class PageHandler;
@@ -1020,19 +1021,25 @@ struct VgaMemory {
 	uint8_t* linear = {};
 };
 
-struct VGA_Changes {
-	// Add a few more just to be safe
-	// Allocated dynamically: [(VGA_MEMORY >> VGA_CHANGE_SHIFT) + 32]
-	uint8_t* map = nullptr;
-
-	uint8_t checkMask    = 0;
-	uint8_t frame        = 0;
-	uint8_t writeMask    = 0;
-	bool active          = 0;
-	uint32_t clearMask   = 0;
-	uint32_t start       = 0;
-	uint32_t last        = 0;
-	uint32_t lastAddress = 0;
+// Frame-level change tracking of the video memory. The tracked page handlers
+// stamp every written block with the current frame number, which lets the
+// draw code pass scanlines that only read unchanged blocks to the renderer
+// without drawing them.
+struct VgaChanges {
+	// One frame stamp per (1 << VGA_CHANGE_SHIFT) bytes of video memory
+	std::vector<uint8_t> map = {};
+
+	// Incremented at the start of every drawn frame; wraps around
+	uint8_t frame = 0;
+
+	// Stamp of the last change to the display state that's not held in
+	// video memory (palette, font, and CRTC, attribute and sequencer
+	// registers)
+	uint8_t state_frame = 0;
+
+	// True if the current memory handlers observe all writes to the video
+	// memory. Untracked modes fall back to the renderer's per-line diffing.
+	bool is_tracking = false;
 };
 
 struct VgaLfb {
@@ -1076,9 +1083,7 @@ struct VgaType {
 	// How much delay to add to video memory I/O in nanoseconds
 	uint16_t vmem_delay_ns = 0;
 
-#ifdef VGA_KEEP_CHANGES
 	VgaChanges changes = {};
-#endif
 
 	VgaLfb lfb = {};
 
@@ -1184,6 +1189,28 @@ void VGA_AllowPixelDoubling(const bool allow);
 
 extern VgaType vga;
 
+// Stamps the video memory blocks spanning the given inclusive range of linear
+// byte offsets as changed in the current frame. Only the first and last blocks
+// are stamped, so the range must not be longer than a block.
+inline void VGA_MarkMemoryChanged(const uint32_t first, const uint32_t last)
+{
+	auto& changes = vga.changes;
+	changes.map[first >> VGA_CHANGE_SHIFT] = changes.frame;
+	changes.map[last >> VGA_CHANGE_SHIFT]  = changes.frame;
+}
+
+// Stamps the display state as changed in the current frame, so the following
+// frames are drawn in full
+inline void VGA_MarkStateChanged()
+{
+	vga.changes.state_frame = vga.changes.frame;
+}
+
+// Called before changing state that affects drawing mid-frame. If the frame is
+// being drawn in one go, this draws the lines the beam has already passed
+// with the current state and draws the rest of the frame line by line.
+void VGA_StopFrameBatching();
+
 // Support for modular SVGA implementation
 
 /* Video mode extra data to be passed to FinishSetMode_SVGA().
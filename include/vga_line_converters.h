@@ -0,0 +1,73 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2025  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_VGA_LINE_CONVERTERS_H
+#define DOSBOX_VGA_LINE_CONVERTERS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "bgrx8888.h"
+
+// The inner loops of the VGA line drawers, which turn video memory into the
+// pixels of one scanline. There's a portable scalar implementation of each,
+// which also serves as the reference, and a vectorised one.
+//
+// None of the converters handle video memory wrap-around; the callers pass
+// contiguous runs of source bytes. The destination doesn't need to be
+// aligned.
+
+// One character cell of a text mode scanline. The glyph bits are
+// most-significant-bit first; bit (pixels_per_cell - 1) is the leftmost pixel.
+struct TextCell {
+	uint16_t glyph_bits = 0;
+	Bgrx8888 fg_colour  = {};
+	Bgrx8888 bg_colour  = {};
+};
+
+struct VgaLineConverters {
+	// Expands packed 4-bit pixels (high nibble first) through a 16-entry
+	// palette to one byte per pixel.
+	void (*expand_nibbles)(const uint8_t* src, size_t num_bytes,
+	                       const uint8_t* palette, uint8_t* dest);
+
+	// Same as above, but every pixel is written twice.
+	void (*expand_nibbles_doubled)(const uint8_t* src, size_t num_bytes,
+	                               const uint8_t* palette, uint8_t* dest);
+
+	// Expands 8-bit palette indices to 32-bit BGRX pixels. Runs of indices
+	// below 16 (as in the EGA and 16-colour VGA modes) take a fast path.
+	void (*expand_indices)(const uint8_t* src, size_t num_pixels,
+	                       const Bgrx8888* palette, uint8_t* dest);
+
+	// Expands text mode cells that are 8 or 9 pixels wide to 32-bit BGRX
+	// pixels.
+	void (*expand_text_cells)(const TextCell* cells, size_t num_cells,
+	                          uint8_t pixels_per_cell, uint8_t* dest);
+};
+
+const VgaLineConverters& VGA_GetScalarLineConverters();
+const VgaLineConverters& VGA_GetSimdLineConverters();
+
+// Returns the vectorised converters if the host runs them natively, or the
+// scalar ones otherwise.
+const VgaLineConverters& VGA_GetLineConverters();
+
+#endif
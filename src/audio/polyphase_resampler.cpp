@@ -0,0 +1,321 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2025  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "polyphase_resampler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <numbers>
+#include <numeric>
+#include <tuple>
+
+#include "simde/x86/sse2.h"
+
+static_assert(sizeof(AudioFrame) == 2 * sizeof(float),
+              "The dot products treat audio frames as interleaved floats");
+
+// Ratios with more output phases than this use an interpolated table of
+// 'NumOversampledPhases' instead
+constexpr uint32_t MaxExactPhases       = 256;
+constexpr uint32_t NumOversampledPhases = 256;
+
+// Downsampling by a large factor lengthens the filter proportionally; this
+// caps the cost of extreme ratios at the expense of stopband attenuation
+constexpr int MaxNumTaps = 1024;
+
+struct FilterParams {
+	int num_taps;
+
+	// Passband edge as a fraction of the lower of the two Nyquist rates
+	double bandwidth;
+
+	double kaiser_beta;
+};
+
+static FilterParams get_filter_params(const PolyphaseQuality quality)
+{
+	switch (quality) {
+	case PolyphaseQuality::Low: return {32, 0.85, 6.0};
+	case PolyphaseQuality::Medium: return {64, 0.91, 8.0};
+	case PolyphaseQuality::High: return {128, 0.95, 10.0};
+	}
+	assert(false);
+	return {64, 0.91, 8.0};
+}
+
+// Zeroth-order modified Bessel function of the first kind
+static double bessel_i0(const double x)
+{
+	double sum  = 1.0;
+	double term = 1.0;
+	for (int k = 1; term > sum * 1e-12; ++k) {
+		const auto t = x / (2.0 * k);
+		term *= t * t;
+		sum += term;
+	}
+	return sum;
+}
+
+static std::shared_ptr<const PolyphaseCoefficients> build_coefficients(
+        const uint32_t in_step, const uint32_t num_phases,
+        const PolyphaseQuality quality)
+{
+	const auto params = get_filter_params(quality);
+
+	auto num_taps = static_cast<double>(params.num_taps);
+	auto cutoff   = params.bandwidth;
+
+	// When downsampling, the cutoff moves down to the output's Nyquist
+	// rate and the filter gets longer to keep the same transition band
+	if (in_step > num_phases) {
+		const auto ratio = static_cast<double>(in_step) / num_phases;
+		num_taps *= ratio;
+		cutoff /= ratio;
+	}
+
+	auto c = std::make_shared<PolyphaseCoefficients>();
+
+	c->in_step         = in_step;
+	c->num_phases      = num_phases;
+	c->num_taps        = std::min(static_cast<int>(std::ceil(num_taps / 4)) * 4,
+                               MaxNumTaps);
+	c->is_interpolated = num_phases > MaxExactPhases;
+
+	// The extra oversampled row holds phase 0 shifted by one input frame,
+	// so interpolating from the last phase needs no special case
+	const auto table_phases = c->is_interpolated ? NumOversampledPhases
+	                                             : num_phases;
+	const auto num_rows = c->is_interpolated ? table_phases + 1 : table_phases;
+
+	c->table.resize(static_cast<size_t>(num_rows) * c->num_taps * 2);
+
+	const auto half_taps = c->num_taps / 2;
+	const auto i0_beta   = bessel_i0(params.kaiser_beta);
+
+	std::vector<double> row_coeffs(c->num_taps);
+
+	for (uint32_t row = 0; row < num_rows; ++row) {
+		const auto frac = static_cast<double>(row) / table_phases;
+
+		double sum = 0.0;
+		for (int k = 0; k < c->num_taps; ++k) {
+			// Distance from the output frame's position to the tap's
+			// input frame, in input frames
+			const auto x = (half_taps - 1 - k) + frac;
+
+			const auto r = x / half_taps;
+			const auto window = (std::abs(r) >= 1.0)
+			                          ? 0.0
+			                          : bessel_i0(params.kaiser_beta *
+			                                      std::sqrt(1.0 - r * r)) /
+			                                    i0_beta;
+
+			const auto arg  = std::numbers::pi * cutoff * x;
+			const auto sinc = (x == 0.0) ? 1.0 : std::sin(arg) / arg;
+
+			row_coeffs[k] = cutoff * sinc * window;
+			sum += row_coeffs[k];
+		}
+
+		// Normalise every phase to unity gain so DC passes through
+		// without ripple
+		auto dest = c->table.data() + static_cast<size_t>(row) * c->num_taps * 2;
+		for (const auto coeff : row_coeffs) {
+			*dest++ = static_cast<float>(coeff / sum);
+			*dest++ = static_cast<float>(coeff / sum);
+		}
+	}
+
+	return c;
+}
+
+// Tables that are still in use, so resamplers at the same ratio share them
+static std::mutex coefficients_mutex = {};
+static std::map<std::tuple<uint32_t, uint32_t, PolyphaseQuality>,
+                std::weak_ptr<const PolyphaseCoefficients>>
+        coefficient_tables = {};
+
+static std::shared_ptr<const PolyphaseCoefficients> get_coefficients(
+        const int in_rate_hz, const int out_rate_hz, const PolyphaseQuality quality)
+{
+	assert(in_rate_hz > 0);
+	assert(out_rate_hz > 0);
+
+	const auto divisor    = std::gcd(in_rate_hz, out_rate_hz);
+	const auto in_step    = static_cast<uint32_t>(in_rate_hz / divisor);
+	const auto num_phases = static_cast<uint32_t>(out_rate_hz / divisor);
+
+	const auto key = std::make_tuple(in_step, num_phases, quality);
+
+	std::lock_guard lock(coefficients_mutex);
+
+	if (const auto it = coefficient_tables.find(key);
+	    it != coefficient_tables.end()) {
+		if (auto existing = it->second.lock()) {
+			return existing;
+		}
+	}
+
+	auto coefficients       = build_coefficients(in_step, num_phases, quality);
+	coefficient_tables[key] = coefficients;
+	return coefficients;
+}
+
+// Adds the left and right halves of the two frames in 'acc'
+static AudioFrame sum_frames(const simde__m128 acc)
+{
+	const auto folded = simde_mm_add_ps(acc, simde_mm_movehl_ps(acc, acc));
+
+	float lanes[4];
+	simde_mm_storeu_ps(lanes, folded);
+	return {lanes[0], lanes[1]};
+}
+
+static AudioFrame convolve(const float* samples, const float* coeffs,
+                           const int num_taps)
+{
+	auto acc_a = simde_mm_setzero_ps();
+	auto acc_b = simde_mm_setzero_ps();
+
+	// Four frames per iteration, in two independent accumulators
+	for (int i = 0; i < num_taps * 2; i += 8) {
+		acc_a = simde_mm_add_ps(acc_a,
+		                        simde_mm_mul_ps(simde_mm_loadu_ps(samples + i),
+		                                        simde_mm_loadu_ps(coeffs + i)));
+		acc_b = simde_mm_add_ps(
+		        acc_b,
+		        simde_mm_mul_ps(simde_mm_loadu_ps(samples + i + 4),
+		                        simde_mm_loadu_ps(coeffs + i + 4)));
+	}
+	return sum_frames(simde_mm_add_ps(acc_a, acc_b));
+}
+
+// Convolves with two neighbouring phases at once, sharing the sample loads,
+// and interpolates between the results
+static AudioFrame convolve_interpolated(const float* samples,
+                                        const float* coeffs_a,
+                                        const float* coeffs_b,
+                                        const float frac, const int num_taps)
+{
+	auto acc_a = simde_mm_setzero_ps();
+	auto acc_b = simde_mm_setzero_ps();
+
+	for (int i = 0; i < num_taps * 2; i += 4) {
+		const auto s = simde_mm_loadu_ps(samples + i);
+
+		acc_a = simde_mm_add_ps(acc_a,
+		                        simde_mm_mul_ps(s, simde_mm_loadu_ps(coeffs_a + i)));
+		acc_b = simde_mm_add_ps(acc_b,
+		                        simde_mm_mul_ps(s, simde_mm_loadu_ps(coeffs_b + i)));
+	}
+
+	const auto lerped = simde_mm_add_ps(
+	        acc_a,
+	        simde_mm_mul_ps(simde_mm_set1_ps(frac), simde_mm_sub_ps(acc_b, acc_a)));
+
+	return sum_frames(lerped);
+}
+
+PolyphaseResampler::PolyphaseResampler(const int in_rate_hz, const int out_rate_hz,
+                                       const PolyphaseQuality _quality)
+        : quality(_quality),
+          coefficients(get_coefficients(in_rate_hz, out_rate_hz, _quality))
+{
+	Reset();
+}
+
+void PolyphaseResampler::SetRates(const int in_rate_hz, const int out_rate_hz)
+{
+	auto new_coefficients = get_coefficients(in_rate_hz, out_rate_hz, quality);
+	if (new_coefficients == coefficients) {
+		return;
+	}
+
+	const auto prev_num_taps   = coefficients->num_taps;
+	const auto prev_num_phases = coefficients->num_phases;
+
+	coefficients = std::move(new_coefficients);
+
+	if (coefficients->num_taps != prev_num_taps) {
+		Reset();
+		return;
+	}
+
+	// Keep the fractional position at the new phase resolution
+	phase = static_cast<uint32_t>(static_cast<uint64_t>(phase) *
+	                              coefficients->num_phases / prev_num_phases);
+}
+
+void PolyphaseResampler::Reset()
+{
+	assert(coefficients);
+
+	history.assign(coefficients->num_taps / 2 - 1, AudioFrame{});
+	read_pos = 0;
+	phase    = 0;
+}
+
+int PolyphaseResampler::GetInputLatency() const
+{
+	assert(coefficients);
+	return coefficients->num_taps / 2;
+}
+
+void PolyphaseResampler::Process(const std::span<const AudioFrame> in,
+                                 std::vector<AudioFrame>& out)
+{
+	assert(coefficients);
+	const auto& c = *coefficients;
+
+	history.insert(history.end(), in.begin(), in.end());
+
+	const auto num_taps = static_cast<size_t>(c.num_taps);
+
+	const auto samples = reinterpret_cast<const float*>(history.data());
+
+	while (read_pos + num_taps <= history.size()) {
+		const auto window = samples + read_pos * 2;
+
+		if (c.is_interpolated) {
+			const auto pos = uint64_t{phase} * NumOversampledPhases;
+			const auto row = pos / c.num_phases;
+			const auto frac = static_cast<float>(pos % c.num_phases) /
+			                  static_cast<float>(c.num_phases);
+
+			out.push_back(convolve_interpolated(
+			        window, c.Row(row), c.Row(row + 1), frac, c.num_taps));
+		} else {
+			out.push_back(convolve(window, c.Row(phase), c.num_taps));
+		}
+
+		phase += c.in_step;
+		read_pos += phase / c.num_phases;
+		phase %= c.num_phases;
+	}
+
+	// Drop the input frames no future output frame will read
+	const auto num_consumed = std::min(read_pos, history.size());
+	history.erase(history.begin(),
+	              history.begin() + static_cast<std::ptrdiff_t>(num_consumed));
+	read_pos -= num_consumed;
+}
@@ -0,0 +1,125 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2025  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_POLYPHASE_RESAMPLER_H
+#define DOSBOX_POLYPHASE_RESAMPLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "audio_frame.h"
+
+/*  Polyphase Windowed-Sinc Resampler
+ *  ---------------------------------
+ *  Converts stereo audio between two fixed sample rates with a
+ *  Kaiser-windowed sinc filter. The filter is precomputed for every output
+ *  phase the rate ratio can produce, so each output frame costs a single
+ *  vectorised dot product over the filter taps.
+ *
+ *  Ratios with too many distinct phases to tabulate (e.g., the OPL's
+ *  49716 Hz to 48000 Hz) use an oversampled table instead, and interpolate
+ *  linearly between its two nearest phases.
+ *
+ *  The coefficient tables only depend on the reduced rate ratio and the
+ *  quality, so channels running at the same ratio share them.
+ */
+
+// Distortion figures are THD+N of a 1 kHz sine resampled from 44100 Hz to
+// 48000 Hz
+enum class PolyphaseQuality {
+	// 32 taps, about -75 dB
+	Low,
+
+	// 64 taps, about -100 dB
+	Medium,
+
+	// 128 taps, about -120 dB
+	High
+};
+
+struct PolyphaseCoefficients {
+	// The input to output rate ratio reduced to lowest terms; every output
+	// frame advances the input by 'in_step / num_phases' frames.
+	uint32_t in_step    = 0;
+	uint32_t num_phases = 0;
+
+	// Always a multiple of four, so the dot products need no tail handling
+	int num_taps = 0;
+
+	// Set when 'table' holds 'NumOversampledPhases + 1' oversampled phases
+	// instead of one row per output phase
+	bool is_interpolated = false;
+
+	// One row of 'num_taps' coefficients per phase, with every coefficient
+	// stored twice to line up with the interleaved left and right samples
+	std::vector<float> table = {};
+
+	const float* Row(const size_t row) const
+	{
+		return table.data() + row * static_cast<size_t>(num_taps) * 2;
+	}
+};
+
+class PolyphaseResampler {
+public:
+	PolyphaseResampler(int in_rate_hz, int out_rate_hz, PolyphaseQuality quality);
+
+	// Keeps the buffered input if the filter length stays the same
+	void SetRates(int in_rate_hz, int out_rate_hz);
+
+	// Clears the buffered input and primes it with enough silence for the
+	// first output frame to line up with the first input frame
+	void Reset();
+
+	// Resamples all frames in 'in' and appends the results to 'out'. Input
+	// frames that are still needed by the filter are buffered for the next
+	// call.
+	void Process(std::span<const AudioFrame> in, std::vector<AudioFrame>& out);
+
+	PolyphaseQuality GetQuality() const
+	{
+		return quality;
+	}
+
+	// Number of input frames buffered before the first output frame
+	int GetInputLatency() const;
+
+	std::shared_ptr<const PolyphaseCoefficients> GetCoefficients() const
+	{
+		return coefficients;
+	}
+
+private:
+	PolyphaseQuality quality = PolyphaseQuality::Medium;
+
+	std::shared_ptr<const PolyphaseCoefficients> coefficients = {};
+
+	std::vector<AudioFrame> history = {};
+
+	// First input frame of the filter window for the next output frame,
+	// and its position between input frames in 1/num_phases units
+	size_t read_pos = 0;
+	uint32_t phase  = 0;
+};
+
+#endif
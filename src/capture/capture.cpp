@@ -614,6 +614,13 @@ static void capture_init(Section* sec)
 
 	image_capturer = std::make_unique<ImageCapturer>(prefs);
 
+	const std::string backpressure = secprop->Get_string(
+	        "video_capture_backpressure");
+
+	capture_video_set_backpressure(backpressure == "drop"
+	                                       ? VideoCaptureBackpressure::Drop
+	                                       : VideoCaptureBackpressure::Block);
+
 	constexpr auto changeable_at_runtime = true;
 	sec->AddDestroyFunction(&capture_destroy, changeable_at_runtime);
 }
@@ -699,6 +706,18 @@ static void init_capture_dosbox_settings(Section_prop& secprop)
 	        "Keybindings for taking single screenshots in specific formats are also\n"
 	        "available.");
 	assert(str_prop);
+
+	str_prop = secprop.Add_string("video_capture_backpressure", when_idle, "block");
+	str_prop->Set_values({"block", "drop"});
+	str_prop->Set_help(
+	        "What to do when the video encoder can't keep up with the emulated output\n"
+	        "('block' by default). Video capture frames are compressed on a separate\n"
+	        "thread, and a small number of frames can be queued up for compression.\n"
+	        "  block:  Wait until the encoder catches up; all frames are captured, but\n"
+	        "          the emulation might slow down on slower hosts.\n"
+	        "  drop:   Skip the frames that don't fit into the queue; the emulation runs\n"
+	        "          at full speed, but the video may have duplicate frames.");
+	assert(str_prop);
 }
 
 void CAPTURE_AddConfigSection(const ConfigPtr& conf)
@@ -20,13 +20,21 @@
  */
 
 #include "capture.h"
+#include "capture_video.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <thread>
 
 #include "math_utils.h"
 #include "mem.h"
 #include "render.h"
+#include "rwqueue.h"
 #include "support.h"
 
 #include "zmbv/zmbv.h"
@@ -136,7 +144,7 @@ static void add_avi_chunk(const char* tag, const uint32_t size,
 	host_writed(index + 12, size);
 }
 
-void capture_video_finalise()
+static void finalise_avi_file()
 {
 	if (!video.handle) {
 		return;
@@ -301,9 +309,9 @@ void capture_video_finalise()
 	video.handle = nullptr;
 }
 
-void capture_video_add_audio_data(const uint32_t sample_rate,
-                                  const uint32_t num_sample_frames,
-                                  const int16_t* sample_frames)
+static void buffer_audio_data(const uint32_t sample_rate,
+                              const uint32_t num_sample_frames,
+                              const int16_t* sample_frames)
 {
 	if (!video.handle) {
 		return;
@@ -321,6 +329,19 @@ void capture_video_add_audio_data(const uint32_t sample_rate,
 	video.audio.sample_rate = sample_rate;
 }
 
+// The motion search of the encoder is spread across multiple threads; leave
+// some room for the emulation and mixer threads.
+static int get_num_encoder_threads()
+{
+	constexpr auto MaxEncoderThreads = 8;
+	constexpr auto NumReservedThreads = 2;
+
+	const auto num_host_threads = static_cast<int>(
+	        std::thread::hardware_concurrency());
+
+	return std::clamp(num_host_threads - NumReservedThreads, 1, MaxEncoderThreads);
+}
+
 static void create_avi_file(const uint16_t width, const uint16_t height,
                             const PixelFormat pixel_format,
                             const float frames_per_second, ZMBV_FORMAT format)
@@ -329,7 +350,7 @@ static void create_avi_file(const uint16_t width, const uint16_t height,
 	if (!video.handle) {
 		return;
 	}
-	video.codec = new VideoCodec();
+	video.codec = new VideoCodec(get_num_encoder_threads());
 	if (!video.codec->SetupCompress(width, height)) {
 		return;
 	}
@@ -439,7 +460,37 @@ static void compress_raw_frame(const RenderedImage& image)
 	}
 }
 
-void capture_video_add_frame(const RenderedImage& image, const float frames_per_second)
+static void write_buffered_audio()
+{
+	if (video.audio.buf_frames_used) {
+		add_avi_chunk("01wb",
+		              video.audio.buf_frames_used * SampleFrameSize,
+		              video.audio.buf,
+		              0);
+
+		video.audio.bytes_written = video.audio.buf_frames_used *
+		                            SampleFrameSize;
+		video.audio.buf_frames_used = 0;
+	}
+}
+
+// Dropped frames are written as empty video chunks, which players interpret
+// as "repeat the previous frame". This keeps the video stream's timing intact
+// relative to the audio stream.
+static void write_dropped_frames(const uint32_t num_frames)
+{
+	if (!video.handle) {
+		return;
+	}
+	for (uint32_t i = 0; i < num_frames; ++i) {
+		add_avi_chunk("00dc", 0, video.buf.data(), 0x0);
+		video.frames++;
+
+		write_buffered_audio();
+	}
+}
+
+static void encode_frame(const RenderedImage& image, const float frames_per_second)
 {
 	const auto& src = image.params;
 	assert(src.width <= SCALER_MAXWIDTH);
@@ -458,7 +509,7 @@ void capture_video_add_frame(const RenderedImage& image, const float frames_per_
 	if (video.handle && (video.width != raw_width || video.height != raw_height ||
 	                     video.pixel_format != src.pixel_format ||
 	                     video.frames_per_second != frames_per_second)) {
-		capture_video_finalise();
+		finalise_avi_file();
 	}
 
 	const auto zmbv_format = to_zmbv_format(src.pixel_format);
@@ -496,14 +547,222 @@ void capture_video_add_frame(const RenderedImage& image, const float frames_per_
 
 	//		LOG_MSG("CAPTURE: Frame %d video %d audio
 	//%d",video.frames, written, video.audio_buf_frames_used *4 );
-	if (video.audio.buf_frames_used) {
-		add_avi_chunk("01wb",
-		              video.audio.buf_frames_used * SampleFrameSize,
-		              video.audio.buf,
-		              0);
+	write_buffered_audio();
+}
 
-		video.audio.bytes_written = video.audio.buf_frames_used *
-		                            SampleFrameSize;
-		video.audio.buf_frames_used = 0;
+// Video capture worker
+// ~~~~~~~~~~~~~~~~~~~~
+// Compressing and writing the frames happens on a worker thread so the
+// emulation thread only needs to snapshot the rendered image. The frame
+// buffers cycle between the emulation thread (which fills them) and the
+// worker (which returns them after compression); limiting their number bounds
+// both the memory use and how far the worker can lag behind.
+
+class FrameBufferPool {
+public:
+	// Returns a free buffer, or nothing if all buffers are in flight and
+	// we're not allowed to wait for one.
+	std::optional<std::vector<uint8_t>> Acquire(const bool wait)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		if (free_buffers.empty() && num_allocated < MaxFrameBuffers) {
+			++num_allocated;
+			return std::vector<uint8_t>{};
+		}
+		if (free_buffers.empty()) {
+			if (!wait) {
+				return {};
+			}
+			has_free_buffer.wait(lock, [&] { return !free_buffers.empty(); });
+		}
+		auto buffer = std::move(free_buffers.back());
+		free_buffers.pop_back();
+		return buffer;
+	}
+
+	void Release(std::vector<uint8_t>&& buffer)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			free_buffers.emplace_back(std::move(buffer));
+		}
+		has_free_buffer.notify_one();
+	}
+
+private:
+	static constexpr size_t MaxFrameBuffers = 8;
+
+	std::mutex mutex                        = {};
+	std::condition_variable has_free_buffer = {};
+
+	std::vector<std::vector<uint8_t>> free_buffers = {};
+	size_t num_allocated                           = 0;
+};
+
+// Room for the in-flight frames plus the audio chunks added in the meantime
+// (one per emulated millisecond).
+static constexpr auto MaxQueuedTasks = 1024;
+
+static struct {
+	RWQueue<VideoCaptureTask> fifo{MaxQueuedTasks};
+	std::thread thread   = {};
+	FrameBufferPool pool = {};
+
+	// Checked by the mixer thread when adding audio
+	std::atomic<bool> is_running = false;
+
+	VideoCaptureBackpressure backpressure = VideoCaptureBackpressure::Block;
+
+	uint32_t num_pending_dropped_frames = 0;
+	uint32_t num_total_dropped_frames   = 0;
+
+	// Incremented by the mixer thread
+	std::atomic<uint32_t> num_dropped_audio_chunks = 0;
+} worker = {};
+
+static void process_queued_tasks()
+{
+	while (auto task = worker.fifo.Dequeue()) {
+		switch (task->type) {
+		case VideoCaptureTask::Type::Frame: {
+			write_dropped_frames(task->num_dropped_frames);
+
+			const auto image_num_bytes = task->params.height * task->pitch;
+
+			RenderedImage image = {};
+			image.params        = task->params;
+			image.pitch         = task->pitch;
+			image.image_data    = task->frame_buf.data();
+			image.palette_data  = task->has_palette
+			                            ? task->frame_buf.data() + image_num_bytes
+			                            : nullptr;
+
+			encode_frame(image, task->frames_per_second);
+
+			worker.pool.Release(std::move(task->frame_buf));
+		} break;
+
+		case VideoCaptureTask::Type::Audio:
+			buffer_audio_data(task->sample_rate,
+			                  check_cast<uint32_t>(task->samples.size() /
+			                                       NumAudioChannels),
+			                  task->samples.data());
+			break;
+		}
+	}
+	finalise_avi_file();
+}
+
+static void start_worker()
+{
+	if (worker.is_running) {
+		return;
+	}
+	worker.fifo.Start();
+
+	worker.thread = std::thread(process_queued_tasks);
+	set_thread_name(worker.thread, "dosbox:vidcap");
+
+	worker.is_running = true;
+}
+
+void capture_video_set_backpressure(const VideoCaptureBackpressure backpressure)
+{
+	worker.backpressure = backpressure;
+}
+
+void capture_video_add_frame(const RenderedImage& image, const float frames_per_second)
+{
+	start_worker();
+
+	const auto can_wait = (worker.backpressure == VideoCaptureBackpressure::Block);
+
+	auto frame_buf = worker.pool.Acquire(can_wait);
+	if (!frame_buf) {
+		++worker.num_pending_dropped_frames;
+		++worker.num_total_dropped_frames;
+		return;
+	}
+
+	// Palettes are always 256 RGBA entries (see RenderedImage::deep_copy())
+	constexpr auto PaletteNumBytes = 256 * 4;
+
+	const auto image_num_bytes = static_cast<size_t>(image.params.height *
+	                                                 image.pitch);
+	const auto has_palette = (image.palette_data != nullptr);
+
+	frame_buf->resize(image_num_bytes + (has_palette ? PaletteNumBytes : 0));
+
+	assert(image.image_data);
+	std::memcpy(frame_buf->data(), image.image_data, image_num_bytes);
+	if (has_palette) {
+		std::memcpy(frame_buf->data() + image_num_bytes,
+		            image.palette_data,
+		            PaletteNumBytes);
+	}
+
+	VideoCaptureTask task   = {};
+	task.type               = VideoCaptureTask::Type::Frame;
+	task.params             = image.params;
+	task.pitch              = image.pitch;
+	task.has_palette        = has_palette;
+	task.frames_per_second  = frames_per_second;
+	task.num_dropped_frames = worker.num_pending_dropped_frames;
+	task.frame_buf          = std::move(*frame_buf);
+
+	worker.num_pending_dropped_frames = 0;
+
+	worker.fifo.Enqueue(std::move(task));
+}
+
+void capture_video_add_audio_data(const uint32_t sample_rate,
+                                  const uint32_t num_sample_frames,
+                                  const int16_t* sample_frames)
+{
+	// Audio is only recorded alongside the frames, so there's nothing to
+	// do until the first frame has started the worker
+	if (!worker.is_running) {
+		return;
+	}
+
+	VideoCaptureTask task = {};
+	task.type             = VideoCaptureTask::Type::Audio;
+	task.sample_rate      = sample_rate;
+	task.samples.assign(sample_frames,
+	                    sample_frames + num_sample_frames * NumAudioChannels);
+
+	// Never hold up the mixer thread; if the worker has fallen this far
+	// behind, drop the chunk instead
+	if (!worker.fifo.NonblockingEnqueue(std::move(task))) {
+		++worker.num_dropped_audio_chunks;
+	}
+}
+
+void capture_video_finalise()
+{
+	if (!worker.is_running) {
+		return;
+	}
+
+	// Let the worker compress the pending frames and finalise the file
+	worker.fifo.Stop();
+	if (worker.thread.joinable()) {
+		worker.thread.join();
+	}
+	worker.is_running = false;
+
+	if (worker.num_total_dropped_frames > 0) {
+		LOG_WARNING("CAPTURE: Dropped %u video frames because the encoder "
+		            "couldn't keep up",
+		            worker.num_total_dropped_frames);
+	}
+	if (worker.num_dropped_audio_chunks > 0) {
+		LOG_WARNING("CAPTURE: Dropped %u audio chunks because the encoder "
+		            "couldn't keep up",
+		            worker.num_dropped_audio_chunks.load());
 	}
+	worker.num_pending_dropped_frames = 0;
+	worker.num_total_dropped_frames   = 0;
+	worker.num_dropped_audio_chunks   = 0;
 }
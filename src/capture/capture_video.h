@@ -22,8 +22,46 @@
 #ifndef DOSBOX_CAPTURE_VIDEO_H
 #define DOSBOX_CAPTURE_VIDEO_H
 
+#include <cstdint>
+#include <vector>
+
 #include "render.h"
 
+// What to do when the video capture worker can't keep up with the emulated
+// output and all pooled frame buffers are in flight.
+enum class VideoCaptureBackpressure {
+	// Wait on the emulation thread until a frame buffer is freed up; every
+	// frame is captured.
+	Block,
+	// Drop the frame; it's written as an empty "repeat the previous frame"
+	// chunk so the audio and video streams stay in sync.
+	Drop
+};
+
+// A unit of work for the video capture worker thread. Frames are snapshotted
+// into pooled buffers on the emulation thread, then compressed and muxed
+// together with the audio chunks on the worker in submission order.
+struct VideoCaptureTask {
+	enum class Type { Frame, Audio } type = Type::Frame;
+
+	// Frame data: the image rows followed by the palette
+	ImageInfo params        = {};
+	uint16_t pitch          = 0;
+	bool has_palette        = false;
+	float frames_per_second = 0.0f;
+
+	// Number of frames dropped directly before this one
+	uint32_t num_dropped_frames = 0;
+
+	std::vector<uint8_t> frame_buf = {};
+
+	// Audio data: interleaved 16-bit stereo sample frames
+	uint32_t sample_rate         = 0;
+	std::vector<int16_t> samples = {};
+};
+
+void capture_video_set_backpressure(const VideoCaptureBackpressure backpressure);
+
 void capture_video_add_frame(const RenderedImage& image,
                              const float frames_per_second);
 
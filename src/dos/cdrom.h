@@ -24,6 +24,7 @@
 
 #include "dosbox.h"
 
+#include <atomic>
 #include <cstring>
 #include <fstream>
 #include <iostream>
@@ -31,6 +32,7 @@
 #include <memory>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "support.h"
@@ -329,6 +331,11 @@ public:
 	}
 
 private:
+	// Tracks are decoded ahead of playback on a dedicated thread, so the
+	// mixer callback only copies already decoded frames out of the queue.
+	// The decoder runs on into the next track once the current one ends.
+	// The mutex guards the playback state; the decoder releases it while
+	// seeking and decoding.
 	static struct imagePlayer {
 		// Objects, pointers, and then scalars; in descending size-order.
 		std::mutex mutex                   = {};
@@ -336,25 +343,40 @@ private:
 		MixerChannelPtr channel            = nullptr;
 		CDROM_Interface_Image* cd          = nullptr;
 
-		void (MixerChannel::*addFrames)(int, const int16_t*) = nullptr;
-
-		uint32_t playedTrackFrames  = 0;
-		uint32_t totalTrackFrames   = 0;
-		uint32_t startSector        = 0;
-		bool isPlaying              = false;
-		bool isPaused               = false;
-
-		// TODO `MixerBufferByteSize` is hardcoded to 1024 * 16 bytes,
-		// so this buffer has been 32k long for a while now. There's
-		// potential for buffer overflows, though; the code that writes
-		// to the buffer asserts the max length of the writes, but
-		// allows lengths far greater than the 32k limit. So it kinda
-		// works, but by fluke.
-		//
-		// Probably the safest way going forward is to turn this into a
-		// `std::vector` and size it as needed at runtime.
-		//
-		int16_t buffer[MixerBufferByteSize * 2] = {};
+		// Decoded frames waiting to be played by the mixer callback
+		RWQueue<AudioFrame> frames{REDBOOK_PCM_FRAMES_PER_SECOND / 2};
+
+		std::thread decoder                    = {};
+		std::condition_variable decoder_wakeup = {};
+
+		// Decoder-side scratch buffers, reused between chunks
+		std::vector<int16_t> decode_buffer     = {};
+		std::vector<AudioFrame> decoded_frames = {};
+
+		// Mixer-side scratch buffer
+		std::vector<AudioFrame> callback_frames = {};
+
+		std::atomic<uint32_t> playedTrackFrames = 0;
+		uint32_t decodedTrackFrames             = 0;
+		uint32_t totalTrackFrames               = 0;
+		uint32_t startSector                    = 0;
+
+		// Byte offset the decoder seeks to before decoding the track
+		uint32_t seekOffset = 0;
+
+		// Bumped whenever playback is restarted or the CD is removed, so
+		// the decoder can discard work started for an earlier request
+		uint32_t playbackId = 0;
+
+		// Rate of the next track, applied by the mixer callback once the
+		// previous track's frames have played out
+		std::atomic<int> pendingSampleRate = 0;
+
+		std::atomic<bool> isPlaying = false;
+		std::atomic<bool> isPaused  = false;
+		std::atomic<bool> isDecoding = false;
+		bool needsSeek              = false;
+		bool decoderShouldExit      = false;
 	} player;
 
 	// Private utility functions
@@ -364,8 +386,11 @@ private:
 	                 const bool mode2);
 	std::vector<Track>::iterator GetTrack(const uint32_t sector);
 	void CDAudioCallback(const int desired_track_frames);
-	void PlayNextAudioTrack();
+	static void DecoderLoop();
+	static bool DecodeNextChunk(std::unique_lock<std::mutex>& lock);
+	bool AdvanceToNextAudioTrack(std::unique_lock<std::mutex>& lock);
 	bool PlayAudioTrack(const Track& track, const uint32_t sector_offset);
+	void StopPlayback();
 
 	// Private functions for cue sheet processing
 	bool  LoadCueSheet(const char *cuefile);
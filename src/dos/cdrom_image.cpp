@@ -23,6 +23,7 @@
 
 #include "cdrom.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cctype>
 #include <chrono>
@@ -33,6 +34,7 @@
 #include <iterator>
 #include <limits>
 #include <sstream>
+#include <utility>
 #include <vector>
 
 #if !defined(WIN32)
@@ -41,13 +43,19 @@
 #include <cstring>
 #endif
 
+#include "byteorder.h"
 #include "channel_names.h"
+#include "cross.h"
+#include "decoders/mp3_seek_table.h"
 #include "drives.h"
 #include "fs_utils.h"
 #include "math_utils.h"
 #include "setup.h"
 #include "string_utils.h"
 
+// Subdirectory of the config directory holding cached MP3 seek tables
+constexpr auto Mp3SeekTableCacheDir = "mp3-seek-tables";
+
 // String maximums, local to this file
 #define MAX_LINE_LENGTH 512
 #define MAX_FILENAME_LENGTH 256
@@ -60,6 +68,10 @@ using tracks_size_t    = std::vector<CDROM_Interface_Image::Track>::size_type;
 // Ensure the maximum allowed redbook bytes stays within the API type sizes
 static_assert(MAX_REDBOOK_BYTES <= UINT32_MAX);
 
+// Number of track frames the decoder thread decodes per iteration (~46 ms at
+// 44.1 kHz); small enough to get the first frames to the mixer quickly.
+constexpr uint32_t DecodeChunkFrames = 2048;
+
 // Report bad seeks that would go beyond the end of the track
 bool CDROM_Interface_Image::TrackFile::offsetInsideTrack(const uint32_t offset)
 {
@@ -501,6 +513,10 @@ CDROM_Interface_Image::CDROM_Interface_Image()
 			player.channel->Enable(false); // only enabled during playback periods
 			MIXER_UnlockMixerThread();
 		}
+		if (!player.decoder.joinable()) {
+			player.decoderShouldExit = false;
+			player.decoder = std::thread(&CDROM_Interface_Image::DecoderLoop);
+		}
 #ifdef DEBUG
 		LOG_MSG("CDROM: Initialised the %s audio channel", ChannelName::CdAudio);
 #endif
@@ -510,6 +526,17 @@ CDROM_Interface_Image::CDROM_Interface_Image()
 
 CDROM_Interface_Image::~CDROM_Interface_Image()
 {
+	// The decoder thread is shared by all images, so it's stopped along
+	// with the last one
+	if (refCount == 1 && player.decoder.joinable()) {
+		{
+			std::lock_guard lock(player.mutex);
+			player.decoderShouldExit = true;
+		}
+		player.decoder_wakeup.notify_all();
+		player.decoder.join();
+	}
+
 	MIXER_LockMixerThread();
 	refCount--;
 
@@ -524,7 +551,10 @@ CDROM_Interface_Image::~CDROM_Interface_Image()
 		player.channel.reset();
 	}
 	if (player.cd == this) {
+		// Prevent the decoder from advancing into our tracks
+		std::lock_guard lock(player.mutex);
 		player.cd = nullptr;
+		++player.playbackId;
 	}
 	MIXER_UnlockMixerThread();
 }
@@ -638,7 +668,7 @@ bool CDROM_Interface_Image::GetAudioSub(unsigned char& attr,
 		if (track_file) {
 			LagDriveResponse();
 			const uint32_t sample_rate = track_file->getRate();
-			const uint32_t played_frames = ceil_udivide(player.playedTrackFrames
+			const uint32_t played_frames = ceil_udivide(player.playedTrackFrames.load()
 			                               * REDBOOK_FRAMES_PER_SECOND, sample_rate);
 			absolute_sector = player.startSector + played_frames;
 			track_iter current_track = GetTrack(absolute_sector);
@@ -706,48 +736,35 @@ bool CDROM_Interface_Image::PlayAudioTrack(const Track& track, const uint32_t se
 {
 	const auto track_file = track.file;
 	if (!track_file || track.attr == 0x40 || !player.channel) {
-		StopAudio();
+		StopPlayback();
 		return false;
 	}
 
-	const auto byte_offset = track.skip + sector_offset * track.sectorSize;
+	// Discard anything decoded for the previous playback request
+	player.frames.Stop();
+	player.frames.Clear();
+	player.frames.Start();
 
-	// Guard: Bail if our track could not be seeked
-	if (!track_file->seek(byte_offset)) {
-		LOG_MSG("CDROM: Track %d failed to seek to byte %u, so cancelling playback",
-		        track.number, byte_offset);
-		StopAudio();
-		return false;
-	}
-
-	// We're performing an audio-task, so update the audio position
-	track_file->setAudioPosition(byte_offset);
-
-	// Get properties about the current track
-	const uint8_t track_channels = track_file->getChannels();
-	const uint32_t track_rate = track_file->getRate();
+	// Seeking can take tens of milliseconds with some codecs, so it's left
+	// to the decoder thread
+	player.seekOffset = track.skip + sector_offset * track.sectorSize;
+	player.needsSeek  = true;
 
 	// Update our player with properties about this playback sequence
+	++player.playbackId;
+	player.pendingSampleRate = 0;
 	player.cd = this;
 	player.trackFile = track_file;
+	player.decodedTrackFrames = 0;
 	player.isPlaying = true;
 	player.isPaused = false;
+	player.isDecoding = true;
 	currentTrackIndex = track.number - 1;
 
-	// Assign the mixer function associated with this track's content type
-	if (track_file->getEndian() == AUDIO_S16SYS) {
-		player.addFrames = (track_channels == 2)
-		                         ? &MixerChannel::AddSamples_s16
-		                         : &MixerChannel::AddSamples_m16;
-	} else {
-		player.addFrames = (track_channels == 2)
-		                         ? &MixerChannel::AddSamples_s16_nonnative
-		                         : &MixerChannel::AddSamples_m16_nonnative;
-	}
-
 	// start the channel!
-	player.channel->SetSampleRate(track_rate);
+	player.channel->SetSampleRate(check_cast<int>(track_file->getRate()));
 	player.channel->Enable(true);
+	player.decoder_wakeup.notify_one();
 	return true;
 }
 
@@ -760,7 +777,7 @@ bool CDROM_Interface_Image::PlayAudioSector(uint32_t start, uint32_t len)
 
 	// Guard: sanity check the request beyond what GetTrack already checks
 	if (len == 0 || track == tracks.end()) {
-		StopAudio();
+		StopPlayback();
 #ifdef DEBUG
 		LOG_MSG("CDROM: PlayAudioSector => sanity check failed");
 #endif
@@ -836,17 +853,30 @@ bool CDROM_Interface_Image::PauseAudio(bool resume)
 
 bool CDROM_Interface_Image::StopAudio(void)
 {
-	player.isPlaying = false;
-	player.isPaused = false;
-	if (player.channel) {
-		player.channel->Enable(false);
-	}
+	std::lock_guard lock(player.mutex);
+	StopPlayback();
 #ifdef DEBUG
 	LOG_MSG("CDROM: StopAudio => stopped playback and halted the mixer");
 #endif
 	return true;
 }
 
+// Must be called with the player's mutex held
+void CDROM_Interface_Image::StopPlayback()
+{
+	player.isPlaying  = false;
+	player.isPaused   = false;
+	player.isDecoding = false;
+
+	// Have the decoder discard the chunk it might be working on
+	++player.playbackId;
+	player.frames.Clear();
+
+	if (player.channel) {
+		player.channel->Enable(false);
+	}
+}
+
 void CDROM_Interface_Image::ChannelControl(TCtrl ctrl)
 {
 	// Guard: Bail if our mixer channel hasn't been allocated
@@ -1006,6 +1036,23 @@ bool CDROM_Interface_Image::ReadSector(uint8_t *buffer, const bool raw, const ui
 bool CDROM_Interface_Image::ReadSectorsHost(void *buffer, bool raw, unsigned long sector, unsigned long num)
 {
 	unsigned int sectorSize = raw ? BYTES_PER_RAW_REDBOOK_FRAME : BYTES_PER_COOKED_REDBOOK_FRAME;
+
+	// Cooked sectors of a plain 2048-byte data track are stored back to
+	// back, so read them with a single request if they're in one track
+	if (!raw && num > 1) {
+		track_const_iter track = GetTrack(sector);
+		if (track != tracks.end() && track->file &&
+		    track->sectorSize == BYTES_PER_COOKED_REDBOOK_FRAME &&
+		    !track->mode2 && sector >= track->start &&
+		    sector + num <= track->start + track->length) {
+			const uint32_t offset = track->skip +
+			                        (sector - track->start) * track->sectorSize;
+			return track->file->read(static_cast<uint8_t*>(buffer),
+			                         offset,
+			                         static_cast<uint32_t>(num * sectorSize));
+		}
+	}
+
 	bool success = true; //Gobliiins reads 0 sectors
 	for(unsigned long i = 0; i < num; i++) {
 		success = ReadSector((uint8_t*)buffer + (i * (Bitu)sectorSize), raw, sector + i);
@@ -1015,69 +1062,233 @@ bool CDROM_Interface_Image::ReadSectorsHost(void *buffer, bool raw, unsigned lon
 	return success;
 }
 
-void CDROM_Interface_Image::PlayNextAudioTrack()
+bool CDROM_Interface_Image::AdvanceToNextAudioTrack(std::unique_lock<std::mutex>& lock)
 {
+	assert(lock.owns_lock());
+
 	const auto next_track_index = currentTrackIndex + 1;
 	if (next_track_index >= tracks.size()) {
-		StopAudio();
-		return;
+		return false;
 	}
 
-	const auto &next_track = tracks[next_track_index];
+	const auto& next_track = tracks[next_track_index];
 	assert(next_track.number == next_track_index + 1);
 
-	PlayAudioTrack(next_track, 0);
+	const auto track_file = next_track.file;
+	if (!track_file || next_track.attr == 0x40) {
+		return false;
+	}
+
+	// This CD can be removed while we're unlocked, so take copies
+	const auto track_number = next_track.number;
+	const auto skip         = next_track.skip;
+	const auto playback_id  = player.playbackId;
+
+	lock.unlock();
+	const auto is_seeked = track_file->seek(skip);
+	if (is_seeked) {
+		// We're performing an audio-task, so update the audio position
+		track_file->setAudioPosition(skip);
+	}
+	lock.lock();
+
+	// Playback was restarted or the CD removed meanwhile, so leave the
+	// player to the new request
+	if (player.playbackId != playback_id) {
+		return true;
+	}
+
+	if (!is_seeked) {
+		LOG_MSG("CDROM: Track %d failed to seek to byte %u, so cancelling playback",
+		        track_number,
+		        skip);
+		return false;
+	}
+
+	// The channel can only run at one rate, so the mixer callback switches
+	// it once the previous track's frames have played out. Decoding is
+	// held off until then.
+	const auto next_rate = check_cast<int>(track_file->getRate());
+	if (player.channel && player.channel->GetSampleRate() != next_rate) {
+		player.pendingSampleRate = next_rate;
+	}
+
+	player.trackFile  = track_file;
+	currentTrackIndex = next_track_index;
+	return true;
 }
 
-void CDROM_Interface_Image::CDAudioCallback(const int desired_track_frames)
+void CDROM_Interface_Image::DecoderLoop()
 {
-	/**
-	 *  This callback runs in SDL's mixer thread, so there's a risk
-	 *  our track_file pointer could be removed by the main thread.
-	 *  We reserve the track_file up-front for the scope of this call.
-	 */
-	std::lock_guard lock(player.mutex);
-	std::shared_ptr<TrackFile> track_file = player.trackFile.lock();
+	std::unique_lock lock(player.mutex);
 
-	// Guards: Bail if the request or our player is invalid
-	if (desired_track_frames == 0 || !player.cd || !track_file) {
-#ifdef DEBUG
-		LOG_MSG("CDROM: CDAudioCallback called with one more empty dependencies:\n"
-		        "\t - frames to play (%" PRIuPTR ")\n"
-		        "\t - pointer to the CD object (%p)\n"
-		        "\t - pointer to the track's file (%p)\n",
-		        desired_track_frames, static_cast<void *>(player.cd),
-		        static_cast<void *>(track_file.get()));
-#endif
-		if (player.cd)
-			player.cd->StopAudio();
-		return;
+	while (!player.decoderShouldExit) {
+		const auto has_room = player.frames.Size() + DecodeChunkFrames <=
+		                      player.frames.MaxCapacity();
+
+		if (!player.isDecoding || !has_room || player.pendingSampleRate) {
+			// Woken up when playback starts or the mixer callback has
+			// consumed frames; the timeout covers missed notifications
+			player.decoder_wakeup.wait_for(lock, std::chrono::milliseconds(10));
+			continue;
+		}
+		if (!DecodeNextChunk(lock)) {
+			player.isDecoding = false;
+		}
+	}
+}
+
+bool CDROM_Interface_Image::DecodeNextChunk(std::unique_lock<std::mutex>& lock)
+{
+	assert(lock.owns_lock());
+
+	// Reserve the track file for the scope of this call in case the main
+	// thread switches tracks
+	const auto track_file = player.trackFile.lock();
+	if (!player.cd || !track_file) {
+		return false;
+	}
+
+	assert(player.totalTrackFrames >= player.decodedTrackFrames);
+	const auto frames_remaining = player.totalTrackFrames -
+	                              player.decodedTrackFrames;
+	if (frames_remaining == 0) {
+		return false;
+	}
+	const auto num_frames   = std::min(DecodeChunkFrames, frames_remaining);
+	const auto num_channels = track_file->getChannels();
+
+	const auto playback_id = player.playbackId;
+	const auto seek_offset = player.seekOffset;
+	const auto needs_seek  = std::exchange(player.needsSeek, false);
+
+	// Seeking and decoding can be slow, so release the lock meanwhile to
+	// not hold up the emulation thread. Only this thread touches the
+	// decode buffers.
+	lock.unlock();
+
+	auto is_seeked = true;
+	if (needs_seek) {
+		is_seeked = track_file->seek(seek_offset);
+		if (is_seeked) {
+			// We're performing an audio-task, so update the audio position
+			track_file->setAudioPosition(seek_offset);
+		}
 	}
 
-	const auto decoded_track_frames = check_cast<uint16_t>(
-	        track_file->decode(player.buffer, desired_track_frames));
+	auto& buffer = player.decode_buffer;
+	auto& frames = player.decoded_frames;
+	frames.clear();
+
+	uint32_t num_decoded = 0;
+	if (is_seeked) {
+		buffer.resize(num_frames *
+		              std::max<size_t>(num_channels, REDBOOK_CHANNELS));
+		num_decoded = track_file->decode(buffer.data(), num_frames);
+		assert(num_decoded <= num_frames);
+	}
+
+	// Convert to the mixer's frame format here so the mixer callback only
+	// has to copy
+	const bool is_native = (track_file->getEndian() == AUDIO_S16SYS);
+	auto to_native = [is_native](const int16_t sample) {
+		return is_native ? sample
+		                 : static_cast<int16_t>(
+		                           bswap_u16(static_cast<uint16_t>(sample)));
+	};
+
+	for (uint32_t i = 0; i < num_decoded; ++i) {
+		if (num_channels == 1) {
+			frames.emplace_back(to_native(buffer[i]));
+		} else {
+			frames.emplace_back(to_native(buffer[i * num_channels]),
+			                    to_native(buffer[i * num_channels + 1]));
+		}
+	}
 
-	if (!decoded_track_frames) {
+	lock.lock();
+
+	// Discard the chunk if playback was restarted meanwhile
+	if (player.playbackId != playback_id) {
+		return true;
+	}
+
+	if (!is_seeked) {
+		LOG_MSG("CDROM: Failed to seek to byte %u, so cancelling playback",
+		        seek_offset);
+		return false;
+	}
+
+	if (num_decoded == 0) {
 		// This particular CDDA track has come to an end, but the
 		// program has requested we continue playing for a longer
 		// period. So keep going!
-		player.cd->PlayNextAudioTrack();
+		return player.cd->AdvanceToNextAudioTrack(lock);
+	}
+
+	// We only decode when the queue has room for the whole chunk
+	player.frames.NonblockingBulkEnqueue(frames);
+	player.decodedTrackFrames += num_decoded;
+
+	return player.decodedTrackFrames < player.totalTrackFrames;
+}
+
+void CDROM_Interface_Image::CDAudioCallback(const int desired_track_frames)
+{
+	/**
+	 *  This callback runs in SDL's mixer thread. Tracks are decoded ahead
+	 *  of time by the decoder thread, so we only copy the decoded frames
+	 *  and never wait on codecs or seeks.
+	 */
+	if (desired_track_frames <= 0) {
 		return;
 	}
+	const auto num_desired = static_cast<size_t>(desired_track_frames);
 
-	// Use the stereo or mono and native or nonnative AddSamples call
-	// assigned during construction
-	(player.channel.get()->*player.addFrames)(decoded_track_frames, player.buffer);
+	auto& frames = player.callback_frames;
+	const auto num_played = player.frames.NonblockingBulkDequeue(frames,
+	                                                             num_desired);
+	if (num_played > 0) {
+		player.decoder_wakeup.notify_one();
+	}
+
+	if (num_played == 0 && player.pendingSampleRate) {
+		// The previous track has played out, so switch to the next
+		// track's rate. The lock keeps a concurrent playback request
+		// from being switched to a stale rate; if it's busy, we retry
+		// on the next callback rather than wait.
+		std::unique_lock lock(player.mutex, std::try_to_lock);
+		if (lock.owns_lock()) {
+			if (const auto rate = player.pendingSampleRate.exchange(0); rate) {
+				player.channel->SetSampleRate(rate);
+			}
+			player.decoder_wakeup.notify_one();
+		}
+	}
 
-	player.playedTrackFrames += decoded_track_frames;
-	if (player.playedTrackFrames >= player.totalTrackFrames) {
+	if (num_played == 0 && !player.isDecoding) {
+		// The main thread might be restarting playback right now, so
+		// we only stop under the lock and after checking again that
+		// nothing is left to play. If the lock is busy, we check again
+		// on the next callback.
+		std::unique_lock lock(player.mutex, std::try_to_lock);
+		if (lock.owns_lock() && !player.isDecoding &&
+		    player.frames.Size() == 0) {
 #ifdef DEBUG
-		LOG_MSG("CDROM: CDAudioCallback stopping because "
-		"playedTrackFrames (%u) >= totalTrackFrames (%u)",
-		player.playedTrackFrames, player.totalTrackFrames);
+			LOG_MSG("CDROM: CDAudioCallback stopping because all "
+			        "%u requested track frames have been played",
+			        player.totalTrackFrames);
 #endif
-		player.cd->StopAudio();
+			StopPlayback();
+			return;
+		}
 	}
+
+	// Fill any underrun with silence, the decoder will catch up
+	frames.resize(num_desired);
+	player.channel->AddSamples_sfloat(desired_track_frames, &frames[0][0]);
+
+	player.playedTrackFrames += check_cast<uint32_t>(num_played);
 }
 
 bool CDROM_Interface_Image::LoadIsoFile(const char* filename)
@@ -1485,4 +1696,7 @@ void CDROM_Image_Init(Section* sec)
 		sec->AddDestroyFunction(CDROM_Image_Destroy);
 	}
 	Sound_Init();
+
+	// Seek tables of MP3 tracks are cached so later mounts are instant
+	set_mp3_seek_table_cache_dir(GetConfigDir() / Mp3SeekTableCacheDir);
 }
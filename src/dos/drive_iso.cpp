@@ -18,10 +18,12 @@
 
 #include "drives.h"
 
+#include <algorithm>
 #include <cctype>
 #include <cstring>
 
 #include "cdrom.h"
+#include "control.h"
 #include "dos_mscdex.h"
 #include "dos_system.h"
 #include "string_utils.h"
@@ -44,12 +46,16 @@ public:
 	bool IsOnReadOnlyMedium() const override;
 
 private:
+	bool ReadSector(uint8_t** buffer, const uint32_t sector);
+
 	std::shared_ptr<isoDrive> drive = nullptr;
-	int cachedSector = -1;
 	uint32_t fileBegin = 0;
 	uint32_t filePos = 0;
 	uint32_t fileEnd = 0;
-	uint8_t buffer[ISO_FRAMESIZE] = {{}};
+
+	// Sequential reads are detected by the previously read sector, and
+	// trigger a read-ahead of the following sectors into the drive's cache
+	int lastSector = -1;
 };
 
 isoFile::isoFile(std::shared_ptr<isoDrive> iso_drive, const char *name, FileStat_Block *stat, uint32_t offset)
@@ -67,6 +73,27 @@ isoFile::isoFile(std::shared_ptr<isoDrive> iso_drive, const char *name, FileStat
 	attr = static_cast<uint8_t>(stat->attr);
 }
 
+bool isoFile::ReadSector(uint8_t** buffer, const uint32_t sector)
+{
+	// Only read ahead when the file is being read sequentially, and never
+	// past the file's last sector
+	uint32_t num_read_ahead = 0;
+	if (static_cast<int>(sector) == lastSector + 1 && fileEnd > 0) {
+		const uint32_t last_file_sector = (fileEnd - 1) / ISO_FRAMESIZE;
+		if (last_file_sector > sector) {
+			num_read_ahead = std::min(last_file_sector - sector,
+			                          IsoMaxReadAheadSectors);
+		}
+	}
+
+	if (!drive->ReadCachedSector(buffer, sector, num_read_ahead)) {
+		lastSector = -1;
+		return false;
+	}
+	lastSector = static_cast<int>(sector);
+	return true;
+}
+
 bool isoFile::Read(uint8_t *data, uint16_t *size) {
 	if (filePos + *size > fileEnd)
 		*size = (uint16_t)(fileEnd - filePos);
@@ -74,35 +101,22 @@ bool isoFile::Read(uint8_t *data, uint16_t *size) {
 	uint16_t nowSize = 0;
 	uint32_t sector = filePos / ISO_FRAMESIZE;
 
-	if (static_cast<int>(sector) != cachedSector) {
-		if (drive->readSector(buffer, sector)) {
-			cachedSector = static_cast<int>(sector);
-		} else {
-			*size = 0;
-			cachedSector = -1;
-		}
-	}
-
 	static_assert(ISO_FRAMESIZE <= UINT16_MAX, "");
 	auto sectorPos = static_cast<uint16_t>(filePos % ISO_FRAMESIZE);
 
+	uint8_t* buffer = nullptr;
 	while (nowSize < *size) {
-		uint16_t remSector = ISO_FRAMESIZE - sectorPos;
-		uint16_t remSize = *size - nowSize;
-		if(remSector < remSize) {
-			memcpy(&data[nowSize], &buffer[sectorPos], remSector);
-			nowSize += remSector;
-			sectorPos = 0;
-			sector++;
-			cachedSector++;
-			if (!drive->readSector(buffer, sector)) {
-				*size = nowSize;
-				cachedSector = -1;
-			}
-		} else {
-			memcpy(&data[nowSize], &buffer[sectorPos], remSize);
-			nowSize += remSize;
+		if (!ReadSector(&buffer, sector)) {
+			break;
 		}
+		const uint16_t remSector = ISO_FRAMESIZE - sectorPos;
+		const uint16_t remSize   = *size - nowSize;
+		const uint16_t chunkSize = std::min(remSector, remSize);
+
+		memcpy(&data[nowSize], &buffer[sectorPos], chunkSize);
+		nowSize += chunkSize;
+		sectorPos = 0;
+		sector++;
 	}
 	*size = nowSize;
 	filePos += *size;
@@ -148,6 +162,7 @@ bool isoFile::IsOnReadOnlyMedium() const
 
 isoDrive::isoDrive(char driveLetter, const char *fileName, uint8_t mediaid, int &error)
         : nextFreeDirIterator(0),
+          sectorCache(IsoDefaultSectorCacheSize),
           iso(false),
           dataCD(false),
           rootEntry{},
@@ -158,9 +173,16 @@ isoDrive::isoDrive(char driveLetter, const char *fileName, uint8_t mediaid, int
 	this->fileName[0]  = '\0';
 	this->discLabel[0] = '\0';
 	memset(dirIterators, 0, sizeof(dirIterators));
-	memset(sectorHashEntries, 0, sizeof(sectorHashEntries));
 	memset(&rootEntry, 0, sizeof(isoDirEntry));
 
+	const auto section = control ? static_cast<Section_prop*>(
+	                                       control->GetSection("dos"))
+	                             : nullptr;
+	if (section) {
+		sectorCache.Resize(static_cast<size_t>(
+		        section->Get_int("cdrom_sector_cache")));
+	}
+
 	safe_strcpy(this->fileName, fileName);
 	type  = DosDriveType::Iso;
 	error = UpdateMscdex(driveLetter, fileName, subUnit);
@@ -185,7 +207,13 @@ isoDrive::isoDrive(char driveLetter, const char *fileName, uint8_t mediaid, int
 	}
 }
 
-isoDrive::~isoDrive() { }
+isoDrive::~isoDrive()
+{
+	LOG_DEBUG("DRIVE: Sector cache of %s had %llu hits and %llu misses",
+	          fileName,
+	          static_cast<unsigned long long>(sectorCache.GetHits()),
+	          static_cast<unsigned long long>(sectorCache.GetMisses()));
+}
 
 int isoDrive::UpdateMscdex(char drive_letter, const char *path, uint8_t &sub_unit)
 {
@@ -426,8 +454,19 @@ bool isoDrive::GetNextDirEntry(const int dirIteratorHandle, isoDirEntry* de) {
 	uint8_t* buffer = nullptr;
 	DirIterator& dirIterator = dirIterators[dirIteratorHandle];
 
+	// Directories are walked sector by sector, so read ahead up to the
+	// directory's last sector
+	auto read_ahead = [&dirIterator]() -> uint32_t {
+		if (dirIterator.endSector <= dirIterator.currentSector) {
+			return 0;
+		}
+		return std::min(dirIterator.endSector - dirIterator.currentSector,
+		                IsoMaxReadAheadSectors);
+	};
+
 	// check if the directory entry is valid
-	if (dirIterator.valid && ReadCachedSector(&buffer, dirIterator.currentSector)) {
+	if (dirIterator.valid &&
+	    ReadCachedSector(&buffer, dirIterator.currentSector, read_ahead())) {
 		// check if the next sector has to be read
 		if ((dirIterator.pos >= ISO_FRAMESIZE)
 		 || (buffer[dirIterator.pos] == 0)
@@ -437,7 +476,9 @@ bool isoDrive::GetNextDirEntry(const int dirIteratorHandle, isoDirEntry* de) {
 		 	if (dirIterator.currentSector < dirIterator.endSector) {
 			 	dirIterator.pos = 0;
 			 	dirIterator.currentSector++;
-			 	if (!ReadCachedSector(&buffer, dirIterator.currentSector)) {
+			 	if (!ReadCachedSector(&buffer,
+			 	                      dirIterator.currentSector,
+			 	                      read_ahead())) {
 			 		return false;
 			 	}
 		 	} else {
@@ -468,24 +509,96 @@ void isoDrive::FreeDirIterator(const int dirIterator) {
 	}
 }
 
-bool isoDrive::ReadCachedSector(uint8_t** buffer, const uint32_t sector) {
-	// get hash table entry
-	int pos = sector % ISO_MAX_HASH_TABLE_SIZE;
-	SectorHashEntry& he = sectorHashEntries[pos];
+bool isoDrive::ReadCachedSector(uint8_t** buffer, const uint32_t sector,
+                                const uint32_t num_read_ahead)
+{
+	if (auto data = sectorCache.Find(sector); data) {
+		*buffer = data;
+		return true;
+	}
+
+	// Don't let the read-ahead evict more than half of the cache
+	const auto max_read_ahead = static_cast<uint32_t>(
+	        sectorCache.GetCapacity() / 2);
+	uint32_t num_sectors = 1 + std::min(num_read_ahead, max_read_ahead);
+
+	sectorFillBuffer.resize(num_sectors * ISO_FRAMESIZE);
+	auto& cdrom = CDROM::cdroms[subUnit];
 
-	// check if the entry is valid and contains the correct sector
-	if (!he.valid || he.sector != sector) {
-		if (!CDROM::cdroms[subUnit]->ReadSector(he.data, false, sector)) {
+	// Fill the requested sector and its read-ahead with a single request,
+	// falling back to only the requested sector if that fails (e.g., the
+	// read-ahead crosses into a track we can't read)
+	if (num_sectors == 1 ||
+	    !cdrom->ReadSectorsHost(sectorFillBuffer.data(), false, sector, num_sectors)) {
+		if (!cdrom->ReadSector(sectorFillBuffer.data(), false, sector)) {
 			return false;
 		}
-		he.valid = true;
-		he.sector = sector;
+		num_sectors = 1;
 	}
 
-	*buffer = he.data;
+	// Insert the requested sector last so it's the most-recently used
+	for (auto i = num_sectors; i-- > 0;) {
+		*buffer = sectorCache.Insert(sector + i,
+		                             &sectorFillBuffer[i * ISO_FRAMESIZE]);
+	}
+	assert(*buffer);
 	return true;
 }
 
+IsoSectorCache::IsoSectorCache(const size_t num_sectors)
+{
+	Resize(num_sectors);
+}
+
+uint8_t* IsoSectorCache::Find(const uint32_t sector)
+{
+	const auto it = index.find(sector);
+	if (it == index.end()) {
+		++misses;
+		return nullptr;
+	}
+	++hits;
+
+	// Move the entry to the front without reallocating it
+	entries.splice(entries.begin(), entries, it->second);
+	return it->second->data.data();
+}
+
+uint8_t* IsoSectorCache::Insert(const uint32_t sector, const uint8_t* data)
+{
+	assert(data);
+	assert(capacity > 0);
+
+	if (const auto it = index.find(sector); it != index.end()) {
+		entries.splice(entries.begin(), entries, it->second);
+	} else if (entries.size() < capacity) {
+		entries.emplace_front();
+		index[sector] = entries.begin();
+	} else {
+		// Recycle the least-recently used entry
+		index.erase(entries.back().sector);
+		entries.splice(entries.begin(), entries, std::prev(entries.end()));
+		index[sector] = entries.begin();
+	}
+
+	auto& entry  = entries.front();
+	entry.sector = sector;
+	memcpy(entry.data.data(), data, ISO_FRAMESIZE);
+	return entry.data.data();
+}
+
+void IsoSectorCache::Resize(const size_t num_sectors)
+{
+	assert(num_sectors > 0);
+	capacity = num_sectors;
+
+	while (entries.size() > capacity) {
+		index.erase(entries.back().sector);
+		entries.pop_back();
+	}
+	index.reserve(capacity);
+}
+
 inline bool isoDrive::readSector(uint8_t *buffer, uint32_t sector) {
 	return CDROM::cdroms[subUnit]->ReadSector(buffer, false, sector);
 }
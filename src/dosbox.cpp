@@ -779,6 +779,14 @@ void DOSBOX_Init()
 	        "Currently, you need to disable this for a few games, otherwise they will crash\n"
 	        "at startup (e.g., Deus, Ishar 3, Robinson's Requiem, Time Warriors).");
 
+	pbool = secprop->Add_bool("vga_render_whole_frames", only_at_start, false);
+	pbool->Set_help(
+	        "Draw each frame in one go at the end of the active display instead of line by\n"
+	        "line ('off' by default). Frames in which the program changes the palette,\n"
+	        "the line offset, the EGA panning, or blanks the screen mid-frame are drawn\n"
+	        "line by line from that point. Only takes effect with 'vga_render_per_scanline'\n"
+	        "enabled on EGA and VGA machines.");
+
 	pbool = secprop->Add_bool("speed_mods", only_at_start, true);
 	pbool->Set_help(
 	        "Permit changes known to improve performance ('on' by default).\n"
@@ -1152,7 +1160,7 @@ void DOSBOX_Init()
 	        "  - for 'mouse':      model (optional; overrides the 'com_mouse_model' setting).\n"
 	        "  - for 'direct':     realport (required), rxdelay (optional).\n"
 	        "                      (e.g., realport:COM1, realport:ttyS0).\n"
-	        "  - for 'modem':      listenport, sock, bps (all optional).\n"
+	        "  - for 'modem':      listenport, sock, bps, txdelay (all optional).\n"
 	        "  - for 'nullmodem':  server, rxdelay, txdelay, telnet, usedtr,\n"
 	        "                      transparent, port, inhsocket, sock (all optional).\n"
 	        "The 'sock' parameter specifies the protocol to use at both sides of the\n"
@@ -1292,6 +1300,13 @@ void DOSBOX_Init()
 	        "(e.g., Astral Blur demo). If you experience crashes related to file\n"
 	        "permissions, you can try disabling this.");
 
+	pint = secprop->Add_int("cdrom_sector_cache", when_idle, 256);
+	pint->SetMinMax(32, 65536);
+	pint->Set_help(
+	        "Number of 2 KB sectors cached for each mounted CD-ROM image (256 by default).\n"
+	        "Larger values speed up directory walks and file reads on big CD-ROM images.\n"
+	        "Takes effect when the image is mounted.");
+
 	// Mscdex
 	secprop->AddInitFunction(&MSCDEX_Init);
 	secprop->AddInitFunction(&DRIVES_Init);
@@ -1308,6 +1323,17 @@ void DOSBOX_Init()
 	pbool->SetEnabledOptions({"ipx"});
 #endif
 
+	pint = secprop->Add_int("ipx_packets_per_tick", when_idle, 64);
+	pint->SetMinMax(1, 1024);
+	pint->SetOptionHelp(
+	        "Maximum number of IPX packets received per emulated millisecond (64 by default).\n"
+	        "Everything that arrived since the last millisecond is received at once, up to\n"
+	        "this limit. Lower values cap how much a flood of packets can slow down\n"
+	        "emulation; 1 receives a single packet per millisecond.");
+#if C_IPX
+	pint->SetEnabledOptions({"ipx_packets_per_tick"});
+#endif
+
 	secprop = control->AddSection_prop("ethernet", &NE2K_Init, changeable_at_runtime);
 
 	pbool = secprop->Add_bool("ne2000", when_idle, false);
@@ -26,6 +26,7 @@
 #include <cstdlib>
 #include <memory>
 #include <mutex>
+#include <utility>
 
 #include "../capture/capture.h"
 #include "control.h"
@@ -212,6 +213,11 @@ bool RENDER_StartUpdate()
 	Scaler_ChangedLines[0]  = 0;
 	Scaler_ChangedLineIndex = 0;
 
+	// Lines can only be skipped if the cache holds the whole previous frame
+	const auto was_cache_complete = std::exchange(render.scale.cacheComplete,
+	                                              false);
+	render.canSkipLines = false;
+
 	// Clearing the cache will first process the line to make sure it's
 	// never the same
 	if (render.scale.clearCache) {
@@ -241,7 +247,8 @@ bool RENDER_StartUpdate()
 			    CAPTURE_IsCapturingVideo()) {
 				render.fullFrame = true;
 			} else {
-				render.fullFrame = false;
+				render.fullFrame    = false;
+				render.canSkipLines = was_cache_complete;
 			}
 		}
 	}
@@ -249,9 +256,15 @@ bool RENDER_StartUpdate()
 	return true;
 }
 
+bool RENDER_CanSkipUnchangedLines()
+{
+	return render.updating && render.canSkipLines;
+}
+
 static void halt_render()
 {
 	RENDER_DrawLine = empty_line_handler;
+	render.scale.cacheComplete = false;
 	GFX_EndUpdate(nullptr);
 	render.updating = false;
 	render.active   = false;
@@ -263,6 +276,9 @@ void RENDER_EndUpdate(bool abort)
 		return;
 	}
 
+	// The line handler is only emptied mid-frame if the update failed
+	render.scale.cacheComplete = !abort &&
+	                             RENDER_DrawLine != empty_line_handler;
 	RENDER_DrawLine = empty_line_handler;
 
 	if (CAPTURE_IsCapturingImage() || CAPTURE_IsCapturingVideo()) {
@@ -24,6 +24,7 @@
 
 #include "dosbox.h"
 #include "render.h"
+#include "render_span_converters.h"
 #include <cstring>
 
 uint8_t Scaler_Aspect[SCALER_MAXHEIGHT]        = {};
@@ -31,6 +32,8 @@ uint16_t Scaler_ChangedLines[SCALER_MAXHEIGHT] = {};
 
 Bitu Scaler_ChangedLineIndex = 0;
 
+static const auto& span_converters = RENDER_GetSpanConverters();
+
 static union {
 	 //The +1 is a at least for the normal scalers not needed. (-1 is enough)
 	 uint32_t b32[SCALER_MAX_MUL_HEIGHT + 1][SCALER_MAXWIDTH];
@@ -26,12 +26,16 @@
 #error "Scaler goes too wide"
 #endif
 
+#if defined(PMAKE_SPAN) && SCALERWIDTH > 2
+#error "Span converters only go up to double width"
+#endif
+
 #if defined (SCALERLINEAR)
 static void conc4d(SCALERNAME,SBPP,DBPP,L)(const void *s) {
 #else
 static void conc4d(SCALERNAME,SBPP,DBPP,R)(const void *s) {
 #endif
-#ifdef RENDER_NULL_INPUT
+	// Unchanged lines skipped by the caller
 	if (!s) {
 		render.scale.cacheRead += render.scale.cachePitch;
 #if defined(SCALERLINEAR) 
@@ -42,7 +46,6 @@ static void conc4d(SCALERNAME,SBPP,DBPP,R)(const void *s) {
 		ScalerAddLines( 0, skipLines );
 		return;
 	}
-#endif
 	/* Clear the complete line marker */
 	Bitu hadChange = 0;
 	auto src   = static_cast<const SRCTYPE*>(s);
@@ -85,6 +88,23 @@ static void conc4d(SCALERNAME,SBPP,DBPP,R)(const void *s) {
 #endif
 #endif //defined(SCALERLINEAR)
 			hadChange = 1;
+#if defined(PMAKE_SPAN)
+			const Bitu num_pixels = x > 32 ? 32 : x;
+			std::memcpy(cache, src, num_pixels * sizeof(SRCTYPE));
+#if (SCALERWIDTH == 1)
+			PMAKE_SPAN(src, num_pixels, line0);
+#else
+			PMAKE_SPAN_DW(src, num_pixels, line0);
+#endif
+#if (SCALERHEIGHT > 1)
+			std::memcpy(line1, line0, num_pixels * SCALERWIDTH * PSIZE);
+			line1 += num_pixels * SCALERWIDTH;
+#endif
+			src += num_pixels;
+			cache += num_pixels;
+			line0 += num_pixels * SCALERWIDTH;
+			x -= num_pixels;
+#else
 			for (Bitu i = x > 32 ? 32 : x;i>0;i--,x--) {
 				const SRCTYPE S = *src;
 				*cache = S;
@@ -96,6 +116,7 @@ static void conc4d(SCALERNAME,SBPP,DBPP,R)(const void *s) {
 				line1 += SCALERWIDTH;
 #endif
 			}
+#endif // defined(PMAKE_SPAN)
 #if defined(SCALERLINEAR)
 #if (SCALERHEIGHT > 1)
 			Bitu copyLen = (Bitu)((uint8_t*)line1 - (uint8_t*)WC[0]);
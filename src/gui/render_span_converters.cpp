@@ -0,0 +1,296 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2025  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "render_span_converters.h"
+
+#include "native_simd.h"
+
+// GCC and Clang can build functions for instruction sets beyond the baseline
+// and let us check for them at runtime
+#if (defined(__x86_64__) || defined(__i386__)) && \
+        (defined(__GNUC__) || defined(__clang__))
+#	define HAS_AVX2_DISPATCH 1
+#	include <immintrin.h>
+#endif
+
+// Scalar reference implementations
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+static inline uint32_t rgb565_to_32(const uint32_t pixel)
+{
+	// RRRrrGGggggBBBbb -> RRRrrRRRGGggggGGBBBbbBBB
+	return ((pixel & (31 << 11)) << 8) | ((pixel & (63 << 5)) << 5) |
+	       ((pixel & 0xe01f) << 3) | ((pixel & (3 << 9)) >> 1) |
+	       ((pixel & (7 << 2)) >> 2);
+}
+
+static void palette_to_32_scalar(const uint8_t* src, const size_t num_pixels,
+                                 const uint32_t* lut, uint32_t* dest)
+{
+	for (size_t i = 0; i < num_pixels; ++i) {
+		dest[i] = lut[src[i]];
+	}
+}
+
+static void palette_to_32_doubled_scalar(const uint8_t* src, const size_t num_pixels,
+                                         const uint32_t* lut, uint32_t* dest)
+{
+	for (size_t i = 0; i < num_pixels; ++i) {
+		const auto pixel = lut[src[i]];
+		*dest++          = pixel;
+		*dest++          = pixel;
+	}
+}
+
+static void rgb565_to_32_scalar(const uint16_t* src, const size_t num_pixels,
+                                uint32_t* dest)
+{
+	for (size_t i = 0; i < num_pixels; ++i) {
+		dest[i] = rgb565_to_32(src[i]);
+	}
+}
+
+static void rgb565_to_32_doubled_scalar(const uint16_t* src,
+                                        const size_t num_pixels, uint32_t* dest)
+{
+	for (size_t i = 0; i < num_pixels; ++i) {
+		const auto pixel = rgb565_to_32(src[i]);
+		*dest++          = pixel;
+		*dest++          = pixel;
+	}
+}
+
+static void double_32_scalar(const uint32_t* src, const size_t num_pixels,
+                             uint32_t* dest)
+{
+	for (size_t i = 0; i < num_pixels; ++i) {
+		const auto pixel = src[i];
+		*dest++          = pixel;
+		*dest++          = pixel;
+	}
+}
+
+// Vectorised implementations
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+static inline simde__m128i load_vector(const void* src)
+{
+	return simde_mm_loadu_si128(static_cast<const simde__m128i*>(src));
+}
+
+static inline void store_vector(void* dest, const simde__m128i val)
+{
+	simde_mm_storeu_si128(static_cast<simde__m128i*>(dest), val);
+}
+
+static inline void store_doubled(uint32_t* dest, const simde__m128i pixels)
+{
+	store_vector(dest, simde_mm_unpacklo_epi32(pixels, pixels));
+	store_vector(dest + 4, simde_mm_unpackhi_epi32(pixels, pixels));
+}
+
+static inline simde__m128i lookup_4(const uint8_t* src, const uint32_t* lut)
+{
+	return simde_mm_set_epi32(static_cast<int32_t>(lut[src[3]]),
+	                          static_cast<int32_t>(lut[src[2]]),
+	                          static_cast<int32_t>(lut[src[1]]),
+	                          static_cast<int32_t>(lut[src[0]]));
+}
+
+// SSE2 has no gather, so the lookups stay scalar but the pixels are written
+// a vector at a time
+static void palette_to_32_simd(const uint8_t* src, const size_t num_pixels,
+                               const uint32_t* lut, uint32_t* dest)
+{
+	size_t i = 0;
+	for (; i + 4 <= num_pixels; i += 4) {
+		store_vector(dest + i, lookup_4(src + i, lut));
+	}
+	palette_to_32_scalar(src + i, num_pixels - i, lut, dest + i);
+}
+
+static void palette_to_32_doubled_simd(const uint8_t* src, const size_t num_pixels,
+                                       const uint32_t* lut, uint32_t* dest)
+{
+	size_t i = 0;
+	for (; i + 4 <= num_pixels; i += 4) {
+		store_doubled(dest + i * 2, lookup_4(src + i, lut));
+	}
+	palette_to_32_doubled_scalar(src + i, num_pixels - i, lut, dest + i * 2);
+}
+
+// Expands four RGB565 pixels, zero-extended to 32 bits
+static inline simde__m128i rgb565_to_32_x4(const simde__m128i pixels)
+{
+	const auto red = simde_mm_slli_epi32(
+	        simde_mm_and_si128(pixels, simde_mm_set1_epi32(31 << 11)), 8);
+	const auto green = simde_mm_slli_epi32(
+	        simde_mm_and_si128(pixels, simde_mm_set1_epi32(63 << 5)), 5);
+	const auto red_blue_low = simde_mm_slli_epi32(
+	        simde_mm_and_si128(pixels, simde_mm_set1_epi32(0xe01f)), 3);
+	const auto green_low = simde_mm_srli_epi32(
+	        simde_mm_and_si128(pixels, simde_mm_set1_epi32(3 << 9)), 1);
+	const auto blue_low = simde_mm_srli_epi32(
+	        simde_mm_and_si128(pixels, simde_mm_set1_epi32(7 << 2)), 2);
+
+	return simde_mm_or_si128(simde_mm_or_si128(red, green),
+	                         simde_mm_or_si128(simde_mm_or_si128(red_blue_low,
+	                                                             green_low),
+	                                           blue_low));
+}
+
+static void rgb565_to_32_simd(const uint16_t* src, const size_t num_pixels,
+                              uint32_t* dest)
+{
+	const auto zero = simde_mm_setzero_si128();
+
+	size_t i = 0;
+	for (; i + 8 <= num_pixels; i += 8) {
+		const auto pixels = load_vector(src + i);
+		store_vector(dest + i,
+		             rgb565_to_32_x4(simde_mm_unpacklo_epi16(pixels, zero)));
+		store_vector(dest + i + 4,
+		             rgb565_to_32_x4(simde_mm_unpackhi_epi16(pixels, zero)));
+	}
+	rgb565_to_32_scalar(src + i, num_pixels - i, dest + i);
+}
+
+static void rgb565_to_32_doubled_simd(const uint16_t* src,
+                                      const size_t num_pixels, uint32_t* dest)
+{
+	const auto zero = simde_mm_setzero_si128();
+
+	size_t i = 0;
+	for (; i + 8 <= num_pixels; i += 8) {
+		const auto pixels = load_vector(src + i);
+		store_doubled(dest + i * 2,
+		              rgb565_to_32_x4(simde_mm_unpacklo_epi16(pixels, zero)));
+		store_doubled(dest + i * 2 + 8,
+		              rgb565_to_32_x4(simde_mm_unpackhi_epi16(pixels, zero)));
+	}
+	rgb565_to_32_doubled_scalar(src + i, num_pixels - i, dest + i * 2);
+}
+
+static void double_32_simd(const uint32_t* src, const size_t num_pixels,
+                           uint32_t* dest)
+{
+	size_t i = 0;
+	for (; i + 4 <= num_pixels; i += 4) {
+		store_doubled(dest + i * 2, load_vector(src + i));
+	}
+	double_32_scalar(src + i, num_pixels - i, dest + i * 2);
+}
+
+// AVX2 palette lookups, selected at runtime
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+#if HAS_AVX2_DISPATCH
+
+__attribute__((target("avx2"))) static inline __m256i lookup_8_avx2(
+        const uint8_t* src, const uint32_t* lut)
+{
+	const auto indices = _mm256_cvtepu8_epi32(
+	        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src)));
+	return _mm256_i32gather_epi32(reinterpret_cast<const int*>(lut), indices, 4);
+}
+
+__attribute__((target("avx2"))) static void palette_to_32_avx2(
+        const uint8_t* src, const size_t num_pixels, const uint32_t* lut,
+        uint32_t* dest)
+{
+	size_t i = 0;
+	for (; i + 8 <= num_pixels; i += 8) {
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i),
+		                    lookup_8_avx2(src + i, lut));
+	}
+	palette_to_32_scalar(src + i, num_pixels - i, lut, dest + i);
+}
+
+__attribute__((target("avx2"))) static void palette_to_32_doubled_avx2(
+        const uint8_t* src, const size_t num_pixels, const uint32_t* lut,
+        uint32_t* dest)
+{
+	size_t i = 0;
+	for (; i + 8 <= num_pixels; i += 8) {
+		const auto pixels = lookup_8_avx2(src + i, lut);
+
+		// The unpacks work within each 128-bit lane, so the lanes need
+		// putting back in order
+		const auto low  = _mm256_unpacklo_epi32(pixels, pixels);
+		const auto high = _mm256_unpackhi_epi32(pixels, pixels);
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i * 2),
+		                    _mm256_permute2x128_si256(low, high, 0x20));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i * 2 + 8),
+		                    _mm256_permute2x128_si256(low, high, 0x31));
+	}
+	palette_to_32_doubled_scalar(src + i, num_pixels - i, lut, dest + i * 2);
+}
+
+static bool host_has_avx2()
+{
+	return __builtin_cpu_supports("avx2");
+}
+#endif // HAS_AVX2_DISPATCH
+
+// Dispatch
+// ~~~~~~~~
+
+const RenderSpanConverters& RENDER_GetScalarSpanConverters()
+{
+	static constexpr RenderSpanConverters converters = {
+	        palette_to_32_scalar,
+	        palette_to_32_doubled_scalar,
+	        rgb565_to_32_scalar,
+	        rgb565_to_32_doubled_scalar,
+	        double_32_scalar,
+	};
+	return converters;
+}
+
+const RenderSpanConverters& RENDER_GetSimdSpanConverters()
+{
+	static constexpr RenderSpanConverters converters = {
+	        palette_to_32_simd,
+	        palette_to_32_doubled_simd,
+	        rgb565_to_32_simd,
+	        rgb565_to_32_doubled_simd,
+	        double_32_simd,
+	};
+	return converters;
+}
+
+static RenderSpanConverters select_span_converters()
+{
+	auto converters = has_native_sse2 ? RENDER_GetSimdSpanConverters()
+	                                  : RENDER_GetScalarSpanConverters();
+#if HAS_AVX2_DISPATCH
+	if (host_has_avx2()) {
+		converters.palette_to_32         = palette_to_32_avx2;
+		converters.palette_to_32_doubled = palette_to_32_doubled_avx2;
+	}
+#endif
+	return converters;
+}
+
+const RenderSpanConverters& RENDER_GetSpanConverters()
+{
+	static const auto converters = select_span_converters();
+	return converters;
+}
@@ -203,6 +203,27 @@
 #	define SRCTYPE uint32_t
 #endif
 
+// The hot combinations convert whole spans at once using the vectorised
+// converters; PMAKE_SPAN writes each pixel once, PMAKE_SPAN_DW twice.
+#if DBPP == 32
+#	if SBPP == 8 || SBPP == 9
+#		define PMAKE_SPAN(_SRC, _NUM, _DST) \
+			span_converters.palette_to_32(_SRC, _NUM, render.pal.lut.b32, _DST)
+#		define PMAKE_SPAN_DW(_SRC, _NUM, _DST) \
+			span_converters.palette_to_32_doubled(_SRC, _NUM, render.pal.lut.b32, _DST)
+#	elif SBPP == 16 && !defined(WORDS_BIGENDIAN)
+#		define PMAKE_SPAN(_SRC, _NUM, _DST) \
+			span_converters.rgb565_to_32(_SRC, _NUM, _DST)
+#		define PMAKE_SPAN_DW(_SRC, _NUM, _DST) \
+			span_converters.rgb565_to_32_doubled(_SRC, _NUM, _DST)
+#	elif SBPP == 32 && !defined(WORDS_BIGENDIAN)
+#		define PMAKE_SPAN(_SRC, _NUM, _DST) \
+			std::memcpy(_DST, _SRC, (_NUM) * sizeof(uint32_t))
+#		define PMAKE_SPAN_DW(_SRC, _NUM, _DST) \
+			span_converters.double_32(_SRC, _NUM, _DST)
+#	endif
+#endif
+
 //  C0 C1 C2 D3
 //  C3 C4 C5 D4
 //  C6 C7 C8 D5
@@ -285,6 +306,8 @@
 #undef PSIZE
 #undef PTYPE
 #undef PMAKE
+#undef PMAKE_SPAN
+#undef PMAKE_SPAN_DW
 #undef WC
 #undef LC
 #undef FC
@@ -28,10 +28,14 @@
 #include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
+#include <condition_variable>
 #include <cstring>
+#include <mutex>
 #include <sys/types.h>
+#include <thread>
 #include <tuple>
 #include <unistd.h>
+#include <vector>
 
 #if C_DEBUG
 #include <queue>
@@ -70,6 +74,7 @@
 #include "sdlmain.h"
 #include "setup.h"
 #include "string_utils.h"
+#include "support.h"
 #include "timer.h"
 #include "titlebar.h"
 #include "tracy.h"
@@ -136,6 +141,18 @@ typedef void (APIENTRYP PFNGLUNIFORM1IPROC) (GLint location, GLint v0);
 typedef void (APIENTRYP PFNGLUSEPROGRAMPROC) (GLuint program);
 typedef void (APIENTRYP PFNGLVERTEXATTRIBPOINTERPROC) (GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid *pointer);
 
+// Pixel buffer objects and sync objects for streaming texture uploads
+typedef void (APIENTRYP PFNGLBINDBUFFERPROC) (GLenum target, GLuint buffer);
+typedef void (APIENTRYP PFNGLBUFFERDATAPROC) (GLenum target, GLsizeiptr size, const void *data, GLenum usage);
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC) (GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+typedef GLenum (APIENTRYP PFNGLCLIENTWAITSYNCPROC) (GLsync sync, GLbitfield flags, GLuint64 timeout);
+typedef void (APIENTRYP PFNGLDELETEBUFFERSPROC) (GLsizei n, const GLuint *buffers);
+typedef void (APIENTRYP PFNGLDELETESYNCPROC) (GLsync sync);
+typedef GLsync (APIENTRYP PFNGLFENCESYNCPROC) (GLenum condition, GLbitfield flags);
+typedef void (APIENTRYP PFNGLGENBUFFERSPROC) (GLsizei n, GLuint *buffers);
+typedef void *(APIENTRYP PFNGLMAPBUFFERRANGEPROC) (GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+typedef GLboolean (APIENTRYP PFNGLUNMAPBUFFERPROC) (GLenum target);
+
 /* Apple defines these functions in their GL header (as core functions)
  * so we can't use their names as function pointers. We can't link
  * directly as some platforms may not have them. So they get their own
@@ -161,6 +178,17 @@ PFNGLUNIFORM2FPROC glUniform2f = nullptr;
 PFNGLUNIFORM1IPROC glUniform1i = nullptr;
 PFNGLUSEPROGRAMPROC glUseProgram = nullptr;
 PFNGLVERTEXATTRIBPOINTERPROC glVertexAttribPointer = nullptr;
+
+PFNGLBINDBUFFERPROC glBindBuffer         = nullptr;
+PFNGLBUFFERDATAPROC glBufferData         = nullptr;
+PFNGLBUFFERSTORAGEPROC glBufferStorage   = nullptr;
+PFNGLCLIENTWAITSYNCPROC glClientWaitSync = nullptr;
+PFNGLDELETEBUFFERSPROC glDeleteBuffers   = nullptr;
+PFNGLDELETESYNCPROC glDeleteSync         = nullptr;
+PFNGLFENCESYNCPROC glFenceSync           = nullptr;
+PFNGLGENBUFFERSPROC glGenBuffers         = nullptr;
+PFNGLMAPBUFFERRANGEPROC glMapBufferRange = nullptr;
+PFNGLUNMAPBUFFERPROC glUnmapBuffer       = nullptr;
 }
 
 /* "using" is meant to hide identical names declared in outer scope
@@ -186,6 +214,17 @@ PFNGLVERTEXATTRIBPOINTERPROC glVertexAttribPointer = nullptr;
 #define glUseProgram              gl2::glUseProgram
 #define glVertexAttribPointer     gl2::glVertexAttribPointer
 
+#define glBindBuffer              gl2::glBindBuffer
+#define glBufferData              gl2::glBufferData
+#define glBufferStorage           gl2::glBufferStorage
+#define glClientWaitSync          gl2::glClientWaitSync
+#define glDeleteBuffers           gl2::glDeleteBuffers
+#define glDeleteSync              gl2::glDeleteSync
+#define glFenceSync               gl2::glFenceSync
+#define glGenBuffers              gl2::glGenBuffers
+#define glMapBufferRange          gl2::glMapBufferRange
+#define glUnmapBuffer             gl2::glUnmapBuffer
+
 #endif // C_OPENGL
 
 #ifdef WIN32
@@ -232,11 +271,16 @@ static SDL_Rect to_sdl_rect(const DosBox::Rect& r)
 static void clean_up_sdl_resources();
 static void handle_video_resize(int width, int height);
 
-static void update_frame_texture([[maybe_unused]] const uint16_t* changedLines);
+static bool present_frame();
+static void pause_present_thread();
+
+static void update_frame_texture(const uint16_t* changedLines);
 static bool present_frame_texture();
 #if C_OPENGL
 static void update_frame_gl(const uint16_t *changedLines);
 static bool present_frame_gl();
+static void create_pixel_buffers(const size_t size_bytes);
+static void destroy_pixel_buffers();
 static const char* safe_gl_get_string(const GLenum requested_name,
                                       const char* default_result);
 #endif
@@ -624,6 +668,8 @@ uint8_t GFX_GetBestMode(const uint8_t flags)
 // Useful during output initialization or transitions.
 void GFX_DisengageRendering()
 {
+	pause_present_thread();
+
 	sdl.frame.update  = update_frame_noop;
 	sdl.frame.present = present_frame_noop;
 }
@@ -1058,7 +1104,7 @@ static void maybe_present_throttled(const bool frame_is_new)
 		last_present_time = now - (9 * wait_overage / 10);
 
 		if (frame_is_new || was_new_and_throttled) {
-			sdl.frame.present();
+			present_frame();
 		}
 	}
 	// Otherwise we've had to throttle the frame, however if the frame was
@@ -1084,7 +1130,7 @@ static void maybe_present_synced(const bool present_if_last_skipped)
 	const auto should_present = on_time || (present_if_last_skipped &&
 	                                        !last_frame_presented);
 
-	last_frame_presented = should_present ? sdl.frame.present() : false;
+	last_frame_presented = should_present ? present_frame() : false;
 
 	last_sync_time = should_present ? GetTicksUs() : now;
 }
@@ -1711,6 +1757,8 @@ uint8_t GFX_SetSize(const int render_width_px, const int render_height_px,
 	if (sdl.updating)
 		GFX_EndUpdate(nullptr);
 
+	pause_present_thread();
+
 	GFX_DisengageRendering();
 	// The rendering objects are recreated below with new sizes, after which
 	// frame rendering is re-engaged with the output-type specific calls.
@@ -1848,6 +1896,7 @@ uint8_t GFX_SetSize(const int render_width_px, const int render_height_px,
 	}
 	case RenderingBackend::OpenGl: {
 #if C_OPENGL
+		destroy_pixel_buffers();
 		free(sdl.opengl.framebuf);
 		sdl.opengl.framebuf = nullptr;
 		if (!(flags & GFX_CAN_32)) {
@@ -2127,6 +2176,8 @@ uint8_t GFX_SetSize(const int render_width_px, const int render_height_px,
 		             emptytex);
 		delete[] emptytex;
 
+		create_pixel_buffers(framebuffer_bytes);
+
 		if (sdl.opengl.framebuffer_is_srgb_encoded) {
 			glEnable(GL_FRAMEBUFFER_SRGB);
 #if 0
@@ -2268,6 +2319,8 @@ void GFX_SetShader([[maybe_unused]] const ShaderInfo& shader_info,
                    [[maybe_unused]] const std::string& shader_source)
 {
 #if C_OPENGL
+	pause_present_thread();
+
 	sdl.opengl.shader_info   = shader_info;
 	sdl.opengl.shader_source = shader_source;
 
@@ -2377,6 +2430,8 @@ void sticky_keys(bool restore){
 
 void GFX_SwitchFullScreen()
 {
+	pause_present_thread();
+
 	sdl.desktop.switching_fullscreen = true;
 
 	// Record the window's current canvas size if we're departing window-mode
@@ -2407,6 +2462,609 @@ static void switch_fullscreen(bool pressed)
 	}
 }
 
+// Pixel buffer object streaming
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// With 'gl_texture_upload = pbo', the changed lines are copied into one of a
+// ring of pixel buffer objects and the texture is updated from there. The
+// driver can then copy the pixels to the texture asynchronously instead of
+// stalling on client memory, and we write the next frame into the next
+// buffer while the GPU is still reading the previous one.
+//
+// The buffers are persistently mapped where buffer storage is available
+// (OpenGL 4.4 or GL_ARB_buffer_storage), otherwise they're mapped for each
+// frame. A fence guards every buffer. If the GPU is still reading a buffer
+// when we come round to it again, that frame is uploaded directly from the
+// framebuffer instead.
+//
+#if C_OPENGL
+constexpr int NumPixelBuffers = 3;
+
+static struct {
+	bool is_requested = false;
+
+	// The driver provides the required functions
+	bool is_supported       = false;
+	bool has_buffer_storage = false;
+
+	// The buffers are set up for the current output size
+	bool is_enabled    = false;
+	bool is_persistent = false;
+
+	std::array<GLuint, NumPixelBuffers> buffers = {};
+	std::array<uint8_t*, NumPixelBuffers> mapped = {};
+	std::array<GLsync, NumPixelBuffers> fences  = {};
+
+	GLsizeiptr size_bytes = 0;
+	int next_index        = 0;
+
+	int num_direct_uploads = 0;
+} pixel_buffers = {};
+
+// A run of consecutive changed lines
+struct LineRun {
+	int y         = 0;
+	int num_lines = 0;
+};
+
+static void destroy_pixel_buffers()
+{
+	auto& pb = pixel_buffers;
+	if (!pb.is_enabled) {
+		return;
+	}
+	for (auto i = 0; i < NumPixelBuffers; ++i) {
+		if (pb.fences[i]) {
+			glDeleteSync(pb.fences[i]);
+		}
+		if (pb.mapped[i]) {
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pb.buffers[i]);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		}
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glDeleteBuffers(NumPixelBuffers, pb.buffers.data());
+
+	pb.is_enabled    = false;
+	pb.is_persistent = false;
+	pb.buffers       = {};
+	pb.mapped        = {};
+	pb.fences        = {};
+	pb.size_bytes    = 0;
+	pb.next_index    = 0;
+}
+
+static void create_pixel_buffers(const size_t size_bytes)
+{
+	auto& pb = pixel_buffers;
+
+	destroy_pixel_buffers();
+
+	if (!pb.is_requested) {
+		return;
+	}
+	if (!pb.is_supported) {
+		static bool warned = false;
+		if (!warned) {
+			LOG_WARNING("OPENGL: Pixel buffer objects are not supported, "
+			            "uploading textures directly");
+			warned = true;
+		}
+		return;
+	}
+
+	pb.size_bytes    = check_cast<GLsizeiptr>(size_bytes);
+	pb.is_persistent = pb.has_buffer_storage;
+	pb.is_enabled    = true;
+
+	glGenBuffers(NumPixelBuffers, pb.buffers.data());
+
+	constexpr GLbitfield PersistentFlags = GL_MAP_WRITE_BIT |
+	                                       GL_MAP_PERSISTENT_BIT |
+	                                       GL_MAP_COHERENT_BIT;
+	auto is_ok = true;
+	for (auto i = 0; i < NumPixelBuffers && is_ok; ++i) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pb.buffers[i]);
+
+		if (pb.is_persistent) {
+			glBufferStorage(GL_PIXEL_UNPACK_BUFFER,
+			                pb.size_bytes,
+			                nullptr,
+			                PersistentFlags);
+
+			pb.mapped[i] = static_cast<uint8_t*>(glMapBufferRange(
+			        GL_PIXEL_UNPACK_BUFFER, 0, pb.size_bytes, PersistentFlags));
+
+			is_ok = (pb.mapped[i] != nullptr);
+		} else {
+			glBufferData(GL_PIXEL_UNPACK_BUFFER,
+			             pb.size_bytes,
+			             nullptr,
+			             GL_STREAM_DRAW);
+		}
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	if (!is_ok) {
+		LOG_WARNING("OPENGL: Failed to set up pixel buffer objects, "
+		            "uploading textures directly");
+		destroy_pixel_buffers();
+		return;
+	}
+
+	static bool logged = false;
+	if (!logged) {
+		LOG_MSG("OPENGL: Streaming texture uploads through %d %s pixel buffer objects",
+		        NumPixelBuffers,
+		        pb.is_persistent ? "persistently mapped" : "mapped");
+		logged = true;
+	}
+}
+
+// Binds the next pixel buffer and returns where to copy the frame to, or
+// nullptr if the frame should be uploaded directly
+static uint8_t* begin_pixel_buffer_upload()
+{
+	auto& pb = pixel_buffers;
+	if (!pb.is_enabled) {
+		return nullptr;
+	}
+
+	auto& fence = pb.fences[pb.next_index];
+	if (fence) {
+		// Don't wait; the GPU is running behind if it hasn't finished
+		// with the oldest buffer in the ring yet
+		const auto status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		if (status == GL_TIMEOUT_EXPIRED) {
+			++pb.num_direct_uploads;
+			return nullptr;
+		}
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pb.buffers[pb.next_index]);
+
+	if (pb.is_persistent) {
+		return pb.mapped[pb.next_index];
+	}
+
+	// Unsynchronised, as the fence already told us the GPU is done with
+	// the buffer. This also keeps the lines from earlier frames intact.
+	const auto pixels = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER,
+	                                     0,
+	                                     pb.size_bytes,
+	                                     GL_MAP_WRITE_BIT |
+	                                             GL_MAP_UNSYNCHRONIZED_BIT);
+	if (!pixels) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		++pb.num_direct_uploads;
+		return nullptr;
+	}
+	return static_cast<uint8_t*>(pixels);
+}
+
+// Uploads the given lines of the frame to the texture, either through the
+// next pixel buffer or directly
+static void upload_texture_lines_gl(const uint8_t* pixels, const int pitch,
+                                    const int width_px,
+                                    const std::vector<LineRun>& line_runs)
+{
+	if (line_runs.empty()) {
+		return;
+	}
+
+	// With a pixel buffer bound, the pixels pointer is an offset into it
+	auto upload = [&](const uint8_t* source) {
+		for (const auto& run : line_runs) {
+			const auto offset = static_cast<uintptr_t>(run.y) * pitch;
+			const auto lines = source ? static_cast<const void*>(source + offset)
+			                          : reinterpret_cast<const void*>(offset);
+
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, run.y, width_px,
+			                run.num_lines, GL_BGRA_EXT,
+			                GL_UNSIGNED_INT_8_8_8_8_REV, lines);
+		}
+	};
+
+	auto& pb = pixel_buffers;
+
+	const auto staging = begin_pixel_buffer_upload();
+	if (!staging) {
+		upload(pixels);
+		return;
+	}
+
+	for (const auto& run : line_runs) {
+		const auto offset = static_cast<size_t>(run.y) * pitch;
+		std::memcpy(staging + offset,
+		            pixels + offset,
+		            static_cast<size_t>(run.num_lines) * pitch);
+	}
+
+	// The contents can get lost (e.g., on a display mode change) while
+	// the buffer is mapped, in which case we upload directly
+	if (!pb.is_persistent && !glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER)) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		++pb.num_direct_uploads;
+		upload(pixels);
+		return;
+	}
+
+	upload(nullptr);
+
+	pb.fences[pb.next_index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	pb.next_index = (pb.next_index + 1) % NumPixelBuffers;
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+#endif // C_OPENGL
+
+// Vblank-to-present latency
+// ~~~~~~~~~~~~~~~~~~~~~~~~~
+// Measures the time from the emulated video card completing a frame to the
+// host presenting it, so changes to the presentation path can be checked for
+// input lag regressions. The totals are logged on shutdown.
+//
+static struct {
+	// When the frame about to be presented was completed; zero if the frame
+	// doesn't come from the emulated video card (e.g., when benchmarking the
+	// presentation rate)
+	int64_t vblank_us = 0;
+
+	int64_t total_us   = 0;
+	int64_t max_us     = 0;
+	int64_t num_frames = 0;
+} present_latency = {};
+
+static void record_present_latency()
+{
+	if (present_latency.vblank_us == 0) {
+		return;
+	}
+	const auto latency_us = GetTicksUsSince(present_latency.vblank_us);
+
+	present_latency.total_us += latency_us;
+	present_latency.max_us = std::max(present_latency.max_us, latency_us);
+	++present_latency.num_frames;
+}
+
+static void log_present_latency()
+{
+	if (present_latency.num_frames == 0) {
+		return;
+	}
+	constexpr auto MicrosInMillisecond = 1000.0;
+
+	const auto avg_ms = static_cast<double>(present_latency.total_us) /
+	                    static_cast<double>(present_latency.num_frames) /
+	                    MicrosInMillisecond;
+	const auto max_ms = static_cast<double>(present_latency.max_us) /
+	                    MicrosInMillisecond;
+
+	LOG_MSG("SDL: Presented %lld frames, vblank-to-present latency was "
+	        "%.2f ms on average and %.2f ms at most",
+	        static_cast<long long>(present_latency.num_frames),
+	        avg_ms,
+	        max_ms);
+}
+
+// Threaded presentation
+// ~~~~~~~~~~~~~~~~~~~~~
+// With 'threaded_presentation' enabled, the OpenGL texture upload and
+// presentation run on a separate thread, so a present that blocks on vsync
+// doesn't stall the emulation.
+//
+// The scalers keep rendering into sdl.opengl.framebuf on the main thread.
+// GFX_EndUpdate copies the changed lines into the pending frame buffer, which
+// the present thread swaps with the buffer it uploads from. If the present
+// thread falls behind, newer frames are merged into the pending one, so we
+// always present the latest frame.
+//
+// A GL context can only be current on one thread at a time. Main thread code
+// that makes GL calls or changes the window needs to pause the present thread
+// first, which hands the context back to the main thread. The next frame
+// hands it to the present thread again.
+//
+// SDL's texture renderer must only be used from the thread that created it,
+// so the texture output always presents on the main thread.
+//
+#if C_OPENGL
+static struct {
+	std::thread thread         = {};
+	std::mutex mutex           = {};
+	std::condition_variable cv = {};
+
+	bool is_enabled = false;
+
+	// Only accessed by the main thread
+	bool is_paused      = true;
+	bool should_present = false;
+
+	// Protected by the mutex
+	bool pause_requested = true;
+	bool is_parked       = false;
+	bool should_quit     = false;
+
+	// Frame buffers with one flag per line. The geometry only changes
+	// while the present thread is paused.
+	struct Frame {
+		std::vector<uint8_t> pixels = {};
+
+		// Lines that changed since the previous frame was taken by the
+		// present thread, and so need uploading
+		std::vector<uint8_t> dirty_lines = {};
+	};
+
+	// Protected by the mutex
+	struct : Frame {
+		// Lines where this buffer lags behind sdl.opengl.framebuf
+		std::vector<uint8_t> stale_lines = {};
+
+		bool is_available   = false;
+		bool should_present = false;
+		int64_t vblank_us   = 0;
+	} pending = {};
+
+	// Only accessed by the present thread while it's running
+	Frame presented = {};
+
+	int width_px  = 0;
+	int height_px = 0;
+	int pitch     = 0;
+} present_thread = {};
+
+static bool present_thread_is_active()
+{
+	// Post-render captures read the backbuffer from the main thread
+	return present_thread.is_enabled && sdl.opengl.framebuf &&
+	       sdl.frame.update == update_frame_gl &&
+	       !CAPTURE_IsCapturingPostRenderImage();
+}
+
+// Returns true if any lines were uploaded
+static bool upload_dirty_lines_gl(const std::vector<uint8_t>& pixels,
+                                  const std::vector<uint8_t>& dirty_lines)
+{
+	const auto& pt = present_thread;
+
+	static std::vector<LineRun> line_runs = {};
+	line_runs.clear();
+
+	int y = 0;
+	while (y < pt.height_px) {
+		if (!dirty_lines[y]) {
+			++y;
+			continue;
+		}
+		const auto start_y = y;
+		while (y < pt.height_px && dirty_lines[y]) {
+			++y;
+		}
+		line_runs.push_back({start_y, y - start_y});
+	}
+	upload_texture_lines_gl(pixels.data(), pt.pitch, pt.width_px, line_runs);
+
+	return !line_runs.empty();
+}
+
+static void present_thread_loop()
+{
+	auto& pt = present_thread;
+
+	auto has_context = false;
+
+	std::unique_lock lock(pt.mutex);
+	while (true) {
+		if (pt.pause_requested || pt.should_quit) {
+			if (has_context) {
+				SDL_GL_MakeCurrent(sdl.window, nullptr);
+				has_context = false;
+			}
+			pt.is_parked = true;
+			pt.cv.notify_all();
+
+			pt.cv.wait(lock, [&] {
+				return pt.should_quit || !pt.pause_requested;
+			});
+			if (pt.should_quit) {
+				return;
+			}
+			pt.is_parked = false;
+			continue;
+		}
+		if (!pt.pending.is_available) {
+			pt.cv.wait(lock, [&] {
+				return pt.pause_requested || pt.should_quit ||
+				       pt.pending.is_available;
+			});
+			continue;
+		}
+
+		// Take the pending frame. The buffer we hand back in exchange
+		// lags behind in the lines that changed since we took the
+		// previous frame.
+		std::swap(pt.pending.pixels, pt.presented.pixels);
+		std::swap(pt.pending.dirty_lines, pt.presented.dirty_lines);
+
+		for (size_t y = 0; y < pt.pending.stale_lines.size(); ++y) {
+			pt.pending.stale_lines[y] |= pt.presented.dirty_lines[y];
+			pt.pending.dirty_lines[y] = 0;
+		}
+
+		const auto should_present = pt.pending.should_present;
+		const auto vblank_us      = pt.pending.vblank_us;
+
+		pt.pending.should_present = false;
+		pt.pending.is_available   = false;
+
+		lock.unlock();
+
+		if (!has_context) {
+			SDL_GL_MakeCurrent(sdl.window, sdl.opengl.context);
+			has_context = true;
+		}
+		if (!upload_dirty_lines_gl(pt.presented.pixels,
+		                           pt.presented.dirty_lines)) {
+			sdl.opengl.actual_frame_count++;
+		}
+		if (should_present) {
+			present_latency.vblank_us = vblank_us;
+			present_frame_gl();
+		}
+
+		lock.lock();
+	}
+}
+
+// Hands the GL context back to the main thread
+static void pause_present_thread()
+{
+	auto& pt = present_thread;
+	if (pt.is_paused) {
+		return;
+	}
+	{
+		std::unique_lock lock(pt.mutex);
+		pt.pause_requested = true;
+		pt.cv.notify_all();
+		pt.cv.wait(lock, [&] { return pt.is_parked; });
+	}
+	SDL_GL_MakeCurrent(sdl.window, sdl.opengl.context);
+	pt.is_paused = true;
+}
+
+static void resume_present_thread()
+{
+	auto& pt = present_thread;
+	if (!pt.is_paused) {
+		return;
+	}
+	if (!pt.thread.joinable()) {
+		pt.thread = std::thread(present_thread_loop);
+		set_thread_name(pt.thread, "dosbox:present");
+	}
+	SDL_GL_MakeCurrent(sdl.window, nullptr);
+	{
+		std::lock_guard lock(pt.mutex);
+
+		// The output might have been resized or its texture recreated
+		// while we were paused, so start over with a full upload
+		pt.width_px  = sdl.draw.render_width_px;
+		pt.height_px = sdl.draw.render_height_px;
+		pt.pitch     = sdl.opengl.pitch;
+
+		const auto num_lines = static_cast<size_t>(pt.height_px);
+		const auto num_bytes = num_lines * static_cast<size_t>(pt.pitch);
+
+		pt.pending.pixels.resize(num_bytes);
+		pt.pending.dirty_lines.assign(num_lines, 1);
+		pt.pending.stale_lines.assign(num_lines, 1);
+		pt.pending.is_available   = false;
+		pt.pending.should_present = false;
+
+		pt.presented.pixels.resize(num_bytes);
+		pt.presented.dirty_lines.assign(num_lines, 0);
+
+		pt.pause_requested = false;
+	}
+	pt.cv.notify_all();
+	pt.is_paused = false;
+}
+
+static void stop_present_thread()
+{
+	auto& pt = present_thread;
+	if (!pt.thread.joinable()) {
+		return;
+	}
+	pause_present_thread();
+	{
+		std::lock_guard lock(pt.mutex);
+		pt.should_quit = true;
+	}
+	pt.cv.notify_all();
+	pt.thread.join();
+
+	pt.should_quit = false;
+	pt.is_parked   = false;
+}
+
+static void submit_frame_to_present_thread(const uint16_t* changed_lines,
+                                           const int64_t vblank_us)
+{
+	auto& pt = present_thread;
+
+	const auto framebuf = static_cast<const uint8_t*>(sdl.opengl.framebuf);
+	const auto pitch    = static_cast<size_t>(pt.pitch);
+
+	{
+		std::lock_guard lock(pt.mutex);
+		auto& pending = pt.pending;
+
+		// Run-length encoded changed lines (alternating counts of
+		// unchanged and changed lines)
+		if (changed_lines) {
+			int y        = 0;
+			size_t index = 0;
+			while (y < pt.height_px) {
+				const auto num_lines = std::min(
+				        static_cast<int>(changed_lines[index]),
+				        pt.height_px - y);
+				if (index & 1) {
+					std::fill_n(pending.dirty_lines.begin() + y, num_lines, 1);
+					std::fill_n(pending.stale_lines.begin() + y, num_lines, 1);
+				}
+				y += num_lines;
+				index++;
+			}
+		}
+
+		// Bring the pending buffer up to date
+		for (size_t y = 0; y < pending.stale_lines.size(); ++y) {
+			if (pending.stale_lines[y]) {
+				std::memcpy(pending.pixels.data() + y * pitch,
+				            framebuf + y * pitch,
+				            pitch);
+				pending.stale_lines[y] = 0;
+			}
+		}
+
+		pending.should_present = pending.should_present || pt.should_present;
+		pending.vblank_us    = vblank_us;
+		pending.is_available = true;
+	}
+	pt.cv.notify_all();
+
+	pt.should_present = false;
+}
+
+// The presenters call this instead of sdl.frame.present()
+static bool present_frame()
+{
+	if (present_thread_is_active()) {
+		// Presented by the thread once GFX_EndUpdate submits the frame
+		present_thread.should_present = true;
+		return true;
+	}
+	return sdl.frame.present();
+}
+#else
+static bool present_thread_is_active()
+{
+	return false;
+}
+
+static void pause_present_thread() {}
+static void resume_present_thread() {}
+static void stop_present_thread() {}
+static void submit_frame_to_present_thread(const uint16_t*, const int64_t) {}
+
+static bool present_frame()
+{
+	return sdl.frame.present();
+}
+#endif // C_OPENGL
+
 // This function returns write'able buffer for user to draw upon. Successful
 // return depends on properly initialized SDL_Block structure (which generally
 // can be achieved via GFX_SetSize call), and specifically - properly
@@ -2449,13 +3107,47 @@ bool GFX_StartUpdate(uint8_t * &pixels, int &pitch)
 	return false;
 }
 
+// Returns true if the run-length encoded changed lines array (alternating
+// counts of unchanged and changed lines) doesn't contain any changed lines.
+static bool is_unchanged_frame(const uint16_t* changedLines)
+{
+	if (!changedLines) {
+		return false;
+	}
+	int y        = 0;
+	size_t index = 0;
+	while (y < sdl.draw.render_height_px) {
+		if ((index & 1) && changedLines[index] > 0) {
+			return false;
+		}
+		y += changedLines[index];
+		index++;
+	}
+	return true;
+}
+
 void GFX_EndUpdate(const uint16_t* changedLines)
 {
 	static int64_t cumulative_time_rendered_us = 0;
 
 	const auto start_us = GetTicksUs();
 
-	sdl.frame.update(changedLines);
+	// The frame is complete at this point, so this is the closest we get
+	// to the emulated vertical blank
+	const auto is_threaded = present_thread_is_active();
+	if (is_threaded) {
+		resume_present_thread();
+	} else {
+		pause_present_thread();
+
+		present_latency.vblank_us = start_us;
+		sdl.frame.update(changedLines);
+	}
+
+	// A frame that was rendered but didn't change any lines (e.g., a
+	// palette write that left every pixel the same) is treated as a
+	// duplicate so the presenters can skip it.
+	const auto is_frame_new = sdl.updating && !is_unchanged_frame(changedLines);
 
 	if (CAPTURE_IsCapturingPostRenderImage()) {
 		// Always present the frame if we want to capture the next rendered
@@ -2463,14 +3155,14 @@ void GFX_EndUpdate(const uint16_t* changedLines)
 		// keep the contents of rendered and raw/upscaled screenshots in sync
 		// (so they capture the exact same frame) in multi-output image
 		// capture modes.
-		sdl.frame.present();
+		present_frame();
 	} else {
 		// Helper lambda indicating whether the frame should be presented.
 		// Returns true if the frame has been updated or if the limit of
 		// sequentially skipped duplicate frames has been reached.
-		auto vfr_should_present = []() {
+		auto vfr_should_present = [is_frame_new]() {
 			static uint16_t dupe_tally = 0;
-			if (sdl.updating || ++dupe_tally > sdl.frame.max_dupe_frames) {
+			if (is_frame_new || ++dupe_tally > sdl.frame.max_dupe_frames) {
 				dupe_tally = 0;
 				return true;
 			}
@@ -2479,11 +3171,11 @@ void GFX_EndUpdate(const uint16_t* changedLines)
 
 		switch (sdl.frame.mode) {
 		case FrameMode::Cfr:
-			maybe_present_synced(sdl.updating);
+			maybe_present_synced(is_frame_new);
 			break;
 		case FrameMode::Vfr:
 			if (vfr_should_present()) {
-				sdl.frame.present();
+				present_frame();
 			}
 			break;
 		case FrameMode::ThrottledVfr:
@@ -2494,6 +3186,12 @@ void GFX_EndUpdate(const uint16_t* changedLines)
 		}
 	}
 
+	if (is_threaded) {
+		submit_frame_to_present_thread(changedLines, start_us);
+	} else {
+		present_latency.vblank_us = 0;
+	}
+
 	const auto elapsed_us = GetTicksUsSince(start_us);
 	cumulative_time_rendered_us += elapsed_us;
 
@@ -2518,12 +3216,53 @@ void GFX_EndUpdate(const uint16_t* changedLines)
 
 // Texture update and presentation
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-static void update_frame_texture([[maybe_unused]] const uint16_t *changedLines)
+static void update_frame_texture(const uint16_t* changedLines)
 {
-	SDL_UpdateTexture(sdl.texture.texture,
-	                  nullptr, // update entire texture
-	                  sdl.texture.input_surface->pixels,
-	                  sdl.texture.input_surface->pitch);
+	// Nothing new was rendered, so the texture still holds the last frame
+	if (!changedLines) {
+		return;
+	}
+
+	const auto pixels = static_cast<const uint8_t*>(
+	        sdl.texture.input_surface->pixels);
+	const auto pitch = sdl.texture.input_surface->pitch;
+
+	// Each SDL_UpdateTexture call has a fixed overhead (and can involve a
+	// texture lock or a driver round-trip), so changed runs separated by
+	// only a few unchanged lines are coalesced into a single upload.
+	constexpr int MaxCoalescedGapLines = 8;
+
+	auto upload_rows = [&](const int y, const int height_px) {
+		const SDL_Rect rect = {0, y, sdl.draw.render_width_px, height_px};
+		SDL_UpdateTexture(sdl.texture.texture, &rect, pixels + y * pitch, pitch);
+	};
+
+	int pending_y      = 0;
+	int pending_height = 0;
+
+	int y        = 0;
+	size_t index = 0;
+	while (y < sdl.draw.render_height_px) {
+		const int num_lines = changedLines[index];
+		if (!(index & 1)) {
+			// Unchanged lines; flush the pending run if the gap is
+			// too wide to be worth uploading along with it.
+			if (pending_height > 0 && num_lines > MaxCoalescedGapLines) {
+				upload_rows(pending_y, pending_height);
+				pending_height = 0;
+			}
+		} else if (num_lines > 0) {
+			if (pending_height == 0) {
+				pending_y = y;
+			}
+			pending_height = y + num_lines - pending_y;
+		}
+		y += num_lines;
+		index++;
+	}
+	if (pending_height > 0) {
+		upload_rows(pending_y, pending_height);
+	}
 }
 
 static std::optional<RenderedImage> get_rendered_output_from_backbuffer()
@@ -2665,6 +3404,7 @@ static bool present_frame_texture()
 		}
 
 		SDL_RenderPresent(sdl.renderer);
+		record_present_latency();
 	}
 	render_pacer->Checkpoint();
 	return is_presenting;
@@ -2676,23 +3416,27 @@ static bool present_frame_texture()
 static void update_frame_gl(const uint16_t* changedLines)
 {
 	if (changedLines) {
-		const auto framebuf = static_cast<uint8_t *>(sdl.opengl.framebuf);
-		const auto pitch = sdl.opengl.pitch;
+		static std::vector<LineRun> line_runs = {};
+		line_runs.clear();
+
 		int y = 0;
 		size_t index = 0;
 		while (y < sdl.draw.render_height_px) {
 			if (!(index & 1)) {
 				y += changedLines[index];
 			} else {
-				const uint8_t *pixels = framebuf + y * pitch;
 				const int height_px = changedLines[index];
-				glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y,
-				                sdl.draw.render_width_px, height_px, GL_BGRA_EXT,
-				                GL_UNSIGNED_INT_8_8_8_8_REV, pixels);
+				if (height_px > 0) {
+					line_runs.push_back({y, height_px});
+				}
 				y += height_px;
 			}
 			index++;
 		}
+		upload_texture_lines_gl(static_cast<uint8_t*>(sdl.opengl.framebuf),
+		                        sdl.opengl.pitch,
+		                        sdl.draw.render_width_px,
+		                        line_runs);
 	} else {
 		sdl.opengl.actual_frame_count++;
 	}
@@ -2723,6 +3467,7 @@ static bool present_frame_gl()
 		}
 
 		SDL_GL_SwapWindow(sdl.window);
+		record_present_latency();
 	}
 	render_pacer->Checkpoint();
 	return is_presenting;
@@ -2794,6 +3539,8 @@ static void clean_up_sdl_resources()
 static void GUI_ShutDown(Section *)
 {
 	GFX_Stop();
+	stop_present_thread();
+	log_present_latency();
 
 	if (sdl.draw.callback)
 		(sdl.draw.callback)( GFX_CallbackStop );
@@ -2808,6 +3555,13 @@ static void GUI_ShutDown(Section *)
 		sdl.renderer = nullptr;
 	}
 #if C_OPENGL
+	if (pixel_buffers.num_direct_uploads > 0) {
+		LOG_MSG("OPENGL: Uploaded %d frames directly because their pixel "
+		        "buffer was still in use",
+		        pixel_buffers.num_direct_uploads);
+	}
+	destroy_pixel_buffers();
+
 	if (sdl.opengl.context) {
 		SDL_GL_DeleteContext(sdl.opengl.context);
 		sdl.opengl.context = nullptr;
@@ -3330,6 +4084,34 @@ static void set_output(Section* sec, const bool wants_aspect_ratio_correction)
 			        "glUseProgram");
 			glVertexAttribPointer = (PFNGLVERTEXATTRIBPOINTERPROC)
 			        SDL_GL_GetProcAddress("glVertexAttribPointer");
+
+			glBindBuffer = (PFNGLBINDBUFFERPROC)SDL_GL_GetProcAddress(
+			        "glBindBuffer");
+			glBufferData = (PFNGLBUFFERDATAPROC)SDL_GL_GetProcAddress(
+			        "glBufferData");
+			glBufferStorage = (PFNGLBUFFERSTORAGEPROC)SDL_GL_GetProcAddress(
+			        "glBufferStorage");
+			glClientWaitSync = (PFNGLCLIENTWAITSYNCPROC)SDL_GL_GetProcAddress(
+			        "glClientWaitSync");
+			glDeleteBuffers = (PFNGLDELETEBUFFERSPROC)SDL_GL_GetProcAddress(
+			        "glDeleteBuffers");
+			glDeleteSync = (PFNGLDELETESYNCPROC)SDL_GL_GetProcAddress(
+			        "glDeleteSync");
+			glFenceSync = (PFNGLFENCESYNCPROC)SDL_GL_GetProcAddress(
+			        "glFenceSync");
+			glGenBuffers = (PFNGLGENBUFFERSPROC)SDL_GL_GetProcAddress(
+			        "glGenBuffers");
+			glMapBufferRange = (PFNGLMAPBUFFERRANGEPROC)SDL_GL_GetProcAddress(
+			        "glMapBufferRange");
+			glUnmapBuffer = (PFNGLUNMAPBUFFERPROC)SDL_GL_GetProcAddress(
+			        "glUnmapBuffer");
+
+			// Any pixel buffers belonged to the previous context
+			pixel_buffers.is_enabled = false;
+			pixel_buffers.buffers    = {};
+			pixel_buffers.mapped     = {};
+			pixel_buffers.fences     = {};
+			pixel_buffers.next_index = 0;
 			sdl.opengl.use_shader =
 			        (glAttachShader && glCompileShader &&
 			         glCreateProgram && glDeleteProgram &&
@@ -3355,6 +4137,28 @@ static void set_output(Section* sec, const bool wants_aspect_ratio_correction)
 			        SDL_GL_ExtensionSupported(
 			                "GL_ARB_texture_non_power_of_two");
 
+			// Pixel buffer objects need OpenGL 2.1, and mapping ranges and
+			// sync objects OpenGL 3.2, or the equivalent extensions
+			const auto has_gl_3_2 = gl_version_major > 3 ||
+			                        (gl_version_major == 3 &&
+			                         gl_version_string[1] == '.' &&
+			                         gl_version_string[2] >= '2');
+
+			pixel_buffers.is_supported =
+			        glBindBuffer && glBufferData && glClientWaitSync &&
+			        glDeleteBuffers && glDeleteSync && glFenceSync &&
+			        glGenBuffers && glMapBufferRange && glUnmapBuffer &&
+			        (has_gl_3_2 ||
+			         (SDL_GL_ExtensionSupported("GL_ARB_pixel_buffer_object") &&
+			          SDL_GL_ExtensionSupported("GL_ARB_map_buffer_range") &&
+			          SDL_GL_ExtensionSupported("GL_ARB_sync")));
+
+			pixel_buffers.has_buffer_storage =
+			        glBufferStorage &&
+			        (gl_version_major > 4 ||
+			         (gl_version_major == 4 && gl_version_string[2] >= '4') ||
+			         SDL_GL_ExtensionSupported("GL_ARB_buffer_storage"));
+
 			std::string npot_support_msg = sdl.opengl.npot_textures_supported
 			                                     ? "supported"
 			                                     : "not supported";
@@ -3550,6 +4354,13 @@ static void read_gui_config(Section* sec)
 		            presentation_mode_pref.c_str());
 	}
 
+#if C_OPENGL
+	present_thread.is_enabled = section->Get_bool("threaded_presentation");
+
+	pixel_buffers.is_requested = (section->Get_string("gl_texture_upload") ==
+	                              "pbo");
+#endif
+
 	sdl.desktop.full.display_res = sdl.desktop.full.fixed && (!sdl.desktop.full.width || !sdl.desktop.full.height);
 	if (sdl.desktop.full.display_res) {
 		GFX_ObtainDisplayDimensions();
@@ -3658,6 +4469,7 @@ void GFX_RegenerateWindow(Section *sec) {
 		first_window = false;
 		return;
 	}
+	pause_present_thread();
 	remove_window();
 	set_output(sec, is_aspect_ratio_correction_enabled());
 	GFX_ResetScreen();
@@ -3849,6 +4661,10 @@ bool GFX_Events()
 			};
 			break;
 		case SDL_WINDOWEVENT:
+			// Window events can resize the output or set the GL
+			// viewport
+			pause_present_thread();
+
 			switch (event.window.event) {
 			case SDL_WINDOWEVENT_RESTORED:
 				// LOG_DEBUG("SDL: Window has been restored");
@@ -4473,6 +5289,22 @@ static void config_add_sdl()
 	        "  vfr:   Always present changed DOS frames at a variable frame rate.");
 	pstring->Set_values({"auto", "cfr", "vfr"});
 
+	pbool = sdl_sec->Add_bool("threaded_presentation", on_start, false);
+	pbool->Set_help(
+	        "Upload and present frames on a separate thread so presenting doesn't stall\n"
+	        "the emulation when it blocks on vsync (disabled by default). Only the OpenGL\n"
+	        "outputs support this; the 'texture' outputs always present on the main\n"
+	        "thread.");
+
+	pstring = sdl_sec->Add_string("gl_texture_upload", on_start, "direct");
+	pstring->Set_help(
+	        "Select how the OpenGL outputs upload frames to the GPU:\n"
+	        "  direct:  Upload the changed lines straight from system memory (default).\n"
+	        "  pbo:     Stream the changed lines through a ring of pixel buffer objects\n"
+	        "           so the GPU can copy them asynchronously. Falls back to 'direct'\n"
+	        "           if the driver doesn't support them.");
+	pstring->Set_values({"direct", "pbo"});
+
 	auto pmulti = sdl_sec->AddMultiVal("capture_mouse", deprecated, ",");
 	pmulti->Set_help("Moved to [mouse] section and renamed to 'mouse_capture'.");
 
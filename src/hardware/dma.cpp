@@ -20,6 +20,7 @@
 #include "dosbox.h"
 
 #include <algorithm>
+#include <array>
 #include <cstring>
 #include <memory>
 
@@ -53,11 +54,13 @@ static void UpdateEMSMapping()
 	}
 }
 
-// Generic function to read or write a block of data to or from memory.
-// Don't use this directly; call two helpers: DMA_BlockRead or DMA_BlockWrite
-static void perform_dma_io(const DmaDirection direction, const PhysPt spage,
-                           PhysPt mem_address, void* const data_start,
-                           const size_t num_words, const uint8_t is_dma16)
+// Calls the visitor with each piece of the transfer that's contiguous in
+// guest memory, in order: visit(chunk_start, chunk_bytes). Pieces end at
+// page boundaries, as pages in the first MB can be remapped by EMS.
+template <typename Visitor>
+static void for_each_dma_chunk(const PhysPt spage, PhysPt mem_address,
+                               const size_t num_words, const uint8_t is_dma16,
+                               Visitor&& visit)
 {
 	assert(is_dma16 == 0 || is_dma16 == 1);
 
@@ -66,12 +69,9 @@ static void perform_dma_io(const DmaDirection direction, const PhysPt spage,
 	// Maybe move the mem_address into the 16-bit range
 	mem_address <<= is_dma16;
 
-	// The data pointer will be incremented per transfer
-	auto data_pt = reinterpret_cast<uint8_t*>(data_start);
-
 	// Convert from DMA 'words' to actual bytes, no greater than 64 KB
-	auto remaining_bytes = check_cast<uint16_t>(num_words << is_dma16);
-	do {
+	auto remaining_bytes = check_cast<uint32_t>(num_words << is_dma16);
+	while (remaining_bytes) {
 		// Find the right EMS page that contains the current address
 		auto page = highpart_addr_page + (mem_address >> 12);
 		if (page < EMM_PAGEFRAME4K) {
@@ -84,32 +84,65 @@ static void perform_dma_io(const DmaDirection direction, const PhysPt spage,
 
 		// Calculate the offset within the page
 		const auto pos_in_page       = mem_address & (dos_pagesize - 1);
-		const auto bytes_to_page_end = check_cast<uint16_t>(
-		        dos_pagesize - pos_in_page);
+		const auto bytes_to_page_end = dos_pagesize - pos_in_page;
 		const auto chunk_start = check_cast<PhysPt>(page * dos_pagesize +
 		                                            pos_in_page);
 
 		// Determine how many bytes to transfer within this page
 		const auto chunk_bytes = std::min(remaining_bytes, bytes_to_page_end);
 
+		visit(chunk_start, chunk_bytes);
+
+		mem_address += chunk_bytes;
+		remaining_bytes -= chunk_bytes;
+	}
+}
+
+// Returns the host memory backing the chunk, or nullptr if it lies (partly)
+// outside of the emulated RAM. Such chunks are read as 0xff and writes to them
+// are dropped, rather than going past the end of MemBase.
+static uint8_t* get_host_chunk(const PhysPt chunk_start, const uint32_t chunk_bytes)
+{
+	const auto ram_bytes = static_cast<uint64_t>(MEM_TotalPages()) * dos_pagesize;
+	if (static_cast<uint64_t>(chunk_start) + chunk_bytes > ram_bytes) {
+		return nullptr;
+	}
+	return MemBase + chunk_start;
+}
+
+// Generic function to read or write a block of data to or from memory.
+// Don't use this directly; call two helpers: DMA_BlockRead or DMA_BlockWrite
+static void perform_dma_io(const DmaDirection direction, const PhysPt spage,
+                           const PhysPt mem_address, void* const data_start,
+                           const size_t num_words, const uint8_t is_dma16)
+{
+	// The data pointer will be incremented per transfer
+	auto data_pt = reinterpret_cast<uint8_t*>(data_start);
+
+	auto transfer_chunk = [&](const PhysPt chunk_start, const uint32_t chunk_bytes) {
+		const auto host_chunk = get_host_chunk(chunk_start, chunk_bytes);
+
 		// Copy the data from the page address into the data pointer
 		if (direction == DmaDirection::Read) {
-			for (auto i = 0; i < chunk_bytes; ++i) {
-				data_pt[i] = phys_readb(chunk_start + i);
+			if (host_chunk) {
+				std::memcpy(data_pt, host_chunk, chunk_bytes);
+			} else {
+				// Nothing's there to drive the bus
+				std::memset(data_pt, 0xff, chunk_bytes);
 			}
 		}
 
 		// Copy the data from the data pointer into the page address
 		else if (direction == DmaDirection::Write) {
-			for (auto i = 0; i < chunk_bytes; ++i) {
-				phys_writeb(chunk_start + i, data_pt[i]);
+			if (host_chunk) {
+				std::memcpy(host_chunk, data_pt, chunk_bytes);
 			}
 		}
 
-		mem_address += chunk_bytes;
 		data_pt += chunk_bytes;
-		remaining_bytes -= chunk_bytes;
-	} while (remaining_bytes);
+	};
+
+	for_each_dma_chunk(spage, mem_address, num_words, is_dma16, transfer_chunk);
 }
 
 void TANDYSOUND_ShutDown(Section* = nullptr);
@@ -421,35 +454,24 @@ void DmaChannel::ClearRequest()
 	has_raised_request = false;
 }
 
-size_t DmaChannel::Read(const size_t words, uint8_t* const dest_buffer)
-{
-	return ReadOrWrite(DmaDirection::Read, words, dest_buffer);
-}
-
-size_t DmaChannel::Write(const size_t words, uint8_t* const src_buffer)
-{
-	return ReadOrWrite(DmaDirection::Write, words, src_buffer);
-}
-
-size_t DmaChannel::ReadOrWrite(const DmaDirection direction, const size_t words,
-                               uint8_t* const buffer)
+// Advances the channel by the requested words, handing each contiguous run of
+// DMA addresses to transfer(addr, num_words), and handles the terminal count
+template <typename Transfer>
+size_t DmaChannel::ReadOrWrite(const size_t words, Transfer&& transfer)
 {
 	auto want     = check_cast<uint16_t>(words);
 	uint16_t done = 0;
 	curr_addr &= dma_wrapping;
 
-	// incremented per transfer
-	auto curr_buffer = buffer;
 again:
 	Bitu left = (curr_count + 1);
 	if (want < left) {
-		perform_dma_io(direction, page_base, curr_addr, curr_buffer, want, is_16bit);
+		transfer(curr_addr, want);
 		done += want;
 		curr_addr += want;
 		curr_count -= want;
 	} else {
-		perform_dma_io(direction, page_base, curr_addr, curr_buffer, left, is_16bit);
-		curr_buffer += left << is_16bit;
+		transfer(curr_addr, check_cast<uint16_t>(left));
 		want -= left;
 		done += left;
 		ReachedTerminalCount();
@@ -471,6 +493,52 @@ again:
 	return done;
 }
 
+size_t DmaChannel::Read(const size_t words, uint8_t* const dest_buffer)
+{
+	// incremented per transfer
+	auto curr_buffer = dest_buffer;
+
+	return ReadOrWrite(words, [&](const PhysPt addr, const uint16_t num_words) {
+		perform_dma_io(DmaDirection::Read, page_base, addr, curr_buffer, num_words, is_16bit);
+		curr_buffer += num_words << is_16bit;
+	});
+}
+
+size_t DmaChannel::Write(const size_t words, uint8_t* const src_buffer)
+{
+	// incremented per transfer
+	auto curr_buffer = src_buffer;
+
+	return ReadOrWrite(words, [&](const PhysPt addr, const uint16_t num_words) {
+		perform_dma_io(DmaDirection::Write, page_base, addr, curr_buffer, num_words, is_16bit);
+		curr_buffer += num_words << is_16bit;
+	});
+}
+
+size_t DmaChannel::ReadSpans(const size_t words, const DmaSpanReader& reader)
+{
+	assert(reader);
+
+	// Read for the rare pieces outside of the emulated RAM, where nothing
+	// drives the bus
+	static const auto open_bus = [] {
+		std::array<uint8_t, dos_pagesize> bytes = {};
+		bytes.fill(0xff);
+		return bytes;
+	}();
+
+	return ReadOrWrite(words, [&](const PhysPt addr, const uint16_t num_words) {
+		auto read_chunk = [&](const PhysPt chunk_start, const uint32_t chunk_bytes) {
+			if (const auto host_chunk = get_host_chunk(chunk_start, chunk_bytes)) {
+				reader({host_chunk, chunk_bytes});
+			} else {
+				reader({open_bus.data(), chunk_bytes});
+			}
+		};
+		for_each_dma_chunk(page_base, addr, num_words, is_16bit, read_chunk);
+	});
+}
+
 bool DmaChannel::HasReservation() const
 {
 	return (reservation_callback && !reservation_owner.empty());
@@ -68,6 +68,9 @@ packetBuffer incomingPacket;
 static uint16_t socketCount;
 static uint16_t opensockets[SOCKTABLESIZE];
 
+// Most datagrams handed to the program per emulated millisecond
+static int packets_per_tick = 1;
+
 static uint16_t swapByte(uint16_t sockNum) {
 	return (((sockNum>> 8)) | (sockNum << 8));
 }
@@ -572,7 +575,8 @@ static void pingSend(void) {
 		LOG_MSG("IPX: Failed to send a ping packet: %s", SDLNet_GetError());
 }
 
-static void receivePacket(uint8_t *buffer, int16_t bufSize) {
+// Returns false if no ECB was listening, so the packet was lost
+static bool receivePacket(uint8_t *buffer, int16_t bufSize) {
 	ECBClass *useECB;
 	ECBClass *nextECB;
 	uint16_t *bufword = (uint16_t *)buffer;
@@ -589,7 +593,7 @@ static void receivePacket(uint8_t *buffer, int16_t bufSize) {
 			IPaddress tmpAddr;
 			UnpackIP(tmpHeader->src.addr.byIP, &tmpAddr);
 			pingAck(tmpAddr);
-			return;
+			return true;
 		}
 	}
 
@@ -600,23 +604,55 @@ static void receivePacket(uint8_t *buffer, int16_t bufSize) {
 		if(useECB->iuflag == USEFLAG_LISTENING && useECB->mysocket == useSocket) {
 			useECB->writeDataBuffer(buffer, bufSize);
 			useECB->NotifyESR();
-			return;
+			return true;
 		}
 		useECB = nextECB;
 	}
 	LOG_IPX("IPX: RX Packet loss!");
+	return false;
 }
 
-static void IPX_ClientLoop(void) {
-	int numrecv;
-	UDPpacket inPacket;
-	inPacket.data = (Uint8 *)recvBuffer;
-	inPacket.maxlen = IPXBUFFERSIZE;
-	inPacket.channel = UDPChannel;
+int IPX_ReceivePendingPackets(UDPsocket socket, const int channel,
+                              uint8_t* buffer, const int buffer_size,
+                              const int max_packets,
+                              const std::function<bool(uint8_t*, int)>& on_packet)
+{
+	UDPpacket packet = {};
+	packet.data      = buffer;
+	packet.maxlen    = buffer_size;
+
+	int num_received = 0;
+	while (num_received < max_packets) {
+		// SDL_net overwrites the channel with the sender's
+		packet.channel = channel;
+
+		// Returns 0 once the socket is empty, and -1 on errors
+		if (SDLNet_UDP_Recv(socket, &packet) <= 0) {
+			break;
+		}
+		++num_received;
+		if (!on_packet(packet.data, packet.len)) {
+			break;
+		}
+	}
+	return num_received;
+}
 
+static void IPX_ClientLoop(void) {
 	// Its amazing how much simpler UDP is than TCP
-	numrecv = SDLNet_UDP_Recv(ipxClientSocket, &inPacket);
-	if(numrecv) receivePacket(inPacket.data, inPacket.len);
+	//
+	// Hand over everything that arrived since the last tick, so bursts
+	// from busy games don't queue up in the socket buffer. If no ECB was
+	// listening for a packet, the rest wait until the next tick to give
+	// the program a chance to post more.
+	IPX_ReceivePendingPackets(ipxClientSocket,
+	                          UDPChannel,
+	                          recvBuffer,
+	                          IPXBUFFERSIZE,
+	                          packets_per_tick,
+	                          [](uint8_t* data, const int len) {
+		                          return receivePacket(data, check_cast<int16_t>(len));
+	                          });
 }
 
 
@@ -1025,15 +1061,21 @@ public:
 					WriteOut("DISCONNECTED\n");
 				}
 				if(isIpxServer) {
+					const auto status = IPX_GetServerStatus();
 					WriteOut("List of active connections:\n\n");
-					int i;
-					IPaddress *ptrAddr;
-					for(i=0;i<SOCKETTABLESIZE;i++) {
-						if(IPX_isConnectedToServer(i,&ptrAddr)) {
-							WriteOut("     %d.%d.%d.%d from port %d\n", CONVIP(ptrAddr->host), SDLNet_Read16(&ptrAddr->port));
-						}
+					for (const auto& peer : status.peers) {
+						WriteOut("     %d.%d.%d.%d from port %d, %" PRIu64 " packets, %.2f ms latency (%.2f ms max)\n",
+						         CONVIP(peer.address.host),
+						         SDLNet_Read16(&peer.address.port),
+						         peer.num_packets,
+						         peer.average_latency_ms,
+						         peer.max_latency_ms);
 					}
-					WriteOut("\n");
+					WriteOut("\nPackets relayed: %" PRIu64 " of %" PRIu64 " (%.0f per second), %" PRIu64 " dropped\n\n",
+					         status.num_sent,
+					         status.num_received,
+					         status.packets_per_second,
+					         status.num_dropped);
 				}
 				return;
 			}
@@ -1110,6 +1152,8 @@ public:
 		if (section && !section->Get_bool("ipx"))
 			return;
 
+		packets_per_tick = section->Get_int("ipx_packets_per_tick");
+
 		if (!NetWrapper_InitializeSDLNet())
 			return;
 
@@ -20,27 +20,107 @@
 
 #if C_IPX
 
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <cinttypes>
+#include <mutex>
 #include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include "ipx.h"
 #include "ipxserver.h"
 #include "timer.h"
 
+// On Linux the relay talks to its socket directly so it can wait on epoll and
+// move whole batches of datagrams per system call; elsewhere it goes through
+// SDL_net one datagram at a time.
+#if defined(LINUX)
+#define IPX_SERVER_EPOLL 1
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
 static constexpr int UDP_UNICAST = -1; // SDLNet magic number
 
-static IPaddress ipxServerIp;     // IPAddress for server's listening port
-static UDPsocket ipxServerSocket; // Listening server socket
-static SDLNet_SocketSet socket_set = nullptr;
+// Datagrams received (and sent) per system call on the batching path
+static constexpr int BatchSize = 64;
 
-static packetBuffer connBuffer[SOCKETTABLESIZE];
+// Each client gets its own IPX node address (its IP and port), so there's no
+// inherent limit; this only stops a runaway client from growing the table.
+static constexpr size_t MaxPeers = 256;
+
+static IPaddress ipxServerIp;               // IPAddress for server's listening port
+static UDPsocket ipxServerSocket = nullptr; // Listening server socket
+static SDLNet_SocketSet socket_set = nullptr;
 
 static uint8_t inBuffer[IPXBUFFERSIZE];
-static IPaddress ipconn[SOCKETTABLESIZE]; // Active TCP/IP connection
 
 static std::thread ipx_server_thread;
 static std::atomic_bool ipx_server_running = false;
 
+// A registered client along with what the relay has seen of it
+struct IpxPeer {
+	IPaddress address = {};
+
+	uint64_t num_packets     = 0;
+	uint64_t num_forwards    = 0;
+	int64_t total_latency_us = 0;
+	int64_t max_latency_us   = 0;
+};
+
+// Every unicast packet is routed by its destination address, so the peers are
+// hashed on it rather than scanned for. The nodes are stable, so the pointers
+// held by queued packets stay valid as peers join.
+static std::unordered_map<uint64_t, IpxPeer> peers = {};
+
+static struct {
+	uint64_t num_received = 0;
+	uint64_t num_sent     = 0;
+	uint64_t num_dropped  = 0;
+
+	// The rate is sampled over roughly the last second
+	int64_t sampled_at_us         = 0;
+	uint64_t sampled_num_received = 0;
+	double packets_per_second     = 0.0;
+} server_stats = {};
+
+// The server thread owns the peers and the counters; IPXNET STATUS takes this
+// to read them
+static std::mutex server_mutex;
+
+// A copy of a received packet waiting to be relayed to one peer. The payload
+// stays in the receive buffer until the queue is flushed.
+struct OutgoingPacket {
+	IPaddress address   = {};
+	const uint8_t* data = nullptr;
+	int len             = 0;
+	IpxPeer* source     = nullptr;
+	int64_t received_us = 0;
+};
+
+static std::vector<OutgoingPacket> outgoing = {};
+
+#if defined(IPX_SERVER_EPOLL)
+static struct {
+	int socket_fd = -1;
+	int epoll_fd  = -1;
+	int wake_fd   = -1;
+} native = {};
+#endif
+
+static uint64_t to_peer_key(const uint32_t host, const uint16_t port)
+{
+	return (static_cast<uint64_t>(host) << 16) | port;
+}
+
 uint8_t packetCRC(uint8_t* buffer, uint16_t bufSize)
 {
 	uint8_t tmpCRC = 0;
@@ -52,79 +132,141 @@ uint8_t packetCRC(uint8_t* buffer, uint16_t bufSize)
 	return tmpCRC;
 }
 
-/*
-static void closeSocket(uint16_t sockidx) {
-	uint32_t host;
+static bool send_now(const IPaddress& address, const uint8_t* data, const int len)
+{
+#if defined(IPX_SERVER_EPOLL)
+	if (native.socket_fd >= 0) {
+		sockaddr_in dest     = {};
+		dest.sin_family      = AF_INET;
+		dest.sin_addr.s_addr = address.host;
+		dest.sin_port        = address.port;
+		const auto result    = sendto(native.socket_fd,
+                                           data,
+                                           static_cast<size_t>(len),
+                                           MSG_DONTWAIT,
+                                           reinterpret_cast<sockaddr*>(&dest),
+                                           sizeof(dest));
+		if (result < 0) {
+			LOG_MSG("IPXSERVER: %s", strerror(errno));
+			return false;
+		}
+		return true;
+	}
+#endif
+	UDPpacket packet = {};
+	packet.channel   = UDP_UNICAST;
+	packet.data      = const_cast<uint8_t*>(data);
+	packet.len       = len;
+	packet.maxlen    = len;
+	packet.address   = address;
+	if (SDLNet_UDP_Send(ipxServerSocket, UDP_UNICAST, &packet) == 0) {
+		LOG_MSG("IPXSERVER: %s", SDLNet_GetError());
+		return false;
+	}
+	return true;
+}
 
-	host = ipconn[sockidx].host;
-	LOG_MSG("IPXSERVER: %d.%d.%d.%d disconnected", CONVIP(host));
+static void record_forward(const OutgoingPacket& packet, const int64_t now_us)
+{
+	if (!packet.source) {
+		return;
+	}
+	const auto latency_us = std::max<int64_t>(now_us - packet.received_us, 0);
 
-	SDLNet_TCP_DelSocket(serverSocketSet,tcpconn[sockidx]);
-	SDLNet_TCP_Close(tcpconn[sockidx]);
-	connBuffer[sockidx].connected = false;
-	connBuffer[sockidx].waitsize = false;
+	auto& peer = *packet.source;
+	++peer.num_forwards;
+	peer.total_latency_us += latency_us;
+	peer.max_latency_us = std::max(peer.max_latency_us, latency_us);
 }
-*/
-
-static void sendIPXPacket(uint8_t *buffer, int16_t bufSize) {
-	uint16_t srcport, destport;
-	uint32_t srchost, desthost;
-	UDPpacket outPacket;
-	outPacket.channel = -1;
-	outPacket.data = buffer;
-	outPacket.len = bufSize;
-	outPacket.maxlen = bufSize;
-	IPXHeader *tmpHeader;
-	tmpHeader = (IPXHeader *)buffer;
-
-	srchost = tmpHeader->src.addr.byIP.host;
-	desthost = tmpHeader->dest.addr.byIP.host;
-
-	srcport = tmpHeader->src.addr.byIP.port;
-	destport = tmpHeader->dest.addr.byIP.port;
-
-	if(desthost == 0xffffffff) {
-		// Broadcast
-		for (uint16_t i = 0; i < SOCKETTABLESIZE; ++i) {
-			if(connBuffer[i].connected && ((ipconn[i].host != srchost)||(ipconn[i].port!=srcport))) {
-				outPacket.address = ipconn[i];
-				const int result = SDLNet_UDP_Send(ipxServerSocket,
-				                                   UDP_UNICAST,
-				                                   &outPacket);
-				if (result == 0) {
-					LOG_MSG("IPXSERVER: %s", SDLNet_GetError());
-					continue;
-				}
-				//LOG_MSG("IPXSERVER: Packet of %d bytes sent from %d.%d.%d.%d to %d.%d.%d.%d (BROADCAST) (%x CRC)", bufSize, CONVIP(srchost), CONVIP(ipconn[i].host), packetCRC(&buffer[30], bufSize-30));
-			}
+
+#if defined(IPX_SERVER_EPOLL)
+static void flush_outgoing_batched()
+{
+	std::array<mmsghdr, BatchSize> msgs   = {};
+	std::array<iovec, BatchSize> iovs     = {};
+	std::array<sockaddr_in, BatchSize> to = {};
+
+	size_t first = 0;
+	while (first < outgoing.size()) {
+		const auto count = std::min(outgoing.size() - first,
+		                            static_cast<size_t>(BatchSize));
+		for (size_t i = 0; i < count; ++i) {
+			const auto& packet = outgoing[first + i];
+
+			to[i]                 = {};
+			to[i].sin_family      = AF_INET;
+			to[i].sin_addr.s_addr = packet.address.host;
+			to[i].sin_port        = packet.address.port;
+
+			iovs[i].iov_base = const_cast<uint8_t*>(packet.data);
+			iovs[i].iov_len  = static_cast<size_t>(packet.len);
+
+			msgs[i]                     = {};
+			msgs[i].msg_hdr.msg_name    = &to[i];
+			msgs[i].msg_hdr.msg_namelen = sizeof(to[i]);
+			msgs[i].msg_hdr.msg_iov     = &iovs[i];
+			msgs[i].msg_hdr.msg_iovlen  = 1;
 		}
-	} else {
-		// Specific address
-		for (uint16_t i = 0; i < SOCKETTABLESIZE; ++i) {
-			if((connBuffer[i].connected) && (ipconn[i].host == desthost) && (ipconn[i].port == destport)) {
-				outPacket.address = ipconn[i];
-				const int result = SDLNet_UDP_Send(ipxServerSocket,
-				                                   UDP_UNICAST,
-				                                   &outPacket);
-				if (result == 0) {
-					LOG_MSG("IPXSERVER: %s", SDLNet_GetError());
-					continue;
-				}
-				//LOG_MSG("IPXSERVER: Packet sent from %d.%d.%d.%d to %d.%d.%d.%d", CONVIP(srchost), CONVIP(desthost));
-			}
+
+		const auto num_sent = sendmmsg(native.socket_fd,
+		                               msgs.data(),
+		                               static_cast<unsigned int>(count),
+		                               MSG_DONTWAIT);
+		const auto now_us = GetTicksUs();
+		if (num_sent <= 0) {
+			// The first one failed (most likely the send buffer is
+			// full); drop it rather than stall the other peers
+			++server_stats.num_dropped;
+			++first;
+			continue;
 		}
+		for (auto i = 0; i < num_sent; ++i) {
+			record_forward(outgoing[first + i], now_us);
+		}
+		server_stats.num_sent += static_cast<uint64_t>(num_sent);
+		first += static_cast<size_t>(num_sent);
 	}
+	outgoing.clear();
 }
+#endif
 
-bool IPX_isConnectedToServer(Bits tableNum, IPaddress ** ptrAddr) {
-	if(tableNum >= SOCKETTABLESIZE) return false;
-	*ptrAddr = &ipconn[tableNum];
-	return connBuffer[tableNum].connected;
+static void flush_outgoing()
+{
+#if defined(IPX_SERVER_EPOLL)
+	if (native.socket_fd >= 0) {
+		flush_outgoing_batched();
+		return;
+	}
+#endif
+	for (const auto& packet : outgoing) {
+		if (send_now(packet.address, packet.data, packet.len)) {
+			record_forward(packet, GetTicksUs());
+			++server_stats.num_sent;
+		} else {
+			++server_stats.num_dropped;
+		}
+	}
+	outgoing.clear();
+}
+
+static void update_rate()
+{
+	const auto now_us     = GetTicksUs();
+	const auto elapsed_us = now_us - server_stats.sampled_at_us;
+	if (elapsed_us < 1'000'000) {
+		return;
+	}
+	const auto num_new = server_stats.num_received -
+	                     server_stats.sampled_num_received;
+
+	server_stats.packets_per_second = static_cast<double>(num_new) * 1e6 /
+	                                  static_cast<double>(elapsed_us);
+	server_stats.sampled_at_us        = now_us;
+	server_stats.sampled_num_received = server_stats.num_received;
 }
 
 static void ackClient(IPaddress clientAddr) {
 	IPXHeader regHeader = {};
-	UDPpacket regPacket;
 
 	SDLNet_Write16(0xffff, regHeader.checkSum);
 	SDLNet_Write16(sizeof(regHeader), regHeader.length);
@@ -138,127 +280,431 @@ static void ackClient(IPaddress clientAddr) {
 	SDLNet_Write16(0x2, regHeader.src.socket);
 	regHeader.transControl = 0;
 
-	regPacket.data = (Uint8 *)&regHeader;
-	regPacket.len = sizeof(regHeader);
-	regPacket.maxlen = sizeof(regHeader);
-	regPacket.address = clientAddr;
 	// Send registration string to client.  If client doesn't get this, client will not be registered
-	const int result = SDLNet_UDP_Send(ipxServerSocket, UDP_UNICAST, &regPacket);
-	if (result == 0)
-		LOG_MSG("IPXSERVER: Connection response not sent: %s",
-		        SDLNet_GetError());
+	if (!send_now(clientAddr,
+	              reinterpret_cast<const uint8_t*>(&regHeader),
+	              sizeof(regHeader))) {
+		LOG_MSG("IPXSERVER: Connection response not sent");
+	}
+}
+
+static void register_peer(const IPaddress& address)
+{
+	const auto key = to_peer_key(address.host, address.port);
+
+	if (peers.find(key) != peers.end()) {
+		LOG_MSG("IPXSERVER: Reconnect from %d.%d.%d.%d", CONVIP(address.host));
+	} else if (peers.size() >= MaxPeers) {
+		LOG_WARNING("IPXSERVER: Refused connection from %d.%d.%d.%d, already serving %d clients",
+		            CONVIP(address.host),
+		            static_cast<int>(MaxPeers));
+		++server_stats.num_dropped;
+		return;
+	} else {
+		IpxPeer peer = {};
+		peer.address = address;
+		peers.emplace(key, peer);
+		LOG_MSG("IPXSERVER: Connect from %d.%d.%d.%d", CONVIP(address.host));
+	}
+	ackClient(address);
 }
 
-static void IPX_ServerLoop() {
-	UDPpacket inPacket;
-	IPaddress tmpAddr;
-
-	//char regString[] = "IPX Register\0";
-
-	uint32_t host;
-
-	inPacket.channel = -1;
-	inPacket.data = &inBuffer[0];
-	inPacket.maxlen = IPXBUFFERSIZE;
-
-	const int result = SDLNet_UDP_Recv(ipxServerSocket, &inPacket);
-	if (result != 0) {
-		// Check to see if incoming packet is a registration packet
-		// For this, I just spoofed the echo protocol packet designation 0x02
-		IPXHeader *tmpHeader;
-		tmpHeader = (IPXHeader *)&inBuffer[0];
-
-		// Check to see if echo packet
-		if(SDLNet_Read16(tmpHeader->dest.socket) == 0x2) {
-			// Null destination node means its a server registration packet
-			if(tmpHeader->dest.addr.byIP.host == 0x0) {
-				UnpackIP(tmpHeader->src.addr.byIP, &tmpAddr);
-				for (uint16_t i = 0; i < SOCKETTABLESIZE; ++i) {
-					if(!connBuffer[i].connected) {
-						// Use prefered host IP rather than the reported source IP
-						// It may be better to use the reported source
-						ipconn[i] = inPacket.address;
-
-						connBuffer[i].connected = true;
-						host = ipconn[i].host;
-						LOG_MSG("IPXSERVER: Connect from %d.%d.%d.%d", CONVIP(host));
-						ackClient(inPacket.address);
-						return;
-					} else {
-						if((ipconn[i].host == tmpAddr.host) && (ipconn[i].port == tmpAddr.port)) {
-
-							LOG_MSG("IPXSERVER: Reconnect from %d.%d.%d.%d", CONVIP(tmpAddr.host));
-							// Update anonymous port number if changed
-							ipconn[i].port = inPacket.address.port;
-							ackClient(inPacket.address);
-							return;
-						}
-					}
-				}
+static void queue_to_peer(IpxPeer& dest, const uint8_t* data, const int len,
+                          IpxPeer* source, const int64_t received_us)
+{
+	OutgoingPacket packet = {};
+	packet.address        = dest.address;
+	packet.data           = data;
+	packet.len            = len;
+	packet.source         = source;
+	packet.received_us    = received_us;
+	outgoing.push_back(packet);
+}
+
+// Interprets the IPX header and queues the packet for the peers it's
+// addressed to. The data must stay valid until the queue is flushed.
+static void relay_packet(const uint8_t* data, const int len,
+                         const IPaddress& from, const int64_t received_us)
+{
+	++server_stats.num_received;
+
+	if (len < static_cast<int>(sizeof(IPXHeader))) {
+		++server_stats.num_dropped;
+		return;
+	}
+	const auto header = reinterpret_cast<const IPXHeader*>(data);
+
+	// Check to see if incoming packet is a registration packet
+	// For this, I just spoofed the echo protocol packet designation 0x02
+	// Null destination node means its a server registration packet
+	if (SDLNet_Read16(header->dest.socket) == 0x2 &&
+	    header->dest.addr.byIP.host == 0x0) {
+		// Use the address the packet came from rather than the one the
+		// client reports, which is unknown to it until it's registered
+		register_peer(from);
+		return;
+	}
+
+	const auto source_it = peers.find(to_peer_key(from.host, from.port));
+	const auto source = (source_it != peers.end()) ? &source_it->second
+	                                               : nullptr;
+	if (source) {
+		++source->num_packets;
+	}
+
+	const auto srchost  = header->src.addr.byIP.host;
+	const auto srcport  = header->src.addr.byIP.port;
+	const auto desthost = header->dest.addr.byIP.host;
+	const auto destport = header->dest.addr.byIP.port;
+
+	if (desthost == 0xffffffff) {
+		// Broadcast
+		for (auto& [key, peer] : peers) {
+			if (peer.address.host != srchost || peer.address.port != srcport) {
+				queue_to_peer(peer, data, len, source, received_us);
 			}
 		}
+		return;
+	}
 
-		// IPX packet is complete.  Now interpret IPX header and send to respective IP address
-		sendIPXPacket((uint8_t*)inPacket.data,
-		              static_cast<int16_t>(inPacket.len));
+	// Specific address
+	const auto dest_it = peers.find(to_peer_key(desthost, destport));
+	if (dest_it == peers.end()) {
+		++server_stats.num_dropped;
+		return;
 	}
+	queue_to_peer(dest_it->second, data, len, source, received_us);
 }
 
-void IPX_StopServer() {
-	ipx_server_running = false;
+static void IPX_ServerLoop()
+{
+	UDPpacket inPacket = {};
+	inPacket.channel   = -1;
+	inPacket.data      = &inBuffer[0];
+	inPacket.maxlen    = IPXBUFFERSIZE;
+
+	// Relay everything that's waiting, within reason, before checking the
+	// socket set again
+	for (auto i = 0; i < BatchSize; ++i) {
+		if (SDLNet_UDP_Recv(ipxServerSocket, &inPacket) <= 0) {
+			break;
+		}
+		const auto received_us = GetTicksUs();
 
-	if (ipx_server_thread.joinable()) {
-		ipx_server_thread.join();
+		const std::lock_guard lock(server_mutex);
+		relay_packet(inPacket.data, inPacket.len, inPacket.address, received_us);
+		flush_outgoing();
+		update_rate();
 	}
+}
 
-	SDLNet_FreeSocketSet(socket_set);
-	SDLNet_UDP_Close(ipxServerSocket);
-	socket_set = nullptr;
+#if defined(IPX_SERVER_EPOLL)
+
+static int64_t to_us(const timespec& ts)
+{
+	return static_cast<int64_t>(ts.tv_sec) * 1'000'000 + ts.tv_nsec / 1'000;
 }
 
-bool IPX_StartServer(uint16_t portnum)
+// Receives up to a batch of datagrams and relays them. Returns false once the
+// socket has been drained.
+static bool relay_native_batch()
 {
-	if (!SDLNet_ResolveHost(&ipxServerIp, nullptr, portnum)) {
-		//serverSocketSet = SDLNet_AllocSocketSet(SOCKETTABLESIZE);
-		ipxServerSocket = SDLNet_UDP_Open(portnum);
-		if(!ipxServerSocket) return false;
+	static uint8_t buffers[BatchSize][IPXBUFFERSIZE];
+
+	// Room for the kernel's receive timestamp
+	constexpr auto ControlSize = CMSG_SPACE(sizeof(timespec));
+	alignas(cmsghdr) static uint8_t controls[BatchSize][ControlSize];
+
+	std::array<mmsghdr, BatchSize> msgs     = {};
+	std::array<iovec, BatchSize> iovs       = {};
+	std::array<sockaddr_in, BatchSize> from = {};
+
+	for (auto i = 0; i < BatchSize; ++i) {
+		iovs[i].iov_base = buffers[i];
+		iovs[i].iov_len  = IPXBUFFERSIZE;
+
+		msgs[i].msg_hdr.msg_name       = &from[i];
+		msgs[i].msg_hdr.msg_namelen    = sizeof(from[i]);
+		msgs[i].msg_hdr.msg_iov        = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen     = 1;
+		msgs[i].msg_hdr.msg_control    = controls[i];
+		msgs[i].msg_hdr.msg_controllen = ControlSize;
+	}
 
-		for (auto& i : connBuffer) {
-			i.connected = false;
+	const auto num_received = recvmmsg(native.socket_fd,
+	                                   msgs.data(),
+	                                   BatchSize,
+	                                   MSG_DONTWAIT,
+	                                   nullptr);
+	if (num_received <= 0) {
+		if (num_received < 0 && errno != EAGAIN && errno != EWOULDBLOCK &&
+		    errno != EINTR) {
+			LOG_ERR("IPXSERVER: %s", strerror(errno));
 		}
+		return false;
+	}
 
-		if (!socket_set) {
-			socket_set = SDLNet_AllocSocketSet(1);
-			if (!socket_set) {
-				LOG_ERR("IPXSERVER: %s", SDLNet_GetError());
-				return false;
+	// The kernel stamps packets with the wall clock, so we work out how
+	// long ago that was and take it off our own clock
+	timespec now_real = {};
+	clock_gettime(CLOCK_REALTIME, &now_real);
+	const auto now_real_us = to_us(now_real);
+	const auto now_us      = GetTicksUs();
+
+	const std::lock_guard lock(server_mutex);
+	for (auto i = 0; i < num_received; ++i) {
+		const auto& hdr = msgs[i].msg_hdr;
+
+		auto received_us = now_us;
+		for (auto cmsg = CMSG_FIRSTHDR(&hdr); cmsg;
+		     cmsg       = CMSG_NXTHDR(const_cast<msghdr*>(&hdr), cmsg)) {
+			if (cmsg->cmsg_level == SOL_SOCKET &&
+			    cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+				timespec ts = {};
+				memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+				received_us -= std::max<int64_t>(now_real_us - to_us(ts), 0);
 			}
-			if (SDLNet_UDP_AddSocket(socket_set, ipxServerSocket) == -1) {
-				LOG_ERR("IPXSERVER: %s", SDLNet_GetError());
-				return false;
+		}
+
+		if (hdr.msg_flags & MSG_TRUNC) {
+			// Larger than any IPX packet we'd pass on
+			++server_stats.num_received;
+			++server_stats.num_dropped;
+			continue;
+		}
+
+		IPaddress address = {};
+		address.host      = from[i].sin_addr.s_addr;
+		address.port      = from[i].sin_port;
+
+		relay_packet(buffers[i],
+		             static_cast<int>(msgs[i].msg_len),
+		             address,
+		             received_us);
+	}
+	// The queued packets point into the buffers, so they have to go out
+	// before the next batch is received
+	flush_outgoing();
+	update_rate();
+
+	return num_received == BatchSize;
+}
+
+static void native_server_loop()
+{
+	while (ipx_server_running) {
+		std::array<epoll_event, 2> events = {};
+
+		// Wakes at least once a second to keep the rate current
+		const auto num_events = epoll_wait(native.epoll_fd,
+		                                   events.data(),
+		                                   static_cast<int>(events.size()),
+		                                   1000);
+		if (num_events < 0) {
+			if (errno != EINTR) {
+				LOG_ERR("IPXSERVER: %s", strerror(errno));
 			}
+			continue;
+		}
+		if (num_events == 0) {
+			const std::lock_guard lock(server_mutex);
+			update_rate();
+			continue;
+		}
+		while (ipx_server_running && relay_native_batch()) {
+		}
+	}
+}
+
+static void close_native_server()
+{
+	for (auto fd : {&native.socket_fd, &native.epoll_fd, &native.wake_fd}) {
+		if (*fd >= 0) {
+			close(*fd);
+			*fd = -1;
+		}
+	}
+}
+
+static bool open_native_server(const uint16_t portnum)
+{
+	auto fail = [](const char* what) {
+		LOG_WARNING("IPXSERVER: Can't %s (%s), using SDL_net instead",
+		            what,
+		            strerror(errno));
+		close_native_server();
+		return false;
+	};
+
+	native.socket_fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (native.socket_fd < 0) {
+		return fail("create the socket");
+	}
+
+	sockaddr_in addr     = {};
+	addr.sin_family      = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port        = htons(portnum);
+	if (bind(native.socket_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+		return fail("listen on the port");
+	}
+
+	// Optional; without the timestamps the latency is measured from when
+	// the packet was read rather than when it arrived
+	constexpr int On = 1;
+	setsockopt(native.socket_fd, SOL_SOCKET, SO_TIMESTAMPNS, &On, sizeof(On));
+
+	// Bursts of broadcasts from dozens of clients can outrun the default
+	// buffer between wakeups
+	constexpr int BufferSize = 1024 * 1024;
+	setsockopt(native.socket_fd, SOL_SOCKET, SO_RCVBUF, &BufferSize, sizeof(BufferSize));
+	setsockopt(native.socket_fd, SOL_SOCKET, SO_SNDBUF, &BufferSize, sizeof(BufferSize));
+
+	native.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (native.epoll_fd < 0) {
+		return fail("create the epoll instance");
+	}
+	native.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (native.wake_fd < 0) {
+		return fail("create the wakeup event");
+	}
+
+	for (const auto fd : {native.socket_fd, native.wake_fd}) {
+		epoll_event event = {};
+		event.events      = EPOLLIN;
+		event.data.fd     = fd;
+		if (epoll_ctl(native.epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+			return fail("watch the socket");
 		}
+	}
+	return true;
+}
 
-		if (!ipx_server_running) {
-			ipx_server_running = true;
-			ipx_server_thread  = std::thread([]() {
-                                while (ipx_server_running) {
-                                        const int num_ready = SDLNet_CheckSockets(
-                                                socket_set, 100);
-                                        if (num_ready == -1) {
-                                                LOG_ERR("IPXSERVER: %s",
-                                                        SDLNet_GetError());
-                                                continue;
-                                        }
-                                        if (num_ready > 0) {
-                                                IPX_ServerLoop();
-                                        }
-                                }
-                        });
+#endif
+
+IpxServerStatus IPX_GetServerStatus()
+{
+	const std::lock_guard lock(server_mutex);
+
+	IpxServerStatus status    = {};
+	status.num_received       = server_stats.num_received;
+	status.num_sent           = server_stats.num_sent;
+	status.num_dropped        = server_stats.num_dropped;
+	status.packets_per_second = server_stats.packets_per_second;
+
+	for (const auto& [key, peer] : peers) {
+		IpxServerPeerStatus peer_status = {};
+		peer_status.address             = peer.address;
+		peer_status.num_packets         = peer.num_packets;
+		if (peer.num_forwards) {
+			peer_status.average_latency_ms =
+			        static_cast<double>(peer.total_latency_us) /
+			        static_cast<double>(peer.num_forwards) / 1000.0;
 		}
+		peer_status.max_latency_ms = static_cast<double>(peer.max_latency_us) /
+		                             1000.0;
+		status.peers.push_back(peer_status);
+	}
+	return status;
+}
+
+void IPX_StopServer() {
+	ipx_server_running = false;
+
+#if defined(IPX_SERVER_EPOLL)
+	if (native.wake_fd >= 0) {
+		constexpr uint64_t One = 1;
+		[[maybe_unused]] const auto n = write(native.wake_fd, &One, sizeof(One));
+	}
+#endif
+
+	if (ipx_server_thread.joinable()) {
+		ipx_server_thread.join();
+	}
+
+#if defined(IPX_SERVER_EPOLL)
+	close_native_server();
+#endif
+	if (socket_set) {
+		SDLNet_FreeSocketSet(socket_set);
+		socket_set = nullptr;
+	}
+	if (ipxServerSocket) {
+		SDLNet_UDP_Close(ipxServerSocket);
+		ipxServerSocket = nullptr;
+	}
+
+	const std::lock_guard lock(server_mutex);
+	LOG_MSG("IPXSERVER: Stopped after relaying %" PRIu64 " of %" PRIu64
+	        " packets to %d clients, %" PRIu64 " dropped",
+	        server_stats.num_sent,
+	        server_stats.num_received,
+	        static_cast<int>(peers.size()),
+	        server_stats.num_dropped);
+	peers.clear();
+	server_stats = {};
+}
+
+static bool start_sdl_server(const uint16_t portnum)
+{
+	ipxServerSocket = SDLNet_UDP_Open(portnum);
+	if (!ipxServerSocket) {
+		return false;
+	}
+
+	socket_set = SDLNet_AllocSocketSet(1);
+	if (!socket_set) {
+		LOG_ERR("IPXSERVER: %s", SDLNet_GetError());
+		return false;
+	}
+	if (SDLNet_UDP_AddSocket(socket_set, ipxServerSocket) == -1) {
+		LOG_ERR("IPXSERVER: %s", SDLNet_GetError());
+		return false;
+	}
+
+	ipx_server_running = true;
+	ipx_server_thread  = std::thread([]() {
+                while (ipx_server_running) {
+                        const int num_ready = SDLNet_CheckSockets(socket_set, 100);
+                        if (num_ready == -1) {
+                                LOG_ERR("IPXSERVER: %s", SDLNet_GetError());
+                                continue;
+                        }
+                        if (num_ready > 0) {
+                                IPX_ServerLoop();
+                        } else {
+                                const std::lock_guard lock(server_mutex);
+                                update_rate();
+                        }
+                }
+        });
+	return true;
+}
+
+bool IPX_StartServer(uint16_t portnum)
+{
+	if (ipx_server_running) {
+		return true;
+	}
+	if (SDLNet_ResolveHost(&ipxServerIp, nullptr, portnum)) {
+		return false;
+	}
+
+	{
+		const std::lock_guard lock(server_mutex);
+		peers.clear();
+		server_stats               = {};
+		server_stats.sampled_at_us = GetTicksUs();
+	}
+
+#if defined(IPX_SERVER_EPOLL)
+	if (open_native_server(portnum)) {
+		ipx_server_running = true;
+		ipx_server_thread  = std::thread(native_server_loop);
 		return true;
 	}
-	return false;
+#endif
+	return start_sdl_server(portnum);
 }
 
 #endif
@@ -76,6 +76,9 @@ using matrix = std::array<std::array<T, COLS>, ROWS>;
 
 using HighpassFilter = std::array<Iir::Butterworth::HighPass<2>, 2>;
 
+// Non-interleaved left and right samples
+using AuxBuffer = std::array<std::vector<float>, 2>;
+
 using EmVerb = MVerb<float>;
 
 struct CrossfeedSettings {
@@ -174,9 +177,10 @@ struct MixerSettings {
 	// Output by mix_samples, to be enqueud into the final_output queue
 	std::vector<AudioFrame> output_buffer = {};
 
-	// Temporary mixing buffers
-	std::vector<AudioFrame> reverb_aux_buffer   = {};
-	std::vector<AudioFrame> chorus_aux_buffer   = {};
+	// Temporary mixing buffers. The reverb and chorus sends are kept as
+	// separate left and right channels, which is what the effects process.
+	AuxBuffer reverb_aux_buffer                 = {};
+	AuxBuffer chorus_aux_buffer                 = {};
 	std::vector<int16_t> capture_buffer         = {};
 	std::vector<AudioFrame> fast_forward_buffer = {};
 
@@ -211,6 +215,9 @@ struct MixerSettings {
 	ChorusSettings chorus = {};
 	bool do_chorus        = false;
 
+	// Speex is used if unset
+	std::optional<PolyphaseQuality> polyphase_quality = {};
+
 	bool is_manually_muted = false;
 
 	std::atomic<bool> fast_forward_mode = false;
@@ -944,6 +951,9 @@ void MixerChannel::Enable(const bool should_enable)
 //   - Speex resampling if:
 //   	   channel_rate_hz != mixer_rate_hz
 //
+// "Speex resampling" is done by the polyphase resampler instead if the
+// 'resampler' setting selects one of its qualities.
+//
 void MixerChannel::ConfigureResampler()
 {
 #ifdef DEBUG_MIXER
@@ -959,6 +969,22 @@ void MixerChannel::ConfigureResampler()
 	do_zoh_upsample  = false;
 	do_resample      = false;
 
+	auto configure_polyphase_resampler = [&](const int in_rate_hz) {
+		const auto quality = *mixer.polyphase_quality;
+
+		if (polyphase_resampler && polyphase_resampler->GetQuality() == quality) {
+			polyphase_resampler->SetRates(in_rate_hz, mixer_rate_hz);
+		} else {
+			polyphase_resampler = std::make_unique<PolyphaseResampler>(
+			        in_rate_hz, mixer_rate_hz, quality);
+		}
+
+		LOG_DEBUG("%s: Polyphase resampler is on, input rate: %d Hz, output rate: %d Hz",
+		          name.c_str(),
+		          in_rate_hz,
+		          mixer_rate_hz);
+	};
+
 	auto configure_speex_resampler = [&](const int _in_rate_hz) {
 		const spx_uint32_t in_rate_hz  = _in_rate_hz;
 		const spx_uint32_t out_rate_hz = mixer_rate_hz;
@@ -1010,6 +1036,20 @@ void MixerChannel::ConfigureResampler()
 		          out_rate_hz);
 	};
 
+	// Only one of the two resamplers is kept around
+	auto configure_resampler = [&](const int in_rate_hz) {
+		if (mixer.polyphase_quality) {
+			if (speex_resampler.state) {
+				speex_resampler_destroy(speex_resampler.state);
+				speex_resampler.state = nullptr;
+			}
+			configure_polyphase_resampler(in_rate_hz);
+		} else {
+			polyphase_resampler.reset();
+			configure_speex_resampler(in_rate_hz);
+		}
+	};
+
 	switch (resample_method) {
 	case ResampleMethod::LerpUpsampleOrResample:
 		if (channel_rate_hz < mixer_rate_hz) {
@@ -1021,7 +1061,7 @@ void MixerChannel::ConfigureResampler()
 #endif
 		} else if (channel_rate_hz > mixer_rate_hz) {
 			do_resample = true;
-			configure_speex_resampler(channel_rate_hz);
+			configure_resampler(channel_rate_hz);
 
 		} else {
 			// channel_rate_hz == mixer_rate_hz
@@ -1040,7 +1080,7 @@ void MixerChannel::ConfigureResampler()
 #endif
 			if (zoh_upsampler.target_rate_hz != mixer_rate_hz) {
 				do_resample = true;
-				configure_speex_resampler(zoh_upsampler.target_rate_hz);
+				configure_resampler(zoh_upsampler.target_rate_hz);
 			}
 
 		} else {
@@ -1049,7 +1089,7 @@ void MixerChannel::ConfigureResampler()
 			//
 			if (channel_rate_hz != mixer_rate_hz) {
 				do_resample = true;
-				configure_speex_resampler(channel_rate_hz);
+				configure_resampler(channel_rate_hz);
 			}
 		}
 		break;
@@ -1057,7 +1097,7 @@ void MixerChannel::ConfigureResampler()
 	case ResampleMethod::Resample:
 		if (channel_rate_hz != mixer_rate_hz) {
 			do_resample = true;
-			configure_speex_resampler(channel_rate_hz);
+			configure_resampler(channel_rate_hz);
 		}
 		break;
 	}
@@ -1074,7 +1114,15 @@ void MixerChannel::ClearResampler()
 	if (do_zoh_upsample) {
 		InitZohUpsamplerState();
 	}
-	if (do_resample) {
+	if (do_resample && polyphase_resampler) {
+		polyphase_resampler->Reset();
+
+#ifdef DEBUG_MIXER
+		LOG_DEBUG("%s: Polyphase resampler cleared and primed %d-frame input queue",
+		          name.c_str(),
+		          polyphase_resampler->GetInputLatency());
+#endif
+	} else if (do_resample) {
 		assert(speex_resampler.state);
 		speex_resampler_reset_mem(speex_resampler.state);
 		speex_resampler_skip_zeros(speex_resampler.state);
@@ -1626,6 +1674,14 @@ void MixerChannel::SetResampleMethod(const ResampleMethod method)
 	ConfigureResampler();
 }
 
+void MixerChannel::ResetResampler()
+{
+	std::lock_guard lock(mutex);
+
+	ConfigureResampler();
+	ClearResampler();
+}
+
 void MixerChannel::SetCrossfeedStrength(const float strength)
 {
 	std::lock_guard lock(mutex);
@@ -2155,8 +2211,8 @@ void MixerChannel::AddSamples(const int num_frames, const Type* data)
 	// - No upsampling or resampling
 	// - LERP  upsampling only
 	// - ZoH   upsampling only
-	// - Speex resampling only
-	// - ZoH upsampling followed by Speex resampling
+	// - Speex or polyphase resampling only
+	// - ZoH upsampling followed by Speex or polyphase resampling
 
 	// Zero-order-hold upsampling is performed in
 	// ConvertSamplesAndMaybeZohUpsample to reduce the number of temporary
@@ -2219,6 +2275,9 @@ void MixerChannel::AddSamples(const int num_frames, const Type* data)
 				i += 1;
 			}
 		}
+	} else if (do_resample && polyphase_resampler) {
+		polyphase_resampler->Process(convert_buffer, audio_frames);
+
 	} else if (do_resample) {
 		auto in_frames = check_cast<spx_uint32_t>(convert_buffer.size());
 
@@ -2405,6 +2464,29 @@ static float normalize_sample(float sample)
 	return sample / 32768.0f;
 }
 
+static void add_to_aux_buffer(AuxBuffer& aux_buffer,
+                              const std::vector<AudioFrame>& frames,
+                              const size_t num_frames, const float send_gain)
+{
+	auto& [left, right] = aux_buffer;
+	assert(num_frames <= left.size() && num_frames <= frames.size());
+
+	for (size_t i = 0; i < num_frames; ++i) {
+		left[i] += frames[i].left * send_gain;
+		right[i] += frames[i].right * send_gain;
+	}
+}
+
+static void add_aux_buffer_to_output(const AuxBuffer& aux_buffer)
+{
+	const auto& [left, right] = aux_buffer;
+	assert(left.size() == mixer.output_buffer.size());
+
+	for (size_t i = 0; i < mixer.output_buffer.size(); ++i) {
+		mixer.output_buffer[i] += AudioFrame(left[i], right[i]);
+	}
+}
+
 // Mix a certain amount of new sample frames
 static void mix_samples(const int frames_requested)
 {
@@ -2413,11 +2495,12 @@ static void mix_samples(const int frames_requested)
 	mixer.output_buffer.clear();
 	mixer.output_buffer.resize(frames_requested);
 
-	mixer.reverb_aux_buffer.clear();
-	mixer.reverb_aux_buffer.resize(frames_requested);
-
-	mixer.chorus_aux_buffer.clear();
-	mixer.chorus_aux_buffer.resize(frames_requested);
+	for (auto& samples : mixer.reverb_aux_buffer) {
+		samples.assign(frames_requested, 0.0f);
+	}
+	for (auto& samples : mixer.chorus_aux_buffer) {
+		samples.assign(frames_requested, 0.0f);
+	}
 
 	// Render all channels and accumulate results in the master mixbuffer
 	for (const auto& [_, channel] : mixer.channels) {
@@ -2435,16 +2518,20 @@ static void mix_samples(const int frames_requested)
 			} else {
 				mixer.output_buffer[i] += channel->audio_frames[i];
 			}
+		}
 
-			if (mixer.do_reverb && channel->do_reverb_send) {
-				mixer.reverb_aux_buffer[i] += channel->audio_frames[i] *
-				                              channel->reverb.send_gain;
-			}
+		if (mixer.do_reverb && channel->do_reverb_send) {
+			add_to_aux_buffer(mixer.reverb_aux_buffer,
+			                  channel->audio_frames,
+			                  num_frames,
+			                  channel->reverb.send_gain);
+		}
 
-			if (mixer.do_chorus && channel->do_chorus_send) {
-				mixer.chorus_aux_buffer[i] += channel->audio_frames[i] *
-				                              channel->chorus.send_gain;
-			}
+		if (mixer.do_chorus && channel->do_chorus_send) {
+			add_to_aux_buffer(mixer.chorus_aux_buffer,
+			                  channel->audio_frames,
+			                  num_frames,
+			                  channel->chorus.send_gain);
 		}
 
 		channel->audio_frames.erase(channel->audio_frames.begin(),
@@ -2459,36 +2546,38 @@ static void mix_samples(const int frames_requested)
 		// Apply reverb effect to the reverb aux buffer, then mix the
 		// results to the master output.
 		//
-		for (size_t i = 0; i < mixer.reverb_aux_buffer.size(); ++i) {
-			// High-pass filter the reverb input
-			auto& hpf = mixer.reverb.highpass_filter;
+		auto& [left, right] = mixer.reverb_aux_buffer;
 
-			// MVerb operates on two non-interleaved sample streams
-			AudioFrame in_frame = mixer.reverb_aux_buffer[i];
-			in_frame.left       = hpf[0].filter(in_frame.left);
-			in_frame.right      = hpf[1].filter(in_frame.right);
-
-			float* in_buf[2] = {&in_frame.left, &in_frame.right};
-
-			AudioFrame out_frame = {};
-			float* out_buf[2] = {&out_frame.left, &out_frame.right};
+		// High-pass filter the reverb input
+		auto& hpf = mixer.reverb.highpass_filter;
+		for (auto& sample : left) {
+			sample = hpf[0].filter(sample);
+		}
+		for (auto& sample : right) {
+			sample = hpf[1].filter(sample);
+		}
 
-			constexpr auto NumFrames = 1;
-			mixer.reverb.mverb.process(in_buf, out_buf, NumFrames);
+		// MVerb operates on two non-interleaved sample streams
+		mixer.reverb.mverb.processBlock(left.data(),
+		                                right.data(),
+		                                left.data(),
+		                                right.data(),
+		                                frames_requested);
 
-			mixer.output_buffer[i] += out_frame;
-		}
+		add_aux_buffer_to_output(mixer.reverb_aux_buffer);
 	}
 
 	if (mixer.do_chorus) {
 		// Apply chorus effect to the chorus aux buffer, then mix the
 		// results to the master output.
 		//
-		for (size_t i = 0; i < mixer.chorus_aux_buffer.size(); ++i) {
-			auto frame = mixer.chorus_aux_buffer[i];
-			mixer.chorus.chorus_engine.process(&frame.left, &frame.right);
-			mixer.output_buffer[i] += frame;
-		}
+		auto& [left, right] = mixer.chorus_aux_buffer;
+
+		mixer.chorus.chorus_engine.process(left.data(),
+		                                   right.data(),
+		                                   frames_requested);
+
+		add_aux_buffer_to_output(mixer.chorus_aux_buffer);
 	}
 
 	// Apply high-pass filter to the master output
@@ -2533,8 +2622,8 @@ static void mix_samples(const int frames_requested)
 
 			// We're producing more audio than the capture is
 			// consuming. This usually happens when the main thread
-			// is being slowed down by video encoding (e.g., slow
-			// host CPU or using zlib rather than zlib_ng). Not
+			// is being slowed down (e.g., by a video capture in
+			// 'block' back-pressure mode on a slow host CPU). Not
 			// ideal as this results in an audible "skip forward".
 			// Without this, it's a complete stuttery mess though so
 			// it's the lesser of two evils.
@@ -2912,6 +3001,40 @@ static void init_master_highpass_filter()
 	MIXER_UnlockMixerThread();
 }
 
+static std::optional<PolyphaseQuality> resampler_pref_to_polyphase_quality(
+        const std::string& pref)
+{
+	if (pref == "polyphase-low") {
+		return PolyphaseQuality::Low;
+	}
+	if (pref == "polyphase-medium") {
+		return PolyphaseQuality::Medium;
+	}
+	if (pref == "polyphase-high") {
+		return PolyphaseQuality::High;
+	}
+	if (pref != "speex") {
+		// the conf system programmatically guarantees only the above
+		// prefs are used
+		LOG_WARNING("MIXER: Invalid 'resampler' setting: '%s', using 'speex'",
+		            pref.c_str());
+	}
+	return {};
+}
+
+// Must be called with the mixer thread locked
+static void set_polyphase_quality(const std::optional<PolyphaseQuality> quality)
+{
+	if (mixer.polyphase_quality == quality) {
+		return;
+	}
+	mixer.polyphase_quality = quality;
+
+	for (const auto& [name, channel] : mixer.channels) {
+		channel->ResetResampler();
+	}
+}
+
 static void init_denoiser(bool enabled)
 {
 	for (const auto& [_, channel] : mixer.channels) {
@@ -3007,6 +3130,10 @@ void MIXER_Init(Section* sec)
 		MIXER_SetChorusPreset(new_chorus_preset);
 	}
 
+	// Initialise the channel resamplers
+	set_polyphase_quality(resampler_pref_to_polyphase_quality(
+	        secprop->Get_string("resampler")));
+
 	// Init per-channel denoisers
 	init_denoiser(secprop->Get_bool("denoiser"));
 
@@ -3195,6 +3322,19 @@ static void init_mixer_dosbox_settings(Section_prop& sec_prop)
 	        "  - Use the MIXER command to fine-tune the chorus levels per channel.");
 	string_prop->Set_values({"off", "on", "light", "normal", "strong"});
 
+	string_prop = sec_prop.Add_string("resampler", WhenIdle, "speex");
+	string_prop->Set_help(
+	        "Resampler used to convert the audio channels to the mixer's sample rate\n"
+	        "('speex' by default):\n"
+	        "  speex:             Speex resampler at quality 5.\n"
+	        "  polyphase-low:     Built-in polyphase resampler with a 32-tap filter.\n"
+	        "  polyphase-medium:  Built-in polyphase resampler with a 64-tap filter.\n"
+	        "  polyphase-high:    Built-in polyphase resampler with a 128-tap filter.\n"
+	        "Longer filters keep more of the high frequencies and alias less, but take\n"
+	        "more CPU time.");
+	string_prop->Set_values(
+	        {"speex", "polyphase-low", "polyphase-medium", "polyphase-high"});
+
 	bool_prop = sec_prop.Add_bool("denoiser", WhenIdle, DefaultOn);
 	bool_prop->Set_help(
 	        "Remove low-level residual noise from the output of the OPL synth and the Roland\n"
@@ -17,12 +17,14 @@
  *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
+#include <algorithm>
 #include <array>
 #include <cmath>
 #include <cstring>
 #include <iomanip>
 #include <map>
 #include <optional>
+#include <span>
 #include <string>
 #include <tuple>
 
@@ -168,14 +170,15 @@ struct SbInfo {
 		uint32_t left       = 0; // Left in active cycle
 		uint32_t min        = 0;
 
-		union {
-			uint8_t b8[DmaBufSize];
-			int16_t b16[DmaBufSize];
-		} buf = {};
+		uint8_t buf[DmaBufSize] = {};
 
-		uint32_t bits        = 0;
-		DmaChannel* chan     = nullptr;
-		uint32_t remain_size = 0;
+		uint32_t bits    = 0;
+		DmaChannel* chan = nullptr;
+
+		// The start of a PCM frame whose remaining bytes are still to
+		// be read (e.g., the left sample of a stereo pair)
+		std::array<uint8_t, 4> partial_frame = {};
+		uint8_t partial_frame_bytes          = 0;
 	} dma = {};
 
 	bool speaker_enabled = false;
@@ -1013,13 +1016,13 @@ static std::vector<AudioFrame>& maybe_silence(const T* samples,
 
 static uint32_t read_dma_8bit(const uint32_t bytes_to_read, const uint32_t buffer_index = 0)
 {
-	static_assert(sizeof(sb.dma.buf.b8[0]) == 1);
+	static_assert(sizeof(sb.dma.buf[0]) == 1);
 
 	if (buffer_index >= DmaBufSize) {
 		// Should never happen as the code is currently written.
 		// Calling code has buffer_index either 0 or 1 to handle a dangling sample from the last read.
 		// This is to solve an edge case for stereo sound when the DMA buffer has an odd number of samples.
-		assertm(false, "SBLASTER: Read requested out of bounds of sb.dma.buf.b8");
+		assertm(false, "SBLASTER: Read requested out of bounds of sb.dma.buf");
 		return 0;
 	}
 
@@ -1030,57 +1033,141 @@ static uint32_t read_dma_8bit(const uint32_t bytes_to_read, const uint32_t buffe
 
 	const uint32_t bytes_available = DmaBufSize - buffer_index;
 	const uint32_t clamped_bytes = std::min(bytes_to_read, bytes_available);
-	const auto bytes_read = sb.dma.chan->Read(clamped_bytes, sb.dma.buf.b8 + buffer_index);
+	const auto bytes_read = sb.dma.chan->Read(clamped_bytes, sb.dma.buf + buffer_index);
 	assert(bytes_read <= clamped_bytes);
 
 	return check_cast<uint32_t>(bytes_read);
 }
 
-static uint32_t read_dma_16bit(const uint32_t words_to_read, const uint32_t buffer_index = 0)
+static void enqueue_frames(std::vector<AudioFrame>& frames)
 {
-	static_assert(sizeof(sb.dma.buf.b16[0]) == 2);
+	assert(sblaster);
+	frames_added_this_tick += static_cast<int>(frames.size());
+	sblaster->output_queue.NonblockingBulkEnqueue(frames);
+}
 
-	if (buffer_index >= DmaBufSize) {
-		// Should never happen as the code is currently written.
-		// Calling code has buffer_index either 0 or 1 to handle a dangling sample from the last read.
-		// This is to solve an edge case for stereo sound when the DMA buffer has an odd number of samples.
-		assertm(false, "SBLASTER: Read requested out of bounds of sb.dma.buf.b16");
-		return 0;
-	}
+// Reads a sample stored in the DOS program's byte order
+template <typename T>
+static float read_sample(const uint8_t* data)
+{
+	T sample = {};
+	std::memcpy(&sample, data, sizeof(T));
+	return to_float(sample);
+}
 
-	// In dma.cpp, if sb.dma.chan->is_16bit is set, we're dealing with 16-bit words.
-	// Otherwise, we're dealing with 8-bit words (bytes).
-	// Calling code handles this case and conditionally divides by two.
-	uint32_t bytes_requested = words_to_read;
-	if (sb.dma.chan->is_16bit) {
-		bytes_requested *= 2;
-		// Calling code uses these internal SoundBlaster variables.
-		// sb.dma.chan->is_16bit is the source of truth in terms of memory safety.
-		// Assert that these two always match up.
-		assertm(sb.dma.mode == DmaMode::Pcm16Bit, "SoundBlaster expected 8-bit read but DMA controller is 16-bit");
+template <FrameType frame_type, typename T>
+static AudioFrame read_frame(const uint8_t* data)
+{
+	const auto left = read_sample<T>(data);
+	if constexpr (frame_type == FrameType::Mono) {
+		return {left, left};
 	} else {
-		assertm(sb.dma.mode == DmaMode::Pcm16BitAliased, "SoundBlaster expected 16-bit read but DMA controller is 8-bit");
+		return {left, read_sample<T>(data + sizeof(T))};
+	}
+}
+
+// Converts a piece of a PCM DMA transfer into audio frames, or silent frames
+// while still warming up or with the speaker off. A frame split across two
+// pieces (or two transfers) is put back together from sb.dma.partial_frame.
+template <FrameType frame_type, typename T>
+static void append_pcm_frames(std::span<const uint8_t> bytes,
+                              const bool is_silent, std::vector<AudioFrame>& frames)
+{
+	constexpr size_t FrameBytes = sizeof(T) * (frame_type == FrameType::Mono ? 1 : 2);
+	static_assert(FrameBytes <= std::tuple_size_v<decltype(sb.dma.partial_frame)>);
+
+	auto& partial_frame       = sb.dma.partial_frame;
+	auto& partial_frame_bytes = sb.dma.partial_frame_bytes;
+
+	// Complete the partial frame first
+	if (partial_frame_bytes > 0) {
+		const auto num_bytes = std::min(FrameBytes - partial_frame_bytes,
+		                                bytes.size());
+		std::copy_n(bytes.begin(),
+		            num_bytes,
+		            partial_frame.begin() + partial_frame_bytes);
+
+		partial_frame_bytes = check_cast<uint8_t>(partial_frame_bytes + num_bytes);
+		bytes = bytes.subspan(num_bytes);
+
+		if (partial_frame_bytes < FrameBytes) {
+			return;
+		}
+		frames.emplace_back(is_silent
+		                            ? AudioFrame()
+		                            : read_frame<frame_type, T>(partial_frame.data()));
+		partial_frame_bytes = 0;
 	}
 
-	// Clamp words to read so we don't overflow our buffer.
-	const uint32_t bytes_available = (DmaBufSize - buffer_index) * 2;
-	uint32_t clamped_words = std::min(bytes_requested, bytes_available);
-	if (sb.dma.chan->is_16bit) {
-		clamped_words /= 2;
+	// Convert all whole frames in one pass, straight from guest memory
+	const auto num_frames  = bytes.size() / FrameBytes;
+	const auto first_frame = frames.size();
+	frames.resize(first_frame + num_frames);
+
+	if (!is_silent) {
+		const auto in  = bytes.data();
+		const auto out = frames.data() + first_frame;
+		for (size_t i = 0; i < num_frames; ++i) {
+			out[i] = read_frame<frame_type, T>(in + i * FrameBytes);
+		}
 	}
 
-	const auto unsigned_buf = reinterpret_cast<uint8_t*>(sb.dma.buf.b16 + buffer_index);
-	const auto words_read = sb.dma.chan->Read(clamped_words, unsigned_buf);
-	assert(words_read <= clamped_words);
+	// Keep the start of a trailing partial frame for the next piece
+	const auto tail = bytes.subspan(num_frames * FrameBytes);
+	std::copy(tail.begin(), tail.end(), partial_frame.begin());
+	partial_frame_bytes = check_cast<uint8_t>(tail.size());
+}
+
+// Reads PCM samples from DMA and converts them into audio frames without
+// copying them into an intermediate buffer first. Returns the number of DMA
+// words read.
+template <FrameType frame_type, typename T>
+static uint32_t read_dma_pcm(const uint32_t words_to_read, std::vector<AudioFrame>& frames)
+{
+	// The DMA words are 16-bit wide only on 16-bit DMA channels; 16-bit
+	// samples can also come through 8-bit channels
+	assert(sizeof(T) == 2 || !sb.dma.chan->is_16bit);
+
+	// Read no more samples per call than fit in sb.dma.buf, like the
+	// buffered ADPCM reads
+	constexpr auto MaxBytes = DmaBufSize * sizeof(T);
+	const auto max_words = check_cast<uint32_t>(sb.dma.chan->is_16bit ? MaxBytes / 2
+	                                                                  : MaxBytes);
+	const auto clamped_words = std::min(words_to_read, max_words);
+
+	const auto is_silent = (sb.dsp.warmup_remaining_ms > 0 || !sb.speaker_enabled);
+
+	const auto words_read = sb.dma.chan->ReadSpans(
+	        clamped_words, [&](const std::span<const uint8_t> bytes) {
+		        append_pcm_frames<frame_type, T>(bytes, is_silent, frames);
+	        });
+
+	if (!frames.empty() && sb.dsp.warmup_remaining_ms > 0) {
+		--sb.dsp.warmup_remaining_ms;
+	}
 
 	return check_cast<uint32_t>(words_read);
 }
 
-static void enqueue_frames(std::vector<AudioFrame>& frames)
+template <typename T>
+static std::tuple<uint32_t, uint32_t, uint16_t> play_dma_pcm(const uint32_t words_to_read)
 {
-	assert(sblaster);
-	frames_added_this_tick += static_cast<int>(frames.size());
-	sblaster->output_queue.NonblockingBulkEnqueue(frames);
+	static std::vector<AudioFrame> frames = {};
+	frames.clear();
+
+	const auto words_read = sb.dma.stereo
+	                              ? read_dma_pcm<FrameType::Stereo, T>(words_to_read, frames)
+	                              : read_dma_pcm<FrameType::Mono, T>(words_to_read, frames);
+
+	const auto num_frames  = check_cast<uint16_t>(frames.size());
+	const auto num_samples = static_cast<uint32_t>(num_frames) *
+	                         (sb.dma.stereo ? 2 : 1);
+
+	// Only whole frames are added; the rest waits for the next transfer
+	if (num_frames) {
+		enqueue_frames(frames);
+	}
+	return {words_read, num_samples, num_frames};
 }
 
 static void play_dma_transfer(const uint32_t bytes_requested)
@@ -1091,23 +1178,12 @@ static void play_dma_transfer(const uint32_t bytes_requested)
 	                                                      : bytes_requested;
 
 	// All three of these must be populated during the DMA sequence to
-	// ensure the proper quantities and unit are being accounted for.
-	// For example: use the channel count to convert from samples to frames.
+	// ensure the proper quantities and unit are being accounted for. The
+	// bytes read are DMA words, which are 16-bit wide on 16-bit channels.
 	uint32_t bytes_read = 0;
 	uint32_t samples    = 0;
 	uint16_t frames     = 0;
 
-	// In DmaMode::Pcm16BitAliased mode temporarily divide by 2 to get
-	// number of 16-bit samples, because 8-bit DMA Read returns byte size,
-	// while in DmaMode::Pcm16Bit mode 16-bit DMA Read returns word size.
-	const uint8_t dma16_to_sample_divisor = sb.dma.mode == DmaMode::Pcm16BitAliased
-	                                              ? 2
-	                                              : 1;
-
-	// Used to convert from samples to frames (which is what AddSamples
-	// unintuitively uses.. )
-	const uint8_t channels = sb.dma.stereo ? 2 : 1;
-
 	last_dma_callback = PIC_FullIndex();
 
 	// Temporary counter for ADPCM modes
@@ -1122,14 +1198,14 @@ static void play_dma_transfer(const uint32_t bytes_requested)
 		uint32_t i = 0;
 		if (num_bytes > 0 && sb.adpcm.haveref) {
 			sb.adpcm.haveref   = false;
-			sb.adpcm.reference = sb.dma.buf.b8[0];
+			sb.adpcm.reference = sb.dma.buf[0];
 			sb.adpcm.stepsize  = MinAdaptiveStepSize;
 			++i;
 		}
 		// Decode the remaining DMA buffer into samples using the
 		// provided function
 		while (i < num_bytes) {
-			const auto decoded = decode_adpcm_fn(sb.dma.buf.b8[i]);
+			const auto decoded = decode_adpcm_fn(sb.dma.buf[i]);
 			constexpr auto NumDecoded = check_cast<uint8_t>(
 			        decoded.size());
 
@@ -1160,88 +1236,16 @@ static void play_dma_transfer(const uint32_t bytes_requested)
 		break;
 
 	case DmaMode::Pcm8Bit:
-		if (sb.dma.stereo) {
-			bytes_read = read_dma_8bit(bytes_to_read, sb.dma.remain_size);
-			samples = bytes_read + sb.dma.remain_size;
-			frames  = check_cast<uint16_t>(samples / channels);
-
-			// Only add whole frames when in stereo DMA mode. The
-			// number of frames comes from the DMA request, and
-			// therefore user-space data.
-			if (frames) {
-				if (sb.dma.sign) {
-					const auto signed_buf = reinterpret_cast<int8_t*>(sb.dma.buf.b8);
-					enqueue_frames(maybe_silence<FrameType::Stereo>(signed_buf, samples));
-				} else {
-					enqueue_frames(maybe_silence<FrameType::Stereo>(sb.dma.buf.b8, samples));
-				}
-			}
-			// Otherwise there's an unhandled dangling sample from
-			// the last round
-			if (samples & 1) {
-				sb.dma.remain_size = 1;
-				sb.dma.buf.b8[0]   = sb.dma.buf.b8[samples - 1];
-			} else {
-				sb.dma.remain_size = 0;
-			}
-
-		} else { // Mono
-			bytes_read = read_dma_8bit(bytes_to_read);
-			samples    = bytes_read;
-			// mono sanity-check
-			assert(channels == 1);
-			if (sb.dma.sign) {
-				const auto signed_buf = reinterpret_cast<int8_t*>(sb.dma.buf.b8);
-				enqueue_frames(maybe_silence<FrameType::Mono>(signed_buf, samples));
-			} else {
-				enqueue_frames(maybe_silence<FrameType::Mono>(sb.dma.buf.b8, samples));
-			}
-		}
+		std::tie(bytes_read, samples, frames) =
+		        sb.dma.sign ? play_dma_pcm<int8_t>(bytes_to_read)
+		                    : play_dma_pcm<uint8_t>(bytes_to_read);
 		break;
 
 	case DmaMode::Pcm16BitAliased:
-		assert(dma16_to_sample_divisor == 2);
-		[[fallthrough]];
-
 	case DmaMode::Pcm16Bit:
-		if (sb.dma.stereo) {
-			bytes_read = read_dma_16bit(bytes_to_read, sb.dma.remain_size);
-			samples = (bytes_read + sb.dma.remain_size) /
-			          dma16_to_sample_divisor;
-			frames = check_cast<uint16_t>(samples / channels);
-
-			// Only add whole frames when in stereo DMA mode
-			if (frames) {
-				if (sb.dma.sign) {
-					enqueue_frames(maybe_silence<FrameType::Stereo>(sb.dma.buf.b16, samples));
-				} else {
-					const auto unsigned_buf = reinterpret_cast<uint16_t*>(sb.dma.buf.b16);
-					enqueue_frames(maybe_silence<FrameType::Stereo>(unsigned_buf, samples));
-				}
-			}
-			if (samples & 1) {
-				// Carry over the dangling sample into the next
-				// round, or...
-				sb.dma.remain_size = 1;
-				sb.dma.buf.b16[0] = sb.dma.buf.b16[samples - 1];
-			} else {
-				// ...the DMA transfer is done
-				sb.dma.remain_size = 0;
-			}
-		} else { // 16-bit mono
-			bytes_read = read_dma_16bit(bytes_to_read);
-			samples    = bytes_read / dma16_to_sample_divisor;
-
-			// mono sanity check
-			assert(channels == 1);
-
-			if (sb.dma.sign) {
-				enqueue_frames(maybe_silence<FrameType::Mono>(sb.dma.buf.b16, samples));
-			} else {
-				const auto unsigned_buf = reinterpret_cast<uint16_t*>(sb.dma.buf.b16);
-				enqueue_frames(maybe_silence<FrameType::Mono>(unsigned_buf, samples));
-			}
-		}
+		std::tie(bytes_read, samples, frames) =
+		        sb.dma.sign ? play_dma_pcm<int16_t>(bytes_to_read)
+		                    : play_dma_pcm<uint16_t>(bytes_to_read);
 		break;
 
 	default:
@@ -1676,7 +1680,8 @@ static void dsp_reset()
 	sb.dma.sign        = false;
 	sb.dma.autoinit    = false;
 	sb.dma.mode        = DmaMode::None;
-	sb.dma.remain_size = 0;
+
+	sb.dma.partial_frame_bytes = 0;
 
 	if (sb.dma.chan) {
 		sb.dma.chan->ClearRequest();
@@ -24,6 +24,7 @@
 
 #include "misc_util.h"
 
+#include <algorithm>
 #include <cassert>
 
 #include "timer.h"
@@ -31,6 +32,10 @@
 // Constants
 constexpr int connection_timeout_ms = 5000;
 
+// At 115200 baud this is about a third of a second of data, gathered with one
+// read instead of thousands
+constexpr size_t receive_buffer_size = 4096;
+
 const char* to_string(const SocketType socket_type)
 {
 	switch (socket_type) {
@@ -42,10 +47,7 @@ const char* to_string(const SocketType socket_type)
 
 // --- GENERIC NET INTERFACE -------------------------------------------------
 
-NETClientSocket::NETClientSocket()
-{
-	// nothing
-}
+NETClientSocket::NETClientSocket() : receivebuffer(receive_buffer_size) {}
 
 NETClientSocket::~NETClientSocket()
 {
@@ -64,13 +66,14 @@ NETClientSocket* NETClientSocket::NETClientFactory(const SocketType socketType,
 	return nullptr;
 }
 
-void NETClientSocket::FlushBuffer()
+bool NETClientSocket::FlushBuffer()
 {
 	if (sendbufferindex) {
 		if (!SendArray(sendbuffer.data(), sendbufferindex))
-			return;
+			return false;
 		sendbufferindex = 0;
 	}
+	return true;
 }
 
 void NETClientSocket::SetSendBufferSize(size_t n)
@@ -102,6 +105,68 @@ bool NETClientSocket::SendByteBuffered(uint8_t val)
 	return SendArray(sendbuffer.data(), sendbuffer.size());
 }
 
+bool NETClientSocket::SendArrayBuffered(const uint8_t *data, const size_t n)
+{
+	assert(data);
+	if (sendbuffer.empty())
+		return SendArray(data, n);
+
+	if (sendbufferindex + n > sendbuffer.size()) {
+		if (!FlushBuffer())
+			return false;
+		// too big to ever fit, so there's nothing to gain by buffering
+		if (n > sendbuffer.size())
+			return SendArray(data, n);
+	}
+	std::copy_n(data, n, sendbuffer.data() + sendbufferindex);
+	sendbufferindex += n;
+	return true;
+}
+
+SocketState NETClientSocket::FillReceiveBuffer()
+{
+	assert(receivebufferindex == receivebufferend);
+	receivebufferindex = 0;
+	receivebufferend = receivebuffer.size();
+	if (!ReadAvailable(receivebuffer.data(), receivebufferend)) {
+		receivebufferend = 0;
+		return SocketState::Closed;
+	}
+	return receivebufferend ? SocketState::Good : SocketState::Empty;
+}
+
+SocketState NETClientSocket::GetcharNonBlock(uint8_t &val)
+{
+	if (receivebufferindex == receivebufferend) {
+		const auto state = FillReceiveBuffer();
+		if (state != SocketState::Good)
+			return state;
+	}
+	val = receivebuffer[receivebufferindex++];
+	return SocketState::Good;
+}
+
+bool NETClientSocket::ReceiveArray(uint8_t *data, size_t &n)
+{
+	assert(data);
+	if (receivebufferindex == receivebufferend) {
+		// large reads don't need to go through the buffer
+		if (n >= receivebuffer.size())
+			return ReadAvailable(data, n);
+
+		if (FillReceiveBuffer() == SocketState::Closed) {
+			n = 0;
+			return false;
+		}
+	}
+	// Anything already buffered is handed out first; if the connection
+	// has closed since, the next call reports it
+	n = std::min(n, receivebufferend - receivebufferindex);
+	std::copy_n(receivebuffer.data() + receivebufferindex, n, data);
+	receivebufferindex += n;
+	return true;
+}
+
 NETServerSocket::NETServerSocket() {}
 
 NETServerSocket::~NETServerSocket() {}
@@ -331,19 +396,6 @@ ENETClientSocket::~ENETClientSocket()
 	}
 }
 
-SocketState ENETClientSocket::GetcharNonBlock(uint8_t &val)
-{
-	updateState();
-
-	if (receiveBuffer.size()) {
-		val = receiveBuffer.front();
-		receiveBuffer.pop();
-		return SocketState::Good;
-	}
-
-	return SocketState::Empty;
-}
-
 bool ENETClientSocket::Putchar(uint8_t val)
 {
 	updateState();
@@ -401,45 +453,21 @@ bool ENETClientSocket::SendArray(const uint8_t *data, size_t n)
 	return isopen;
 }
 
-bool ENETClientSocket::ReceiveArray(uint8_t *data, size_t &n)
+bool ENETClientSocket::ReadAvailable(uint8_t *data, size_t &n)
 {
-	size_t x = 0;
-
-	// Prime the pump.
+	// Service the host once for everything that has arrived, rather than
+	// once per byte
 	updateState();
 
-#if 0
-	// This block is how the SDLNet documentation says the TCP code should behave.
-
-	// The SDL TCP code doesn't wait if there is no pending data.
-	if (receiveBuffer.empty()) {
-	        n = 0;
-	        return isopen;
-	}
-
-	// SDLNet_TCP_Recv says it blocks until it receives "n" bytes.
-	// Based on the softmodem code, I'm not sure this is true.
-	while (isopen && x < n) {
-	        if (!receiveBuffer.empty()) {
-	                data[x++] = receiveBuffer.front();
-	                receiveBuffer.pop();
-	        }
-	        updateState();
-	}
-#else
-	// This block is how softmodem.cpp seems to expect the code to behave.
-	// Needless to say, not following the docs seems to work better.  :-)
-
-	while (isopen && x < n && !receiveBuffer.empty()) {
+	size_t x = 0;
+	while (x < n && !receiveBuffer.empty()) {
 		data[x++] = receiveBuffer.front();
 		receiveBuffer.pop();
-		updateState();
 	}
-
 	n = x;
-#endif
 
-	return isopen;
+	// Data that arrived before the peer disconnected is still handed out
+	return isopen || x > 0;
 }
 
 bool ENETClientSocket::GetRemoteAddressString(char *buffer)
@@ -653,7 +681,7 @@ bool TCPClientSocket::GetRemoteAddressString(char *buffer)
 	return true;
 }
 
-bool TCPClientSocket::ReceiveArray(uint8_t *data, size_t &n)
+bool TCPClientSocket::ReadAvailable(uint8_t *data, size_t &n)
 {
 	assertm(n <= static_cast<size_t>(std::numeric_limits<int>::max()),
 	        "SDL_net can't handle more bytes at a time.");
@@ -674,21 +702,6 @@ bool TCPClientSocket::ReceiveArray(uint8_t *data, size_t &n)
 	}
 }
 
-SocketState TCPClientSocket::GetcharNonBlock(uint8_t &val)
-{
-	SocketState state = SocketState::Empty;
-	if(SDLNet_CheckSockets(listensocketset,0))
-	{
-		if (SDLNet_TCP_Recv(mysock, &val, 1) == 1)
-			state = SocketState::Good;
-		else {
-			isopen = false;
-			state = SocketState::Closed;
-		}
-	}
-	return state;
-}
-
 bool TCPClientSocket::Putchar(uint8_t val)
 {
 	return SendArray(&val, 1);
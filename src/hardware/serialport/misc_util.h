@@ -91,21 +91,39 @@ public:
 	                                         const char* destination,
 	                                         const uint16_t port);
 
-	virtual SocketState GetcharNonBlock(uint8_t &val) = 0;
 	virtual bool Putchar(uint8_t val) = 0;
 	virtual bool SendArray(const uint8_t *data, size_t n) = 0;
-	virtual bool ReceiveArray(uint8_t *data, size_t &n) = 0;
 	virtual bool GetRemoteAddressString(char *buffer) = 0;
 
-	void FlushBuffer();
+	// Incoming data is read from the socket in large chunks and served
+	// from a buffer, so taking it a byte at a time is cheap
+	SocketState GetcharNonBlock(uint8_t &val);
+	bool ReceiveArray(uint8_t *data, size_t &n);
+
+	// Outgoing data is gathered in the send buffer (if one has been set)
+	// until it's full or the owner flushes it
+	bool FlushBuffer();
 	void SetSendBufferSize(size_t n);
 	bool SendByteBuffered(uint8_t val);
+	bool SendArrayBuffered(const uint8_t *data, size_t n);
+	size_t GetBufferedSendSize() const { return sendbufferindex; }
 
 	bool isopen = false;
 
+protected:
+	// Reads up to n bytes that have already arrived without blocking, and
+	// sets n to the number read. Returns false if the connection is closed.
+	virtual bool ReadAvailable(uint8_t *data, size_t &n) = 0;
+
 private:
+	SocketState FillReceiveBuffer();
+
 	size_t sendbufferindex = 0;
 	std::vector<uint8_t> sendbuffer = {};
+
+	size_t receivebufferindex = 0;
+	size_t receivebufferend = 0;
+	std::vector<uint8_t> receivebuffer = {};
 };
 
 class NETServerSocket {
@@ -153,12 +171,13 @@ public:
 
 	~ENETClientSocket() override;
 
-	SocketState GetcharNonBlock(uint8_t &val) override;
 	bool Putchar(uint8_t val) override;
 	bool SendArray(const uint8_t *data, size_t n) override;
-	bool ReceiveArray(uint8_t *data, size_t &n) override;
 	bool GetRemoteAddressString(char *buffer) override;
 
+protected:
+	bool ReadAvailable(uint8_t *data, size_t &n) override;
+
 private:
 	void updateState();
 
@@ -196,12 +215,13 @@ public:
 
 	~TCPClientSocket() override;
 
-	SocketState GetcharNonBlock(uint8_t &val) override;
 	bool Putchar(uint8_t val) override;
 	bool SendArray(const uint8_t *data, size_t n) override;
-	bool ReceiveArray(uint8_t *data, size_t &n) override;
 	bool GetRemoteAddressString(char *buffer) override;
 
+protected:
+	bool ReadAvailable(uint8_t *data, size_t &n) override;
+
 private:
 
 #ifdef NATIVESOCKETS
@@ -137,6 +137,13 @@ CSerialModem::CSerialModem(const uint8_t port_idx, CommandLine *cmd)
 		listenport = val;
 	// Otherwise the default listenport will be used
 
+	// txdelay: How many milliseconds to gather outgoing data before
+	// sending it, which saves sending a packet per tick during transfers.
+	if (getUintFromString("txdelay:", val, cmd)) {
+		if (val <= 500)
+			tx_gather_ticks = val / MODEM_TICKTIME;
+	}
+
 	// TODO: Fix dialtones if requested
 	//mhd.chan=MIXER_AddChannel((MIXER_MixHandler)this->MODEM_Callback,8000,"MODEM");
 	//MIXER_Enable(mhd.chan,false);
@@ -409,7 +416,9 @@ void CSerialModem::EnterIdleState(){
 	dtrofftimer = -1;
 	warmup_remain_ticks = 0;
 
-	// get rid of everything
+	// get rid of everything, but send what's still buffered first
+	if (clientsocket && clientsocket->isopen)
+		clientsocket->FlushBuffer();
 	clientsocket.reset();
 	waitingclientsocket.reset();
 	if (serversocket) {
@@ -449,6 +458,9 @@ void CSerialModem::EnterConnectedState() {
 	connected = true;
 	ringing = false;
 	dtrofftimer = -1;
+	if (clientsocket)
+		clientsocket->SetSendBufferSize(MODEM_BUFFER_QUEUE_SIZE);
+	tx_buffered_ticks = 0;
 	CSerial::setCD(true);
 	CSerial::setRI(false);
 }
@@ -985,13 +997,28 @@ void CSerialModem::Timer2()
 
 	if (clientsocket && txbuffersize && warmup_remain_ticks == 0) {
 		// down here it saves a lot of network traffic
-		if (!clientsocket->SendArray(tmpbuf,txbuffersize)) {
+		if (!clientsocket->SendArrayBuffered(tmpbuf, txbuffersize)) {
 			SendRes(ResNOCARRIER);
 			LOG_INFO("SERIAL: No carrier on send");
 			EnterIdleState();
 		}
 	}
 
+	// Send the gathered data once the oldest of it has waited long enough,
+	// or straight away when dropping back to command mode
+	if (clientsocket && clientsocket->GetBufferedSendSize()) {
+		if (tx_buffered_ticks >= tx_gather_ticks || commandmode) {
+			tx_buffered_ticks = 0;
+			if (!clientsocket->FlushBuffer()) {
+				SendRes(ResNOCARRIER);
+				LOG_INFO("SERIAL: No carrier on send");
+				EnterIdleState();
+			}
+		} else {
+			tx_buffered_ticks++;
+		}
+	}
+
 	// Handle incoming to the serial port
 	if (!commandmode && clientsocket && rqueue->left()) {
 		size_t usesize = rqueue->left() >= 16 ? 16 : rqueue->left();
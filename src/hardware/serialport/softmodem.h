@@ -246,6 +246,9 @@ protected:
 	uint32_t dtrmode = 0;
 	int32_t dtrofftimer = 0;
 	int32_t warmup_remain_ticks = 0;
+	// Outgoing data is gathered for up to this many ticks before it's sent
+	uint32_t tx_gather_ticks = 4;
+	uint32_t tx_buffered_ticks = 0;
 	uint8_t tmpbuf[MODEM_BUFFER_QUEUE_SIZE] = {0};
 	uint16_t listenport = 23; // 23 is the default telnet TCP/IP port
 	uint8_t reg[SREGS] = {0};
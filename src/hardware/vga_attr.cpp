@@ -78,6 +78,8 @@ void VGA_ATTR_SetPalette(uint8_t palette_reg_idx, const PaletteRegister value)
 {
 	assert(palette_reg_idx < NumCgaColors);
 
+	VGA_StopFrameBatching();
+
 	// The attribute table stores only 6 bits
 	vga.attr.palette[palette_reg_idx] = value.index;
 
@@ -110,6 +112,7 @@ static uint8_t read_p3c0(io_port_t, io_width_t)
 static void write_p3c0(io_port_t, io_val_t value, io_width_t)
 {
 	auto val = check_cast<uint8_t>(value);
+	VGA_MarkStateChanged();
 
 	if (vga.attr.is_address_mode) {
 		vga.attr.is_address_mode = false;
@@ -117,6 +120,12 @@ static void write_p3c0(io_port_t, io_val_t value, io_width_t)
 		auto reg       = AttributeAddressRegister{val};
 		vga.attr.index = reg.attribute_address;
 
+		// Blanks or unblanks the screen
+		const bool is_enabled   = reg.palette_address_source;
+		const bool was_disabled = vga.attr.disabled & 1;
+		if (is_enabled == was_disabled) {
+			VGA_StopFrameBatching();
+		}
 		if (reg.palette_address_source) {
 			vga.attr.disabled &= ~1;
 		} else {
@@ -249,6 +258,7 @@ static void write_p3c0(io_port_t, io_val_t value, io_width_t)
 			if (machine == MCH_EGA) {
 				// On the EGA panning can be programmed for
 				// every scanline:
+				VGA_StopFrameBatching();
 				vga.draw.panning = vga.config.pel_panning;
 			}
 			//      0-3	Indicates number of pixels to shift the
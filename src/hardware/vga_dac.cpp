@@ -98,6 +98,8 @@ static bool is_ega_color(const Rgb666 color)
 //
 static void vga_dac_send_color(const uint8_t palette_idx, const uint8_t color_idx)
 {
+	VGA_StopFrameBatching();
+
 	const auto rgb666 = vga.dac.rgb[color_idx];
 
 	constexpr auto ega_mode_640x350_16color = 0x10;
@@ -177,6 +179,7 @@ static void vga_dac_send_color(const uint8_t palette_idx, const uint8_t color_id
 
 	// Map the source color into palette's requested index
 	vga.dac.palette_map[palette_idx].Set(b8, g8, r8);
+	VGA_MarkStateChanged();
 
 	ReelMagic_RENDER_SetPalette(palette_idx, r8, g8, b8);
 }
@@ -37,6 +37,7 @@
 #include "render.h"
 #include "rgb565.h"
 #include "vga.h"
+#include "vga_line_converters.h"
 #include "video.h"
 
 // #define DEBUG_VGA_DRAW
@@ -58,6 +59,9 @@ constexpr auto max_line_bytes  = SCALER_MAXWIDTH * max_pixel_bytes;
 alignas(uint32_t) static std::array<uint8_t, max_line_bytes> templine_buffer;
 static auto TempLine = templine_buffer.data();
 
+// The fastest inner loops the host supports
+static const auto& line_converters = VGA_GetLineConverters();
+
 static uint8_t * VGA_Draw_1BPP_Line(Bitu vidstart, Bitu line) {
 	const uint8_t *base = vga.tandy.draw_base + ((line & vga.tandy.line_mask) << vga.tandy.line_shift);
 
@@ -277,10 +281,27 @@ static uint8_t *VGA_Draw_CGA4_Composite_Line(Bitu vidstart, Bitu line)
 	return Composite_Process(vga.tandy.color_select & 0x0f, vga.draw.blocks, true);
 }
 
+// Returns the start of the source bytes if they don't wrap around the
+// end of the Tandy video memory, or nullptr if they do
+static const uint8_t* get_unwrapped_tandy_bytes(const uint8_t* base,
+                                                const Bitu vidstart,
+                                                const Bitu num_bytes)
+{
+	const auto start = vidstart & vga.tandy.addr_mask;
+	if (num_bytes == 0 || start + num_bytes - 1 > vga.tandy.addr_mask) {
+		return nullptr;
+	}
+	return base + start;
+}
+
 static uint8_t * VGA_Draw_4BPP_Line(Bitu vidstart, Bitu line) {
 	const uint8_t *base = vga.tandy.draw_base + ((line & vga.tandy.line_mask) << vga.tandy.line_shift);
 	uint8_t* draw=TempLine;
 	Bitu end = vga.draw.blocks*2;
+	if (const auto src = get_unwrapped_tandy_bytes(base, vidstart, end)) {
+		line_converters.expand_nibbles(src, end, vga.attr.palette, draw);
+		return TempLine;
+	}
 	while(end) {
 		uint8_t byte = base[vidstart & vga.tandy.addr_mask];
 		*draw++=vga.attr.palette[byte >> 4];
@@ -295,6 +316,10 @@ static uint8_t * VGA_Draw_4BPP_Line_Double(Bitu vidstart, Bitu line) {
 	const uint8_t *base = vga.tandy.draw_base + ((line & vga.tandy.line_mask) << vga.tandy.line_shift);
 	uint8_t* draw=TempLine;
 	Bitu end = vga.draw.blocks;
+	if (const auto src = get_unwrapped_tandy_bytes(base, vidstart, end)) {
+		line_converters.expand_nibbles_doubled(src, end, vga.attr.palette, draw);
+		return TempLine;
+	}
 	while(end) {
 		uint8_t byte = base[vidstart & vga.tandy.addr_mask];
 		uint8_t data = vga.attr.palette[byte >> 4];
@@ -307,34 +332,6 @@ static uint8_t * VGA_Draw_4BPP_Line_Double(Bitu vidstart, Bitu line) {
 	return TempLine;
 }
 
-#ifdef VGA_KEEP_CHANGES
-static uint8_t * VGA_Draw_Changes_Line(Bitu vidstart, Bitu line) {
-	Bitu checkMask = vga.changes.checkMask;
-	uint8_t *map = vga.changes.map;
-	Bitu start = (vidstart >> VGA_CHANGE_SHIFT);
-	Bitu end = ((vidstart + vga.draw.line_length ) >> VGA_CHANGE_SHIFT);
-	for (; start <= end; ++start) {
-		if ( map[start] & checkMask ) {
-			Bitu offset = vidstart & vga.draw.linear_mask;
-			if (vga.draw.linear_mask-offset < vga.draw.line_length)
-				memcpy(vga.draw.linear_base+vga.draw.linear_mask+1, vga.draw.linear_base, vga.draw.line_length);
-			uint8_t *ret = &vga.draw.linear_base[ offset ];
-#if !defined(C_UNALIGNED_MEMORY)
-			if (((Bitu)ret) & (sizeof(Bitu) - 1)) {
-				memcpy( TempLine, ret, vga.draw.line_length );
-				return TempLine;
-			}
-#endif
-			return ret;
-		}
-	}
-//	memset( TempLine, 0x30, vga.changes.lineWidth );
-//	return TempLine;
-	return 0;
-}
-
-#endif
-
 static uint8_t * VGA_Draw_Linear_Line(Bitu vidstart, Bitu /*line*/) {
 	Bitu offset = vidstart & vga.draw.linear_mask;
 	uint8_t* ret = &vga.draw.linear_base[offset];
@@ -387,6 +384,17 @@ static uint8_t* draw_unwrapped_line_from_dac_palette(Bitu vidstart,
 
 	auto linear_pos = vidstart;
 
+	// Lines that don't wrap around the end of video memory are converted
+	// in one go
+	if (pixels_in_line > 0 &&
+	    (vidstart & linear_mask) + pixels_in_line - 1 <= linear_mask) {
+		line_converters.expand_indices(linear_addr + (vidstart & linear_mask),
+		                               pixels_in_line,
+		                               palette_map,
+		                               TempLine);
+		return TempLine;
+	}
+
 	// Draw in batches of four to let the host pipeline deeper.
 	constexpr auto num_repeats = 4;
 	assert(pixels_in_line % num_repeats == 0);
@@ -448,36 +456,26 @@ static uint8_t* draw_linear_line_from_dac_palette(Bitu vidstart, Bitu /*line*/)
 		        vga.draw.line_length - wrapped_len);
 
 		// unwrapped chunk: to top of memory block
-		auto palette_index_end = palette_index_it +
-		                         std::min(unwrapped_len, pixels_remaining);
-		while (palette_index_it != palette_index_end) {
-			memcpy(line_addr,
-			       palette_map + *palette_index_it++,
-			       bytes_per_pixel);
-			line_addr += bytes_per_pixel;
-			--pixels_remaining;
-		}
+		const auto num_unwrapped = std::min(unwrapped_len, pixels_remaining);
+		line_converters.expand_indices(palette_index_it,
+		                               num_unwrapped,
+		                               palette_map,
+		                               line_addr);
+		line_addr += num_unwrapped * bytes_per_pixel;
+		pixels_remaining = static_cast<uint16_t>(pixels_remaining - num_unwrapped);
 
 		// wrapped chunk: from the base of the memory block
-		palette_index_it  = vga.draw.linear_base;
-		palette_index_end = palette_index_it +
-		                    std::min(wrapped_len, pixels_remaining);
-		while (palette_index_it != palette_index_end) {
-			memcpy(line_addr,
-			       palette_map + *palette_index_it++,
-			       bytes_per_pixel);
-			line_addr += bytes_per_pixel;
-			--pixels_remaining;
-		}
+		palette_index_it = vga.draw.linear_base;
+		line_converters.expand_indices(palette_index_it,
+		                               std::min(wrapped_len, pixels_remaining),
+		                               palette_map,
+		                               line_addr);
 
 	} else {
-		auto palette_index_end = palette_index_it + pixels_remaining;
-		while (palette_index_it != palette_index_end) {
-			memcpy(line_addr,
-			       palette_map + *palette_index_it++,
-			       bytes_per_pixel);
-			line_addr += bytes_per_pixel;
-		}
+		line_converters.expand_indices(palette_index_it,
+		                               pixels_remaining,
+		                               palette_map,
+		                               line_addr);
 	}
 	return TempLine;
 }
@@ -811,9 +809,12 @@ static uint8_t* draw_text_line_from_dac_palette(Bitu vidstart, Bitu line)
 	// the console text right (and vice-versa)
 	const uint16_t draw_idx_start = 8 + vga.draw.panning;
 
-	// This holds the to-be-written pixel offset, and is incremented per
-	// pixel and also per character block.
-	auto draw_idx = draw_idx_start;
+	// The cells are collected first, then expanded to pixels in one go
+	static std::array<TextCell, SCALER_MAXWIDTH / 8> cells;
+	assert(blocks <= cells.size());
+	auto cell = cells.begin();
+
+	const auto is_eight_dot_mode = vga.seq.clocking_mode.is_eight_dot_mode;
 
 	while (blocks--) { // for each character in the line
 		const auto chr  = *vidmem++;
@@ -838,18 +839,7 @@ static uint8_t* draw_text_line_from_dac_palette(Bitu vidstart, Bitu line)
 			bg_palette_idx = fg_palette_idx;
 		}
 
-		// The font's bits will indicate which color is used per pixel
-		const auto fg_colour = palette_map[fg_palette_idx];
-		const auto bg_colour = palette_map[bg_palette_idx];
-
-		if (vga.seq.clocking_mode.is_eight_dot_mode) {
-			for (auto n = 0; n < 8; ++n) {
-				const auto color = (font & 0x80) ? fg_colour
-				                                 : bg_colour;
-				write_unaligned_uint32_at(TempLine, draw_idx++, color);
-				font <<= 1;
-			}
-		} else {
+		if (!is_eight_dot_mode) {
 			font <<= 1; // 9 pixels
 			// Extend to the 9th pixel if needed
 			if ((font & 0x2) &&
@@ -857,14 +847,20 @@ static uint8_t* draw_text_line_from_dac_palette(Bitu vidstart, Bitu line)
 			    (chr >= 0xc0) && (chr <= 0xdf)) {
 				font |= 1;
 			}
-			for (auto n = 0; n < 9; ++n) {
-				const auto color = (font & 0x100) ? fg_colour
-				                                  : bg_colour;
-				write_unaligned_uint32_at(TempLine, draw_idx++, color);
-				font <<= 1;
-			}
 		}
+
+		// The font's bits will indicate which color is used per pixel
+		*cell++ = {font, palette_map[fg_palette_idx], palette_map[bg_palette_idx]};
 	}
+
+	const auto num_cells       = static_cast<size_t>(cell - cells.begin());
+	const auto pixels_per_cell = static_cast<uint8_t>(is_eight_dot_mode ? 8 : 9);
+
+	line_converters.expand_text_cells(cells.data(),
+	                                  num_cells,
+	                                  pixels_per_cell,
+	                                  TempLine + draw_idx_start * sizeof(Bgrx8888));
+
 	// draw the text mode cursor if needed
 	if (!SkipCursor(vidstart, line)) {
 		// the adress of the attribute that makes up the cell the cursor is in
@@ -883,7 +879,7 @@ static uint8_t* draw_text_line_from_dac_palette(Bitu vidstart, Bitu line)
 
 			auto draw_addr = &TempLine[cursor_draw_offset];
 
-			draw_idx = draw_idx_start;
+			auto draw_idx = draw_idx_start;
 			for (uint8_t n = 0; n < 8; ++n) {
 				write_unaligned_uint32_at(draw_addr, draw_idx++, fg_colour);
 			}
@@ -892,22 +888,151 @@ static uint8_t* draw_text_line_from_dac_palette(Bitu vidstart, Bitu line)
 	return TempLine + 32;
 }
 
-#ifdef VGA_KEEP_CHANGES
-static inline void VGA_ChangesEnd(void ) {
-	if ( vga.changes.active ) {
-//		vga.changes.active = false;
-		Bitu end = vga.draw.address >> VGA_CHANGE_SHIFT;
-		Bitu total = 4 + end - vga.changes.start;
-		uint32_t clearMask = vga.changes.clearMask;
-		total >>= 2;
-		uint32_t *clear = (uint32_t *)&vga.changes.map[  vga.changes.start & ~3 ];
-		while ( total-- ) {
-			clear[0] &= clearMask;
-			++clear;
+// Scanlines that only read video memory blocks not written to since the
+// previous frame are passed to the renderer as nullptr, which then reuses its
+// cached copy of the line without reading or scaling it. Only modes drawn
+// straight from the linear video memory through tracked memory handlers are
+// eligible (the chunky and unchained 256-colour VGA modes and text modes);
+// everything else relies on the renderer's per-line diffing.
+struct LineSkippingKey {
+	VGAModes mode              = {};
+	VGA_Line_Handler draw_line = nullptr;
+	const uint8_t* linear_base = nullptr;
+	Bitu linear_mask           = 0;
+	Bitu address               = 0;
+	Bitu address_line          = 0;
+	Bitu split_line            = 0;
+	uint16_t panning           = 0;
+	uint32_t line_length       = 0;
+	uint32_t blocks            = 0;
+	Bitu cursor_address        = 0;
+	bool blink                 = false;
+
+	bool operator==(const LineSkippingKey& other) const = default;
+};
+
+static struct {
+	// The latched draw state of the previous frame. Changes to these aren't
+	// necessarily accompanied by a register write in the same frame.
+	LineSkippingKey last_key = {};
+
+	// Number of bytes a scanline reads starting from its address
+	Bitu line_span = 0;
+
+	// Converts draw addresses into linear video memory offsets
+	uint8_t address_shift = 0;
+
+	bool is_enabled = false;
+} line_skipping = {};
+
+static bool is_recent_change(const uint8_t frame_stamp)
+{
+	// Changes stamped in the previous frame count too, as they might have
+	// happened after the line was drawn
+	return static_cast<uint8_t>(vga.changes.frame - frame_stamp) < 2;
+}
+
+static void start_line_skipping()
+{
+	auto& changes = vga.changes;
+	++changes.frame;
+
+	LineSkippingKey key = {};
+	key.mode           = vga.mode;
+	key.draw_line      = VGA_DrawLine;
+	key.linear_base    = vga.draw.linear_base;
+	key.linear_mask    = vga.draw.linear_mask;
+	key.address        = vga.draw.address;
+	key.address_line   = vga.draw.address_line;
+	key.split_line     = vga.draw.split_line;
+	key.panning        = vga.draw.panning;
+	key.line_length    = vga.draw.line_length;
+	key.blocks         = vga.draw.blocks;
+	key.cursor_address = vga.draw.cursor.address;
+	key.blink          = vga.draw.blink;
+
+	const auto is_same_state = (key == line_skipping.last_key);
+	line_skipping.last_key   = key;
+	line_skipping.is_enabled = false;
+
+	if (!changes.is_tracking || !is_same_state ||
+	    ReelMagic_IsVideoMixerEnabled() || !RENDER_CanSkipUnchangedLines()) {
+		return;
+	}
+
+	switch (vga.mode) {
+	case M_VGA: {
+		const auto bytes_per_pixel =
+		        (get_bits_per_pixel(vga.draw.image_info.pixel_format) + 1) / 8;
+		line_skipping.line_span = vga.draw.line_length / bytes_per_pixel;
+
+		// The chain-4 fast memory copy is addressed like the CPU sees
+		// it, with every byte coming from a different plane
+		line_skipping.address_shift = (vga.draw.linear_base == vga.fastmem)
+		                                    ? 2
+		                                    : 0;
+	} break;
+	case M_TEXT:
+		if (vga.tandy.draw_base != vga.mem.linear) {
+			return;
 		}
+		// Character and attribute pairs, plus the partially visible
+		// character when panned
+		line_skipping.line_span     = (vga.draw.blocks + 1) * 2;
+		line_skipping.address_shift = 0;
+		break;
+	default: return;
 	}
+	line_skipping.is_enabled = true;
+}
+
+static bool is_line_unchanged(const Bitu vidstart)
+{
+	if (!line_skipping.is_enabled) {
+		return false;
+	}
+	const auto& changes = vga.changes;
+	if (is_recent_change(changes.state_frame)) {
+		return false;
+	}
+	// Text rows holding the cursor are always drawn, as it blinks
+	if (vga.mode == M_TEXT && vga.draw.cursor.address >= vidstart &&
+	    vga.draw.cursor.address < vidstart + line_skipping.line_span) {
+		return false;
+	}
+
+	const auto offset = vidstart & vga.draw.linear_mask;
+	const auto end    = offset + line_skipping.line_span;
+
+	// Lines wrapping around the end of the video memory are always drawn
+	if (end > vga.draw.linear_mask + 1) {
+		return false;
+	}
+
+	const auto shift      = line_skipping.address_shift;
+	const auto group_mask = (Bitu{1} << shift) - 1;
+
+	const auto first_block = ((offset & ~group_mask) << shift) >> VGA_CHANGE_SHIFT;
+	const auto last_block = ((end << shift) - 1) >> VGA_CHANGE_SHIFT;
+	if (last_block >= changes.map.size()) {
+		return false;
+	}
+	for (auto block = first_block; block <= last_block; ++block) {
+		if (is_recent_change(changes.map[block])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Returns nullptr instead of drawing the line if it's known to be unchanged
+static uint8_t* draw_line_unless_unchanged(const Bitu vidstart, const Bitu line)
+{
+	if (is_line_unchanged(vidstart)) {
+		return nullptr;
+	}
+	return VGA_DrawLine(vidstart, line);
 }
-#endif
 
 static void VGA_ProcessSplit()
 {
@@ -928,8 +1053,20 @@ static void VGA_ProcessSplit()
 	vga.draw.address_line = 0;
 }
 
+// Moves on to the next scanline after one has been drawn
+static void advance_line()
+{
+	++vga.draw.address_line;
+	if (vga.draw.address_line>=vga.draw.address_line_total) {
+		vga.draw.address_line=0;
+		vga.draw.address+=vga.draw.address_add;
+	}
+	++vga.draw.lines_done;
+	if (vga.draw.split_line==vga.draw.lines_done) VGA_ProcessSplit();
+}
+
 static uint8_t bg_color_index = 0; // screen-off black index
-static void VGA_DrawSingleLine(uint32_t /*blah*/)
+static void draw_single_line()
 {
 	if (vga.attr.disabled) {
 		switch(machine) {
@@ -1011,23 +1148,22 @@ static void VGA_DrawSingleLine(uint32_t /*blah*/)
 		}
 		ReelMagic_RENDER_DrawLine(TempLine);
 	} else {
-		uint8_t * data=VGA_DrawLine( vga.draw.address, vga.draw.address_line );
+		const auto data = draw_line_unless_unchanged(vga.draw.address,
+		                                             vga.draw.address_line);
 		ReelMagic_RENDER_DrawLine(data);
 	}
+	advance_line();
+}
 
-	++vga.draw.address_line;
-	if (vga.draw.address_line>=vga.draw.address_line_total) {
-		vga.draw.address_line=0;
-		vga.draw.address+=vga.draw.address_add;
-	}
-	++vga.draw.lines_done;
-	if (vga.draw.split_line==vga.draw.lines_done) VGA_ProcessSplit();
+static void VGA_DrawSingleLine(uint32_t /*blah*/)
+{
+	draw_single_line();
 	if (vga.draw.lines_done < vga.draw.lines_total) {
 		PIC_AddEvent(VGA_DrawSingleLine, vga.draw.delay.per_line_ms);
 	} else RENDER_EndUpdate(false);
 }
 
-static void VGA_DrawEGASingleLine(uint32_t /*blah*/)
+static void draw_ega_single_line()
 {
 	if (vga.attr.disabled) {
 		std::fill(templine_buffer.begin(), templine_buffer.end(), 0);
@@ -1035,42 +1171,33 @@ static void VGA_DrawEGASingleLine(uint32_t /*blah*/)
 	} else {
 		Bitu address = vga.draw.address;
 		if (vga.mode!=M_TEXT) address += vga.draw.panning;
-		uint8_t * data=VGA_DrawLine(address, vga.draw.address_line );
+		const auto data = draw_line_unless_unchanged(address,
+		                                             vga.draw.address_line);
 		ReelMagic_RENDER_DrawLine(data);
 	}
+	advance_line();
+}
 
-	++vga.draw.address_line;
-	if (vga.draw.address_line>=vga.draw.address_line_total) {
-		vga.draw.address_line=0;
-		vga.draw.address+=vga.draw.address_add;
-	}
-	++vga.draw.lines_done;
-	if (vga.draw.split_line==vga.draw.lines_done) VGA_ProcessSplit();
+static void VGA_DrawEGASingleLine(uint32_t /*blah*/)
+{
+	draw_ega_single_line();
 	if (vga.draw.lines_done < vga.draw.lines_total) {
 		PIC_AddEvent(VGA_DrawEGASingleLine, vga.draw.delay.per_line_ms);
 	} else RENDER_EndUpdate(false);
 }
 
+static void draw_part_line()
+{
+	const auto data = draw_line_unless_unchanged(vga.draw.address,
+	                                             vga.draw.address_line);
+	ReelMagic_RENDER_DrawLine(data);
+	advance_line();
+}
+
 static void VGA_DrawPart(uint32_t lines)
 {
 	while (lines--) {
-		uint8_t * data=VGA_DrawLine( vga.draw.address, vga.draw.address_line );
-		ReelMagic_RENDER_DrawLine(data);
-		++vga.draw.address_line;
-		if (vga.draw.address_line>=vga.draw.address_line_total) {
-			vga.draw.address_line=0;
-			vga.draw.address+=vga.draw.address_add;
-		}
-		++vga.draw.lines_done;
-		if (vga.draw.split_line==vga.draw.lines_done) {
-#ifdef VGA_KEEP_CHANGES
-			VGA_ChangesEnd( );
-#endif
-			VGA_ProcessSplit();
-#ifdef VGA_KEEP_CHANGES
-			vga.changes.start = vga.draw.address >> VGA_CHANGE_SHIFT;
-#endif
-		}
+		draw_part_line();
 	}
 	if (--vga.draw.parts_left) {
 		PIC_AddEvent(VGA_DrawPart, vga.draw.delay.parts,
@@ -1078,13 +1205,106 @@ static void VGA_DrawPart(uint32_t lines)
 		                     ? vga.draw.parts_lines
 		                     : (vga.draw.lines_total - vga.draw.lines_done));
 	} else {
-#ifdef VGA_KEEP_CHANGES
-		VGA_ChangesEnd();
-#endif
 		RENDER_EndUpdate(false);
 	}
 }
 
+// Frames are drawn in one go at the end of the active display instead of
+// line by line from PIC events, until the guest changes some state that
+// affects drawing mid-frame (see VGA_StopFrameBatching). Only the per-scanline
+// EGA and VGA drawing modes take part; CGA, Tandy, and Hercules raster effects
+// are done with too many different registers.
+static struct {
+	// PIC time of the start of the first line's period
+	double first_line_start = 0.0;
+
+	bool is_enabled = false;
+
+	// The current frame is drawn in one go
+	bool is_active = false;
+} frame_batching = {};
+
+static void draw_frame_lines(const uint32_t lines_end)
+{
+	const auto draw_line = (vga.draw.mode == EGALINE) ? draw_ega_single_line
+	                                                  : draw_part_line;
+	while (vga.draw.lines_done < lines_end) {
+		draw_line();
+	}
+}
+
+static void VGA_DrawFrame(uint32_t /*val*/)
+{
+	frame_batching.is_active = false;
+
+	draw_frame_lines(vga.draw.lines_total);
+	vga.draw.parts_left = 0;
+
+	RENDER_EndUpdate(false);
+}
+
+static bool start_frame_batching(const double draw_skip)
+{
+	if (!frame_batching.is_enabled) {
+		return false;
+	}
+	// Switching to line by line drawing mid-frame needs one part per line
+	const auto is_per_line = (vga.draw.mode == EGALINE) ||
+	                         (vga.draw.mode == PART &&
+	                          static_cast<uint32_t>(vga.draw.parts_total) ==
+	                                  vga.draw.lines_total);
+	if (!is_per_line) {
+		return false;
+	}
+
+	// The last line is drawn when the beam has passed it, as it would be
+	// line by line
+	frame_batching.first_line_start = vga.draw.delay.framestart + draw_skip;
+	frame_batching.is_active        = true;
+
+	PIC_AddEvent(VGA_DrawFrame, vga.draw.delay.vdend + draw_skip);
+	return true;
+}
+
+void VGA_StopFrameBatching()
+{
+	if (!frame_batching.is_active) {
+		return;
+	}
+	frame_batching.is_active = false;
+	PIC_RemoveEvents(VGA_DrawFrame);
+
+	// Draw the lines the beam has passed with the current state, exactly
+	// when the line by line events would have drawn them
+	const auto line_ms = vga.draw.delay.per_line_ms;
+	const auto elapsed = PIC_FullIndex() - frame_batching.first_line_start;
+
+	const auto lines_passed = static_cast<uint32_t>(
+	        std::clamp(elapsed / line_ms, 0.0, static_cast<double>(vga.draw.lines_total)));
+
+	draw_frame_lines(lines_passed);
+
+	if (vga.draw.lines_done >= vga.draw.lines_total) {
+		vga.draw.parts_left = 0;
+		RENDER_EndUpdate(false);
+		return;
+	}
+
+	// Carry on line by line
+	const auto next_line_delay = std::max(
+	        frame_batching.first_line_start +
+	                static_cast<double>(vga.draw.lines_done + 1) * line_ms -
+	                PIC_FullIndex(),
+	        0.0);
+
+	if (vga.draw.mode == EGALINE) {
+		PIC_AddEvent(VGA_DrawEGASingleLine, next_line_delay);
+	} else {
+		vga.draw.parts_left = vga.draw.lines_total - vga.draw.lines_done;
+		PIC_AddEvent(VGA_DrawPart, next_line_delay, 1);
+	}
+}
+
 void VGA_SetBlinking(const uint8_t enabled)
 {
 	LOG(LOG_VGA, LOG_NORMAL)("Blinking %u", enabled);
@@ -1104,29 +1324,6 @@ void VGA_SetBlinking(const uint8_t enabled)
 	}
 }
 
-#ifdef VGA_KEEP_CHANGES
-static void inline VGA_ChangesStart( void ) {
-	vga.changes.start = vga.draw.address >> VGA_CHANGE_SHIFT;
-	vga.changes.last = vga.changes.start;
-	if ( vga.changes.lastAddress != vga.draw.address ) {
-//		LOG_MSG("Address");
-		VGA_DrawLine = VGA_Draw_Linear_Line;
-		vga.changes.lastAddress = vga.draw.address;
-	} else if ( render.fullFrame ) {
-//		LOG_MSG("Full Frame");
-		VGA_DrawLine = VGA_Draw_Linear_Line;
-	} else {
-//		LOG_MSG("Changes");
-		VGA_DrawLine = VGA_Draw_Changes_Line;
-	}
-	vga.changes.active = true;
-	vga.changes.checkMask = vga.changes.writeMask;
-	vga.changes.clearMask = ~( 0x01010101 << (vga.changes.frame & 7));
-	++vga.changes.frame;
-	vga.changes.writeMask = 1 << (vga.changes.frame & 7);
-}
-#endif
-
 static void VGA_VertInterrupt(uint32_t /*val*/)
 {
 	if ((!vga.draw.vret_triggered) &&
@@ -1218,9 +1415,6 @@ static void VGA_VerticalTimer(uint32_t /*val*/)
 		++vga.draw.split_line; // EGA adds one buggy scanline
 	}
 //	if (machine==MCH_EGA) vga.draw.split_line = ((((vga.config.line_compare&0x5ff)+1)*2-1)/vga.draw.lines_scaled);
-#ifdef VGA_KEEP_CHANGES
-	bool startaddr_changed=false;
-#endif
 	switch (vga.mode) {
 	case M_EGA:
 		if (!(vga.crtc.mode_control.map_display_address_13)) {
@@ -1234,9 +1428,6 @@ static void VGA_VerticalTimer(uint32_t /*val*/)
 		vga.draw.address += vga.draw.bytes_skip;
 		vga.draw.address *= vga.draw.byte_panning_shift;
 		if (machine!=MCH_EGA) vga.draw.address += vga.draw.panning;
-#ifdef VGA_KEEP_CHANGES
-		startaddr_changed=true;
-#endif
 		break;
 	case M_VGA:
 		if (vga.config.compatible_chain4 && (vga.crtc.underline_location & 0x40)) {
@@ -1256,9 +1447,6 @@ static void VGA_VerticalTimer(uint32_t /*val*/)
 		vga.draw.address += vga.draw.bytes_skip;
 		vga.draw.address *= vga.draw.byte_panning_shift;
 		vga.draw.address += vga.draw.panning;
-#ifdef VGA_KEEP_CHANGES
-		startaddr_changed=true;
-#endif
 		break;
 	case M_TEXT:
 		vga.draw.byte_panning_shift = 2;
@@ -1296,9 +1484,6 @@ static void VGA_VerticalTimer(uint32_t /*val*/)
 	if (vga.draw.split_line == 0) {
 		VGA_ProcessSplit();
 	}
-#ifdef VGA_KEEP_CHANGES
-	if (startaddr_changed) VGA_ChangesStart();
-#endif
 
 	// check if some lines at the top off the screen are blanked
 	double draw_skip = 0.0;
@@ -1309,7 +1494,18 @@ static void VGA_VerticalTimer(uint32_t /*val*/)
 		                     vga.draw.address_line_total);
 	}
 
+	start_line_skipping();
+
 	// add the draw event
+	if (frame_batching.is_active) {
+		LOG(LOG_VGAMISC, LOG_NORMAL)("Batched frame not drawn");
+		frame_batching.is_active = false;
+		PIC_RemoveEvents(VGA_DrawFrame);
+		RENDER_EndUpdate(true);
+
+		vga.draw.parts_left = 0;
+		vga.draw.lines_done = vga.draw.lines_total;
+	}
 	switch (vga.draw.mode) {
 	case PART:
 		if (vga.draw.parts_left) {
@@ -1319,7 +1515,11 @@ static void VGA_VerticalTimer(uint32_t /*val*/)
 		}
 		vga.draw.lines_done = 0;
 		vga.draw.parts_left = vga.draw.parts_total;
-		PIC_AddEvent(VGA_DrawPart, vga.draw.delay.parts + draw_skip, vga.draw.parts_lines);
+		if (!start_frame_batching(draw_skip)) {
+			PIC_AddEvent(VGA_DrawPart,
+			             vga.draw.delay.parts + draw_skip,
+			             vga.draw.parts_lines);
+		}
 		break;
 	case DRAWLINE:
 	case EGALINE:
@@ -1333,6 +1533,9 @@ static void VGA_VerticalTimer(uint32_t /*val*/)
 			RENDER_EndUpdate(true);
 		}
 		vga.draw.lines_done = 0;
+		if (start_frame_batching(draw_skip)) {
+			break;
+		}
 		if (vga.draw.mode==EGALINE)
 			PIC_AddEvent(VGA_DrawEGASingleLine,
 			             vga.draw.delay.per_line_ms + draw_skip);
@@ -1344,6 +1547,9 @@ static void VGA_VerticalTimer(uint32_t /*val*/)
 }
 
 void VGA_CheckScanLength(void) {
+	// The line offset takes effect from the next line on
+	VGA_StopFrameBatching();
+
 	switch (vga.mode) {
 	case M_EGA:
 	case M_LIN4:
@@ -1469,6 +1675,8 @@ static void setup_line_drawing_delays(const uint32_t total_lines)
 		vga.draw.parts_total = total_lines;
 	}
 
+	frame_batching.is_enabled = section->Get_bool("vga_render_whole_frames");
+
 	vga.draw.delay.parts = vga.draw.delay.vdend / vga.draw.parts_total;
 
 	assert(total_lines > 0 && total_lines <= SCALER_MAXHEIGHT);
@@ -2861,12 +3069,6 @@ ImageInfo setup_drawing()
 	vga.draw.line_length = render_width *
 	                       ((get_bits_per_pixel(pixel_format) + 1) / 8);
 
-#ifdef VGA_KEEP_CHANGES
-	vga.changes.active    = false;
-	vga.changes.frame     = 0;
-	vga.changes.writeMask = 1;
-#endif
-
 #ifdef DEBUG_VGA_DRAW
 	LOG_DEBUG("VGA: horiz.total: %d, vert.total: %d",
 	          vga_timings.horiz.total,
@@ -2928,6 +3130,10 @@ ImageInfo setup_drawing()
 
 void VGA_SetupDrawing(uint32_t /*val*/)
 {
+	// The lines passed so far are drawn with the old state, as the scanline
+	// total and other drawing parameters can change mid-frame
+	VGA_StopFrameBatching();
+
 	if (vga.mode == M_ERROR) {
 		PIC_RemoveEvents(VGA_VerticalTimer);
 		PIC_RemoveEvents(VGA_PanningLatch);
@@ -3007,6 +3213,8 @@ void VGA_KillDrawing(void) {
 	PIC_RemoveEvents(VGA_DrawPart);
 	PIC_RemoveEvents(VGA_DrawSingleLine);
 	PIC_RemoveEvents(VGA_DrawEGASingleLine);
+	PIC_RemoveEvents(VGA_DrawFrame);
+	frame_batching.is_active = false;
 	vga.draw.parts_left = 0;
 	vga.draw.lines_done = ~0;
 	if (!vga.draw.vga_override) RENDER_EndUpdate(true);
@@ -0,0 +1,308 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2025  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "vga_line_converters.h"
+
+#include <cassert>
+#include <cstring>
+
+#include "mem_unaligned.h"
+#include "native_simd.h"
+
+// The 16-entry table lookups need a byte shuffle (SSSE3's pshufb or NEON's
+// tbl). SIMDe's SSE2 layer doesn't provide one, so we map it ourselves.
+#if defined(SIMDE_X86_SSSE3_NATIVE) || defined(SIMDE_ARM_NEON_A64V8_NATIVE)
+constexpr bool has_native_byte_shuffle = true;
+#else
+constexpr bool has_native_byte_shuffle = false;
+#endif
+
+// Scalar reference implementations
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+static void expand_nibbles_scalar(const uint8_t* src, const size_t num_bytes,
+                                  const uint8_t* palette, uint8_t* dest)
+{
+	for (size_t i = 0; i < num_bytes; ++i) {
+		const auto byte = src[i];
+		*dest++ = palette[byte >> 4];
+		*dest++ = palette[byte & 0x0f];
+	}
+}
+
+static void expand_nibbles_doubled_scalar(const uint8_t* src, const size_t num_bytes,
+                                          const uint8_t* palette, uint8_t* dest)
+{
+	for (size_t i = 0; i < num_bytes; ++i) {
+		const auto byte = src[i];
+		auto pixel      = palette[byte >> 4];
+		*dest++         = pixel;
+		*dest++         = pixel;
+		pixel           = palette[byte & 0x0f];
+		*dest++         = pixel;
+		*dest++         = pixel;
+	}
+}
+
+static void expand_indices_scalar(const uint8_t* src, const size_t num_pixels,
+                                  const Bgrx8888* palette, uint8_t* dest)
+{
+	for (size_t i = 0; i < num_pixels; ++i) {
+		write_unaligned_uint32_at(dest, i, palette[src[i]]);
+	}
+}
+
+static void expand_text_cells_scalar(const TextCell* cells, const size_t num_cells,
+                                     const uint8_t pixels_per_cell, uint8_t* dest)
+{
+	assert(pixels_per_cell == 8 || pixels_per_cell == 9);
+
+	size_t pixel_idx = 0;
+	for (size_t i = 0; i < num_cells; ++i) {
+		const auto& cell = cells[i];
+		for (int bit = pixels_per_cell - 1; bit >= 0; --bit) {
+			const auto colour = ((cell.glyph_bits >> bit) & 1)
+			                          ? cell.fg_colour
+			                          : cell.bg_colour;
+			write_unaligned_uint32_at(dest, pixel_idx++, colour);
+		}
+	}
+}
+
+// Vectorised implementations
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+// Looks up each byte of the indices (0 to 15) in the 16-byte table
+static inline simde__m128i lookup_bytes(const simde__m128i table,
+                                        const simde__m128i indices)
+{
+#if defined(SIMDE_X86_SSSE3_NATIVE)
+	return _mm_shuffle_epi8(table, indices);
+#elif defined(SIMDE_ARM_NEON_A64V8_NATIVE)
+	return simde__m128i_from_neon_u8(
+	        vqtbl1q_u8(simde__m128i_to_neon_u8(table),
+	                   simde__m128i_to_neon_u8(indices)));
+#else
+	alignas(16) uint8_t table_bytes[16];
+	alignas(16) uint8_t index_bytes[16];
+	simde_mm_store_si128(reinterpret_cast<simde__m128i*>(table_bytes), table);
+	simde_mm_store_si128(reinterpret_cast<simde__m128i*>(index_bytes), indices);
+	for (auto& index : index_bytes) {
+		index = table_bytes[index & 0x0f];
+	}
+	return simde_mm_load_si128(reinterpret_cast<const simde__m128i*>(index_bytes));
+#endif
+}
+
+static inline simde__m128i load_16_bytes(const uint8_t* src)
+{
+	return simde_mm_loadu_si128(reinterpret_cast<const simde__m128i*>(src));
+}
+
+static inline void store_16_bytes(uint8_t* dest, const simde__m128i val)
+{
+	simde_mm_storeu_si128(reinterpret_cast<simde__m128i*>(dest), val);
+}
+
+constexpr size_t BytesPerVector = sizeof(simde__m128i);
+
+static void expand_nibbles_simd(const uint8_t* src, const size_t num_bytes,
+                                const uint8_t* palette, uint8_t* dest)
+{
+	const auto table       = load_16_bytes(palette);
+	const auto nibble_mask = simde_mm_set1_epi8(0x0f);
+
+	size_t i = 0;
+	for (; i + BytesPerVector <= num_bytes; i += BytesPerVector) {
+		const auto bytes = load_16_bytes(src + i);
+
+		const auto high = lookup_bytes(
+		        table, simde_mm_and_si128(simde_mm_srli_epi16(bytes, 4), nibble_mask));
+		const auto low = lookup_bytes(table, simde_mm_and_si128(bytes, nibble_mask));
+
+		store_16_bytes(dest, simde_mm_unpacklo_epi8(high, low));
+		store_16_bytes(dest + 16, simde_mm_unpackhi_epi8(high, low));
+		dest += 32;
+	}
+	expand_nibbles_scalar(src + i, num_bytes - i, palette, dest);
+}
+
+static void expand_nibbles_doubled_simd(const uint8_t* src, const size_t num_bytes,
+                                        const uint8_t* palette, uint8_t* dest)
+{
+	const auto table       = load_16_bytes(palette);
+	const auto nibble_mask = simde_mm_set1_epi8(0x0f);
+
+	size_t i = 0;
+	for (; i + BytesPerVector <= num_bytes; i += BytesPerVector) {
+		const auto bytes = load_16_bytes(src + i);
+
+		const auto high = lookup_bytes(
+		        table, simde_mm_and_si128(simde_mm_srli_epi16(bytes, 4), nibble_mask));
+		const auto low = lookup_bytes(table, simde_mm_and_si128(bytes, nibble_mask));
+
+		const auto first_half  = simde_mm_unpacklo_epi8(high, low);
+		const auto second_half = simde_mm_unpackhi_epi8(high, low);
+
+		store_16_bytes(dest, simde_mm_unpacklo_epi8(first_half, first_half));
+		store_16_bytes(dest + 16, simde_mm_unpackhi_epi8(first_half, first_half));
+		store_16_bytes(dest + 32, simde_mm_unpacklo_epi8(second_half, second_half));
+		store_16_bytes(dest + 48, simde_mm_unpackhi_epi8(second_half, second_half));
+		dest += 64;
+	}
+	expand_nibbles_doubled_scalar(src + i, num_bytes - i, palette, dest);
+}
+
+static void expand_indices_simd(const uint8_t* src, const size_t num_pixels,
+                                const Bgrx8888* palette, uint8_t* dest)
+{
+	// Split the first 16 palette entries into one table per colour byte,
+	// so each can be looked up with a byte shuffle
+	alignas(16) uint8_t byte_tables[sizeof(Bgrx8888)][16];
+	for (auto i = 0; i < 16; ++i) {
+		uint8_t colour_bytes[sizeof(Bgrx8888)];
+		memcpy(colour_bytes, &palette[i], sizeof(colour_bytes));
+		for (size_t b = 0; b < sizeof(Bgrx8888); ++b) {
+			byte_tables[b][i] = colour_bytes[b];
+		}
+	}
+	const auto table_0 = load_16_bytes(byte_tables[0]);
+	const auto table_1 = load_16_bytes(byte_tables[1]);
+	const auto table_2 = load_16_bytes(byte_tables[2]);
+	const auto table_3 = load_16_bytes(byte_tables[3]);
+
+	const auto high_nibble_mask = simde_mm_set1_epi8(static_cast<int8_t>(0xf0));
+	const auto zero             = simde_mm_setzero_si128();
+
+	size_t i = 0;
+	for (; i + BytesPerVector <= num_pixels; i += BytesPerVector) {
+		const auto indices = load_16_bytes(src + i);
+
+		// Runs with any index above 15 are looked up one by one
+		const auto is_low_index = simde_mm_cmpeq_epi8(
+		        simde_mm_and_si128(indices, high_nibble_mask), zero);
+		if (simde_mm_movemask_epi8(is_low_index) != 0xffff) {
+			expand_indices_scalar(src + i,
+			                      BytesPerVector,
+			                      palette,
+			                      dest + i * sizeof(Bgrx8888));
+			continue;
+		}
+
+		const auto bytes_0 = lookup_bytes(table_0, indices);
+		const auto bytes_1 = lookup_bytes(table_1, indices);
+		const auto bytes_2 = lookup_bytes(table_2, indices);
+		const auto bytes_3 = lookup_bytes(table_3, indices);
+
+		// Interleave the colour bytes back into 32-bit pixels
+		const auto bytes_01_lo = simde_mm_unpacklo_epi8(bytes_0, bytes_1);
+		const auto bytes_01_hi = simde_mm_unpackhi_epi8(bytes_0, bytes_1);
+		const auto bytes_23_lo = simde_mm_unpacklo_epi8(bytes_2, bytes_3);
+		const auto bytes_23_hi = simde_mm_unpackhi_epi8(bytes_2, bytes_3);
+
+		auto out = dest + i * sizeof(Bgrx8888);
+		store_16_bytes(out, simde_mm_unpacklo_epi16(bytes_01_lo, bytes_23_lo));
+		store_16_bytes(out + 16, simde_mm_unpackhi_epi16(bytes_01_lo, bytes_23_lo));
+		store_16_bytes(out + 32, simde_mm_unpacklo_epi16(bytes_01_hi, bytes_23_hi));
+		store_16_bytes(out + 48, simde_mm_unpackhi_epi16(bytes_01_hi, bytes_23_hi));
+	}
+	expand_indices_scalar(src + i, num_pixels - i, palette, dest + i * sizeof(Bgrx8888));
+}
+
+static void expand_text_cells_simd(const TextCell* cells, const size_t num_cells,
+                                   const uint8_t pixels_per_cell, uint8_t* dest)
+{
+	assert(pixels_per_cell == 8 || pixels_per_cell == 9);
+
+	// The glyph bits of the first and second four pixels
+	const auto left_bits  = simde_mm_setr_epi32(0x80, 0x40, 0x20, 0x10);
+	const auto right_bits = simde_mm_setr_epi32(0x08, 0x04, 0x02, 0x01);
+
+	// The 9th pixel is the lowest bit of 9-pixel wide cells
+	const auto extra_bits = pixels_per_cell - 8;
+
+	for (size_t i = 0; i < num_cells; ++i) {
+		const auto& cell = cells[i];
+
+		const auto glyph = simde_mm_set1_epi32(cell.glyph_bits >> extra_bits);
+		const auto fg = simde_mm_set1_epi32(static_cast<int32_t>(
+		        static_cast<uint32_t>(cell.fg_colour)));
+		const auto bg = simde_mm_set1_epi32(static_cast<int32_t>(
+		        static_cast<uint32_t>(cell.bg_colour)));
+
+		const auto is_left_fg = simde_mm_cmpeq_epi32(
+		        simde_mm_and_si128(glyph, left_bits), left_bits);
+		const auto is_right_fg = simde_mm_cmpeq_epi32(
+		        simde_mm_and_si128(glyph, right_bits), right_bits);
+
+		store_16_bytes(dest,
+		               simde_mm_or_si128(simde_mm_and_si128(is_left_fg, fg),
+		                                 simde_mm_andnot_si128(is_left_fg, bg)));
+		store_16_bytes(dest + 16,
+		               simde_mm_or_si128(simde_mm_and_si128(is_right_fg, fg),
+		                                 simde_mm_andnot_si128(is_right_fg, bg)));
+
+		if (extra_bits) {
+			const auto colour = (cell.glyph_bits & 1) ? cell.fg_colour
+			                                          : cell.bg_colour;
+			write_unaligned_uint32_at(dest, 8, colour);
+		}
+		dest += pixels_per_cell * sizeof(Bgrx8888);
+	}
+}
+
+// Dispatch
+// ~~~~~~~~
+
+const VgaLineConverters& VGA_GetScalarLineConverters()
+{
+	static constexpr VgaLineConverters converters = {
+	        expand_nibbles_scalar,
+	        expand_nibbles_doubled_scalar,
+	        expand_indices_scalar,
+	        expand_text_cells_scalar,
+	};
+	return converters;
+}
+
+const VgaLineConverters& VGA_GetSimdLineConverters()
+{
+	static constexpr VgaLineConverters converters = {
+	        expand_nibbles_simd,
+	        expand_nibbles_doubled_simd,
+	        expand_indices_simd,
+	        expand_text_cells_simd,
+	};
+	return converters;
+}
+
+const VgaLineConverters& VGA_GetLineConverters()
+{
+	// SIMDe picks the instructions at compile time; where it would have to
+	// emulate them, the scalar loops are faster.
+	static constexpr VgaLineConverters converters = {
+	        has_native_byte_shuffle ? expand_nibbles_simd : expand_nibbles_scalar,
+	        has_native_byte_shuffle ? expand_nibbles_doubled_simd
+	                                : expand_nibbles_doubled_scalar,
+	        has_native_byte_shuffle ? expand_indices_simd : expand_indices_scalar,
+	        has_native_sse2 ? expand_text_cells_simd : expand_text_cells_scalar,
+	};
+	return converters;
+}
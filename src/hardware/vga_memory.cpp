@@ -52,13 +52,6 @@
 #define CHECKED4(v) ((v)&((vga.vmemwrap>>2)-1))
 
 
-#ifdef VGA_KEEP_CHANGES
-#define MEM_CHANGED( _MEM ) vga.changes.map[ (_MEM) >> VGA_CHANGE_SHIFT ] |= vga.changes.writeMask;
-//#define MEM_CHANGED( _MEM ) vga.changes.map[ (_MEM) >> VGA_CHANGE_SHIFT ] = 1;
-#else
-#define MEM_CHANGED( _MEM ) 
-#endif
-
 #define TANDY_VIDBASE(_X_)  &MemBase[ 0x80000 + (_X_)]
 
 void VGA_MapMMIO(void);
@@ -229,7 +222,7 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED(addr);
-		MEM_CHANGED( addr << 3);
+		VGA_MarkMemoryChanged(addr, addr);
 		writeHandler(addr+0,(uint8_t)(val >> 0));
 	}
 
@@ -239,7 +232,7 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED(addr);
-		MEM_CHANGED( addr << 3);
+		VGA_MarkMemoryChanged(addr, addr + 1);
 		writeHandler(addr+0,(uint8_t)(val >> 0));
 		writeHandler(addr+1,(uint8_t)(val >> 8));
 	}
@@ -250,7 +243,7 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED(addr);
-		MEM_CHANGED( addr << 3);
+		VGA_MarkMemoryChanged(addr, addr + 3);
 		writeHandler(addr+0,(uint8_t)(val >> 0));
 		writeHandler(addr+1,(uint8_t)(val >> 8));
 		writeHandler(addr+2,(uint8_t)(val >> 16));
@@ -329,7 +322,7 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED2(addr);
-		MEM_CHANGED( addr << 3);
+		VGA_MarkMemoryChanged(addr << 2, (addr << 2) + 3);
 		writeHandler(addr+0,(uint8_t)(val >> 0));
 	}
 
@@ -339,7 +332,7 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED2(addr);
-		MEM_CHANGED( addr << 3);
+		VGA_MarkMemoryChanged(addr << 2, (addr << 2) + 7);
 		writeHandler(addr+0,(uint8_t)(val >> 0));
 		writeHandler(addr+1,(uint8_t)(val >> 8));
 	}
@@ -350,7 +343,7 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED2(addr);
-		MEM_CHANGED( addr << 3);
+		VGA_MarkMemoryChanged(addr << 2, (addr << 2) + 15);
 		writeHandler(addr+0,(uint8_t)(val >> 0));
 		writeHandler(addr+1,(uint8_t)(val >> 8));
 		writeHandler(addr+2,(uint8_t)(val >> 16));
@@ -364,9 +357,21 @@ public:
 	VGA_ChainedVGA_Handler()  {
 		flags=PFLAG_NOCODE;
 	}
+
+	static inline PhysPt ToLinearOffset(PhysPt addr)
+	{
+		return ((addr & ~3) << 2) + (addr & 3);
+	}
+
 	static inline uint8_t *ToLinear(PhysPt addr)
 	{
-		return &vga.mem.linear[((addr & ~3) << 2) + (addr & 3)];
+		return &vga.mem.linear[ToLinearOffset(addr)];
+	}
+
+	static inline void MarkChanged(PhysPt addr, uint32_t num_bytes)
+	{
+		VGA_MarkMemoryChanged(ToLinearOffset(addr),
+		                      ToLinearOffset(addr + num_bytes - 1));
 	}
 
 	static inline uint8_t readHandler_byte(PhysPt addr)
@@ -474,7 +479,7 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED(addr);
-		MEM_CHANGED( addr );
+		MarkChanged(addr, 1);
 		writeHandler_byte(addr, val);
 		writeCache_byte(addr, val);
 	}
@@ -485,8 +490,7 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED(addr);
-		MEM_CHANGED( addr );
-//		MEM_CHANGED( addr + 1);
+		MarkChanged(addr, 2);
 		if (addr & 1) {
 			writeHandler_byte(addr + 0, val >> 0);
 			writeHandler_byte(addr + 1, val >> 8);
@@ -502,8 +506,7 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED(addr);
-		MEM_CHANGED( addr );
-//		MEM_CHANGED( addr + 3);
+		MarkChanged(addr, 4);
 		if (addr & 3) {
 			writeHandler_byte(addr + 0, val >> 0);
 			writeHandler_byte(addr + 1, val >> 8);
@@ -539,7 +542,7 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED2(addr);
-		MEM_CHANGED( addr << 2 );
+		VGA_MarkMemoryChanged(addr << 2, (addr << 2) + 3);
 		writeHandler(addr+0,(uint8_t)(val >> 0));
 	}
 
@@ -549,7 +552,7 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED2(addr);
-		MEM_CHANGED( addr << 2);
+		VGA_MarkMemoryChanged(addr << 2, (addr << 2) + 7);
 		writeHandler(addr+0,(uint8_t)(val >> 0));
 		writeHandler(addr+1,(uint8_t)(val >> 8));
 	}
@@ -560,7 +563,7 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED2(addr);
-		MEM_CHANGED( addr << 2);
+		VGA_MarkMemoryChanged(addr << 2, (addr << 2) + 15);
 		writeHandler(addr+0,(uint8_t)(val >> 0));
 		writeHandler(addr+1,(uint8_t)(val >> 8));
 		writeHandler(addr+2,(uint8_t)(val >> 16));
@@ -597,14 +600,23 @@ public:
 
 		if (vga.seq.map_mask == 0x4) {
 			vga.draw.font[addr] = val;
+			VGA_MarkStateChanged();
 		} else {
-			if (vga.seq.map_mask & 0x4) // font map
+			if (vga.seq.map_mask & 0x4) { // font map
 				vga.draw.font[addr] = val;
-			if (vga.seq.map_mask & 0x2) // character attribute
-				vga.mem.linear[CHECKED3(vga.svga.bank_read_full +
-				                        addr + 1)] = val;
-			if (vga.seq.map_mask & 0x1) // character index
-				vga.mem.linear[CHECKED3(vga.svga.bank_read_full + addr)] = val;
+				VGA_MarkStateChanged();
+			}
+			if (vga.seq.map_mask & 0x2) { // character attribute
+				const auto offset = CHECKED3(vga.svga.bank_read_full +
+				                             addr + 1);
+				VGA_MarkMemoryChanged(offset, offset);
+				vga.mem.linear[offset] = val;
+			}
+			if (vga.seq.map_mask & 0x1) { // character index
+				const auto offset = CHECKED3(vga.svga.bank_read_full + addr);
+				VGA_MarkMemoryChanged(offset, offset);
+				vga.mem.linear[offset] = val;
+			}
 		}
 	}
 };
@@ -662,7 +674,7 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED(addr);
-		MEM_CHANGED( addr );
+		VGA_MarkMemoryChanged(addr, addr);
 		host_writeb(&vga.mem.linear[addr], val);
 	}
 
@@ -672,7 +684,7 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED(addr);
-		MEM_CHANGED(addr);
+		VGA_MarkMemoryChanged(addr, addr + 1);
 		host_writew_at(vga.mem.linear, addr, val);
 	}
 
@@ -682,7 +694,7 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED(addr);
-		MEM_CHANGED(addr);
+		VGA_MarkMemoryChanged(addr, addr + 3);
 		host_writed_at(vga.mem.linear, addr, val);
 	}
 };
@@ -697,7 +709,7 @@ public:
 		write_delay();
 		addr = vga.svga.bank_write_full + (PAGING_GetPhysicalAddress(addr) & 0xffff);
 		addr = CHECKED4(addr);
-		MEM_CHANGED( addr << 3 );
+		VGA_MarkMemoryChanged(addr << 2, (addr << 2) + 3);
 		writeHandler(addr+0,(uint8_t)(val >> 0));
 	}
 
@@ -706,7 +718,7 @@ public:
 		write_delay();
 		addr = vga.svga.bank_write_full + (PAGING_GetPhysicalAddress(addr) & 0xffff);
 		addr = CHECKED4(addr);
-		MEM_CHANGED( addr << 3 );
+		VGA_MarkMemoryChanged(addr << 2, (addr << 2) + 7);
 		writeHandler(addr+0,(uint8_t)(val >> 0));
 		writeHandler(addr+1,(uint8_t)(val >> 8));
 	}
@@ -716,7 +728,7 @@ public:
 		write_delay();
 		addr = vga.svga.bank_write_full + (PAGING_GetPhysicalAddress(addr) & 0xffff);
 		addr = CHECKED4(addr);
-		MEM_CHANGED( addr << 3 );
+		VGA_MarkMemoryChanged(addr << 2, (addr << 2) + 15);
 		writeHandler(addr+0,(uint8_t)(val >> 0));
 		writeHandler(addr+1,(uint8_t)(val >> 8));
 		writeHandler(addr+2,(uint8_t)(val >> 16));
@@ -789,7 +801,7 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) - vga.lfb.addr;
 		addr = CHECKED(addr);
 		host_writeb(&vga.mem.linear[addr], val);
-		MEM_CHANGED( addr );
+		VGA_MarkMemoryChanged(addr, addr);
 	}
 
 	void writew(PhysPt addr, uint16_t val) override
@@ -798,7 +810,7 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) - vga.lfb.addr;
 		addr = CHECKED(addr);
 		host_writew_at(vga.mem.linear, addr, val);
-		MEM_CHANGED( addr );
+		VGA_MarkMemoryChanged(addr, addr + 1);
 	}
 
 	void writed(PhysPt addr, uint32_t val) override
@@ -807,7 +819,7 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) - vga.lfb.addr;
 		addr = CHECKED(addr);
 		host_writed_at(vga.mem.linear, addr, val);
-		MEM_CHANGED( addr );
+		VGA_MarkMemoryChanged(addr, addr + 3);
 	}
 };
 
@@ -975,10 +987,40 @@ void VGA_ChangedBank(void) {
 	VGA_SetupHandlers();
 }
 
+static PageHandler* get_lfb_handler()
+{
+#ifdef VGA_LFB_MAPPED
+	// Writes through the linear framebuffer have to be observed as well
+	// while the video memory is tracked for changes
+	if (vga.changes.is_tracking) {
+		return &vgaph.lfbchanges;
+	}
+	return &vgaph.lfb;
+#else
+	return &vgaph.lfbchanges;
+#endif
+}
+
+static void update_lfb_handler()
+{
+	// The linear framebuffer is only mapped once the S3 has set it up
+	if (!vga.lfb.handler) {
+		return;
+	}
+	if (const auto handler = get_lfb_handler(); handler != vga.lfb.handler) {
+		vga.lfb.handler = handler;
+		MEM_SetLFB(vga.lfb.page, vga.vmemsize / 4096, vga.lfb.handler, &vgaph.mmio);
+	}
+}
+
 void VGA_SetupHandlers(void) {
 	vga.svga.bank_read_full = vga.svga.bank_read*vga.svga.bank_size;
 	vga.svga.bank_write_full = vga.svga.bank_write*vga.svga.bank_size;
 
+	// Only the handlers that stamp the written memory blocks allow skipping
+	// unchanged scanlines; all others write straight to the host memory
+	vga.changes.is_tracking = false;
+
 	PageHandler *newHandler;
 	switch (machine) {
 	case MCH_CGA:
@@ -1116,27 +1158,24 @@ void VGA_SetupHandlers(void) {
 	}
 	if(svgaCard == SVGA_S3Trio && (vga.s3.ext_mem_ctrl & 0x10))
 		MEM_SetPageHandler(VGA_PAGE_A0, 16, &vgaph.mmio);
+
+	vga.changes.is_tracking = (newHandler == &vgaph.cvga ||
+	                           newHandler == &vgaph.uvga ||
+	                           newHandler == &vgaph.text);
 range_done:
+	update_lfb_handler();
 	PAGING_ClearTLB();
 }
 
 void VGA_StartUpdateLFB(void) {
 	vga.lfb.page = vga.s3.la_window << 4;
 	vga.lfb.addr = vga.s3.la_window << 16;
-#ifdef VGA_LFB_MAPPED
-	vga.lfb.handler = &vgaph.lfb;
-#else
-	vga.lfb.handler = &vgaph.lfbchanges;
-#endif
+	vga.lfb.handler = get_lfb_handler();
 	MEM_SetLFB(vga.lfb.page, vga.vmemsize / 4096, vga.lfb.handler, &vgaph.mmio);
 }
 
 static void VGA_Memory_ShutDown(Section * /*sec*/) {
-#ifdef VGA_KEEP_CHANGES
-	delete[] vga.changes.map;
-	vga.mem.linear = {};
-	vga.fastmem    = {};
-#endif
+	vga.changes = {};
 }
 
 static uint32_t determine_vmem_delay_ns()
@@ -1223,12 +1262,11 @@ void VGA_SetupMemory(Section* sec)
 	// vmemwrap <= vmemsize, fastmem implicitly has mem wrap twice as big
 	vga.vmemwrap = vga.vmemsize;
 
-#ifdef VGA_KEEP_CHANGES
-	memset( &vga.changes, 0, sizeof( vga.changes ));
-	int changesMapSize = (vga.vmemsize >> VGA_CHANGE_SHIFT) + 32;
-	vga.changes.map = new uint8_t[changesMapSize];
-	memset(vga.changes.map, 0, changesMapSize);
-#endif
+	// One frame stamp per block of the linear buffer, plus one for writes
+	// straddling its end
+	vga.changes     = {};
+	vga.changes.map.resize((num_linear_bytes >> VGA_CHANGE_SHIFT) + 1);
+
 	vga.svga.bank_read = vga.svga.bank_write = 0;
 	vga.svga.bank_read_full = vga.svga.bank_write_full = 0;
 	vga.svga.bank_size = 0x10000; /* most common bank size is 64K */
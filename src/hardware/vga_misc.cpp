@@ -60,6 +60,7 @@ uint8_t vga_read_p3da(io_port_t, io_width_t)
 static void write_p3c2(io_port_t, io_val_t value, io_width_t)
 {
 	const auto val = check_cast<uint8_t>(value);
+	VGA_MarkStateChanged();
 	/*
 	   Bit  Description
 	    0   If set: Color Emulation with base Address=3Dxh.
@@ -40,6 +40,15 @@ void write_p3c5(io_port_t, io_val_t value, io_width_t)
 {
 	auto val = check_cast<uint8_t>(value);
 	//	LOG_MSG("SEQ WRITE reg %X val %X",seq(index),val);
+
+	// The map mask only affects writes, which are tracked by the memory
+	// handlers, and is rewritten constantly by programs drawing in the
+	// unchained modes
+	constexpr auto MapMaskIndex = 2;
+	if (seq(index) != MapMaskIndex) {
+		VGA_MarkStateChanged();
+	}
+
 	switch (seq(index)) {
 	case 0: /* Reset */ seq(reset) = val; break;
 	case 1: /* Clocking Mode */
@@ -52,6 +61,8 @@ void write_p3c5(io_port_t, io_val_t value, io_width_t)
 			val = reg.data;
 		}
 		if (val != seq(clocking_mode.data)) {
+			VGA_StopFrameBatching();
+
 			// don't resize if only the screen off bit was changed
 			if ((val & (~0x20)) != (seq(clocking_mode.data) & (~0x20))) {
 				seq(clocking_mode.data) = val;
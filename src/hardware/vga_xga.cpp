@@ -156,6 +156,10 @@ void XGA_DrawPoint(Bitu x, Bitu y, Bitu c) {
 	if(y > xga.scissors.y2) return;
 
 	const auto memaddr = (y * XGA_SCREEN_WIDTH) + x;
+	const auto mark_changed = [memaddr](const uint32_t bytes_per_pixel) {
+		const auto first = static_cast<uint32_t>(memaddr * bytes_per_pixel);
+		VGA_MarkMemoryChanged(first, first + bytes_per_pixel - 1);
+	};
 	/* Need to zero out all unused bits in modes that have any (15-bit or "32"-bit -- the last
 	   one is actually 24-bit. Without this step there may be some graphics corruption (mainly,
 	   during windows dragging. */
@@ -165,24 +169,28 @@ void XGA_DrawPoint(Bitu x, Bitu y, Bitu c) {
 			        break;
 		        }
 		        vga.mem.linear[memaddr] = c;
+		        mark_changed(1);
 		        break;
 	        case M_LIN15:
 		        if (memaddr * 2 >= vga.vmemsize) {
 			        break;
 		        }
 		        ((uint16_t*)(vga.mem.linear))[memaddr] = (uint16_t)(c & 0x7fff);
+		        mark_changed(2);
 		        break;
 	        case M_LIN16:
 		        if (memaddr * 2 >= vga.vmemsize) {
 			        break;
 		        }
 		        ((uint16_t*)(vga.mem.linear))[memaddr] = (uint16_t)(c & 0xffff);
+		        mark_changed(2);
 		        break;
 	        case M_LIN32:
 		        if (memaddr * 4 >= vga.vmemsize) {
 			        break;
 		        }
 		        ((uint32_t*)(vga.mem.linear))[memaddr] = c;
+		        mark_changed(4);
 		        break;
 	        default: break;
 	}
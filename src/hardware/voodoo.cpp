@@ -73,6 +73,8 @@
   TODO: Import and adapt Aaron's latest MAME Voodoo sources.
 */
 
+#include "voodoo.h"
+
 #include "dosbox.h"
 
 #include <algorithm>
@@ -80,11 +82,15 @@
 #include <atomic>
 #include <bit>
 #include <cassert>
+#include <cinttypes>
 #include <cmath>
 #include <condition_variable>
 #include <cstdlib>
 #include <cstring>
 #include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include <SDL.h>
 #include <SDL_cpuinfo.h> // for proper SSE defines for MSVC
@@ -100,6 +106,7 @@
 #include "pci_bus.h"
 #include "pic.h"
 #include "render.h"
+#include "rwqueue.h"
 #include "setup.h"
 #include "simde/x86/sse2.h"
 #include "support.h"
@@ -280,10 +287,10 @@ enum VoodooModel
 #ifdef C_ENABLE_VOODOO_OPENGL
 /* maximum number of rasterizers */
 #define MAX_RASTERIZERS			1024
+#endif
 
 /* size of the rasterizer hash table */
 #define RASTER_HASH_SIZE		97
-#endif
 
 /* flags for LFB writes */
 #define LFB_RGB_PRESENT			1
@@ -865,6 +872,38 @@ struct dac_state
 	uint8_t				read_result;			/* pending read result */
 };
 
+/* mode value meaning "not fixed at compile time, read it at runtime" */
+constexpr uint32_t AnyRasterMode = 0xfffffffe;
+
+/* the effective (normalised) mode combination a triangle is drawn with; */
+/* also used as the compile-time key of the specialised rasterizers */
+struct RasterModes {
+	uint32_t tmus       = 0;
+	uint32_t color_path = AnyRasterMode;
+	uint32_t alpha_mode = AnyRasterMode;
+	uint32_t fog_mode   = AnyRasterMode;
+	uint32_t fbz_mode   = AnyRasterMode;
+	uint32_t tex_mode_0 = AnyRasterMode;
+	uint32_t tex_mode_1 = AnyRasterMode;
+
+	constexpr bool operator==(const RasterModes&) const = default;
+};
+
+struct voodoo_state;
+struct triangle_setup;
+
+using raster_func = void (*)(const voodoo_state* vs, const triangle_setup& tri,
+                             int32_t y, const poly_extent* extent,
+                             stats_block& stats);
+
+/* an observed mode combination and the rasterizer selected for it */
+struct raster_mode_entry {
+	RasterModes modes     = {};
+	raster_func callback  = nullptr;
+	bool is_specialised   = false;
+	uint64_t num_triangles = 0;
+};
+
 #ifdef C_ENABLE_VOODOO_OPENGL
 #ifndef GLhandleARB
 #ifdef __APPLE__
@@ -908,6 +947,52 @@ struct draw_state {
 	bool screen_update_pending   = false;
 };
 
+/* the per-triangle parameters, captured when the triangle command is */
+/* executed so the triangle can also be rasterised later on */
+struct triangle_setup
+{
+	raster_func rasterizer = {};
+	uint32_t texmode0      = 0;
+	uint32_t texmode1      = 0;
+
+	uint16_t* drawbuf = {};
+
+	poly_vertex v1 = {};
+	poly_vertex v2 = {};
+	poly_vertex v3 = {};
+
+	int32_t v1y = 0;
+	int32_t v3y = 0;
+
+	/* edge slopes */
+	float dxdy_v1v2 = 0.0f;
+	float dxdy_v1v3 = 0.0f;
+	float dxdy_v2v3 = 0.0f;
+
+	/* iterated FBI parameters */
+	int16_t ax = 0, ay = 0;
+	int32_t startr = 0, startg = 0, startb = 0, starta = 0;
+	int32_t startz = 0;
+	int64_t startw = 0;
+	int32_t drdx = 0, dgdx = 0, dbdx = 0, dadx = 0;
+	int32_t dzdx = 0;
+	int64_t dwdx = 0;
+	int32_t drdy = 0, dgdy = 0, dbdy = 0, dady = 0;
+	int32_t dzdy = 0;
+	int64_t dwdy = 0;
+
+	/* iterated TMU parameters */
+	struct tmu_params {
+		int64_t starts = 0, startt = 0;
+		int64_t startw = 0;
+		int64_t dsdx = 0, dtdx = 0;
+		int64_t dwdx = 0;
+		int64_t dsdy = 0, dtdy = 0;
+		int64_t dwdy = 0;
+		int32_t lodbasetemp = 0;
+	} tmu[MAX_TMU] = {};
+};
+
 struct triangle_worker
 {
 	triangle_worker(const int num_threads_)
@@ -915,6 +1000,7 @@ struct triangle_worker
 	          // I measured 4x the thread count to be the sweet spot, after which performance degrades.
 	          // This gives about 20% more FPS in Descent II over the old 1x count.
 	          num_work_units((num_threads + 1) * 4),
+	          bins(num_work_units),
 	          threads(num_threads)
 	{
 		assert(num_work_units > num_threads);
@@ -931,15 +1017,20 @@ struct triangle_worker
 
 	std::atomic_bool threads_active = {};
 
-	uint16_t* drawbuf = {};
+	/* the triangle being rasterised, split by pixel count */
+	triangle_setup tri = {};
+	int32_t totalpix   = 0;
 
-	poly_vertex v1 = {};
-	poly_vertex v2 = {};
-	poly_vertex v3 = {};
+	/* tile binning: triangles are collected per band of scanlines until */
+	/* the next sync point, then each band is rasterised by one thread */
+	static constexpr size_t MaxBinnedTriangles = 2048;
+
+	bool use_tile_binning = false;
+	bool is_flushing_bins = false;
+	int32_t band_height   = 1;
 
-	int32_t v1y      = 0;
-	int32_t v3y      = 0;
-	int32_t totalpix = 0;
+	std::vector<triangle_setup> binned_triangles = {};
+	std::vector<std::vector<uint32_t>> bins      = {};
 
 	std::vector<std::thread> threads = {};
 
@@ -949,6 +1040,41 @@ struct triangle_worker
 	std::atomic<int> done_count = 0;
 };
 
+/* The command FIFO defers register, LFB, and texture writes to the render */
+/* thread, like the PCI and memory FIFOs of the real card let the host CPU */
+/* carry on while the chip is still busy rendering. */
+struct command_fifo
+{
+	/* matches the 64K-entry memory FIFO of the real card */
+	static constexpr size_t MaxQueuedWrites = 65536;
+
+	/* writes are handed over in batches to keep the locking overhead low; */
+	/* this is the depth of the PCI FIFO */
+	static constexpr size_t BatchSize = 64;
+
+	/* not a valid offset; makes the render thread rasterise the binned */
+	/* triangles */
+	static constexpr uint32_t FlushBinsMarker = UINT32_MAX;
+
+	command_fifo() : queue(MaxQueuedWrites)
+	{
+		batch.reserve(BatchSize);
+	}
+
+	command_fifo(const command_fifo&)            = delete;
+	command_fifo& operator=(const command_fifo&) = delete;
+
+	bool is_enabled = false;
+
+	RWQueue<VoodooWrite> queue;
+	std::vector<VoodooWrite> batch = {};
+
+	std::thread thread = {};
+
+	std::atomic<uint64_t> num_queued    = 0;
+	std::atomic<uint64_t> num_completed = 0;
+};
+
 struct voodoo_state
 {
 	voodoo_state(const int num_threads)
@@ -983,6 +1109,10 @@ struct voodoo_state
 	                                                    rasterizers */
 #endif
 
+	/* software rasterizers selected per observed mode combination */
+	std::vector<raster_mode_entry> raster_modes[RASTER_HASH_SIZE] = {};
+	raster_mode_entry* last_raster_mode = {};
+
 	bool send_config   = {};
 	bool clock_enabled = {};
 	bool output_on     = {};
@@ -997,6 +1127,7 @@ struct voodoo_state
 #endif
 
 	draw_state draw = {};
+	command_fifo fifo = {};
 	triangle_worker tworker;
 	std::vector<stats_block> thread_stats = {};
 };
@@ -1198,7 +1329,6 @@ inline int64_t float_to_int64(uint32_t data, int fixedbits)
 
 
 
-#ifdef C_ENABLE_VOODOO_OPENGL
 /*************************************
  *
  *  Rasterizer inlines
@@ -1262,25 +1392,39 @@ inline uint32_t normalize_tex_mode(uint32_t eff_tex_mode)
 	return eff_tex_mode;
 }
 
-inline uint32_t compute_raster_hash(const raster_info* info)
+inline uint32_t compute_raster_hash(const RasterModes& modes)
 {
 	uint32_t hash;
 
 	/* make a hash */
-	hash = info->eff_color_path;
+	hash = modes.color_path;
 	hash = (hash << 1) | (hash >> 31);
-	hash ^= info->eff_fbz_mode;
+	hash ^= modes.fbz_mode;
 	hash = (hash << 1) | (hash >> 31);
-	hash ^= info->eff_alpha_mode;
+	hash ^= modes.alpha_mode;
 	hash = (hash << 1) | (hash >> 31);
-	hash ^= info->eff_fog_mode;
+	hash ^= modes.fog_mode;
 	hash = (hash << 1) | (hash >> 31);
-	hash ^= info->eff_tex_mode_0;
+	hash ^= modes.tex_mode_0;
 	hash = (hash << 1) | (hash >> 31);
-	hash ^= info->eff_tex_mode_1;
+	hash ^= modes.tex_mode_1;
 
 	return hash % RASTER_HASH_SIZE;
 }
+
+#ifdef C_ENABLE_VOODOO_OPENGL
+inline uint32_t compute_raster_hash(const raster_info* info)
+{
+	RasterModes modes = {};
+	modes.color_path  = info->eff_color_path;
+	modes.alpha_mode  = info->eff_alpha_mode;
+	modes.fog_mode    = info->eff_fog_mode;
+	modes.fbz_mode    = info->eff_fbz_mode;
+	modes.tex_mode_0  = info->eff_tex_mode_0;
+	modes.tex_mode_1  = info->eff_tex_mode_1;
+
+	return compute_raster_hash(modes);
+}
 #endif
 
 
@@ -3032,6 +3176,9 @@ static voodoo_state* v = nullptr;
 static auto vtype = VOODOO_1;
 
 static auto voodoo_bilinear_filtering = false;
+static auto voodoo_dump_raster_modes  = false;
+static auto voodoo_render_thread      = true;
+static auto voodoo_tile_binning       = false;
 
 #define LOG_VOODOO LOG_PCI
 enum {
@@ -3061,10 +3208,23 @@ static double Voodoo_GetHRetracePosition();
 static dither_lut_t dither2_lookup = {};
 static dither_lut_t dither4_lookup = {};
 
-static inline void raster_generic(const voodoo_state* vs, uint32_t TMUS, uint32_t TEXMODE0,
-                                  uint32_t TEXMODE1, void* destbase, int32_t y,
-                                  const poly_extent* extent, stats_block& stats)
+/* picks the compile-time mode if the rasterizer is specialised for one, */
+/* otherwise the one read from the registers */
+constexpr uint32_t select_raster_mode(const uint32_t fixed_mode, const uint32_t runtime_mode)
+{
+	return (fixed_mode != AnyRasterMode) ? fixed_mode : runtime_mode;
+}
+
+template <RasterModes Modes>
+static void raster_generic(const voodoo_state* vs, const triangle_setup& tri,
+                           int32_t y, const poly_extent* extent, stats_block& stats)
 {
+	constexpr uint32_t TMUS = Modes.tmus;
+	static_assert(TMUS <= MAX_TMU);
+
+	const uint32_t TEXMODE0 = select_raster_mode(Modes.tex_mode_0, tri.texmode0);
+	const uint32_t TEXMODE1 = select_raster_mode(Modes.tex_mode_1, tri.texmode1);
+
 	const uint8_t* dither_lookup = nullptr;
 	const uint8_t* dither4       = nullptr;
 	const uint8_t* dither        = nullptr;
@@ -3077,13 +3237,14 @@ static inline void raster_generic(const voodoo_state* vs, uint32_t TMUS, uint32_
 	const auto regs  = vs->reg;
 	const auto& fbi  = vs->fbi;
 	const auto& tmu0 = vs->tmu[0];
-	const auto& tmu1 = vs->tmu[1];
 
-	const uint32_t r_fbzColorPath = regs[fbzColorPath].u;
-	const uint32_t r_fbzMode      = regs[fbzMode].u;
-	const uint32_t r_alphaMode    = regs[alphaMode].u;
-	const uint32_t r_fogMode      = regs[fogMode].u;
-	const uint32_t r_zaColor      = regs[zaColor].u;
+	const uint32_t r_fbzColorPath = select_raster_mode(Modes.color_path,
+	                                                   regs[fbzColorPath].u);
+	const uint32_t r_fbzMode = select_raster_mode(Modes.fbz_mode, regs[fbzMode].u);
+	const uint32_t r_alphaMode = select_raster_mode(Modes.alpha_mode,
+	                                                regs[alphaMode].u);
+	const uint32_t r_fogMode = select_raster_mode(Modes.fog_mode, regs[fogMode].u);
+	const uint32_t r_zaColor = regs[zaColor].u;
 
 	uint32_t r_stipple = regs[stipple].u;
 
@@ -3135,22 +3296,22 @@ static inline void raster_generic(const voodoo_state* vs, uint32_t TMUS, uint32_
 	}
 
 	/* get pointers to the target buffer and depth buffer */
-	uint16_t* dest  = (uint16_t*)destbase + scry * fbi.rowpixels;
+	uint16_t* dest  = tri.drawbuf + scry * fbi.rowpixels;
 	uint16_t* depth = (fbi.auxoffs != (uint32_t)(~0))
 	                        ? ((uint16_t*)(fbi.ram + fbi.auxoffs) +
 	                           scry * fbi.rowpixels)
 	                        : nullptr;
 
 	/* compute the starting parameters */
-	const int32_t dx = startx - (fbi.ax >> 4);
-	const int32_t dy = y - (fbi.ay >> 4);
-
-	int32_t iterr = fbi.startr + dy * fbi.drdy + dx * fbi.drdx;
-	int32_t iterg = fbi.startg + dy * fbi.dgdy + dx * fbi.dgdx;
-	int32_t iterb = fbi.startb + dy * fbi.dbdy + dx * fbi.dbdx;
-	int32_t itera = fbi.starta + dy * fbi.dady + dx * fbi.dadx;
-	int32_t iterz = fbi.startz + dy * fbi.dzdy + dx * fbi.dzdx;
-	int64_t iterw = fbi.startw + dy * fbi.dwdy + dx * fbi.dwdx;
+	const int32_t dx = startx - (tri.ax >> 4);
+	const int32_t dy = y - (tri.ay >> 4);
+
+	int32_t iterr = tri.startr + dy * tri.drdy + dx * tri.drdx;
+	int32_t iterg = tri.startg + dy * tri.dgdy + dx * tri.dgdx;
+	int32_t iterb = tri.startb + dy * tri.dbdy + dx * tri.dbdx;
+	int32_t itera = tri.starta + dy * tri.dady + dx * tri.dadx;
+	int32_t iterz = tri.startz + dy * tri.dzdy + dx * tri.dzdx;
+	int64_t iterw = tri.startw + dy * tri.dwdy + dx * tri.dwdx;
 	int64_t iterw0 = 0;
 	int64_t iterw1 = 0;
 	int64_t iters0 = 0;
@@ -3159,15 +3320,15 @@ static inline void raster_generic(const voodoo_state* vs, uint32_t TMUS, uint32_
 	int64_t itert1 = 0;
 	if (TMUS >= 1)
 	{
-		iterw0 = tmu0.startw + dy * tmu0.dwdy + dx * tmu0.dwdx;
-		iters0 = tmu0.starts + dy * tmu0.dsdy + dx * tmu0.dsdx;
-		itert0 = tmu0.startt + dy * tmu0.dtdy + dx * tmu0.dtdx;
+		iterw0 = tri.tmu[0].startw + dy * tri.tmu[0].dwdy + dx * tri.tmu[0].dwdx;
+		iters0 = tri.tmu[0].starts + dy * tri.tmu[0].dsdy + dx * tri.tmu[0].dsdx;
+		itert0 = tri.tmu[0].startt + dy * tri.tmu[0].dtdy + dx * tri.tmu[0].dtdx;
 	}
 	if (TMUS >= 2)
 	{
-		iterw1 = tmu1.startw + dy * tmu1.dwdy + dx * tmu1.dwdx;
-		iters1 = tmu1.starts + dy * tmu1.dsdy + dx * tmu1.dsdx;
-		itert1 = tmu1.startt + dy * tmu1.dtdy + dx * tmu1.dtdx;
+		iterw1 = tri.tmu[1].startw + dy * tri.tmu[1].dwdy + dx * tri.tmu[1].dwdx;
+		iters1 = tri.tmu[1].starts + dy * tri.tmu[1].dsdy + dx * tri.tmu[1].dsdx;
+		itert1 = tri.tmu[1].startt + dy * tri.tmu[1].dtdy + dx * tri.tmu[1].dtdx;
 	}
 
 	/* loop in X */
@@ -3186,7 +3347,7 @@ static inline void raster_generic(const voodoo_state* vs, uint32_t TMUS, uint32_
 			const tmu_state* const tmus = &vs->tmu[1];
 			const rgb_t* const lookup = tmus->lookup;
 			TEXTURE_PIPELINE(tmus, x, dither4, TEXMODE1, texel,
-								lookup, tmus->lodbasetemp,
+								lookup, tri.tmu[1].lodbasetemp,
 								iters1, itert1, iterw1, texel);
 		}
 
@@ -3198,7 +3359,7 @@ static inline void raster_generic(const voodoo_state* vs, uint32_t TMUS, uint32_
 				const tmu_state* const tmus = &tmu0;
 				const rgb_t* const lookup = tmus->lookup;
 				TEXTURE_PIPELINE(tmus, x, dither4, TEXMODE0, texel,
-								lookup, tmus->lodbasetemp,
+								lookup, tri.tmu[0].lodbasetemp,
 								iters0, itert0, iterw0, texel);
 			} else {	/* send config data to the frame buffer */
 				texel.u=vs->tmu_config;
@@ -3450,25 +3611,235 @@ static inline void raster_generic(const voodoo_state* vs, uint32_t TMUS, uint32_
 		PIXEL_PIPELINE_END(stats);
 
 		/* update the iterated parameters */
-		iterr += fbi.drdx;
-		iterg += fbi.dgdx;
-		iterb += fbi.dbdx;
-		itera += fbi.dadx;
-		iterz += fbi.dzdx;
-		iterw += fbi.dwdx;
+		iterr += tri.drdx;
+		iterg += tri.dgdx;
+		iterb += tri.dbdx;
+		itera += tri.dadx;
+		iterz += tri.dzdx;
+		iterw += tri.dwdx;
 		if (TMUS >= 1)
 		{
-			iterw0 += tmu0.dwdx;
-			iters0 += tmu0.dsdx;
-			itert0 += tmu0.dtdx;
+			iterw0 += tri.tmu[0].dwdx;
+			iters0 += tri.tmu[0].dsdx;
+			itert0 += tri.tmu[0].dtdx;
 		}
 		if (TMUS >= 2)
 		{
-			iterw1 += tmu1.dwdx;
-			iters1 += tmu1.dsdx;
-			itert1 += tmu1.dtdx;
+			iterw1 += tri.tmu[1].dwdx;
+			iters1 += tri.tmu[1].dsdx;
+			itert1 += tri.tmu[1].dtdx;
+		}
+	}
+}
+
+/*-------------------------------------------------
+    specialised rasterizers - raster_generic
+    instantiations with the modes of common
+    Glide setups baked in
+-------------------------------------------------*/
+
+/* fbzColorPath values as set up by Glide's grColorCombine() and */
+/* grAlphaCombine(), after normalize_color_path() */
+constexpr uint32_t ColorPathGouraud       = 0x00e26100; /* iterated RGBA */
+constexpr uint32_t ColorPathDecal         = 0x00e20001; /* texture RGB, iterated A */
+constexpr uint32_t ColorPathModulate      = 0x00e22401; /* texture * iterated RGB, iterated A */
+constexpr uint32_t ColorPathModulateAlpha = 0x00482405; /* texture * iterated RGBA */
+
+/* alphaMode values after normalize_alpha_mode() */
+constexpr uint32_t AlphaModeOpaque    = 0x00000000;
+constexpr uint32_t AlphaModeBlend     = 0x00045110; /* src alpha, 1 - src alpha */
+constexpr uint32_t AlphaModeTestGreater = 0x00000009; /* alpha > ref */
+
+/* fogMode value after normalize_fog_mode() when fog is disabled */
+constexpr uint32_t FogModeDisabled = 0x00000000;
+
+/* The first entry covering the observed modes is used, so more specific */
+/* entries must come first. The table ends with the fully generic rasterizer */
+/* for each TMU count, so every combination is covered. Lines logged by the */
+/* 'voodoo_dump_raster_modes' setting can be pasted here as-is. */
+constexpr RasterModes SpecialisedRasterModes[] = {
+        {.tmus = 0, .color_path = ColorPathGouraud, .alpha_mode = AlphaModeOpaque, .fog_mode = FogModeDisabled},
+        {.tmus = 0, .color_path = ColorPathGouraud, .alpha_mode = AlphaModeBlend, .fog_mode = FogModeDisabled},
+
+        {.tmus = 1, .color_path = ColorPathDecal, .alpha_mode = AlphaModeOpaque, .fog_mode = FogModeDisabled},
+        {.tmus = 1, .color_path = ColorPathDecal, .alpha_mode = AlphaModeBlend, .fog_mode = FogModeDisabled},
+        {.tmus = 1, .color_path = ColorPathDecal, .alpha_mode = AlphaModeTestGreater, .fog_mode = FogModeDisabled},
+        {.tmus = 1, .color_path = ColorPathModulate, .alpha_mode = AlphaModeOpaque, .fog_mode = FogModeDisabled},
+        {.tmus = 1, .color_path = ColorPathModulate, .alpha_mode = AlphaModeBlend, .fog_mode = FogModeDisabled},
+        {.tmus = 1, .color_path = ColorPathModulate, .alpha_mode = AlphaModeTestGreater, .fog_mode = FogModeDisabled},
+        {.tmus = 1, .color_path = ColorPathModulateAlpha, .alpha_mode = AlphaModeOpaque, .fog_mode = FogModeDisabled},
+        {.tmus = 1, .color_path = ColorPathModulateAlpha, .alpha_mode = AlphaModeBlend, .fog_mode = FogModeDisabled},
+        {.tmus = 1, .color_path = ColorPathModulateAlpha, .alpha_mode = AlphaModeTestGreater, .fog_mode = FogModeDisabled},
+
+        {.tmus = 2, .color_path = ColorPathDecal, .alpha_mode = AlphaModeOpaque, .fog_mode = FogModeDisabled},
+        {.tmus = 2, .color_path = ColorPathDecal, .alpha_mode = AlphaModeBlend, .fog_mode = FogModeDisabled},
+        {.tmus = 2, .color_path = ColorPathModulate, .alpha_mode = AlphaModeOpaque, .fog_mode = FogModeDisabled},
+        {.tmus = 2, .color_path = ColorPathModulate, .alpha_mode = AlphaModeBlend, .fog_mode = FogModeDisabled},
+        {.tmus = 2, .color_path = ColorPathModulateAlpha, .alpha_mode = AlphaModeOpaque, .fog_mode = FogModeDisabled},
+        {.tmus = 2, .color_path = ColorPathModulateAlpha, .alpha_mode = AlphaModeBlend, .fog_mode = FogModeDisabled},
+
+        /* generic fallbacks */
+        {.tmus = 0},
+        {.tmus = 1},
+        {.tmus = 2},
+};
+
+template <size_t... Indexes>
+constexpr auto make_specialised_rasterizers(std::index_sequence<Indexes...>)
+{
+	return std::array<raster_func, sizeof...(Indexes)>{
+	        &raster_generic<SpecialisedRasterModes[Indexes]>...};
+}
+
+constexpr auto specialised_rasterizers = make_specialised_rasterizers(
+        std::make_index_sequence<std::size(SpecialisedRasterModes)>());
+
+constexpr bool is_generic_raster_modes(const RasterModes& modes)
+{
+	return modes == RasterModes{modes.tmus};
+}
+
+static bool raster_modes_covered_by(const RasterModes& modes,
+                                    const RasterModes& specialised)
+{
+	auto covered = [](const uint32_t mode, const uint32_t specialised_mode) {
+		return specialised_mode == AnyRasterMode || specialised_mode == mode;
+	};
+	return modes.tmus == specialised.tmus &&
+	       covered(modes.color_path, specialised.color_path) &&
+	       covered(modes.alpha_mode, specialised.alpha_mode) &&
+	       covered(modes.fog_mode, specialised.fog_mode) &&
+	       covered(modes.fbz_mode, specialised.fbz_mode) &&
+	       covered(modes.tex_mode_0, specialised.tex_mode_0) &&
+	       covered(modes.tex_mode_1, specialised.tex_mode_1);
+}
+
+/*-------------------------------------------------
+    find_raster_mode - find the entry for the
+    given modes in our hash table, selecting a
+    rasterizer for it if it's a new combination
+-------------------------------------------------*/
+static raster_mode_entry& find_raster_mode(voodoo_state* vs, const RasterModes& modes)
+{
+	/* consecutive triangles are usually drawn with the same modes */
+	if (vs->last_raster_mode && vs->last_raster_mode->modes == modes) {
+		return *vs->last_raster_mode;
+	}
+
+	auto& bucket = vs->raster_modes[compute_raster_hash(modes)];
+	for (auto& entry : bucket) {
+		if (entry.modes == modes) {
+			vs->last_raster_mode = &entry;
+			return entry;
+		}
+	}
+
+	raster_mode_entry new_entry = {};
+	new_entry.modes = modes;
+	for (size_t i = 0; i < std::size(SpecialisedRasterModes); ++i) {
+		if (raster_modes_covered_by(modes, SpecialisedRasterModes[i])) {
+			new_entry.callback = specialised_rasterizers[i];
+			new_entry.is_specialised = !is_generic_raster_modes(
+			        SpecialisedRasterModes[i]);
+			break;
+		}
+	}
+	assert(new_entry.callback);
+
+	if (LOG_RASTERIZERS) {
+		maybe_log_debug("Adding %s rasterizer: %u %08X %08X %08X %08X %08X %08X\n",
+		                new_entry.is_specialised ? "specialised" : "generic",
+		                modes.tmus,
+		                modes.color_path,
+		                modes.alpha_mode,
+		                modes.fog_mode,
+		                modes.fbz_mode,
+		                modes.tex_mode_0,
+		                modes.tex_mode_1);
+	}
+
+	// This invalidates pointers into the bucket, so only the new entry may
+	// be remembered as the last one
+	bucket.push_back(new_entry);
+	vs->last_raster_mode = &bucket.back();
+	return bucket.back();
+}
+
+/*-------------------------------------------------
+    select_rasterizer - pick the rasterizer and
+    texture modes for the current triangle
+-------------------------------------------------*/
+static void select_rasterizer(voodoo_state* vs, const int texcount, triangle_setup& tri)
+{
+	const auto regs     = vs->reg;
+	const auto& tworker = vs->tworker;
+
+	uint32_t texmode0 = 0;
+	uint32_t texmode1 = 0;
+	if (texcount >= 1) {
+		texmode0 = vs->tmu[0].reg[textureMode].u;
+		if (texcount >= 2) {
+			texmode1 = vs->tmu[1].reg[textureMode].u;
+		}
+		if (tworker.disable_bilinear_filter) // force disable bilinear filter
+		{
+			texmode0 &= ~6;
+			texmode1 &= ~6;
+		}
+	}
+
+	RasterModes modes = {};
+	modes.tmus        = check_cast<uint32_t>(texcount);
+	modes.color_path  = normalize_color_path(regs[fbzColorPath].u);
+	modes.alpha_mode  = normalize_alpha_mode(regs[alphaMode].u);
+	modes.fog_mode    = normalize_fog_mode(regs[fogMode].u);
+	modes.fbz_mode    = normalize_fbz_mode(regs[fbzMode].u);
+	modes.tex_mode_0 = (texcount >= 1) ? normalize_tex_mode(texmode0) : 0xffffffff;
+	modes.tex_mode_1 = (texcount >= 2) ? normalize_tex_mode(texmode1) : 0xffffffff;
+
+	auto& entry = find_raster_mode(vs, modes);
+	++entry.num_triangles;
+
+	tri.rasterizer = entry.callback;
+	tri.texmode0   = texmode0;
+	tri.texmode1   = texmode1;
+}
+
+/*-------------------------------------------------
+    log_raster_modes - log the observed mode
+    combinations, most used first, in the format
+    of the SpecialisedRasterModes table
+-------------------------------------------------*/
+static void log_raster_modes(const voodoo_state* vs)
+{
+	std::vector<const raster_mode_entry*> entries = {};
+	for (const auto& bucket : vs->raster_modes) {
+		for (const auto& entry : bucket) {
+			entries.push_back(&entry);
 		}
 	}
+	std::sort(entries.begin(), entries.end(), [](const auto a, const auto b) {
+		return a->num_triangles > b->num_triangles;
+	});
+
+	LOG_MSG("VOODOO: Observed %zu raster mode combinations, most used first:",
+	        entries.size());
+
+	for (const auto entry : entries) {
+		const auto& modes = entry->modes;
+		LOG_MSG("VOODOO:   {.tmus = %u, .color_path = 0x%08x, .alpha_mode = 0x%08x, "
+		        ".fog_mode = 0x%08x, .fbz_mode = 0x%08x, .tex_mode_0 = 0x%08x, "
+		        ".tex_mode_1 = 0x%08x}, /* %" PRIu64 " triangles, %s */",
+		        modes.tmus,
+		        modes.color_path,
+		        modes.alpha_mode,
+		        modes.fog_mode,
+		        modes.fbz_mode,
+		        modes.tex_mode_0,
+		        modes.tex_mode_1,
+		        entry->num_triangles,
+		        entry->is_specialised ? "specialised" : "generic");
+	}
 }
 
 #ifdef C_ENABLE_VOODOO_OPENGL
@@ -4334,40 +4705,47 @@ static void update_statistics(voodoo_state *vs, bool accumulate)
     COMMAND HANDLERS
 ***************************************************************************/
 
-static void triangle_worker_work(const triangle_worker& tworker,
-                                 const int32_t work_start, const int32_t work_end)
+static void compute_triangle_slopes(triangle_setup& tri)
 {
-	/* determine the number of TMUs involved */
-	uint32_t tmus     = 0;
-	uint32_t texmode0 = 0;
-	uint32_t texmode1 = 0;
-	if (!FBIINIT3_DISABLE_TMUS(v->reg[fbiInit3].u) && FBZCP_TEXTURE_ENABLE(v->reg[fbzColorPath].u))
-	{
-		tmus = 1;
-		texmode0 = v->tmu[0].reg[textureMode].u;
-		if ((v->chipmask & 0x04) != 0)
-		{
-			tmus = 2;
-			texmode1 = v->tmu[1].reg[textureMode].u;
-		}
-		if (tworker.disable_bilinear_filter) //force disable bilinear filter
-		{
-			texmode0 &= ~6;
-			texmode1 &= ~6;
-		}
-	}
-
 	/* compute the slopes for each portion of the triangle */
-	const poly_vertex v1 = tworker.v1;
-	const poly_vertex v2 = tworker.v2;
-	const poly_vertex v3 = tworker.v3;
+	const poly_vertex& v1 = tri.v1;
+	const poly_vertex& v2 = tri.v2;
+	const poly_vertex& v3 = tri.v3;
 
-	const float dxdy_v1v2 = (v2.y == v1.y) ? 0.0f
-	                                       : (v2.x - v1.x) / (v2.y - v1.y);
-	const float dxdy_v1v3 = (v3.y == v1.y) ? 0.0f
-	                                       : (v3.x - v1.x) / (v3.y - v1.y);
-	const float dxdy_v2v3 = (v3.y == v2.y) ? 0.0f
-	                                       : (v3.x - v2.x) / (v3.y - v2.y);
+	tri.dxdy_v1v2 = (v2.y == v1.y) ? 0.0f : (v2.x - v1.x) / (v2.y - v1.y);
+	tri.dxdy_v1v3 = (v3.y == v1.y) ? 0.0f : (v3.x - v1.x) / (v3.y - v1.y);
+	tri.dxdy_v2v3 = (v3.y == v2.y) ? 0.0f : (v3.x - v2.x) / (v3.y - v2.y);
+}
+
+/* computes the unclipped extent of the triangle on the given scanline, */
+/* ordered so startx <= stopx */
+static poly_extent compute_scanline_extent(const triangle_setup& tri, const int32_t y)
+{
+	const float fully = (float)(y) + 0.5f;
+
+	const float startx = tri.v1.x + (fully - tri.v1.y) * tri.dxdy_v1v3;
+
+	/* compute the ending X based on which part of the triangle we're in */
+	const float stopx = (fully < tri.v2.y
+	                             ? (tri.v1.x + (fully - tri.v1.y) * tri.dxdy_v1v2)
+	                             : (tri.v2.x + (fully - tri.v2.y) * tri.dxdy_v2v3));
+
+	/* clamp to full pixels */
+	poly_extent extent;
+	extent.startx = round_coordinate(startx);
+	extent.stopx  = round_coordinate(stopx);
+
+	/* force start < stop */
+	if (extent.startx > extent.stopx) {
+		std::swap(extent.startx, extent.stopx);
+	}
+	return extent;
+}
+
+static void triangle_worker_work(const triangle_worker& tworker,
+                                 const int32_t work_start, const int32_t work_end)
+{
+	const triangle_setup& tri = tworker.tri;
 
 	stats_block my_stats = {};
 
@@ -4382,31 +4760,13 @@ static void triangle_worker_work(const triangle_worker& tworker,
 	const int32_t from = tworker.totalpix * work_start / num_work_units;
 	const int32_t to   = tworker.totalpix * work_end / num_work_units;
 
-	for (int32_t curscan = tworker.v1y, scanend = tworker.v3y, sumpix = 0, lastsum = 0;
+	for (int32_t curscan = tri.v1y, scanend = tri.v3y, sumpix = 0, lastsum = 0;
 	     curscan != scanend && lastsum < to;
 	     lastsum = sumpix, curscan++) {
 
-		const float fully = (float)(curscan) + 0.5f;
-
-		const float startx = v1.x + (fully - v1.y) * dxdy_v1v3;
-
-		/* compute the ending X based on which part of the triangle we're in */
-		const float stopx = (fully < v2.y
-		                             ? (v1.x + (fully - v1.y) * dxdy_v1v2)
-		                             : (v2.x + (fully - v2.y) * dxdy_v2v3));
-
-		/* clamp to full pixels */
-		poly_extent extent;
-		extent.startx = round_coordinate(startx);
-		extent.stopx = round_coordinate(stopx);
-
-		/* force start < stop */
-		if (extent.startx >= extent.stopx)
-		{
-			if (extent.startx == extent.stopx) {
-				continue;
-			}
-			std::swap(extent.startx, extent.stopx);
+		poly_extent extent = compute_scanline_extent(tri, curscan);
+		if (extent.startx == extent.stopx) {
+			continue;
 		}
 
 		sumpix += (extent.stopx - extent.startx);
@@ -4421,11 +4781,40 @@ static void triangle_worker_work(const triangle_worker& tworker,
 			extent.stopx -= (sumpix - to);
 		}
 
-		raster_generic(v, tmus, texmode0, texmode1, tworker.drawbuf, curscan, &extent, my_stats);
+		tri.rasterizer(v, tri, curscan, &extent, my_stats);
 	}
 	sum_statistics(&v->thread_stats[work_start], &my_stats);
 }
 
+/* rasterises the part of every binned triangle that falls into the band */
+static void bin_worker_work(const triangle_worker& tworker, const int32_t band)
+{
+	stats_block my_stats = {};
+
+	const int32_t band_start = band * tworker.band_height;
+	const int32_t band_end   = band_start + tworker.band_height;
+
+	const auto is_first_band = (band == 0);
+	const auto is_last_band  = (band == tworker.num_work_units - 1);
+
+	for (const auto index : tworker.bins[band]) {
+		const triangle_setup& tri = tworker.binned_triangles[index];
+
+		// Scanlines outside the screen go to the first or last band
+		const auto from = is_first_band ? tri.v1y : std::max(tri.v1y, band_start);
+		const auto to = is_last_band ? tri.v3y : std::min(tri.v3y, band_end);
+
+		for (int32_t curscan = from; curscan < to; curscan++) {
+			const poly_extent extent = compute_scanline_extent(tri, curscan);
+			if (extent.startx == extent.stopx) {
+				continue;
+			}
+			tri.rasterizer(v, tri, curscan, &extent, my_stats);
+		}
+	}
+	sum_statistics(&v->thread_stats[band], &my_stats);
+}
+
 // NOTE (weirddan455): In case anyone wants to optimize this further on ARM:
 //
 // I was conservative with setting memory order on these atomic variables.
@@ -4462,7 +4851,11 @@ static int do_triangle_work(triangle_worker& tworker)
 
 	i = tworker.work_index.fetch_add(1, std::memory_order_acq_rel);
 	if (i < tworker.num_work_units) {
-		triangle_worker_work(tworker, i, i + 1);
+		if (tworker.is_flushing_bins) {
+			bin_worker_work(tworker, i);
+		} else {
+			triangle_worker_work(tworker, i, i + 1);
+		}
 		int done = tworker.done_count.fetch_add(1, std::memory_order_acq_rel) + 1;
 		if (done >= tworker.num_work_units) {
 			tworker.done_count.notify_all();
@@ -4502,54 +4895,10 @@ static void triangle_worker_shutdown(triangle_worker& tworker)
 	}
 }
 
-static void triangle_worker_run(triangle_worker& tworker)
+// Wakes up the worker threads and waits until all the work units have been
+// processed
+static void triangle_worker_dispatch(triangle_worker& tworker)
 {
-	if (!tworker.num_threads) {
-		// do not use threaded calculation
-		tworker.totalpix = 0xFFFFFFF;
-		triangle_worker_work(tworker, 0, tworker.num_work_units);
-		return;
-	}
-
-	/* compute the slopes for each portion of the triangle */
-	const poly_vertex v1 = tworker.v1;
-	const poly_vertex v2 = tworker.v2;
-	const poly_vertex v3 = tworker.v3;
-
-	const float dxdy_v1v2 = (v2.y == v1.y) ? 0.0f
-	                                       : (v2.x - v1.x) / (v2.y - v1.y);
-	const float dxdy_v1v3 = (v3.y == v1.y) ? 0.0f
-	                                       : (v3.x - v1.x) / (v3.y - v1.y);
-	const float dxdy_v2v3 = (v3.y == v2.y) ? 0.0f
-	                                       : (v3.x - v2.x) / (v3.y - v2.y);
-
-	int32_t pixsum = 0;
-	for (int32_t curscan = tworker.v1y, scanend = tworker.v3y; curscan != scanend; curscan++)
-	{
-		const float fully  = (float)(curscan) + 0.5f;
-		const float startx = v1.x + (fully - v1.y) * dxdy_v1v3;
-
-		/* compute the ending X based on which part of the triangle we're in */
-		const float stopx = (fully < v2.y
-		                             ? (v1.x + (fully - v1.y) * dxdy_v1v2)
-		                             : (v2.x + (fully - v2.y) * dxdy_v2v3));
-
-		/* clamp to full pixels */
-		const int32_t istartx = round_coordinate(startx);
-		const int32_t istopx  = round_coordinate(stopx);
-
-		/* force start < stop */
-		pixsum += (istartx > istopx ? istartx - istopx : istopx - istartx);
-	}
-	tworker.totalpix = pixsum;
-
-	// Don't wake up threads for just a few pixels
-	if (tworker.totalpix <= 200)
-	{
-		triangle_worker_work(tworker, 0, tworker.num_work_units);
-		return;
-	}
-
 	// The main thread is the only one who sets threads_active (here and in shutdown) so there is no race condition.
 	// In the future, if this changes, this will need to be an atomic compare_exchange.
 	// For now, this is better because 99% of the time threads_active == true.
@@ -4581,6 +4930,93 @@ static void triangle_worker_run(triangle_worker& tworker)
 	}
 }
 
+static void triangle_worker_run(triangle_worker& tworker)
+{
+	if (!tworker.num_threads) {
+		// do not use threaded calculation
+		tworker.totalpix = 0xFFFFFFF;
+		triangle_worker_work(tworker, 0, tworker.num_work_units);
+		return;
+	}
+
+	const triangle_setup& tri = tworker.tri;
+
+	int32_t pixsum = 0;
+	for (int32_t curscan = tri.v1y, scanend = tri.v3y; curscan != scanend; curscan++)
+	{
+		const poly_extent extent = compute_scanline_extent(tri, curscan);
+		pixsum += extent.stopx - extent.startx;
+	}
+	tworker.totalpix = pixsum;
+
+	// Don't wake up threads for just a few pixels
+	if (tworker.totalpix <= 200)
+	{
+		triangle_worker_work(tworker, 0, tworker.num_work_units);
+		return;
+	}
+
+	triangle_worker_dispatch(tworker);
+}
+
+/*-------------------------------------------------
+    flush_triangle_bins - rasterise all the binned
+    triangles, one band per work unit
+-------------------------------------------------*/
+static void flush_triangle_bins(triangle_worker& tworker)
+{
+	if (tworker.binned_triangles.empty()) {
+		return;
+	}
+
+	if (!tworker.num_threads) {
+		for (int32_t band = 0; band < tworker.num_work_units; ++band) {
+			bin_worker_work(tworker, band);
+		}
+	} else {
+		tworker.is_flushing_bins = true;
+		triangle_worker_dispatch(tworker);
+		tworker.is_flushing_bins = false;
+	}
+
+	for (auto& bin : tworker.bins) {
+		bin.clear();
+	}
+	tworker.binned_triangles.clear();
+}
+
+/*-------------------------------------------------
+    bin_triangle - add the triangle to the bins of
+    the bands it covers
+-------------------------------------------------*/
+static void bin_triangle(voodoo_state* vs, const triangle_setup& tri)
+{
+	auto& tworker = vs->tworker;
+
+	if (tworker.binned_triangles.size() >= triangle_worker::MaxBinnedTriangles) {
+		flush_triangle_bins(tworker);
+	}
+
+	// The band layout stays fixed until the bins are flushed
+	if (tworker.binned_triangles.empty()) {
+		const auto num_rows = std::max(vs->fbi.height, uint32_t{1});
+		const auto num_bands = static_cast<uint32_t>(tworker.num_work_units);
+		tworker.band_height = static_cast<int32_t>((num_rows + num_bands - 1) /
+		                                           num_bands);
+	}
+
+	const auto index = static_cast<uint32_t>(tworker.binned_triangles.size());
+	tworker.binned_triangles.push_back(tri);
+
+	const auto last_band = tworker.num_work_units - 1;
+	auto band_of = [&](const int32_t y) {
+		return std::clamp(y / tworker.band_height, 0, last_band);
+	};
+	for (auto band = band_of(tri.v1y); band <= band_of(tri.v3y - 1); ++band) {
+		tworker.bins[band].push_back(index);
+	}
+}
+
 /*-------------------------------------------------
     triangle - execute the 'triangle'
     command
@@ -4784,11 +5220,59 @@ static void triangle(voodoo_state *vs)
 	}
 
 	triangle_worker& tworker = vs->tworker;
-	tworker.v1 = *v1, tworker.v2 = *v2, tworker.v3 = *v3;
-	tworker.drawbuf = drawbuf;
-	tworker.v1y = v1y;
-	tworker.v3y = v3y;
-	triangle_worker_run(tworker);
+	triangle_setup& tri      = tworker.tri;
+
+	select_rasterizer(vs, texcount, tri);
+
+	tri.v1 = *v1, tri.v2 = *v2, tri.v3 = *v3;
+	tri.drawbuf = drawbuf;
+	tri.v1y = v1y;
+	tri.v3y = v3y;
+	compute_triangle_slopes(tri);
+
+	/* capture the iterated parameters */
+	tri.ax     = fbi.ax;
+	tri.ay     = fbi.ay;
+	tri.startr = fbi.startr;
+	tri.startg = fbi.startg;
+	tri.startb = fbi.startb;
+	tri.starta = fbi.starta;
+	tri.startz = fbi.startz;
+	tri.startw = fbi.startw;
+	tri.drdx   = fbi.drdx;
+	tri.dgdx   = fbi.dgdx;
+	tri.dbdx   = fbi.dbdx;
+	tri.dadx   = fbi.dadx;
+	tri.dzdx   = fbi.dzdx;
+	tri.dwdx   = fbi.dwdx;
+	tri.drdy   = fbi.drdy;
+	tri.dgdy   = fbi.dgdy;
+	tri.dbdy   = fbi.dbdy;
+	tri.dady   = fbi.dady;
+	tri.dzdy   = fbi.dzdy;
+	tri.dwdy   = fbi.dwdy;
+
+	for (int i = 0; i < texcount; ++i) {
+		const auto& tmu = vs->tmu[i];
+		auto& params    = tri.tmu[i];
+
+		params.starts      = tmu.starts;
+		params.startt      = tmu.startt;
+		params.startw      = tmu.startw;
+		params.dsdx        = tmu.dsdx;
+		params.dtdx        = tmu.dtdx;
+		params.dwdx        = tmu.dwdx;
+		params.dsdy        = tmu.dsdy;
+		params.dtdy        = tmu.dtdy;
+		params.dwdy        = tmu.dwdy;
+		params.lodbasetemp = tmu.lodbasetemp;
+	}
+
+	if (tworker.use_tile_binning) {
+		bin_triangle(vs, tri);
+	} else {
+		triangle_worker_run(tworker);
+	}
 
 	/* update stats */
 	regs[fbiTrianglesOut].u++;
@@ -5201,6 +5685,15 @@ static void soft_reset(voodoo_state *vs)
  *  Voodoo register writes
  *
  *************************************/
+static uint8_t get_register_number(const uint32_t offset)
+{
+	/* the first 64 registers can be aliased differently */
+	const auto is_aliased = (offset & 0x800c0) == 0x80000 && v->alt_regmap;
+
+	return is_aliased ? register_alias_map[offset & 0x3f]
+	                  : static_cast<uint8_t>(offset & 0xff);
+}
+
 static void register_w(uint32_t offset, uint32_t data)
 {
 	auto chips = check_cast<uint8_t>((offset >> 8) & 0xf);
@@ -5214,11 +5707,7 @@ static void register_w(uint32_t offset, uint32_t data)
 	}
 	chips &= v->chipmask;
 
-	/* the first 64 registers can be aliased differently */
-	const auto is_aliased = (offset & 0x800c0) == 0x80000 && v->alt_regmap;
-
-	const auto regnum = is_aliased ? register_alias_map[offset & 0x3f]
-	                               : static_cast<uint8_t>(offset & 0xff);
+	const auto regnum = get_register_number(offset);
 
 	/* first make sure this register is readable */
 	if ((v->regaccess[regnum] & REGISTER_WRITE) == 0)
@@ -7041,9 +7530,22 @@ constexpr uint32_t next_addr(const uint32_t addr)
 	return addr + next_offset;
 }
 
-static void voodoo_w(const uint32_t addr, const uint32_t data, const uint32_t mask)
+// Writes to the triangle parameter and command registers are the only ones
+// that don't affect how already binned triangles are rasterised
+static bool is_triangle_setup_write(const uint32_t offset)
 {
-	const auto offset = (addr >> 2) & offset_mask;
+	if ((offset & offset_base) != 0) {
+		return false;
+	}
+	const auto regnum = get_register_number(offset);
+	return regnum >= vertexAx && regnum <= ftriangleCMD;
+}
+
+static void execute_write(const uint32_t offset, const uint32_t data, const uint32_t mask)
+{
+	if (v->tworker.use_tile_binning && !is_triangle_setup_write(offset)) {
+		flush_triangle_bins(v->tworker);
+	}
 
 	if ((offset & offset_base) == 0) {
 		register_w(offset, data);
@@ -7054,8 +7556,158 @@ static void voodoo_w(const uint32_t addr, const uint32_t data, const uint32_t ma
 	}
 }
 
-static constexpr uint32_t voodoo_r(const uint32_t addr)
+/*-------------------------------------------------
+    command FIFO - the render thread executes the
+    queued writes in order while the emulation
+    thread carries on
+-------------------------------------------------*/
+static void render_thread_func()
 {
+	auto& fifo = v->fifo;
+
+	while (const auto write = fifo.queue.Dequeue()) {
+		if (write->offset == command_fifo::FlushBinsMarker) {
+			flush_triangle_bins(v->tworker);
+		} else {
+			execute_write(write->offset, write->data, write->mask);
+		}
+
+		const auto num_completed = fifo.num_completed.fetch_add(
+		                                   1, std::memory_order_acq_rel) +
+		                           1;
+
+		// Only wake up the emulation thread if it might be waiting
+		// for us to catch up
+		if (num_completed == fifo.num_queued.load(std::memory_order_acquire)) {
+			fifo.num_completed.notify_one();
+		}
+	}
+}
+
+static void flush_command_fifo()
+{
+	auto& fifo = v->fifo;
+	if (fifo.batch.empty()) {
+		return;
+	}
+	// Count the writes before queueing them so the render thread never
+	// completes more than what's been queued
+	fifo.num_queued.fetch_add(fifo.batch.size(), std::memory_order_release);
+	fifo.queue.BulkEnqueue(fifo.batch);
+}
+
+// Waits until the render thread has executed every queued write, after which
+// the emulation thread can safely access the card's state and memory
+static void voodoo_sync()
+{
+	if (!v) {
+		return;
+	}
+	auto& fifo = v->fifo;
+
+	if (!fifo.is_enabled) {
+		flush_triangle_bins(v->tworker);
+		return;
+	}
+
+	if (v->tworker.use_tile_binning) {
+		fifo.batch.push_back({command_fifo::FlushBinsMarker, 0, 0});
+	}
+	flush_command_fifo();
+
+	const auto num_queued = fifo.num_queued.load(std::memory_order_relaxed);
+
+	uint64_t num_completed;
+	while ((num_completed = fifo.num_completed.load(std::memory_order_acquire)) !=
+	       num_queued) {
+		fifo.num_completed.wait(num_completed, std::memory_order_acquire);
+	}
+}
+
+static void start_render_thread()
+{
+	auto& fifo = v->fifo;
+	assert(!fifo.is_enabled);
+
+	fifo.queue.Start();
+	fifo.thread = std::thread(render_thread_func);
+	set_thread_name(fifo.thread, "dosbox:voodoo");
+
+	fifo.is_enabled = true;
+}
+
+static void stop_render_thread()
+{
+	auto& fifo = v->fifo;
+	if (!fifo.is_enabled) {
+		return;
+	}
+
+	// The render thread drains the remaining writes before it exits
+	flush_command_fifo();
+	fifo.queue.Stop();
+	if (fifo.thread.joinable()) {
+		fifo.thread.join();
+	}
+
+	fifo.is_enabled = false;
+}
+
+static void voodoo_w(const uint32_t addr, const uint32_t data, const uint32_t mask)
+{
+	const auto offset = (addr >> 2) & offset_mask;
+
+	if (!v->fifo.is_enabled) {
+		execute_write(offset, data, mask);
+		return;
+	}
+
+	const auto is_register = (offset & offset_base) == 0;
+	const auto regnum = is_register ? get_register_number(offset) : 0;
+
+	// Registers that bypass the FIFO on the real card (initialisation,
+	// video timing and the DAC) reconfigure the display on the emulation
+	// thread, so they're written once the render thread has caught up
+	if (is_register && (v->regaccess[regnum] & REGISTER_FIFO) == 0) {
+		voodoo_sync();
+		register_w(offset, data);
+		return;
+	}
+
+	auto& fifo = v->fifo;
+	fifo.batch.push_back({offset, data, mask});
+
+	if (is_register) {
+		switch (regnum) {
+		case swapbufferCMD:
+			// The new front buffer must be complete before it's
+			// shown
+			voodoo_sync();
+			return;
+
+		case triangleCMD:
+		case ftriangleCMD:
+		case sDrawTriCMD:
+		case fastfillCMD:
+			// Start rendering right away
+			flush_command_fifo();
+			return;
+
+		default: break;
+		}
+	}
+
+	if (fifo.batch.size() >= command_fifo::BatchSize) {
+		flush_command_fifo();
+	}
+}
+
+static uint32_t voodoo_r(const uint32_t addr)
+{
+	// Reads return the state after all the queued writes, and polling the
+	// status register for the idle state waits for the rendering to finish
+	voodoo_sync();
+
 	const auto offset = (addr >> 2) & offset_mask;
 
 	if ((offset & offset_base) == 0) {
@@ -7367,6 +8019,9 @@ static void Voodoo_VerticalTimer(uint32_t /*val*/)
 		r.max_y = (int)v->fbi.height;
 #endif
 
+		// The front buffer can still be drawn to by queued writes
+		voodoo_sync();
+
 		// draw all lines at once
 		auto* viewbuf = (uint16_t*)(v->fbi.ram +
 		                            v->fbi.rgboffs[v->fbi.frontbuf]);
@@ -7448,6 +8103,8 @@ static void Voodoo_UpdateScreen()
 	// abort drawing
 	RENDER_EndUpdate(true);
 
+	voodoo_sync();
+
 	if ((!v->clock_enabled || !v->output_on) && v->draw.override_on) {
 		// switching off
 		PIC_RemoveEvents(Voodoo_VerticalTimer);
@@ -7865,9 +8522,15 @@ static void voodoo_shutdown()
 	}
 #endif
 
+	stop_render_thread();
+
 	v->active = false;
 	triangle_worker_shutdown(v->tworker);
 
+	if (voodoo_dump_raster_modes) {
+		log_raster_modes(v);
+	}
+
 	delete v;
 	v = nullptr;
 
@@ -7885,6 +8548,11 @@ static void Voodoo_Startup() {
 	v->draw = {};
 
 	v->tworker.disable_bilinear_filter = (voodoo_bilinear_filtering == false);
+	v->tworker.use_tile_binning        = voodoo_tile_binning;
+
+	if (voodoo_render_thread) {
+		start_render_thread();
+	}
 
 	// Switch the pagehandler now that v has been allocated and is in use
 	voodoo_pagehandler = &voodoo_real_pagehandler;
@@ -7914,6 +8582,9 @@ static void voodoo_init(Section* sec)
 	vtype = (memsize_pref == "4" ? VOODOO_1 : VOODOO_1_DTMU);
 
 	voodoo_bilinear_filtering = section->Get_bool("voodoo_bilinear_filtering");
+	voodoo_dump_raster_modes = section->Get_bool("voodoo_dump_raster_modes");
+	voodoo_render_thread = section->Get_bool("voodoo_render_thread");
+	voodoo_tile_binning  = section->Get_bool("voodoo_tile_binning");
 
 	sec->AddDestroyFunction(&voodoo_destroy, false);
 
@@ -7979,6 +8650,25 @@ static void init_voodoo_dosbox_settings(Section_prop& secprop)
 	        "Use bilinear filtering to emulate the 3dfx Voodoo's texture smoothing effect\n"
 	        "('on' by default). Bilinear filtering can impact frame rates on slower systems;\n"
 	        "try turning it off if you're not getting adequate performance.");
+
+	bool_prop = secprop.Add_bool("voodoo_render_thread", OnlyAtStart, true);
+	bool_prop->Set_help(
+	        "Render 3dfx Voodoo graphics on a separate thread ('on' by default). Like the\n"
+	        "command FIFO of the real card, this lets the emulated CPU carry on while the\n"
+	        "3D rendering is in progress. Turn it off if you experience graphical glitches.");
+
+	bool_prop = secprop.Add_bool("voodoo_tile_binning", OnlyAtStart, false);
+	bool_prop->Set_help(
+	        "Collect 3dfx Voodoo triangles per band of scanlines and rasterise each band on\n"
+	        "one thread, instead of splitting every triangle across all threads ('off' by\n"
+	        "default). This avoids waking up the threads for every triangle, which helps\n"
+	        "games that draw many small triangles.");
+
+	bool_prop = secprop.Add_bool("voodoo_dump_raster_modes", OnlyAtStart, false);
+	bool_prop->Set_help(
+	        "Log the 3dfx Voodoo raster mode combinations used by the running program on\n"
+	        "shutdown, most used first ('off' by default). This is a developer option for\n"
+	        "extending the table of specialised software rasterizers.");
 }
 
 void VOODOO_AddConfigSection(const ConfigPtr& conf)
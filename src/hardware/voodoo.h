@@ -21,6 +21,16 @@
 
 #include "control.h"
 
+#include <cstdint>
+
 void VOODOO_AddConfigSection(const ConfigPtr& conf);
 
+// A write to the register, LFB, or texture memory space of the card, queued
+// in the command FIFO until the render thread executes it
+struct VoodooWrite {
+	uint32_t offset = 0;
+	uint32_t data   = 0;
+	uint32_t mask   = 0;
+};
+
 #endif // DOSBOX_VOODOO_H
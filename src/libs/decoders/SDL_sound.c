@@ -343,7 +343,8 @@ int __Sound_strcasecmp(const char *x, const char *y)
  * Allocate a Sound_Sample, and fill in most of its fields. Those that need
  *  to be filled in later, by a decoder, will be initialized to zero.
  */
-static Sound_Sample *alloc_sample(SDL_RWops *rw, Sound_AudioInfo *desired)
+static Sound_Sample *alloc_sample(SDL_RWops *rw, Sound_AudioInfo *desired,
+                                  const char *filename)
 {
     /*
      * !!! FIXME: We're going to need to pool samples, since the mixer
@@ -359,6 +360,11 @@ static Sound_Sample *alloc_sample(SDL_RWops *rw, Sound_AudioInfo *desired)
             memcpy(&sample->desired, desired, sizeof (Sound_AudioInfo));
         }
         internal->rw = rw;
+        if (filename != NULL) {
+            internal->filename = malloc(strlen(filename) + 1);
+            if (internal->filename != NULL)
+                strcpy(internal->filename, filename);
+        }
         sample->opaque = internal;
         retval = sample;
     } else {
@@ -454,8 +460,12 @@ static int init_sample(const Sound_DecoderFunctions *funcs,
 } /* init_sample */
 
 
-Sound_Sample *Sound_NewSample(SDL_RWops *rw, const char *ext,
-                              Sound_AudioInfo *desired)
+/*
+ * Shared by Sound_NewSample() and Sound_NewSampleFromFile(); the filename is
+ *  optional and lets decoders cache per-file data (such as MP3 seek tables).
+ */
+static Sound_Sample *new_sample(SDL_RWops *rw, const char *ext,
+                                Sound_AudioInfo *desired, const char *filename)
 {
     Sound_Sample *retval;
     decoder_element *decoder;
@@ -464,7 +474,7 @@ Sound_Sample *Sound_NewSample(SDL_RWops *rw, const char *ext,
     BAIL_IF_MACRO(!initialized, ERR_NOT_INITIALIZED, NULL);
     BAIL_IF_MACRO(rw == NULL, ERR_INVALID_ARGUMENT, NULL);
 
-    retval = alloc_sample(rw, desired);
+    retval = alloc_sample(rw, desired, filename);
     if (!retval)
         return(NULL);  /* alloc_sample() sets error message... */
 
@@ -517,11 +527,19 @@ Sound_Sample *Sound_NewSample(SDL_RWops *rw, const char *ext,
     } /* for */
 
     /* nothing could handle the sound data... */
+    free(((Sound_SampleInternal *) retval->opaque)->filename);
     free(retval->opaque);
     free(retval);
     SDL_RWclose(rw);
     __Sound_SetError(ERR_UNSUPPORTED_FORMAT);
     return(NULL);
+} /* new_sample */
+
+
+Sound_Sample *Sound_NewSample(SDL_RWops *rw, const char *ext,
+                              Sound_AudioInfo *desired)
+{
+    return(new_sample(rw, ext, desired, NULL));
 } /* Sound_NewSample */
 
 
@@ -546,7 +564,7 @@ Sound_Sample *Sound_NewSampleFromFile(const char *filename,
     if (ext != NULL)
         ext++;
 
-    return(Sound_NewSample(rw, ext, desired));
+    return(new_sample(rw, ext, desired, filename));
 } /* Sound_NewSampleFromFile */
 
 void Sound_FreeSample(Sound_Sample *sample)
@@ -602,6 +620,7 @@ void Sound_FreeSample(Sound_Sample *sample)
     if (internal->rw != NULL)  /* this condition is a "just in case" thing. */
         SDL_RWclose(internal->rw);
 
+    free(internal->filename);
     free(internal);
     free(sample);
 } /* Sound_FreeSample */
@@ -668,6 +687,8 @@ Sint32 Sound_GetDuration(Sound_Sample *sample)
     Sound_SampleInternal *internal;
     BAIL_IF_MACRO(!initialized, ERR_NOT_INITIALIZED, -1);
     internal = (Sound_SampleInternal *) sample->opaque;
+    if (internal->total_time < 0 && internal->funcs->duration != NULL)
+        internal->total_time = internal->funcs->duration(sample);
     return(internal->total_time);
 } /* Sound_GetDuration */
 
@@ -212,6 +212,15 @@ typedef struct __SOUND_DECODERFUNCTIONS__
          *  continue as if nothing happened.
          */
     int (*seek)(Sound_Sample *sample, Uint32 ms);
+
+        /*
+         * Return the duration of (sample) in milliseconds, or -1 if unknown.
+         *  This is only called while (total_time) is negative, for decoders
+         *  that can't tell the duration cheaply when opening the sample.
+         *  Decoders that set (total_time) in their open() method leave this
+         *  NULL.
+         */
+    Sint32 (*duration)(Sound_Sample *sample);
 } Sound_DecoderFunctions;
 
 typedef void (*MixFunc)(float *dst, void *src, Uint32 frames, float *gains);
@@ -221,6 +230,7 @@ typedef struct __SOUND_SAMPLEINTERNAL__
     Sound_Sample *next;
     Sound_Sample *prev;
     SDL_RWops *rw;
+    char *filename;  /* NULL unless opened with Sound_NewSampleFromFile() */
     const Sound_DecoderFunctions *funcs;
     void *buffer;
     Uint32 buffer_size;
@@ -88,6 +88,8 @@ static void MP3_close(Sound_Sample* const sample)
     mp3_t* p_mp3 = static_cast<mp3_t*>(internal->decoder_private);
     if (p_mp3) {
         assert(p_mp3->p_dr);
+        // Deleting p_mp3 waits for a seek table still being built in the
+        // background, which uses its own file handle
         drmp3_uninit(p_mp3->p_dr);
         delete p_mp3->p_dr;
         p_mp3->p_dr = nullptr;
@@ -100,6 +102,7 @@ static Uint32 MP3_read(Sound_Sample* const sample, void* buffer, Uint32 desired_
 {
     Sound_SampleInternal* const internal = static_cast<Sound_SampleInternal*>(sample->opaque);
     mp3_t* p_mp3 = static_cast<mp3_t*>(internal->decoder_private);
+    bind_pending_seek_points(p_mp3);
 
     // LOG_MSG("read-while: num_frames: %u", num_frames);
     return static_cast<Uint32>(drmp3_read_pcm_frames_s16(p_mp3->p_dr,
@@ -127,10 +130,8 @@ static int32_t MP3_open(Sound_Sample* const sample, const char* const ext)
     // Assign our internal decoder to the mp3 object we've just opened
     internal->decoder_private = p_mp3;
 
-    bool result;
-    // Count the MP3's frames
-    const uint64_t num_frames = populate_seek_points(p_mp3, result);
-    if (!result) {
+    // Set up the MP3's frame count and seek table
+    if (!populate_seek_points(p_mp3, internal->filename)) {
         SNDDBG(("MP3: Unable to count the number of PCM frames.\n"));
         MP3_close(sample);
         return 0; // failure
@@ -142,8 +143,10 @@ static int32_t MP3_open(Sound_Sample* const sample, const char* const ext)
     sample->actual.channels = static_cast<uint8_t>(p_mp3->p_dr->channels);
     sample->actual.rate = p_mp3->p_dr->sampleRate;
     sample->actual.format = AUDIO_S16SYS;  // native byte-order based on architecture
-    // total_time needs milliseconds
-    internal->total_time = static_cast<int32_t>(ceil_udivide(num_frames * 1000u, sample->actual.rate));
+    // A new MP3 is still being scanned in the background, so the duration
+    // is only worked out when it's first asked for (see MP3_duration), and
+    // is then estimated unless the scan has finished
+    internal->total_time = -1;
     return 1; // success
 } /* MP3_open */
 
@@ -158,12 +161,22 @@ static Sint32 MP3_seek(Sound_Sample* const sample, const Uint32 ms)
 {
     Sound_SampleInternal* const internal = static_cast<Sound_SampleInternal*>(sample->opaque);
     mp3_t* p_mp3 = static_cast<mp3_t*>(internal->decoder_private);
+    bind_pending_seek_points(p_mp3);
     const uint64_t sample_rate = sample->actual.rate;
     const drmp3_uint64 pcm_frame = ceil_udivide(sample_rate * ms, 1000u);
     const drmp3_bool32 result = drmp3_seek_to_pcm_frame(p_mp3->p_dr, pcm_frame);
     return (result == DRMP3_TRUE);
 } /* MP3_seek */
 
+static Sint32 MP3_duration(Sound_Sample* const sample)
+{
+    Sound_SampleInternal* const internal = static_cast<Sound_SampleInternal*>(sample->opaque);
+    mp3_t* p_mp3 = static_cast<mp3_t*>(internal->decoder_private);
+    const uint64_t num_frames = get_pcm_frame_count(p_mp3);
+    // total_time needs milliseconds
+    return static_cast<int32_t>(ceil_udivide(num_frames * 1000u, sample->actual.rate));
+} /* MP3_duration */
+
 /* dr_mp3 will play layer 1 and 2 files, too */
 static const char* extensions_mp3[] = { "MP3", "MP2", "MP1", nullptr };
 
@@ -180,6 +193,7 @@ extern const Sound_DecoderFunctions __Sound_DecoderFunctions_MP3 = {
     MP3_close,      /*  close() method */
     MP3_read,       /*   read() method */
     MP3_rewind,     /* rewind() method */
-    MP3_seek        /*   seek() method */
+    MP3_seek,       /*   seek() method */
+    MP3_duration    /* duration() method */
 }; }
 /* end of SDL_sound_mp3.c ... */
@@ -21,6 +21,17 @@
 
 #include "mp3_seek_table.h"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <system_error>
+
 // Local headers
 #include "math_utils.h"
 
@@ -82,25 +93,445 @@ static uint64_t generate_new_seek_points(drmp3* const p_dr,
     return pcm_frame_count;
 }
 
-uint64_t populate_seek_points(mp3_t* p_mp3, bool &result)
+// Seek tables are cached on disk, one file per MP3, so later mounts don't
+// need to scan the whole stream again. A cache file starts with the following
+// header (in native byte order), followed by the seek points' fields:
+//   - magic number and format version
+//   - frames per seek point used when building the table
+//   - the MP3's path, size, and modification time, which must all match
+//   - the MP3's PCM frame count and the number of seek points
+constexpr uint32_t SEEK_TABLE_MAGIC   = 0x4B534244; // "DBSK"
+constexpr uint32_t SEEK_TABLE_VERSION = 1;
+
+// The least recently used tables are removed once the cache grows beyond
+// this size. An hour-long MP3 needs a table of roughly 400 KB.
+constexpr uintmax_t MAX_SEEK_TABLE_CACHE_BYTES = 64 * 1024 * 1024;
+
+static std_fs::path seek_table_cache_dir = {};
+
+void set_mp3_seek_table_cache_dir(const std_fs::path& dir)
 {
-    // assume failure until proven otherwise
-    result = false;
+    seek_table_cache_dir = dir;
+}
 
-    const auto pcm_frame_count = generate_new_seek_points(p_mp3->p_dr,
-                                                          p_mp3->seek_points_vector);
-    if (pcm_frame_count == 0) {
+struct mp3_file_info {
+    std::string path = {};
+    uint64_t size    = 0;
+    int64_t mtime    = 0;
+};
+
+static bool get_file_info(const char* filename, mp3_file_info& info)
+{
+    std::error_code ec = {};
+    const auto path = std_fs::absolute(filename, ec);
+    if (ec) {
+        return false;
+    }
+    info.path = path.string();
+    info.size = static_cast<uint64_t>(std_fs::file_size(path, ec));
+    if (ec) {
+        return false;
+    }
+    const auto mtime = std_fs::last_write_time(path, ec);
+    if (ec) {
+        return false;
+    }
+    info.mtime = static_cast<int64_t>(mtime.time_since_epoch().count());
+    return true;
+}
+
+// The cache file is named after a hash of the MP3's absolute path (the path
+// itself is stored inside the file to rule out collisions)
+static std_fs::path get_cache_file_path(const mp3_file_info& info)
+{
+    // 64-bit FNV-1a, stable across platforms and runs
+    uint64_t hash = 0xcbf29ce484222325;
+    for (const auto c : info.path) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001b3;
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.seek", static_cast<unsigned long long>(hash));
+    return seek_table_cache_dir / name;
+}
+
+// Each writer gets its own temporary file, so two instances (or two mounts of
+// the same MP3) caching the same table never write to the same file
+static std_fs::path get_unique_temp_path(const std_fs::path& file)
+{
+    static std::atomic<uint32_t> num_temp_files = 0;
+    std::random_device rd;
+
+    char suffix[48];
+    snprintf(suffix, sizeof(suffix), ".%08x%08x-%u.tmp",
+             static_cast<unsigned>(rd()), static_cast<unsigned>(rd()),
+             static_cast<unsigned>(num_temp_files++));
+
+    auto temp_file = file;
+    temp_file += suffix;
+    return temp_file;
+}
+
+template <typename T>
+static void write_value(std::ofstream& out, const T value)
+{
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+static bool read_value(std::ifstream& in, T& value)
+{
+    in.read(reinterpret_cast<char*>(&value), sizeof(value));
+    return in.good();
+}
+
+static bool load_cached_seek_points(const mp3_file_info& info,
+                                    uint64_t& pcm_frame_count,
+                                    std::vector<drmp3_seek_point>& seek_points_vector)
+{
+    const auto cache_file = get_cache_file_path(info);
+    std::ifstream in(cache_file, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+
+    uint32_t magic = 0, version = 0, frames_per_point = 0, path_length = 0;
+    if (!read_value(in, magic) || magic != SEEK_TABLE_MAGIC ||
+        !read_value(in, version) || version != SEEK_TABLE_VERSION ||
+        !read_value(in, frames_per_point) || frames_per_point != FRAMES_PER_SEEK_POINT ||
+        !read_value(in, path_length) || path_length != info.path.size()) {
+        return false;
+    }
+
+    std::string path(path_length, '\0');
+    in.read(path.data(), path_length);
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    if (!in.good() || path != info.path ||
+        !read_value(in, size) || size != info.size ||
+        !read_value(in, mtime) || mtime != info.mtime) {
+        return false;
+    }
+
+    uint32_t num_seek_points = 0;
+    if (!read_value(in, pcm_frame_count) || pcm_frame_count == 0 ||
+        !read_value(in, num_seek_points) || num_seek_points == 0) {
+        return false;
+    }
+
+    seek_points_vector.resize(num_seek_points);
+    for (auto& point : seek_points_vector) {
+        if (!read_value(in, point.seekPosInBytes) ||
+            !read_value(in, point.pcmFrameIndex) ||
+            !read_value(in, point.mp3FramesToDiscard) ||
+            !read_value(in, point.pcmFramesToDiscard)) {
+            seek_points_vector.clear();
+            return false;
+        }
+    }
+
+    // Mark the table as recently used, so pruning the cache keeps it
+    std::error_code ec = {};
+    std_fs::last_write_time(cache_file, std_fs::file_time_type::clock::now(), ec);
+    return true;
+}
+
+// Removes the least recently used tables until the cache fits its size limit
+static void prune_seek_table_cache()
+{
+    struct cache_entry {
+        std_fs::path path             = {};
+        uintmax_t size                = 0;
+        std_fs::file_time_type mtime  = {};
+    };
+    std::vector<cache_entry> entries = {};
+    uintmax_t total_bytes = 0;
+
+    std::error_code ec = {};
+    for (const auto& dir_entry : std_fs::directory_iterator(seek_table_cache_dir, ec)) {
+        if (dir_entry.path().extension() != ".seek") {
+            continue;
+        }
+        cache_entry entry = {dir_entry.path(), dir_entry.file_size(ec), {}};
+        if (ec) {
+            continue;
+        }
+        entry.mtime = dir_entry.last_write_time(ec);
+        if (ec) {
+            continue;
+        }
+        total_bytes += entry.size;
+        entries.push_back(std::move(entry));
+    }
+    if (total_bytes <= MAX_SEEK_TABLE_CACHE_BYTES) {
+        return;
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) {
+        return a.mtime < b.mtime;
+    });
+    for (const auto& entry : entries) {
+        if (total_bytes <= MAX_SEEK_TABLE_CACHE_BYTES) {
+            break;
+        }
+        if (std_fs::remove(entry.path, ec)) {
+            total_bytes -= entry.size;
+        }
+    }
+}
+
+static void save_cached_seek_points(const mp3_file_info& info,
+                                    const uint64_t pcm_frame_count,
+                                    const std::vector<drmp3_seek_point>& seek_points_vector)
+{
+    std::error_code ec = {};
+    std_fs::create_directories(seek_table_cache_dir, ec);
+
+    // Write to a temporary file first and then rename it into place, so
+    // other instances never see a partially written table
+    const auto cache_file = get_cache_file_path(info);
+    const auto temp_file  = get_unique_temp_path(cache_file);
+    {
+        std::ofstream out(temp_file, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return;
+        }
+        write_value(out, SEEK_TABLE_MAGIC);
+        write_value(out, SEEK_TABLE_VERSION);
+        write_value(out, FRAMES_PER_SEEK_POINT);
+        write_value(out, static_cast<uint32_t>(info.path.size()));
+        out.write(info.path.data(), static_cast<std::streamsize>(info.path.size()));
+        write_value(out, info.size);
+        write_value(out, info.mtime);
+        write_value(out, pcm_frame_count);
+        write_value(out, static_cast<uint32_t>(seek_points_vector.size()));
+        for (const auto& point : seek_points_vector) {
+            write_value(out, point.seekPosInBytes);
+            write_value(out, point.pcmFrameIndex);
+            write_value(out, point.mp3FramesToDiscard);
+            write_value(out, point.pcmFramesToDiscard);
+        }
+        if (!out) {
+            out.close();
+            std_fs::remove(temp_file, ec);
+            return;
+        }
+    }
+    std_fs::rename(temp_file, cache_file, ec);
+    if (ec) {
+        std_fs::remove(temp_file, ec);
+        return;
+    }
+    prune_seek_table_cache();
+}
+
+// Works out the stream's PCM frame count from its first frame without
+// scanning the rest of the file: either from the frame count in a Xing,
+// Info, or VBRI header, or from the file's size and the first frame's
+// bitrate. Returns 0 if the stream doesn't start with a usable frame.
+static uint64_t estimate_pcm_frame_count(const mp3_file_info& info)
+{
+    std::ifstream in(info.path, std::ios::binary);
+    if (!in) {
         return 0;
     }
 
-    // We bind our seek points to the dr_mp3 object which will be used for fast seeking.
-    if(drmp3_bind_seek_table(p_mp3->p_dr,
-                             static_cast<uint32_t>(p_mp3->seek_points_vector.size()),
-                             p_mp3->seek_points_vector.data())
-                             != DRMP3_TRUE) {
+    // Skip the ID3v2 tag, which can be large when it holds cover art
+    uint64_t audio_start = 0;
+    std::array<drmp3_uint8, 10> id3 = {};
+    in.read(reinterpret_cast<char*>(id3.data()), id3.size());
+    if (in.gcount() == static_cast<std::streamsize>(id3.size()) &&
+        std::memcmp(id3.data(), "ID3", 3) == 0) {
+        const uint64_t tag_size = (id3[6] & 0x7f) << 21 | (id3[7] & 0x7f) << 14 |
+                                  (id3[8] & 0x7f) << 7 | (id3[9] & 0x7f);
+        const bool has_footer = (id3[5] & 0x10) != 0;
+        audio_start = id3.size() + tag_size + (has_footer ? 10 : 0);
+    }
+    if (audio_start >= info.size) {
         return 0;
     }
 
-    result = true;
-    return pcm_frame_count;
+    // Enough for the first frame and the following ones dr_mp3 checks
+    std::vector<drmp3_uint8> data(16 * 1024);
+    in.clear();
+    in.seekg(static_cast<std::streamoff>(audio_start));
+    in.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    data.resize(static_cast<size_t>(in.gcount()));
+
+    // Only the frame's header and side info are parsed without an output
+    // buffer. The decoder state is too large for the stack.
+    auto p_dec = std::make_unique<drmp3dec>();
+    drmp3dec_init(p_dec.get());
+    drmp3dec_frame_info frame_info = {};
+    drmp3dec_decode_frame(p_dec.get(), data.data(), static_cast<int>(data.size()),
+                          nullptr, &frame_info);
+    if (frame_info.hz <= 0 || frame_info.layer <= 0) {
+        return 0;
+    }
+
+    // The decoder keeps a copy of the frame's header, which we use to find
+    // where the frame starts
+    const auto header = p_dec->header;
+    const auto frame_start = std::search(data.begin(), data.end(), header, header + 4);
+    if (frame_start == data.end()) {
+        return 0;
+    }
+    const auto frame_offset = static_cast<size_t>(frame_start - data.begin());
+
+    const bool is_mpeg1 = frame_info.hz >= 32000;
+    const bool is_mono  = frame_info.channels == 1;
+    const uint64_t pcm_frames_per_mp3_frame = (frame_info.layer == 1) ? 384
+                                            : (frame_info.layer == 2 || is_mpeg1) ? 1152
+                                                                                  : 576;
+
+    const auto read_be32 = [&](const size_t offset) -> uint64_t {
+        if (offset + 4 > data.size()) {
+            return 0;
+        }
+        return static_cast<uint64_t>(data[offset]) << 24 | data[offset + 1] << 16 |
+               data[offset + 2] << 8 | data[offset + 3];
+    };
+    const auto has_tag = [&](const size_t offset, const char* tag) {
+        return offset + 4 <= data.size() && std::memcmp(&data[offset], tag, 4) == 0;
+    };
+
+    // The Xing or Info header follows the side info and holds the number of
+    // MP3 frames if its first flag is set
+    const size_t side_info_bytes = is_mpeg1 ? (is_mono ? 17 : 32) : (is_mono ? 9 : 17);
+    const size_t xing_offset = frame_offset + 4 + side_info_bytes;
+    if (has_tag(xing_offset, "Xing") || has_tag(xing_offset, "Info")) {
+        const auto flags = read_be32(xing_offset + 4);
+        const auto num_mp3_frames = (flags & 1) ? read_be32(xing_offset + 8) : 0;
+        if (num_mp3_frames > 0) {
+            return num_mp3_frames * pcm_frames_per_mp3_frame;
+        }
+    }
+
+    // The VBRI header always sits 32 bytes past the frame header
+    const size_t vbri_offset = frame_offset + 4 + 32;
+    if (has_tag(vbri_offset, "VBRI")) {
+        const auto num_mp3_frames = read_be32(vbri_offset + 14);
+        if (num_mp3_frames > 0) {
+            return num_mp3_frames * pcm_frames_per_mp3_frame;
+        }
+    }
+
+    // Otherwise treat the stream as constant bitrate, leaving out the ID3v1
+    // tag if there is one
+    if (frame_info.bitrate_kbps <= 0) {
+        return 0;
+    }
+    uint64_t audio_bytes = info.size - audio_start - frame_offset;
+    constexpr uint64_t id3v1_size = 128;
+    if (audio_bytes > id3v1_size) {
+        std::array<char, 3> id3v1 = {};
+        in.clear();
+        in.seekg(-static_cast<std::streamoff>(id3v1_size), std::ios::end);
+        in.read(id3v1.data(), id3v1.size());
+        if (in.good() && std::memcmp(id3v1.data(), "TAG", 3) == 0) {
+            audio_bytes -= id3v1_size;
+        }
+    }
+    const uint64_t bytes_per_second = static_cast<uint64_t>(frame_info.bitrate_kbps) * 1000 / 8;
+    return audio_bytes * static_cast<uint64_t>(frame_info.hz) / bytes_per_second;
+}
+
+static bool bind_seek_points(mp3_t* p_mp3)
+{
+    // We bind our seek points to the dr_mp3 object which will be used for fast seeking.
+    return drmp3_bind_seek_table(p_mp3->p_dr,
+                                 static_cast<uint32_t>(p_mp3->seek_points_vector.size()),
+                                 p_mp3->seek_points_vector.data())
+                                 == DRMP3_TRUE;
+}
+
+// Counts the frames and builds the seek table using a separate dr_mp3
+// instance on its own file handle, so it can run while the sample is being
+// decoded
+static mp3_scan_t scan_in_background(const mp3_file_info info)
+{
+    mp3_scan_t scan = {};
+
+    // The decoder state is too large for the stack
+    auto p_dr = std::make_unique<drmp3>();
+    if (drmp3_init_file(p_dr.get(), info.path.c_str(), nullptr) != DRMP3_TRUE) {
+        return scan;
+    }
+    scan.pcm_frame_count = generate_new_seek_points(p_dr.get(), scan.seek_points);
+    drmp3_uninit(p_dr.get());
+
+    // Don't cache the result if the file changed underneath us
+    mp3_file_info current_info = {};
+    if (scan.pcm_frame_count > 0 && !seek_table_cache_dir.empty() &&
+        get_file_info(info.path.c_str(), current_info) &&
+        current_info.size == info.size && current_info.mtime == info.mtime) {
+        save_cached_seek_points(info, scan.pcm_frame_count, scan.seek_points);
+    }
+    return scan;
+}
+
+static void finish_pending_scan(mp3_t* p_mp3)
+{
+    if (!p_mp3->pending_scan.valid()) {
+        return;
+    }
+    auto scan = p_mp3->pending_scan.get();
+
+    // The background scan couldn't re-open the file, so scan our own stream
+    if (scan.pcm_frame_count == 0) {
+        scan.seek_points.clear();
+        scan.pcm_frame_count = generate_new_seek_points(p_mp3->p_dr, scan.seek_points);
+    }
+
+    p_mp3->pcm_frame_count = scan.pcm_frame_count;
+    p_mp3->seek_points_vector = std::move(scan.seek_points);
+    if (!p_mp3->seek_points_vector.empty()) {
+        bind_seek_points(p_mp3);
+    }
+}
+
+uint64_t get_pcm_frame_count(mp3_t* p_mp3)
+{
+    // Only wait for the background scan if the frame count couldn't be
+    // estimated, otherwise pick up its result only once it's finished
+    const bool is_scan_finished = p_mp3->pending_scan.valid() &&
+        p_mp3->pending_scan.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    if (is_scan_finished || p_mp3->pcm_frame_count == 0) {
+        finish_pending_scan(p_mp3);
+    }
+    return p_mp3->pcm_frame_count;
+}
+
+void bind_pending_seek_points(mp3_t* p_mp3)
+{
+    finish_pending_scan(p_mp3);
+}
+
+bool populate_seek_points(mp3_t* p_mp3, const char* filename)
+{
+    mp3_file_info info = {};
+    const bool has_file_info = filename && get_file_info(filename, info);
+
+    // Fast path: a previously built seek table for the same file
+    if (has_file_info && !seek_table_cache_dir.empty() &&
+        load_cached_seek_points(info, p_mp3->pcm_frame_count, p_mp3->seek_points_vector)) {
+        if (bind_seek_points(p_mp3)) {
+            return true;
+        }
+        p_mp3->seek_points_vector.clear();
+    }
+
+    // Without a file to re-open, scan the stream here as we always have
+    if (!has_file_info) {
+        p_mp3->pcm_frame_count = generate_new_seek_points(p_mp3->p_dr,
+                                                          p_mp3->seek_points_vector);
+        return p_mp3->pcm_frame_count > 0 && bind_seek_points(p_mp3);
+    }
+
+    // Otherwise leave the whole scan, including counting the frames, to a
+    // background thread that's only waited for on the first seek or read.
+    // Until then, the duration comes from an estimate.
+    p_mp3->pcm_frame_count = estimate_pcm_frame_count(info);
+    p_mp3->pending_scan = std::async(std::launch::async, scan_in_background, info);
+    return true;
 }
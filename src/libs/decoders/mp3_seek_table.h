@@ -33,23 +33,53 @@
 
 #include "config.h"
 
+#include <future>    // provides: future
 #include <vector>    // provides: vector
 #include <SDL.h>     // provides: SDL_RWops
 
+#include "std_filesystem.h"
+
 // Ensure we only get the API
 #ifdef DR_MP3_IMPLEMENTATION
 #  undef DR_MP3_IMPLEMENTATION
 #endif
 #include "dr_mp3.h" // provides: drmp3
 
+// The frame count and seek table found by scanning an MP3 stream
+struct mp3_scan_t {
+    uint64_t pcm_frame_count = 0;
+    std::vector<drmp3_seek_point> seek_points = {};
+};
+
 // Our private-decoder structure where we hold:
 //   - a pointer to the working dr_mp3 instance
-//   - a vector of seek_points
+//   - a vector of seek_points and the stream's PCM frame count
+//   - the scan still running in the background, if any
 struct mp3_t {
     drmp3* p_dr = nullptr;    // the actual drmp3 instance we open, read, and seek within
     std::vector<drmp3_seek_point> seek_points_vector = {};
+    uint64_t pcm_frame_count = 0;
+    std::future<mp3_scan_t> pending_scan = {};
 };
 
-uint64_t populate_seek_points(mp3_t* p_mp3, bool &result);
+// Sets up the stream's PCM frame count and seek table, returning false if
+// the stream can't be scanned. When the MP3's filename is known, both are
+// loaded from the on-disk cache, or scanned on a background thread and
+// cached for the next time. The frame count is estimated from the stream's
+// first frame while the scan is running.
+bool populate_seek_points(mp3_t* p_mp3, const char* filename);
+
+// Returns the stream's PCM frame count, which is the estimate while the
+// background scan is still running. Only waits for the scan if no estimate
+// could be made. Returns 0 if the stream couldn't be scanned.
+uint64_t get_pcm_frame_count(mp3_t* p_mp3);
+
+// Binds the seek points being built in the background, waiting for them to
+// finish if needed. Must be called before seeking or reading.
+void bind_pending_seek_points(mp3_t* p_mp3);
+
+// Sets the directory where seek tables are cached between runs. The cache is
+// disabled while no directory has been set.
+void set_mp3_seek_table_cache_dir(const std_fs::path& dir);
 
 #endif
@@ -410,6 +410,7 @@ extern const Sound_DecoderFunctions __Sound_DecoderFunctions_OPUS =
     opus_close,  /*  close() method */
     opus_read,   /*   read() method */
     opus_rewind, /* rewind() method */
-    opus_seek    /*   seek() method */
+    opus_seek,   /*   seek() method */
+    nullptr      /* duration() method */
 }; }
 /* end of opus.cpp ... */
@@ -21,7 +21,9 @@
 #define _USE_MATH_DEFINES 1
 #endif
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 
 //forward declaration
 template<typename T, int maxLength> class Allpass;
@@ -31,6 +33,34 @@ template<typename T, int maxLength> class StaticDelayLineFourTap;
 template<typename T, int maxLength> class StaticDelayLineEightTap;
 template<typename T, int OverSampleCount> class StateVariable;
 
+// Adds 'gain' times the next 'n' outputs of a delay line tap to 'dest', as
+// if the tap were read after each of the line's next 'n' samples. This only
+// holds while the tap doesn't reach the samples written in the meantime; see
+// getMaxReadAhead().
+template<typename T>
+void accumulateTap(const T *buffer, int length, int tapPosition, T gain, T *dest, int n)
+{
+    int pos = tapPosition + 1;
+    if (pos >= length)
+        pos = 0;
+
+    const int firstRun = std::min(n, length - pos);
+    const T *src = buffer + pos;
+    for (int i = 0; i < firstRun; ++i)
+        dest[i] += gain * src[i];
+
+    for (int i = firstRun; i < n; ++i)
+        dest[i] += gain * buffer[i - firstRun];
+}
+
+// The number of upcoming tap outputs that only depend on samples already in
+// the delay line
+inline int getMaxReadAhead(int length, int writePosition, int tapPosition)
+{
+    const int distance = (tapPosition - writePosition + length) % length;
+    return length - distance - 1;
+}
+
 template<typename T>
 class MVerb
 {
@@ -70,6 +100,129 @@ private:
     int ControlRate = 0;
     int ControlRateCounter = 0;
 
+    // Scratch buffers for processBlock()
+    static constexpr int MaxSubBlockFrames = 256;
+    T EarlyReflectionsL[MaxSubBlockFrames] = {};
+    T EarlyReflectionsR[MaxSubBlockFrames] = {};
+    T AccumulatorL[MaxSubBlockFrames] = {};
+    T AccumulatorR[MaxSubBlockFrames] = {};
+
+    struct Tap {
+        int index;
+        T gain;
+    };
+
+    static constexpr Tap EarlyReflectionTaps[] = {
+            {2, T(0.6)}, {3, T(0.4)}, {4, T(0.3)}, {5, T(0.3)}, {6, T(0.1)}, {7, T(0.1)}};
+
+    template<typename Line>
+    int getMaxReadAhead(const Line &line, int index) const
+    {
+        return ::getMaxReadAhead(line.GetLength(), line.GetTapPosition(0), line.GetTapPosition(index));
+    }
+
+    template<typename Line>
+    void accumulateTap(const Line &line, int index, T gain, T *dest, int n) const
+    {
+        ::accumulateTap(line.GetBuffer(), line.GetLength(), line.GetTapPosition(index), gain, dest, n);
+    }
+
+    // How many frames the output taps can be read ahead of the serial
+    // part of the network
+    int getSubBlockFrames() const
+    {
+        int frames = MaxSubBlockFrames;
+        for (const auto &line : earlyReflectionsDelayLine)
+            for (const auto &tap : EarlyReflectionTaps)
+                frames = std::min(frames, getMaxReadAhead(line, tap.index));
+        for (const auto &line : staticDelayLine)
+            for (int index = 1; index <= 3; ++index)
+                frames = std::min(frames, getMaxReadAhead(line, index));
+        for (int index = 1; index <= 2; ++index) {
+            frames = std::min(frames, getMaxReadAhead(allpassFourTap[1], index));
+            frames = std::min(frames, getMaxReadAhead(allpassFourTap[3], index));
+        }
+        return std::max(frames, 1);
+    }
+
+    // The parts of the network that only read the delay lines: the early
+    // reflection taps and the output taps of the tank. These run over
+    // whole sub-blocks as multiply-adds on contiguous runs, which the
+    // compiler can vectorise.
+    void accumulateOutputTaps(int n)
+    {
+        std::fill_n(EarlyReflectionsL, n, T(0));
+        std::fill_n(EarlyReflectionsR, n, T(0));
+        std::fill_n(AccumulatorL, n, T(0));
+        std::fill_n(AccumulatorR, n, T(0));
+
+        for (const auto &tap : EarlyReflectionTaps) {
+            accumulateTap(earlyReflectionsDelayLine[0], tap.index, tap.gain, EarlyReflectionsL, n);
+            accumulateTap(earlyReflectionsDelayLine[1], tap.index, tap.gain, EarlyReflectionsR, n);
+        }
+
+        const T g = T(0.6);
+        accumulateTap(staticDelayLine[2], 1, g, AccumulatorL, n);
+        accumulateTap(staticDelayLine[2], 2, g, AccumulatorL, n);
+        accumulateTap(allpassFourTap[3], 1, -g, AccumulatorL, n);
+        accumulateTap(staticDelayLine[3], 1, g, AccumulatorL, n);
+        accumulateTap(staticDelayLine[0], 1, -g, AccumulatorL, n);
+        accumulateTap(allpassFourTap[1], 1, -g, AccumulatorL, n);
+        accumulateTap(staticDelayLine[1], 1, -g, AccumulatorL, n);
+
+        accumulateTap(staticDelayLine[0], 2, g, AccumulatorR, n);
+        accumulateTap(staticDelayLine[0], 3, g, AccumulatorR, n);
+        accumulateTap(allpassFourTap[1], 2, -g, AccumulatorR, n);
+        accumulateTap(staticDelayLine[1], 2, g, AccumulatorR, n);
+        accumulateTap(staticDelayLine[2], 3, -g, AccumulatorR, n);
+        accumulateTap(allpassFourTap[3], 2, -g, AccumulatorR, n);
+        accumulateTap(staticDelayLine[3], 2, -g, AccumulatorR, n);
+    }
+
+    // The recursive part of the network that has to run one frame at a
+    // time: input filters, pre-delay, diffusers, and the tank
+    void processTank(const T *inputL, const T *inputR, int n)
+    {
+        for (int i = 0; i < n; ++i) {
+            if (ControlRateCounter >= ControlRate){
+                ControlRateCounter = 0;
+                bandwidthFilter[0].Frequency(BandwidthSmooth);
+                bandwidthFilter[1].Frequency(BandwidthSmooth);
+                damping[0].Frequency(DampingSmooth);
+                damping[1].Frequency(DampingSmooth);
+            }
+            ++ControlRateCounter;
+            const T bandwidthLeft = bandwidthFilter[0](inputL[i]);
+            const T bandwidthRight = bandwidthFilter[1](inputR[i]);
+            EarlyReflectionsL[i] += earlyReflectionsDelayLine[0].Push(bandwidthLeft * T(0.5) + bandwidthRight * T(0.3))
+                                  + (bandwidthLeft * T(0.4) + bandwidthRight * T(0.2)) * T(0.5);
+            EarlyReflectionsR[i] += earlyReflectionsDelayLine[1].Push(bandwidthLeft * T(0.3) + bandwidthRight * T(0.5))
+                                  + (bandwidthLeft * T(0.2) + bandwidthRight * T(0.4)) * T(0.5);
+            T smearedInput = predelay(( bandwidthRight + bandwidthLeft ) * 0.5f);
+            for(int j=0;j<4;j++)
+                smearedInput = allpass[j] ( smearedInput );
+            T leftTank = allpassFourTap[0].Push(smearedInput + PreviousRightTank) ;
+            leftTank = staticDelayLine[0].Push(leftTank);
+            leftTank = damping[0](leftTank);
+            leftTank = allpassFourTap[1].Push(leftTank);
+            leftTank = staticDelayLine[1].Push(leftTank);
+            T rightTank = allpassFourTap[2].Push(smearedInput + PreviousLeftTank) ;
+            rightTank = staticDelayLine[2].Push(rightTank);
+            rightTank = damping[1] (rightTank);
+            rightTank = allpassFourTap[3].Push(rightTank);
+            rightTank = staticDelayLine[3].Push(rightTank);
+            PreviousLeftTank = leftTank * DecaySmooth;
+            PreviousRightTank = rightTank * DecaySmooth;
+        }
+
+        for (auto &line : earlyReflectionsDelayLine)
+            line.AdvanceTaps(n);
+        for (auto &line : allpassFourTap)
+            line.AdvanceTaps(n);
+        for (auto &line : staticDelayLine)
+            line.AdvanceTaps(n);
+    }
+
 public:
     enum
 		{
@@ -209,6 +362,56 @@ public:
         }
     }
 
+    // Processes a block of non-interleaved frames, producing the same output
+    // as calling process() one frame at a time. The outputs may point to
+    // the inputs to process in place.
+    //
+    // Parameter changes take effect at the start of the block, as they do
+    // when processing single frames; this doesn't smooth them across the
+    // block like process() does.
+    void processBlock(const T *inputL, const T *inputR, T *outputL, T *outputR, int sampleFrames){
+        MixSmooth = Mix;
+        EarlyLateSmooth = EarlyMix;
+        BandwidthSmooth = static_cast<T>((BandwidthFreq * MaxFreq) + 100.0f);
+        DampingSmooth = static_cast<T>((DampingFreq * MaxFreq) + 100.0f);
+        PredelaySmooth = static_cast<T>(PreDelayTime * 200 * (SampleRate / 1000));
+        SizeSmooth = Size;
+        DecaySmooth = static_cast<T>((0.7995f * Decay) + 0.005);
+        DensitySmooth = static_cast<T>((0.7995f * Density1) + 0.005);
+
+        predelay.SetLength(static_cast<int>(PredelaySmooth));
+        Density2 = static_cast<T>(DecaySmooth + 0.15);
+        if (Density2 > 0.5)
+            Density2 = 0.5;
+        if (Density2 < 0.25)
+            Density2 = 0.25;
+        allpassFourTap[1].SetFeedback(Density2);
+        allpassFourTap[3].SetFeedback(Density2);
+        allpassFourTap[0].SetFeedback(Density1);
+        allpassFourTap[2].SetFeedback(Density1);
+
+        // The tap positions move in lockstep with the write positions, so
+        // the read-ahead limit stays the same for the whole block
+        const int subBlockFrames = getSubBlockFrames();
+
+        for (int offset = 0; offset < sampleFrames; offset += subBlockFrames) {
+            const int n = std::min(subBlockFrames, sampleFrames - offset);
+
+            // Read the taps before the tank overwrites their samples
+            accumulateOutputTaps(n);
+            processTank(inputL + offset, inputR + offset, n);
+
+            for (int i = 0; i < n; ++i) {
+                const T left = inputL[offset + i];
+                const T right = inputR[offset + i];
+                const T accumulatorL = (AccumulatorL[i] * EarlyMix) + ((1 - EarlyMix) * EarlyReflectionsL[i]);
+                const T accumulatorR = (AccumulatorR[i] * EarlyMix) + ((1 - EarlyMix) * EarlyReflectionsR[i]);
+                outputL[offset + i] = ( left + MixSmooth * ( accumulatorL - left ) ) * Gain;
+                outputR[offset + i] = ( right + MixSmooth * ( accumulatorR - right ) ) * Gain;
+            }
+        }
+    }
+
     void reset(){
         ControlRateCounter = 0;
         bandwidthFilter[0].SetSampleRate(SampleRate);
@@ -525,6 +728,43 @@ public:
     {
         return Length;
     }
+
+    const T *GetBuffer() const
+    {
+        return buffer;
+    }
+
+    // Position 0 is where the next sample is written
+    int GetTapPosition(int Index) const
+    {
+        switch (Index)
+        {
+            case 1: return index2;
+            case 2: return index3;
+            case 3: return index4;
+            default: return index1;
+        }
+    }
+
+    // Like operator(), but only advances the write position. The other
+    // taps must be caught up with AdvanceTaps() before they're read again.
+    T Push(T input)
+    {
+        T bufout = buffer[index1];
+        T temp = input * -Feedback;
+        T output = bufout + temp;
+        buffer[index1] = input + ((bufout+temp)*Feedback);
+        if(++index1>=Length)
+            index1 = 0;
+        return output;
+    }
+
+    void AdvanceTaps(int n)
+    {
+        index2 = (index2 + n) % Length;
+        index3 = (index3 + n) % Length;
+        index4 = (index4 + n) % Length;
+    }
 };
 
 template<typename T, int maxLength>
@@ -665,6 +905,41 @@ public:
     {
         return Length;
     }
+
+    const T *GetBuffer() const
+    {
+        return buffer;
+    }
+
+    // Position 0 is where the next sample is written
+    int GetTapPosition(int Index) const
+    {
+        switch (Index)
+        {
+            case 1: return index2;
+            case 2: return index3;
+            case 3: return index4;
+            default: return index1;
+        }
+    }
+
+    // Like operator(), but only advances the write position. The other
+    // taps must be caught up with AdvanceTaps() before they're read again.
+    T Push(T input)
+    {
+        T output = buffer[index1];
+        buffer[index1++] = input;
+        if(index1 >= Length)
+            index1 = 0;
+        return output;
+    }
+
+    void AdvanceTaps(int n)
+    {
+        index2 = (index2 + n) % Length;
+        index3 = (index3 + n) % Length;
+        index4 = (index4 + n) % Length;
+    }
 };
 
 template<typename T, int maxLength>
@@ -785,6 +1060,49 @@ public:
     {
         return Length;
     }
+
+    const T *GetBuffer() const
+    {
+        return buffer;
+    }
+
+    // Position 0 is where the next sample is written
+    int GetTapPosition(int Index) const
+    {
+        switch (Index)
+        {
+            case 1: return index2;
+            case 2: return index3;
+            case 3: return index4;
+            case 4: return index5;
+            case 5: return index6;
+            case 6: return index7;
+            case 7: return index8;
+            default: return index1;
+        }
+    }
+
+    // Like operator(), but only advances the write position. The other
+    // taps must be caught up with AdvanceTaps() before they're read again.
+    T Push(T input)
+    {
+        T output = buffer[index1];
+        buffer[index1++] = input;
+        if(index1 >= Length)
+            index1 = 0;
+        return output;
+    }
+
+    void AdvanceTaps(int n)
+    {
+        index2 = (index2 + n) % Length;
+        index3 = (index3 + n) % Length;
+        index4 = (index4 + n) % Length;
+        index5 = (index5 + n) % Length;
+        index6 = (index6 + n) % Length;
+        index7 = (index7 + n) % Length;
+        index8 = (index8 + n) % Length;
+    }
 };
 
 template<typename T, int OverSampleCount>
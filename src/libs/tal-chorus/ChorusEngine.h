@@ -98,6 +98,37 @@ public:
         *sampleL= *sampleL+resultL*1.4f;
         *sampleR= *sampleR+resultR*1.4f;
     }
+
+    // Processes a block of non-interleaved frames in place. The left and
+    // right chorus lines don't interact, so each channel is run through its
+    // own lines in a single pass; the output is the same as calling
+    // process() for every frame.
+    void process(float *samplesL, float *samplesR, int sampleFrames)
+    {
+        processChannel(samplesL, sampleFrames, *chorus1L, *chorus2L, dcBlock1L, dcBlock2L);
+        processChannel(samplesR, sampleFrames, *chorus1R, *chorus2R, dcBlock1R, dcBlock2R);
+    }
+
+private:
+    void processChannel(float *samples, int sampleFrames, Chorus &chorus1,
+                        Chorus &chorus2, DCBlock &dcBlock1, DCBlock &dcBlock2)
+    {
+        for (int i = 0; i < sampleFrames; ++i)
+        {
+            float result= 0.0f;
+            if (isChorus1Enabled)
+            {
+                result+= chorus1.process(&samples[i]);
+                dcBlock1.tick(&result, 0.01f);
+            }
+            if (isChorus2Enabled)
+            {
+                result+= chorus2.process(&samples[i]);
+                dcBlock2.tick(&result, 0.01f);
+            }
+            samples[i]= samples[i]+result*1.4f;
+        }
+    }
 };
 
 #endif
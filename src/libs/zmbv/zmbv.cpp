@@ -18,6 +18,7 @@
 
 #include "zmbv.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <cstdio>
@@ -29,6 +30,8 @@
 #include "support.h"
 #include "checks.h"
 
+#include "simde/x86/sse2.h"
+
 CHECK_NARROWING();
 
 constexpr uint8_t DBZV_VERSION_HIGH = 0;
@@ -178,6 +181,11 @@ int VideoCodec::PossibleBlock(const int vx, const int vy, const FrameBlock & blo
 	return ret;
 }
 
+// Returns the number of differing pixels (ignoring the unused top byte of
+// 32-bit pixels). This is the hot spot of the motion search, so full 16-byte
+// vectors are compared with SIMD and only the remainder of the row is
+// compared pixel by pixel. The matching pixels are tallied per lane and only
+// summed up once per block.
 template <class P>
 int VideoCodec::CompareBlock(const int vx, const int vy, const FrameBlock & block)
 {
@@ -185,14 +193,65 @@ int VideoCodec::CompareBlock(const int vx, const int vy, const FrameBlock & bloc
 	P *pold = reinterpret_cast<P *>(oldframe) + block.start + (vy * pitch) + vx;
 	P *pnew = reinterpret_cast<P *>(newframe) + block.start;
 
+	constexpr int PixelsPerVector = sizeof(simde__m128i) / sizeof(P);
+
+	const auto mask = (sizeof(P) == 4) ? simde_mm_set1_epi32(0x00ffffff)
+	                                   : simde_mm_set1_epi32(-1);
+	const auto zero = simde_mm_setzero_si128();
+
+	// Each lane counts up to 255 (8-bit pixels), which is plenty for our
+	// 16x16 blocks
+	assert(block.dy * block.dx / PixelsPerVector < 256);
+
+	auto num_equal_per_lane = zero;
+	auto num_compared       = 0;
+
 	for (auto y = 0; y < block.dy; y++) {
-		for (auto x = 0; x < block.dx; x++) {
+		auto x = 0;
+		for (; x + PixelsPerVector <= block.dx; x += PixelsPerVector) {
+			const auto va = simde_mm_loadu_si128(
+			        reinterpret_cast<const simde__m128i *>(pold + x));
+			const auto vb = simde_mm_loadu_si128(
+			        reinterpret_cast<const simde__m128i *>(pnew + x));
+
+			const auto diff = simde_mm_and_si128(simde_mm_xor_si128(va, vb),
+			                                     mask);
+
+			// Matching lanes are all ones, i.e. -1
+			if constexpr (sizeof(P) == 1) {
+				num_equal_per_lane = simde_mm_sub_epi8(
+				        num_equal_per_lane, simde_mm_cmpeq_epi8(diff, zero));
+			} else if constexpr (sizeof(P) == 2) {
+				num_equal_per_lane = simde_mm_sub_epi16(
+				        num_equal_per_lane, simde_mm_cmpeq_epi16(diff, zero));
+			} else {
+				num_equal_per_lane = simde_mm_sub_epi32(
+				        num_equal_per_lane, simde_mm_cmpeq_epi32(diff, zero));
+			}
+			num_compared += PixelsPerVector;
+		}
+		for (; x < block.dx; x++) {
 			diff_count += ((pold[x] ^ pnew[x]) & 0x00ffffff) != 0;
 		}
 		pold += pitch;
 		pnew += pitch;
 	}
-	return diff_count;
+
+	// Sum up the lanes into 32-bit lanes
+	simde__m128i sums = {};
+	if constexpr (sizeof(P) == 1) {
+		sums = simde_mm_sad_epu8(num_equal_per_lane, zero);
+	} else if constexpr (sizeof(P) == 2) {
+		sums = simde_mm_madd_epi16(num_equal_per_lane, simde_mm_set1_epi16(1));
+	} else {
+		sums = num_equal_per_lane;
+	}
+	sums = simde_mm_add_epi32(sums, simde_mm_srli_si128(sums, 8));
+	sums = simde_mm_add_epi32(sums, simde_mm_srli_si128(sums, 4));
+
+	const auto num_equal = simde_mm_cvtsi128_si32(sums);
+
+	return diff_count + num_compared - num_equal;
 }
 
 template <class P>
@@ -215,6 +274,34 @@ void VideoCodec::AlignWork(size_t & offset) {
 	offset = (offset + blocks.size() * 2u + 3u) & ~3u;
 }
 
+template <class P>
+VideoCodec::BlockVector VideoCodec::SearchBlock(const FrameBlock & block)
+{
+	int8_t bestvx   = 0;
+	int8_t bestvy   = 0;
+	auto bestchange = CompareBlock<P>(0, 0, block);
+	auto possibles  = 64;
+
+	for (auto v = 0; v < VectorCount && possibles; v++) {
+		if (bestchange < 4)
+			break;
+		auto vx = VectorTable[v].x;
+		auto vy = VectorTable[v].y;
+		if (PossibleBlock<P>(vx, vy, block) < 4) {
+			possibles--;
+			// if (!possibles) Msg("Ran out of possibles, at
+			// %d of %d best%d\n",v,VectorCount,bestchange);
+			auto testchange = CompareBlock<P>(vx, vy, block);
+			if (testchange < bestchange) {
+				bestchange = testchange;
+				bestvx     = check_cast<int8_t>(vx);
+				bestvy     = check_cast<int8_t>(vy);
+			}
+		}
+	}
+	return {bestvx, bestvy, bestchange != 0};
+}
+
 template <class P>
 void VideoCodec::AddXorFrame()
 {
@@ -222,41 +309,132 @@ void VideoCodec::AddXorFrame()
 
 	AlignWork(workUsed);
 
+	// The motion search only reads the frames, so it can run in parallel;
+	// the XOR blocks are then written to the work buffer in block order.
+	blockVectors.resize(blocks.size());
+	RunSearch(blocks.size(), [this](const size_t i) {
+		blockVectors[i] = SearchBlock<P>(blocks[i]);
+	});
+
 	size_t b = 0;
 	for (const auto & block : blocks) {
+		const auto & best = blockVectors[b];
 
-		int8_t bestvx   = 0;
-		int8_t bestvy   = 0;
-		auto bestchange = CompareBlock<P>(0, 0, block);
-		auto possibles  = 64;
-
-		for (auto v = 0; v < VectorCount && possibles; v++) {
-			if (bestchange < 4)
-				break;
-			auto vx = VectorTable[v].x;
-			auto vy = VectorTable[v].y;
-			if (PossibleBlock<P>(vx, vy, block) < 4) {
-				possibles--;
-				// if (!possibles) Msg("Ran out of possibles, at
-				// %d of %d best%d\n",v,VectorCount,bestchange);
-				auto testchange = CompareBlock<P>(vx, vy, block);
-				if (testchange < bestchange) {
-					bestchange = testchange;
-					bestvx     = check_cast<int8_t>(vx);
-					bestvy     = check_cast<int8_t>(vy);
-				}
-			}
-		}
-		vectors[b * 2 + 0] = static_cast<uint8_t>(left_shift_signed(bestvx, 1));
-		vectors[b * 2 + 1] = static_cast<uint8_t>(left_shift_signed(bestvy, 1));
-		if (bestchange) {
+		vectors[b * 2 + 0] = static_cast<uint8_t>(left_shift_signed(best.x, 1));
+		vectors[b * 2 + 1] = static_cast<uint8_t>(left_shift_signed(best.y, 1));
+		if (best.has_change) {
 			vectors[b * 2 + 0] |= 1;
-			AddXorBlock<P>(bestvx, bestvy, block);
+			AddXorBlock<P>(best.x, best.y, block);
 		}
 		++b;
 	}
 }
 
+// Motion search threads
+// ~~~~~~~~~~~~~~~~~~~~~
+// Every thread (including the caller) takes part in every search and grabs
+// small chunks of blocks until none are left. The caller only returns after
+// all threads have checked in, so no thread can still be looking at the job
+// when the next frame's search is set up.
+
+constexpr size_t SearchChunkSize = 8;
+
+void VideoCodec::StartSearchThreads()
+{
+	if (num_search_threads <= 1 || !search.threads.empty()) {
+		return;
+	}
+	search.should_stop = false;
+
+	// The calling thread makes up the last one
+	for (auto i = 1; i < num_search_threads; ++i) {
+		search.threads.emplace_back(&VideoCodec::SearchThreadLoop, this);
+		set_thread_name(search.threads.back(), "dosbox:zmbv");
+	}
+}
+
+void VideoCodec::StopSearchThreads()
+{
+	{
+		std::lock_guard<std::mutex> lock(search.mutex);
+		search.should_stop = true;
+	}
+	search.has_job.notify_all();
+
+	for (auto & thread : search.threads) {
+		if (thread.joinable()) {
+			thread.join();
+		}
+	}
+	search.threads.clear();
+}
+
+void VideoCodec::ProcessSearchItems()
+{
+	const auto num_items = search.num_items;
+
+	size_t start = 0;
+	while ((start = search.next_item.fetch_add(SearchChunkSize)) < num_items) {
+		const auto end = std::min(start + SearchChunkSize, num_items);
+		for (auto i = start; i < end; ++i) {
+			search.job(i);
+		}
+	}
+}
+
+void VideoCodec::SearchThreadLoop()
+{
+	uint32_t last_generation = 0;
+
+	std::unique_lock<std::mutex> lock(search.mutex);
+	while (true) {
+		search.has_job.wait(lock, [&] {
+			return search.should_stop || search.generation != last_generation;
+		});
+		if (search.should_stop) {
+			return;
+		}
+		last_generation = search.generation;
+
+		lock.unlock();
+		ProcessSearchItems();
+		lock.lock();
+
+		++search.num_threads_done;
+		search.job_done.notify_one();
+	}
+}
+
+void VideoCodec::RunSearch(const size_t num_items, std::function<void(size_t)> job)
+{
+	if (search.threads.empty() || num_items <= SearchChunkSize) {
+		for (size_t i = 0; i < num_items; ++i) {
+			job(i);
+		}
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(search.mutex);
+
+	search.job       = std::move(job);
+	search.num_items = num_items;
+	search.next_item = 0;
+
+	search.num_threads_done = 0;
+	++search.generation;
+
+	lock.unlock();
+	search.has_job.notify_all();
+
+	ProcessSearchItems();
+
+	lock.lock();
+	search.job_done.wait(lock, [&] {
+		return search.num_threads_done == search.threads.size();
+	});
+	search.job = {};
+}
+
 bool VideoCodec::SetupCompress(const int _width, const int _height)
 {
 	width  = _width;
@@ -266,6 +444,7 @@ bool VideoCodec::SetupCompress(const int _width, const int _height)
 	if (deflateInit2(&zstream, ZLIB_COMPRESSION_LEVEL, ZLIB_COMPRESSION_METHOD, ZLIB_MEM_LEVEL, ZLIB_MEM_LEVEL, ZLIB_STRATEGY) !=
 	    Z_OK)
 		return false;
+	StartSearchThreads();
 	return true;
 }
 
@@ -455,8 +634,9 @@ void VideoCodec::UnXorFrame()
 	uint32_t b = 0;
 	for (const auto & block : blocks) {
 		const auto delta = vectors[b * 2 + 0] & 1;
-		const auto vx    = vectors[b * 2 + 0] >> 1;
-		const auto vy    = vectors[b * 2 + 1] >> 1;
+		// The vectors are signed
+		const auto vx    = static_cast<int8_t>(vectors[b * 2 + 0]) >> 1;
+		const auto vy    = static_cast<int8_t>(vectors[b * 2 + 1]) >> 1;
 		if (delta)
 			UnXorBlock<P>(vx, vy, block);
 		else
@@ -497,10 +677,11 @@ bool VideoCodec::DecompressFrame(uint8_t *framedata, int size)
 	zstream.avail_out = bufsize;
 	zstream.total_out = 0;
 
-	// decompress all the pending data. Note that if Z_FINISH isn't used,
-	// then inflate can also return Z_OK, which indicates multiple inflation
-	// passes are needed.
-	if (inflate(&zstream, Z_FINISH) != Z_STREAM_END)
+	// Decompress all the pending data. The encoder sync-flushes the stream
+	// at the end of each frame (the stream only ends with the video), so
+	// the frame's data is complete once all input has been consumed.
+	const auto result = inflate(&zstream, Z_SYNC_FLUSH);
+	if ((result != Z_OK && result != Z_STREAM_END) || zstream.avail_in != 0)
 		return false;
 
 	workUsed = check_cast<uint32_t>(zstream.total_out);
@@ -602,8 +783,13 @@ void VideoCodec::Output_UpsideDown_24(uint8_t *output)
 	}
 }
 
-VideoCodec::VideoCodec()
+VideoCodec::VideoCodec(const int num_threads) : num_search_threads(num_threads)
 {
 	CreateVectorTable();
 	memset(&zstream, 0, sizeof(zstream));
 }
+
+VideoCodec::~VideoCodec()
+{
+	StopSearchThreads();
+}
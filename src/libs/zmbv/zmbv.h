@@ -19,7 +19,12 @@
 #ifndef DOSBOX_ZMBV_H
 #define DOSBOX_ZMBV_H
 
+#include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 #include "config.h"
@@ -66,6 +71,11 @@ private:
 		int y = 0;
 		int slot = 0;
 	};
+	struct BlockVector {
+		int8_t x = 0;
+		int8_t y = 0;
+		bool has_change = false;
+	};
 	struct KeyframeHeader {
 		uint8_t high_version = 0;
 		uint8_t low_version = 0;
@@ -96,6 +106,7 @@ private:
 	uint32_t bufsize = 0;
 
 	std::vector<FrameBlock> blocks = {};
+	std::vector<BlockVector> blockVectors = {};
 	size_t workUsed = 0;
 	size_t workPos = 0;
 
@@ -110,6 +121,26 @@ private:
 	Compress compress = {};
 	z_stream zstream = {};
 
+	// Motion search worker threads. The blocks are searched independently
+	// in parallel, so the encoded output is identical to the serial search.
+	struct SearchPool {
+		std::vector<std::thread> threads = {};
+
+		std::mutex mutex = {};
+		std::condition_variable has_job = {};
+		std::condition_variable job_done = {};
+
+		std::function<void(size_t)> job = {};
+		size_t num_items = 0;
+		std::atomic<size_t> next_item = 0;
+
+		uint32_t generation = 0;
+		size_t num_threads_done = 0;
+		bool should_stop = false;
+	};
+	SearchPool search = {};
+	int num_search_threads = 0;
+
 	// methods
 	void CreateVectorTable();
 	bool SetupBuffers(ZMBV_FORMAT format, int blockwidth, int blockheight);
@@ -128,11 +159,22 @@ private:
 	void UnXorBlock(int vx, int vy, const FrameBlock & block);
 	template <class P>
 	void CopyBlock(int vx, int vy, const FrameBlock & block);
+	template <class P>
+	BlockVector SearchBlock(const FrameBlock & block);
 
 	void AlignWork(size_t & offset);
 
+	void StartSearchThreads();
+	void StopSearchThreads();
+	void SearchThreadLoop();
+	void ProcessSearchItems();
+	void RunSearch(size_t num_items, std::function<void(size_t)> job);
+
 public:
-	VideoCodec();
+	// The motion search of the encoder is spread across the given number of
+	// threads (including the calling thread); 1 means serial encoding.
+	VideoCodec(int num_threads = 1);
+	~VideoCodec();
 
 	VideoCodec(const VideoCodec &) = delete;            // prevent copy
 	VideoCodec &operator=(const VideoCodec &) = delete; // prevent assignment
@@ -22,6 +22,8 @@
 
 #include <bitset>
 #include <cassert>
+#include <chrono>
+#include <cinttypes>
 #include <compare>
 #include <numeric>
 #include <string>
@@ -95,6 +97,7 @@ static dynlib_handle fsynth_lib = {};
 	FSFUNC(fluid_synth_t*, new_fluid_synth, (fluid_settings_t *settings)) \
 	FSFUNC(fluid_log_function_t, fluid_set_log_function, (int level, fluid_log_function_t fun, void *data)) \
 	FSFUNC(int, fluid_settings_setnum, (fluid_settings_t *settings, const char *name, double val)) \
+	FSFUNC(int, fluid_settings_setint, (fluid_settings_t *settings, const char *name, int val)) \
 	FSFUNC(int, fluid_synth_chorus_on, (fluid_synth_t *synth, int fx_group, int on)) \
 	FSFUNC(int, fluid_synth_set_chorus_group_nr, (fluid_synth_t *synth, int fx_group, int nr)) \
 	FSFUNC(int, fluid_synth_set_chorus_group_level, (fluid_synth_t *synth, int fx_group, double level)) \
@@ -237,6 +240,42 @@ static void init_fluidsynth_dosbox_settings(Section_prop& secprop)
 	        "      same time. Whether this sounds good depends on the SoundFont and the\n"
 	        "      reverb settings being used.");
 
+	str_prop = secprop.Add_string("fsynth_cpu_cores", WhenIdle, "auto");
+	str_prop->Set_help(
+	        "Number of CPU cores FluidSynth renders voices on ('auto' by default).\n"
+	        "  auto:      Use the host's cores, minus two for the emulation and the mixer,\n"
+	        "             up to 4 in total.\n"
+	        "  <number>:  Use this many cores, from 1 to 256. Rendering is only spread\n"
+	        "             across cores when many voices are playing at once.");
+
+	constexpr auto DefaultPolyphony = 256;
+	constexpr auto MinPolyphony     = 16;
+	constexpr auto MaxPolyphony     = 4096;
+
+	int_prop = secprop.Add_int("fsynth_polyphony", WhenIdle, DefaultPolyphony);
+	int_prop->SetMinMax(MinPolyphony, MaxPolyphony);
+	int_prop->Set_help(
+	        format_str("Maximum number of voices FluidSynth plays at once (%d by default).\n"
+	                   "Large SoundFonts can use several voices per note; raise this if notes\n"
+	                   "get cut off, or lower it to reduce the CPU load. The value can range\n"
+	                   "from %d to %d.",
+	                   DefaultPolyphony,
+	                   MinPolyphony,
+	                   MaxPolyphony));
+
+	str_prop = secprop.Add_string("fsynth_sample_loading", WhenIdle, "auto");
+	assert(str_prop);
+	str_prop->Set_values({"auto", "preload", "on-demand"});
+	str_prop->Set_help(
+	        "How FluidSynth loads the SoundFont's samples ('auto' by default).\n"
+	        "  auto:       Load the samples on demand for SoundFonts larger than 256 MB,\n"
+	        "              otherwise preload them.\n"
+	        "  preload:    Load all samples into memory when the SoundFont is loaded.\n"
+	        "  on-demand:  Only keep the samples of the instruments currently in use in\n"
+	        "              memory. This starts up faster and uses much less memory with\n"
+	        "              large SoundFonts, but selecting an instrument for the first time\n"
+	        "              may briefly stall the audio if the SoundFont isn't cached yet.");
+
 	str_prop = secprop.Add_string("fsynth_filter", WhenIdle, "off");
 	assert(str_prop);
 	str_prop->Set_help(
@@ -585,6 +624,45 @@ static void setup_reverb(fluid_synth_t* synth)
 	}
 }
 
+static int get_num_cpu_cores()
+{
+	const auto pref = get_fluidsynth_section()->Get_string("fsynth_cpu_cores");
+
+	if (pref != "auto") {
+		constexpr auto MinCores = 1;
+		constexpr auto MaxCores = 256;
+		if (const auto cores = parse_int(pref);
+		    cores && *cores >= MinCores && *cores <= MaxCores) {
+			return *cores;
+		}
+		LOG_WARNING("FSYNTH: Invalid 'fsynth_cpu_cores' value: '%s', using 'auto'",
+		            pref.c_str());
+		set_section_property_value("fluidsynth", "fsynth_cpu_cores", "auto");
+	}
+
+	constexpr auto MaxAutoCores      = 4;
+	constexpr auto NumReservedThreads = 2;
+
+	const auto num_host_threads = static_cast<int>(
+	        std::thread::hardware_concurrency());
+
+	return std::clamp(num_host_threads - NumReservedThreads, 1, MaxAutoCores);
+}
+
+static bool use_dynamic_sample_loading(const std_fs::path& sf_path)
+{
+	const auto pref = get_fluidsynth_section()->Get_string("fsynth_sample_loading");
+	if (pref != "auto") {
+		return pref == "on-demand";
+	}
+
+	constexpr uintmax_t MaxPreloadSize = 256 * 1024 * 1024;
+
+	std::error_code err = {};
+	const auto sf_size  = std_fs::file_size(sf_path, err);
+	return !err && sf_size > MaxPreloadSize;
+}
+
 MidiDeviceFluidSynth::MidiDeviceFluidSynth()
 {
 	std::string sym_err_msg;
@@ -633,6 +711,33 @@ MidiDeviceFluidSynth::MidiDeviceFluidSynth()
 	                              "synth.sample-rate",
 	                              sample_rate_hz);
 
+	// Voices are spread across the extra cores by FluidSynth's own thread
+	// pool from within fluid_synth_write_float()
+	const auto num_cpu_cores = get_num_cpu_cores();
+	FluidSynth::fluid_settings_setint(fluid_settings.get(),
+	                                  "synth.cpu-cores",
+	                                  num_cpu_cores);
+
+	const auto polyphony = section->Get_int("fsynth_polyphony");
+	FluidSynth::fluid_settings_setint(fluid_settings.get(),
+	                                  "synth.polyphony",
+	                                  polyphony);
+
+	LOG_MSG("FSYNTH: Rendering up to %d voices on %d CPU %s",
+	        polyphony,
+	        num_cpu_cores,
+	        num_cpu_cores == 1 ? "core" : "cores");
+
+	const auto sf_name = section->Get_string("soundfont");
+	const auto sf_path = find_sf_file(sf_name);
+
+	// Samples are loaded when a channel selects an instrument that uses
+	// them, and unloaded once no channel does
+	const auto dynamic_sample_loading = use_dynamic_sample_loading(sf_path);
+	FluidSynth::fluid_settings_setint(fluid_settings.get(),
+	                                  "synth.dynamic-sample-loading",
+	                                  dynamic_sample_loading ? 1 : 0);
+
 	FluidSynthPtr fluid_synth(FluidSynth::new_fluid_synth(fluid_settings.get()),
 	                          FluidSynth::delete_fluid_synth);
 	if (!fluid_synth) {
@@ -642,9 +747,6 @@ MidiDeviceFluidSynth::MidiDeviceFluidSynth()
 	}
 
 	// Load the requested SoundFont or quit if none provided
-	const auto sf_name = section->Get_string("soundfont");
-	const auto sf_path = find_sf_file(sf_name);
-
 	if (!sf_path.empty() && FluidSynth::fluid_synth_sfcount(fluid_synth.get()) == 0) {
 		constexpr auto ResetPresets = true;
 		FluidSynth::fluid_synth_sfload(fluid_synth.get(),
@@ -672,6 +774,9 @@ MidiDeviceFluidSynth::MidiDeviceFluidSynth()
 		        sf_path.string().c_str(),
 		        sf_volume_percent);
 	}
+	if (dynamic_sample_loading) {
+		LOG_MSG("FSYNTH: Loading SoundFont samples on demand");
+	}
 
 	// Applies setting to all groups
 	constexpr int FxGroup = -1;
@@ -723,15 +828,24 @@ MidiDeviceFluidSynth::MidiDeviceFluidSynth()
 	// Double the baseline PCM prebuffer because MIDI is demanding and
 	// bursty. The mixer's default of ~20 ms becomes 40 ms here, which gives
 	// slower systems a better chance to keep up (and prevent their audio
-	// frame FIFO from running dry).
-	const auto render_ahead_ms = MIXER_GetPreBufferMs() * 2;
+	// frame FIFO from running dry). Hosts that still struggle with the
+	// SoundFont get up to four times that, depending on how long rendering
+	// actually takes.
+	const auto min_render_ahead_ms = MIXER_GetPreBufferMs() * 2;
+	const auto max_render_ahead_ms = min_render_ahead_ms * 4;
 
 	// Size the out-bound audio frame FIFO
 	assertm(sample_rate_hz >= 8000, "Sample rate must be at least 8 kHz");
 
 	const auto audio_frames_per_ms = iround(sample_rate_hz / MillisInSecond);
+
+	render_ahead = std::make_unique<RenderAheadController>(
+	        iround(sample_rate_hz),
+	        min_render_ahead_ms * audio_frames_per_ms,
+	        max_render_ahead_ms * audio_frames_per_ms);
+
 	audio_frame_fifo.Resize(
-	        check_cast<size_t>(render_ahead_ms * audio_frames_per_ms));
+	        check_cast<size_t>(render_ahead->GetTargetFrames()));
 
 	// Size the in-bound work FIFO
 	work_fifo.Resize(MaxMidiWorkFifoSize);
@@ -757,6 +871,8 @@ MidiDeviceFluidSynth::~MidiDeviceFluidSynth()
 {
 	LOG_MSG("FSYNTH: Shutting down");
 
+	PrintStats();
+
 	if (had_underruns) {
 		LOG_WARNING(
 		        "FSYNTH: Fix underruns by lowering the CPU load, increasing "
@@ -929,6 +1045,7 @@ void MidiDeviceFluidSynth::MixerCallback(const int requested_audio_frames)
 			LOG_WARNING("FSYNTH: Audio buffer underrun");
 		}
 		had_underruns = true;
+		render_ahead->RecordUnderrun();
 	}
 
 	static std::vector<AudioFrame> audio_frames = {};
@@ -957,6 +1074,8 @@ void MidiDeviceFluidSynth::RenderAudioFramesToFifo(const int num_audio_frames)
 		audio_frames.resize(num_audio_frames);
 	}
 
+	const auto render_start = std::chrono::steady_clock::now();
+
 	FluidSynth::fluid_synth_write_float(synth.get(),
 									num_audio_frames,
 									&audio_frames[0][0],
@@ -966,9 +1085,32 @@ void MidiDeviceFluidSynth::RenderAudioFramesToFifo(const int num_audio_frames)
 									1,
 									2);
 
+	const auto render_us = std::chrono::duration_cast<std::chrono::microseconds>(
+	                               std::chrono::steady_clock::now() - render_start)
+	                               .count();
+
+	if (render_ahead->RecordBlock(num_audio_frames, render_us)) {
+		audio_frame_fifo.Resize(
+		        check_cast<size_t>(render_ahead->GetTargetFrames()));
+	}
+
 	audio_frame_fifo.BulkEnqueue(audio_frames, num_audio_frames);
 }
 
+// Between MIDI messages, render as much as the FIFO has room for, in blocks
+// no larger than FluidSynth's own so new messages don't wait long. When it's
+// full, a single frame is rendered and waits for room as before.
+int MidiDeviceFluidSynth::GetNumIdleAudioFrames()
+{
+	constexpr size_t MaxIdleAudioFrames = 64;
+
+	const auto capacity = audio_frame_fifo.MaxCapacity();
+	const auto size     = audio_frame_fifo.Size();
+
+	const auto headroom = capacity > size ? capacity - size : 0;
+	return check_cast<int>(std::clamp(headroom, size_t{1}, MaxIdleAudioFrames));
+}
+
 void MidiDeviceFluidSynth::ProcessWorkFromFifo()
 {
 	const auto work = work_fifo.Dequeue();
@@ -1005,7 +1147,7 @@ void MidiDeviceFluidSynth::ProcessWorkFromFifo()
 void MidiDeviceFluidSynth::Render()
 {
 	while (work_fifo.IsRunning()) {
-		work_fifo.IsEmpty() ? RenderAudioFramesToFifo()
+		work_fifo.IsEmpty() ? RenderAudioFramesToFifo(GetNumIdleAudioFrames())
 		                    : ProcessWorkFromFifo();
 	}
 }
@@ -1015,6 +1157,30 @@ std_fs::path MidiDeviceFluidSynth::GetSoundFontPath()
 	return soundfont_path;
 }
 
+RenderAheadController::Stats MidiDeviceFluidSynth::GetRenderStats() const
+{
+	assert(render_ahead);
+	return render_ahead->GetStats();
+}
+
+void MidiDeviceFluidSynth::PrintStats()
+{
+	const auto stats = GetRenderStats();
+	if (stats.num_blocks == 0) {
+		return;
+	}
+	LOG_MSG("FSYNTH: Rendered %" PRIu64 " blocks taking %.0f us on average "
+	        "(%" PRId64 " us max); render load %.0f%% (%.0f%% peak), "
+	        "%" PRIu64 " underruns, render-ahead %.0f ms",
+	        stats.num_blocks,
+	        stats.avg_block_us,
+	        stats.max_block_us,
+	        stats.avg_load * 100.0,
+	        stats.peak_load * 100.0,
+	        stats.num_underruns,
+	        stats.target_ms);
+}
+
 std::string format_sf_line(size_t width, const std_fs::path& sf_path)
 {
 	assert(width > 0);
@@ -1121,6 +1287,17 @@ void FSYNTH_ListDevices(MidiDeviceFluidSynth* device, Program* caller)
 		}
 	}
 
+	if (device) {
+		const auto stats = device->GetRenderStats();
+		caller->WriteOut("\n%s", Indent);
+		caller->WriteOut(MSG_Get("FLUIDSYNTH_RENDER_STATS"),
+		                 stats.avg_load * 100.0,
+		                 stats.peak_load * 100.0,
+		                 stats.target_ms,
+		                 static_cast<unsigned long long>(stats.num_underruns));
+		caller->WriteOut("\n");
+	}
+
 	caller->WriteOut("\n");
 }
 
@@ -1135,6 +1312,8 @@ static void fluidsynth_init([[maybe_unused]] Section* sec)
 static void register_fluidsynth_text_messages()
 {
 	MSG_Add("FLUIDSYNTH_NO_SOUNDFONTS", "No available SoundFonts");
+	MSG_Add("FLUIDSYNTH_RENDER_STATS",
+	        "Render load %.0f%% (%.0f%% peak), render-ahead %.0f ms, %llu underruns");
 }
 
 void FSYNTH_AddConfigSection(const ConfigPtr& conf)
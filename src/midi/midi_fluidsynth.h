@@ -32,6 +32,7 @@
 
 #include "dynlib.h"
 #include "mixer.h"
+#include "render_ahead.h"
 #include "rwqueue.h"
 #include "std_filesystem.h"
 
@@ -51,6 +52,7 @@ public:
 	~MidiDeviceFluidSynth() override;
 
 	void PrintStats();
+	RenderAheadController::Stats GetRenderStats() const;
 
 	std::string GetName() const override
 	{
@@ -73,6 +75,7 @@ private:
 	void ProcessWorkFromFifo();
 
 	int GetNumPendingAudioFrames();
+	int GetNumIdleAudioFrames();
 	void RenderAudioFramesToFifo(const int num_audio_frames = 1);
 	void Render();
 
@@ -86,6 +89,7 @@ private:
 
 	MixerChannelPtr mixer_channel = nullptr;
 	RWQueue<AudioFrame> audio_frame_fifo{1};
+	std::unique_ptr<RenderAheadController> render_ahead = {};
 	RWQueue<MidiWork> work_fifo{1};
 	std::thread renderer = {};
 
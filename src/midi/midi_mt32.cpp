@@ -23,6 +23,8 @@
 #if C_MT32EMU
 
 #include <cassert>
+#include <chrono>
+#include <cinttypes>
 #include <deque>
 #include <functional>
 #include <map>
@@ -119,6 +121,23 @@ constexpr bool UseNicePartialMixing = true;
 //
 constexpr auto MidiDelayMode = MT32Emu::MIDIDelayMode_IMMEDIATE;
 
+// Queued MIDI work is handed to the synth in batches of up to this many
+// messages, each timestamped at its own position within the audio rendered
+// after them (see ProcessWorkFromFifo()).
+constexpr uint64_t MaxBatchEvents = 512;
+
+// Holds a full batch plus the few events left over from the previous one.
+// Must be a power of two.
+constexpr uint32_t MidiEventQueueSize = 2048;
+
+// Audio is rendered and queued in blocks of at most this many frames, so
+// the mixer can start on a long stretch of audio before all of it is done
+constexpr int MaxRenderBlockFrames = 1024;
+
+// Without MIDI work, audio is rendered ahead in blocks of at most this many
+// frames; smaller blocks let the next message play sooner
+constexpr size_t MaxIdleAudioFrames = 64;
+
 using Rom = LASynthModel::Rom;
 
 // MT-32
@@ -419,6 +438,9 @@ static void register_mt32_text_messages()
 	MSG_Add("CM32L_ROMS_LABEL", "CM-32L models   ");
 	MSG_Add("MT32_ACTIVE_MODEL_LABEL", "Active model  ");
 	MSG_Add("MT32_SOURCE_DIR_LABEL", "ROM path      ");
+	MSG_Add("MT32_RENDER_STATS",
+	        "Render load %.0f%%, %llu MIDI messages in %llu batches, "
+	        "up to %llu queued");
 }
 
 #if defined(WIN32)
@@ -695,6 +717,7 @@ MidiDeviceMt32::MidiDeviceMt32()
 	mt32_service->setNicePanningEnabled(UseNicePanning);
 	mt32_service->setNicePartialMixingEnabled(UseNicePartialMixing);
 	mt32_service->setMIDIDelayMode(MidiDelayMode);
+	mt32_service->setMIDIEventQueueSize(MidiEventQueueSize);
 
 	const auto rc = mt32_service->openSynth();
 
@@ -776,6 +799,8 @@ MidiDeviceMt32::~MidiDeviceMt32()
 {
 	LOG_MSG("MT32: Shutting down");
 
+	PrintStats();
+
 	if (had_underruns) {
 		LOG_WARNING(
 		        "MT32: Fix underruns by lowering the CPU load or increasing "
@@ -898,72 +923,232 @@ void MidiDeviceMt32::MixerCallback(const int requested_audio_frames)
 	}
 }
 
+static void update_max(std::atomic<uint64_t>& max_value, const uint64_t value)
+{
+	// Only the render thread writes the counters
+	if (value > max_value.load(std::memory_order_relaxed)) {
+		max_value.store(value, std::memory_order_relaxed);
+	}
+}
+
 void MidiDeviceMt32::RenderAudioFramesToFifo(const int num_frames)
 {
 	static std::vector<AudioFrame> audio_frames = {};
 
-	// Maybe expand the vector
-	if (check_cast<int>(audio_frames.size()) < num_frames) {
-		audio_frames.resize(num_frames);
+	auto num_frames_remaining = num_frames;
+
+	while (num_frames_remaining > 0 && audio_frame_fifo.IsRunning()) {
+		const auto block_frames = std::min(num_frames_remaining,
+		                                   MaxRenderBlockFrames);
+
+		// Maybe expand the vector
+		if (check_cast<int>(audio_frames.size()) < block_frames) {
+			audio_frames.resize(block_frames);
+		}
+
+		const auto render_start = std::chrono::steady_clock::now();
+
+		std::unique_lock<std::mutex> lock(service_mutex);
+		service->renderFloat(&audio_frames[0][0], block_frames);
+		lock.unlock();
+
+		const auto render_us = std::chrono::duration_cast<std::chrono::microseconds>(
+		                               std::chrono::steady_clock::now() - render_start)
+		                               .count();
+
+		auto& counters = render_counters;
+		counters.num_blocks.fetch_add(1, std::memory_order_relaxed);
+		counters.num_frames.fetch_add(static_cast<uint64_t>(block_frames),
+		                             std::memory_order_relaxed);
+		counters.total_block_us.fetch_add(static_cast<uint64_t>(render_us),
+		                                 std::memory_order_relaxed);
+		update_max(counters.max_block_us, static_cast<uint64_t>(render_us));
+
+		audio_frame_fifo.BulkEnqueue(audio_frames, block_frames);
+
+		num_frames_remaining -= block_frames;
 	}
+}
 
-	std::unique_lock<std::mutex> lock(service_mutex);
-	service->renderFloat(&audio_frames[0][0], num_frames);
-	lock.unlock();
+int MidiDeviceMt32::GetNumIdleAudioFrames()
+{
+	const auto capacity = audio_frame_fifo.MaxCapacity();
+	const auto size     = audio_frame_fifo.Size();
+
+	const auto headroom = capacity > size ? capacity - size : 0;
+	return check_cast<int>(std::clamp(headroom, size_t{1}, MaxIdleAudioFrames));
+}
 
-	audio_frame_fifo.BulkEnqueue(audio_frames, num_frames);
+// Schedules the message to play at the given synth timestamp. The service
+// mutex must be held. Returns false if the synth's event queue is full.
+bool MidiDeviceMt32::PlayWorkAt(const MidiWork& work, const uint32_t timestamp)
+{
+	mt32emu_return_code rc = MT32EMU_RC_OK;
+
+	if (work.message_type == MessageType::Channel) {
+		assert(work.message.size() <= MaxMidiMessageLen);
+
+		const auto& data   = work.message.data();
+		const uint32_t msg = data[0] + (data[1] << 8) + (data[2] << 16);
+
+		rc = service->playMsgAt(msg, timestamp);
+	} else {
+		assert(work.message_type == MessageType::SysEx);
+
+		rc = service->playSysexAt(work.message.data(),
+		                          static_cast<uint32_t>(work.message.size()),
+		                          timestamp);
+	}
+	return rc != MT32EMU_RC_QUEUE_FULL;
 }
 
-// The next MIDI work task is processed, which includes rendering audio frames
-// prior to applying channel and sysex messages to the service
+// All MIDI work that has arrived is applied as one batch. Each message is
+// timestamped at its arrival time relative to the audio rendered so far, then
+// the audio up to the last one is rendered in large blocks, with libmt32emu
+// applying each message at its exact frame. Bursts of messages, such as the
+// SysEx patch dumps many games send at startup, no longer have a few frames
+// rendered between every one of them.
 void MidiDeviceMt32::ProcessWorkFromFifo()
 {
-	const auto work = work_fifo.Dequeue();
+	auto work = work_fifo.Dequeue();
 	if (!work) {
 		return;
 	}
 
+	auto& counters = render_counters;
+	update_max(counters.max_queue_depth, work_fifo.Size() + 1);
+
 #ifdef DEBUG_MT32
 	LOG_TRACE(
-	        "MT32: %2u audio frames prior to %s message, followed by "
-	        "%2lu more messages. Have %4lu audio frames queued",
-	        work->num_pending_audio_frames,
-	        work->message_type == MessageType::Channel ? "channel" : "sysex",
-	        work_fifo.Size(),
+	        "MT32: Batching %2lu messages. Have %4lu audio frames queued",
+	        work_fifo.Size() + 1,
 	        audio_frame_fifo.Size());
 #endif
 
-	if (work->num_pending_audio_frames > 0) {
-		RenderAudioFramesToFifo(work->num_pending_audio_frames);
-	}
-
 	// Request exclusive access prior to applying messages
-	const std::lock_guard<std::mutex> lock(service_mutex);
+	std::unique_lock<std::mutex> lock(service_mutex);
 
-	if (work->message_type == MessageType::Channel) {
-		assert(work->message.size() <= MaxMidiMessageLen);
+	auto batch_start  = service->getInternalRenderedSampleCount();
+	auto batch_frames = 0;
+
+	uint64_t num_events = 0;
+
+	while (true) {
+		batch_frames += work->num_pending_audio_frames;
+
+		// Timestamps are in the synth's own sample rate
+		const auto timestamp = batch_start +
+		                       service->convertOutputToSynthTimestamp(
+		                               check_cast<uint32_t>(batch_frames));
+
+		if (!PlayWorkAt(*work, timestamp)) {
+			// Render up to this message to drain the synth's event
+			// queue, then play it at the start of the next block. A
+			// message that's due right away still needs some frames
+			// rendered, and the queue may take more than one block to
+			// drain, so keep going until the message is queued. Only
+			// a stopped FIFO, when the device is shutting down, drops
+			// the message.
+			counters.num_queue_full.fetch_add(1, std::memory_order_relaxed);
+
+			auto num_frames = batch_frames;
+			do {
+				lock.unlock();
+				RenderAudioFramesToFifo(num_frames > 0
+				                                ? num_frames
+				                                : GetNumIdleAudioFrames());
+				lock.lock();
+
+				batch_start  = service->getInternalRenderedSampleCount();
+				batch_frames = 0;
+				num_frames   = 0;
+			} while (!PlayWorkAt(*work, batch_start) &&
+			         audio_frame_fifo.IsRunning());
+		}
+		++num_events;
 
-		const auto& data   = work->message.data();
-		const uint32_t msg = data[0] + (data[1] << 8) + (data[2] << 16);
+		if (num_events == MaxBatchEvents || work_fifo.IsEmpty()) {
+			break;
+		}
+		work = work_fifo.Dequeue();
+		if (!work) {
+			break;
+		}
+	}
 
-		service->playMsg(msg);
-	} else {
-		assert(work->message_type == MessageType::SysEx);
+	lock.unlock();
 
-		service->playSysex(work->message.data(),
-		                   static_cast<uint32_t>(work->message.size()));
-	}
+	counters.num_events.fetch_add(num_events, std::memory_order_relaxed);
+	counters.num_batches.fetch_add(1, std::memory_order_relaxed);
+	update_max(counters.max_batch_events, num_events);
+
+	RenderAudioFramesToFifo(batch_frames);
 }
 
 // Keep the FIFO populated with freshly rendered buffers
 void MidiDeviceMt32::Render()
 {
 	while (work_fifo.IsRunning()) {
-		work_fifo.IsEmpty() ? RenderAudioFramesToFifo()
+		work_fifo.IsEmpty() ? RenderAudioFramesToFifo(GetNumIdleAudioFrames())
 		                    : ProcessWorkFromFifo();
 	}
 }
 
+MidiDeviceMt32::RenderStats MidiDeviceMt32::GetRenderStats() const
+{
+	const auto& counters = render_counters;
+
+	RenderStats stats = {};
+
+	stats.num_events       = counters.num_events.load(std::memory_order_relaxed);
+	stats.num_batches      = counters.num_batches.load(std::memory_order_relaxed);
+	stats.max_batch_events = counters.max_batch_events.load(std::memory_order_relaxed);
+	stats.max_queue_depth  = counters.max_queue_depth.load(std::memory_order_relaxed);
+	stats.num_queue_full   = counters.num_queue_full.load(std::memory_order_relaxed);
+	stats.num_blocks       = counters.num_blocks.load(std::memory_order_relaxed);
+	stats.max_block_us     = counters.max_block_us.load(std::memory_order_relaxed);
+
+	const auto num_frames     = counters.num_frames.load(std::memory_order_relaxed);
+	const auto total_block_us = counters.total_block_us.load(std::memory_order_relaxed);
+
+	if (stats.num_blocks > 0) {
+		stats.avg_block_us = static_cast<double>(total_block_us) /
+		                     static_cast<double>(stats.num_blocks);
+	}
+	if (num_frames > 0) {
+		const auto audio_us = static_cast<double>(num_frames) *
+		                      ms_per_audio_frame * 1000.0;
+		stats.render_load = static_cast<double>(total_block_us) / audio_us;
+	}
+	return stats;
+}
+
+void MidiDeviceMt32::PrintStats()
+{
+	const auto stats = GetRenderStats();
+	if (stats.num_blocks == 0) {
+		return;
+	}
+	LOG_MSG("MT32: Rendered %" PRIu64 " blocks taking %.0f us on average "
+	        "(%" PRIu64 " us max); render load %.0f%%",
+	        stats.num_blocks,
+	        stats.avg_block_us,
+	        stats.max_block_us,
+	        stats.render_load * 100.0);
+
+	if (stats.num_events == 0) {
+		return;
+	}
+	LOG_MSG("MT32: Played %" PRIu64 " MIDI messages in %" PRIu64
+	        " batches (%" PRIu64 " max); up to %" PRIu64
+	        " messages were queued, the synth's queue filled up %" PRIu64 " times",
+	        stats.num_events,
+	        stats.num_batches,
+	        stats.max_batch_events,
+	        stats.max_queue_depth,
+	        stats.num_queue_full);
+}
+
 ModelAndDir MidiDeviceMt32::GetModelAndDir()
 {
 	return model_and_dir;
@@ -1096,6 +1281,17 @@ void MT32_ListDevices(MidiDeviceMt32* device, Program* caller)
 		                 MSG_Get("MIDI_DEVICE_NO_MODEL_ACTIVE"));
 	}
 
+	if (device) {
+		const auto stats = device->GetRenderStats();
+		caller->WriteOut("\n%s", Indent);
+		caller->WriteOut(MSG_Get("MT32_RENDER_STATS"),
+		                 stats.render_load * 100.0,
+		                 static_cast<unsigned long long>(stats.num_events),
+		                 static_cast<unsigned long long>(stats.num_batches),
+		                 static_cast<unsigned long long>(stats.max_queue_depth));
+		caller->WriteOut("\n");
+	}
+
 	caller->WriteOut("\n");
 }
 
@@ -27,6 +27,7 @@
 #if C_MT32EMU
 
 #include <atomic>
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <optional>
@@ -71,6 +72,18 @@ public:
 	void SendMidiMessage(const MidiMessage& msg) override;
 	void SendSysExMessage(uint8_t* sysex, size_t len) override;
 
+	struct RenderStats {
+		uint64_t num_events       = 0;
+		uint64_t num_batches      = 0;
+		uint64_t max_batch_events = 0;
+		uint64_t max_queue_depth  = 0; // MIDI work waiting for the renderer
+		uint64_t num_queue_full   = 0; // batches cut short by the synth's queue
+		uint64_t num_blocks       = 0;
+		double avg_block_us       = 0.0;
+		uint64_t max_block_us     = 0;
+		double render_load        = 0.0; // share of real time spent rendering
+	};
+	RenderStats GetRenderStats() const;
 	void PrintStats();
 
 	ModelAndDir GetModelAndDir();
@@ -81,6 +94,8 @@ private:
 	void ProcessWorkFromFifo();
 
 	int GetNumPendingAudioFrames();
+	int GetNumIdleAudioFrames();
+	bool PlayWorkAt(const MidiWork& work, const uint32_t timestamp);
 	void RenderAudioFramesToFifo(const int num_frames = 1);
 	void Render();
 
@@ -95,6 +110,19 @@ private:
 
 	ModelAndDir model_and_dir = {};
 
+	// Written by the render thread, read by anyone
+	struct {
+		std::atomic<uint64_t> num_events       = 0;
+		std::atomic<uint64_t> num_batches      = 0;
+		std::atomic<uint64_t> max_batch_events = 0;
+		std::atomic<uint64_t> max_queue_depth  = 0;
+		std::atomic<uint64_t> num_queue_full   = 0;
+		std::atomic<uint64_t> num_blocks       = 0;
+		std::atomic<uint64_t> num_frames       = 0;
+		std::atomic<uint64_t> total_block_us   = 0;
+		std::atomic<uint64_t> max_block_us     = 0;
+	} render_counters = {};
+
 	// Used to track the balance of time between the last mixer callback
 	// versus the current MIDI SysEx or Msg event.
 	double last_rendered_ms   = 0.0;
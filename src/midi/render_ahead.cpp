@@ -0,0 +1,143 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2025  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "render_ahead.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+// Loads are measured over this much audio, which smooths out the timer
+// resolution and FluidSynth's internal 64-frame blocks
+constexpr double WindowMs = 10.0;
+
+// Weight of each window in the average load
+constexpr double AvgLoadWeight = 0.1;
+
+// How quickly the peak load and the underrun boost fall back
+constexpr double PeakHalfLifeSeconds  = 2.0;
+constexpr double BoostHalfLifeSeconds = 10.0;
+
+// Each underrun grows the render-ahead by this factor
+constexpr double UnderrunBoost = 1.5;
+
+// Loads above this are treated as this; beyond it the render-ahead would
+// grow without bound, and only the underrun boost can help
+constexpr double MaxLoad = 0.75;
+
+static double decay_per_window(const double window_seconds, const double half_life_seconds)
+{
+	return std::pow(0.5, window_seconds / half_life_seconds);
+}
+
+RenderAheadController::RenderAheadController(const int sample_rate_hz,
+                                             const int _min_frames,
+                                             const int _max_frames)
+        : us_per_frame(1'000'000.0 / sample_rate_hz),
+          min_frames(_min_frames),
+          max_frames(std::max(_min_frames, _max_frames)),
+          window_frames(std::max(1, static_cast<int>(sample_rate_hz * WindowMs / 1000.0))),
+          peak_decay(decay_per_window(WindowMs / 1000.0, PeakHalfLifeSeconds)),
+          boost_decay(decay_per_window(WindowMs / 1000.0, BoostHalfLifeSeconds)),
+          target_frames(_min_frames)
+{
+	assert(sample_rate_hz > 0);
+	assert(min_frames > 0);
+}
+
+bool RenderAheadController::RecordBlock(const int frames, const int64_t render_us)
+{
+	assert(frames > 0);
+
+	const std::lock_guard lock(mutex);
+
+	++num_blocks;
+	num_frames += static_cast<uint64_t>(frames);
+	total_block_us += render_us;
+	max_block_us = std::max(max_block_us, render_us);
+
+	window_num_frames += frames;
+	window_render_us += render_us;
+	if (window_num_frames < window_frames) {
+		return false;
+	}
+
+	const auto prev_target_frames = target_frames;
+	EvaluateWindow();
+	return target_frames != prev_target_frames;
+}
+
+void RenderAheadController::EvaluateWindow()
+{
+	const auto window_load = static_cast<double>(window_render_us) /
+	                         (window_num_frames * us_per_frame);
+	window_num_frames = 0;
+	window_render_us  = 0;
+
+	avg_load += (window_load - avg_load) * AvgLoadWeight;
+	peak_load = std::max(window_load, peak_load * peak_decay);
+
+	if (has_pending_underrun.exchange(false)) {
+		boost *= UnderrunBoost;
+	} else {
+		boost = 1.0 + (boost - 1.0) * boost_decay;
+	}
+	const auto max_boost = static_cast<double>(max_frames) / min_frames;
+	boost = std::min(boost, max_boost);
+
+	// With a load of L, refilling the FIFO after it's been drained takes
+	// 1 / (1 - L) times as long as playing it, so that's how much more
+	// we keep queued
+	const auto load_factor = 1.0 / (1.0 - std::min(peak_load, MaxLoad));
+
+	const auto frames = std::ceil(min_frames * std::max(load_factor, boost));
+	target_frames = std::clamp(static_cast<int>(frames), min_frames, max_frames);
+}
+
+void RenderAheadController::RecordUnderrun()
+{
+	++num_underruns;
+	has_pending_underrun = true;
+}
+
+int RenderAheadController::GetTargetFrames() const
+{
+	const std::lock_guard lock(mutex);
+	return target_frames;
+}
+
+RenderAheadController::Stats RenderAheadController::GetStats() const
+{
+	const std::lock_guard lock(mutex);
+
+	Stats stats         = {};
+	stats.num_blocks    = num_blocks;
+	stats.num_frames    = num_frames;
+	stats.avg_block_us  = num_blocks ? static_cast<double>(total_block_us) /
+	                                          static_cast<double>(num_blocks)
+	                                 : 0.0;
+	stats.max_block_us  = max_block_us;
+	stats.avg_load      = avg_load;
+	stats.peak_load     = peak_load;
+	stats.num_underruns = num_underruns;
+	stats.target_frames = target_frames;
+	stats.target_ms     = target_frames * us_per_frame / 1000.0;
+	return stats;
+}
@@ -0,0 +1,104 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2025  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_RENDER_AHEAD_H
+#define DOSBOX_RENDER_AHEAD_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+/*  Render-ahead Controller
+ *  -----------------------
+ *  Sizes the audio frame FIFO between a synthesiser's render thread and the
+ *  mixer from what rendering actually costs on this host.
+ *
+ *  The render thread reports how long each block took. Over windows of a few
+ *  milliseconds of audio, this gives the render load: the share of real time
+ *  spent rendering. The closer the recent peak load gets to 100%, the less
+ *  slack the renderer has to catch up after a burst of notes, so the more
+ *  audio it needs queued up front. Underruns reported by the mixer raise the
+ *  render-ahead further, and that boost decays again over several seconds.
+ *
+ *  The target never drops below the minimum, so a light load behaves exactly
+ *  like a fixed FIFO of that size.
+ */
+
+class RenderAheadController {
+public:
+	RenderAheadController(int sample_rate_hz, int min_frames, int max_frames);
+
+	RenderAheadController(const RenderAheadController&)            = delete;
+	RenderAheadController& operator=(const RenderAheadController&) = delete;
+
+	// Render thread: report a rendered block, excluding the time spent
+	// queueing it. Returns true if the target changed.
+	bool RecordBlock(int frames, int64_t render_us);
+
+	// Mixer thread: report that the FIFO (nearly) ran dry
+	void RecordUnderrun();
+
+	// The number of frames the FIFO should hold
+	int GetTargetFrames() const;
+
+	struct Stats {
+		uint64_t num_blocks    = 0;
+		uint64_t num_frames    = 0;
+		double avg_block_us    = 0.0;
+		int64_t max_block_us   = 0;
+		double avg_load        = 0.0; // share of real time spent rendering
+		double peak_load       = 0.0; // decaying peak of the above
+		uint64_t num_underruns = 0;
+		int target_frames      = 0;
+		double target_ms       = 0.0;
+	};
+	Stats GetStats() const;
+
+private:
+	void EvaluateWindow();
+
+	const double us_per_frame;
+	const int min_frames;
+	const int max_frames;
+	const int window_frames;
+	const double peak_decay;
+	const double boost_decay;
+
+	mutable std::mutex mutex = {};
+
+	// The window being accumulated
+	int window_num_frames    = 0;
+	int64_t window_render_us = 0;
+
+	double avg_load   = 0.0;
+	double peak_load  = 0.0;
+	double boost      = 1.0;
+	int target_frames = 0;
+
+	uint64_t num_blocks    = 0;
+	uint64_t num_frames    = 0;
+	int64_t total_block_us = 0;
+	int64_t max_block_us   = 0;
+
+	std::atomic<uint64_t> num_underruns    = 0;
+	std::atomic<bool> has_pending_underrun = false;
+};
+
+#endif
@@ -21,6 +21,8 @@
 #include "config.h"
 
 #include <algorithm>
+#include <cerrno>
+#include <cstring>
 #include <map>
 #include <stdexcept>
 
@@ -33,6 +35,7 @@
 #include "ethernet_slirp.h"
 #include "setup.h"
 #include "string_utils.h"
+#include "support.h"
 #include "timer.h"
 
 /**
@@ -208,6 +211,13 @@ SlirpEthernetConnection::SlirpEthernetConnection()
 
 SlirpEthernetConnection::~SlirpEthernetConnection()
 {
+#ifdef SLIRP_IO_THREAD
+	IoThreadStop();
+
+	if (num_rx_dropped || num_tx_dropped)
+		LOG_MSG("SLIRP: Dropped %d received and %d sent packets as the queues were full",
+		        num_rx_dropped, num_tx_dropped);
+#endif
 	if (slirp)
 		LibSlirp::slirp_cleanup(slirp);
 }
@@ -239,9 +249,8 @@ bool SlirpEthernetConnection::Initialize(Section *dosbox_config)
 	config.disable_host_loopback = false;
 
 	// The maximum transmission and receive unit sizes.
-	constexpr auto ethernet_frame_size = 14 + 1500; // header + payload
-	config.if_mtu = ethernet_frame_size;
-	config.if_mru = ethernet_frame_size;
+	config.if_mtu = SlirpEthernetFrameSize;
+	config.if_mru = SlirpEthernetFrameSize;
 
 	config.enable_emu = false; // buggy - keep this at false
 	config.in_enabled = true;
@@ -284,6 +293,10 @@ bool SlirpEthernetConnection::Initialize(Section *dosbox_config)
 		ClearPortForwards(is_udp, forwarded_udp_ports);
 		forwarded_udp_ports = SetupPortForwards(is_udp, section->Get_string("udp_port_forwards"));
 
+#ifdef SLIRP_IO_THREAD
+		// From here on, only the I/O thread may call into libslirp
+		is_threaded = IoThreadStart();
+#endif
 		LOG_MSG("SLIRP: Successfully initialized");
 		return true;
 	} else {
@@ -435,11 +448,36 @@ void SlirpEthernetConnection::SendPacket(const uint8_t *packet, int len)
 		            len, GetMTU());
 		return;
 	}
+#ifdef SLIRP_IO_THREAD
+	if (is_threaded) {
+		const auto queued = tx_packets.BeginPush();
+		if (!queued) {
+			++num_tx_dropped;
+			return;
+		}
+		queued->len = len;
+		std::memcpy(queued->data.data(), packet, static_cast<size_t>(len));
+		tx_packets.CommitPush();
+		IoThreadWake();
+		return;
+	}
+#endif
 	LibSlirp::slirp_input(slirp, packet, len);
 }
 
 void SlirpEthernetConnection::GetPackets(std::function<int(const uint8_t *, int)> callback)
 {
+#ifdef SLIRP_IO_THREAD
+	// Only hand over what the I/O thread has already received; there's
+	// nothing to poll here
+	if (is_threaded) {
+		while (const auto received = rx_packets.Front()) {
+			callback(received->data.data(), received->len);
+			rx_packets.Pop();
+		}
+		return;
+	}
+#endif
 	get_packet_callback = callback;
 	uint32_t timeout_ms = 0;
 	PollsClear();
@@ -460,6 +498,19 @@ int SlirpEthernetConnection::ReceivePacket(const uint8_t *packet, int len)
 		            len, GetMRU());
 		return -1;
 	}
+#ifdef SLIRP_IO_THREAD
+	if (is_threaded) {
+		const auto queued = rx_packets.BeginPush();
+		if (!queued) {
+			++num_rx_dropped;
+			return -1;
+		}
+		queued->len = len;
+		std::memcpy(queued->data.data(), packet, static_cast<size_t>(len));
+		rx_packets.CommitPush();
+		return len;
+	}
+#endif
 	return get_packet_callback(packet, len);
 }
 
@@ -519,6 +570,12 @@ void SlirpEthernetConnection::PollRegister(const int fd)
 
 void SlirpEthernetConnection::PollUnregister(const int fd)
 {
+#ifdef SLIRP_IO_THREAD
+	// libslirp is about to close the socket. Forget about it now, as its
+	// number could be reused by a new socket we'd think is already watched.
+	if (fd >= 0 && io.watched_fds.erase(fd))
+		epoll_ctl(io.epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+#endif
 	// sentinels
 	if (fd < 0 || registered_fds.empty())
 		return;
@@ -532,6 +589,253 @@ void SlirpEthernetConnection::PollsAddRegistered()
 			PollAdd(fd, SLIRP_POLL_IN | SLIRP_POLL_OUT);
 }
 
+#ifdef SLIRP_IO_THREAD
+
+/* Begin the I/O thread.
+ * libslirp isn't thread-safe, so once the thread is running it's the only
+ * one calling into libslirp. It sleeps in epoll_wait() until a socket is
+ * ready, a libslirp timer expires, or the guest sends a packet.
+ * libslirp only offers a poll()-style API where it lists the descriptors it
+ * wants on every iteration, so we compare that list with the epoll set and
+ * only make system calls for the changes. */
+
+// How long to sleep if libslirp has nothing scheduled
+constexpr uint32_t MaxIoTimeoutMs = 1000;
+
+static void signal_eventfd(const int fd)
+{
+	constexpr uint64_t one = 1;
+	[[maybe_unused]] const auto ret = write(fd, &one, sizeof(one));
+}
+
+static void drain_eventfd(const int fd)
+{
+	uint64_t count = 0;
+	[[maybe_unused]] const auto ret = read(fd, &count, sizeof(count));
+}
+
+static uint32_t to_epoll_events(const int16_t poll_events)
+{
+	uint32_t epoll_events = 0;
+	if (poll_events & POLLIN)
+		epoll_events |= EPOLLIN;
+	if (poll_events & POLLOUT)
+		epoll_events |= EPOLLOUT;
+	if (poll_events & POLLPRI)
+		epoll_events |= EPOLLPRI;
+	return epoll_events;
+}
+
+static int16_t to_poll_events(const uint32_t epoll_events)
+{
+	int16_t poll_events = 0;
+	if (epoll_events & EPOLLIN)
+		poll_events |= POLLIN;
+	if (epoll_events & EPOLLOUT)
+		poll_events |= POLLOUT;
+	if (epoll_events & EPOLLPRI)
+		poll_events |= POLLPRI;
+	if (epoll_events & EPOLLERR)
+		poll_events |= POLLERR;
+	if (epoll_events & EPOLLHUP)
+		poll_events |= POLLHUP;
+	return poll_events;
+}
+
+// Adds or modifies a descriptor in the epoll set, whichever it needs
+static bool epoll_watch(const int epoll_fd, const int fd, const uint32_t events,
+                        const bool is_watched)
+{
+	epoll_event event = {};
+	event.events      = events;
+	event.data.fd     = fd;
+
+	const auto op = is_watched ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+	if (epoll_ctl(epoll_fd, op, fd, &event) == 0)
+		return true;
+
+	if (errno == EEXIST)
+		return epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event) == 0;
+	if (errno == ENOENT)
+		return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0;
+	return false;
+}
+
+bool SlirpEthernetConnection::IoThreadStart()
+{
+	io.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	io.wake_fd  = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	io.timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+	const auto is_ready = io.epoll_fd >= 0 && io.wake_fd >= 0 &&
+	                      io.timer_fd >= 0 &&
+	                      epoll_watch(io.epoll_fd, io.wake_fd, EPOLLIN, false) &&
+	                      epoll_watch(io.epoll_fd, io.timer_fd, EPOLLIN, false);
+	if (!is_ready) {
+		LOG_WARNING("SLIRP: Failed to set up the I/O thread: %s, polling on every tick instead",
+		            strerror(errno));
+		IoThreadStop();
+		return false;
+	}
+
+	io.should_quit = false;
+	io.thread = std::thread(&SlirpEthernetConnection::IoThreadLoop, this);
+	set_thread_name(io.thread, "dosbox:slirp");
+	return true;
+}
+
+void SlirpEthernetConnection::IoThreadStop()
+{
+	if (io.thread.joinable()) {
+		io.should_quit = true;
+		signal_eventfd(io.wake_fd);
+		io.thread.join();
+	}
+	for (auto fd : {&io.epoll_fd, &io.wake_fd, &io.timer_fd}) {
+		if (*fd >= 0) {
+			close(*fd);
+			*fd = -1;
+		}
+	}
+	io.watched_fds.clear();
+	io.timer_expires_ns = 0;
+}
+
+void SlirpEthernetConnection::IoThreadWake()
+{
+	// One wake-up covers every packet queued before the I/O thread gets
+	// round to clearing the flag
+	if (!io.is_wake_pending.exchange(true))
+		signal_eventfd(io.wake_fd);
+}
+
+void SlirpEthernetConnection::IoThreadLoop()
+{
+	while (!io.should_quit) {
+		IoForwardSentPackets();
+		TimersRun();
+
+		// libslirp shortens the timeout if it has work of its own due
+		uint32_t timeout_ms = MaxIoTimeoutMs;
+		PollsClear();
+		LibSlirp::slirp_pollfds_fill(slirp, &timeout_ms, db_slirp_add_poll, this);
+
+		IoWatchPolls();
+		IoArmTimer();
+		IoPoll(static_cast<int>(std::min(timeout_ms, MaxIoTimeoutMs)));
+	}
+}
+
+void SlirpEthernetConnection::IoForwardSentPackets()
+{
+	// This must be an exchange rather than a plain store: reading the
+	// flag SendPacket set is what makes the packets it queued before
+	// setting it visible here
+	io.is_wake_pending.exchange(false);
+
+	while (const auto queued = tx_packets.Front()) {
+		LibSlirp::slirp_input(slirp, queued->data.data(), queued->len);
+		tx_packets.Pop();
+	}
+}
+
+void SlirpEthernetConnection::IoWatchPolls()
+{
+	for (auto& [fd, watched] : io.watched_fds) {
+		watched.wanted_events = 0;
+		watched.is_wanted     = false;
+	}
+	for (const auto& wanted : polls) {
+		auto& watched = io.watched_fds[wanted.fd];
+		watched.wanted_events |= to_epoll_events(wanted.events);
+		watched.is_wanted = true;
+	}
+
+	// Level-triggered epoll would keep waking us up for sockets libslirp
+	// isn't interested in right now (such as one it has stopped reading
+	// while the guest catches up), so those are removed from the set
+	for (auto it = io.watched_fds.begin(); it != io.watched_fds.end();) {
+		const auto fd = it->first;
+		auto& watched = it->second;
+
+		if (!watched.is_wanted) {
+			epoll_ctl(io.epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+			it = io.watched_fds.erase(it);
+			continue;
+		}
+		if (!watched.is_watched || watched.wanted_events != watched.epoll_events) {
+			watched.is_watched = epoll_watch(io.epoll_fd,
+			                                 fd,
+			                                 watched.wanted_events,
+			                                 watched.is_watched);
+			watched.epoll_events = watched.wanted_events;
+		}
+		++it;
+	}
+}
+
+void SlirpEthernetConnection::IoArmTimer()
+{
+	int64_t expires_ns = 0;
+	for (const auto timer : timers)
+		if (timer->expires_ns && (!expires_ns || timer->expires_ns < expires_ns))
+			expires_ns = timer->expires_ns;
+
+	if (expires_ns == io.timer_expires_ns)
+		return;
+	io.timer_expires_ns = expires_ns;
+
+	// An all-zero value disarms the timer
+	itimerspec spec = {};
+	if (expires_ns) {
+		constexpr int64_t ns_per_s = 1'000'000'000;
+
+		// Zero would disarm it, so overdue timers fire right away instead
+		const auto delay_ns = std::max(expires_ns - db_slirp_clock_get_ns(nullptr),
+		                               int64_t{1});
+		spec.it_value.tv_sec  = static_cast<time_t>(delay_ns / ns_per_s);
+		spec.it_value.tv_nsec = static_cast<long>(delay_ns % ns_per_s);
+	}
+	timerfd_settime(io.timer_fd, 0, &spec, nullptr);
+}
+
+void SlirpEthernetConnection::IoPoll(const int timeout_ms)
+{
+	constexpr int MaxEvents = 64;
+	std::array<epoll_event, MaxEvents> events = {};
+
+	const auto num_events = epoll_wait(io.epoll_fd, events.data(), MaxEvents, timeout_ms);
+
+	io.ready_fds.clear();
+	for (auto i = 0; i < num_events; ++i) {
+		const auto fd = events[static_cast<size_t>(i)].data.fd;
+		if (fd == io.wake_fd) {
+			drain_eventfd(io.wake_fd);
+		} else if (fd == io.timer_fd) {
+			drain_eventfd(io.timer_fd);
+			// The timer is disarmed now, so it needs re-arming even
+			// if the expiry of the next libslirp timer is unchanged
+			io.timer_expires_ns = 0;
+		} else {
+			io.ready_fds[fd] |= to_poll_events(events[static_cast<size_t>(i)].events);
+		}
+	}
+
+	// Report back as poll() would, so PollGetSlirpRevents works as is
+	for (auto& p : polls) {
+		const auto ready = io.ready_fds.find(p.fd);
+		p.revents = (ready == io.ready_fds.end())
+		                  ? 0
+		                  : static_cast<int16_t>(ready->second &
+		                                         (p.events | POLLERR | POLLHUP));
+	}
+
+	const bool poll_failed = (num_events < 0);
+	LibSlirp::slirp_pollfds_poll(slirp, poll_failed, db_slirp_get_revents, this);
+}
+
+#endif // SLIRP_IO_THREAD
+
 /* Begin the bulk of the platform-specific code.
  * This mostly involves handling data structures and mapping
  * libslirp's view of our polling system to whatever we use
@@ -23,14 +23,19 @@
 
 #include "dosbox.h"
 
+#include <array>
+#include <atomic>
 #include <map>
 #include <deque>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include <slirp/libslirp.h>
 
 #include "config.h"
 #include "ethernet.h"
+#include "spsc_ring.h"
 
 /*
  * libslirp really wants a poll() API, so we'll use that when we're
@@ -44,6 +49,28 @@
 #include <poll.h>
 #endif
 
+/*
+ * On Linux, libslirp runs on its own I/O thread that sleeps in epoll_wait()
+ * until a socket, a libslirp timer, or a packet from the guest needs
+ * attention. Elsewhere it's polled from the emulation thread every tick.
+ */
+#if defined(LINUX)
+#define SLIRP_IO_THREAD 1
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
+// The largest Ethernet frame we pass in either direction: header + payload
+constexpr int SlirpEthernetFrameSize = 14 + 1500;
+
+/** An Ethernet frame queued between the guest and libslirp */
+struct slirp_packet {
+	int len = 0;
+	std::array<uint8_t, SlirpEthernetFrameSize> data = {};
+};
+
 /** A libslirp timer
  * libslirp has to simulate periodic tasks such as IPv6 router
  * advertisements. It does this by giving us a callback and expiry
@@ -113,6 +140,52 @@ private:
 	void PollsClear();
 	bool PollsPoll(uint32_t timeout_ms);
 
+#ifdef SLIRP_IO_THREAD
+	/* Runs libslirp on the I/O thread */
+	bool IoThreadStart();
+	void IoThreadStop();
+	void IoThreadLoop();
+	void IoThreadWake();
+	void IoForwardSentPackets();
+	void IoWatchPolls();
+	void IoArmTimer();
+	void IoPoll(int timeout_ms);
+
+	struct watched_fd {
+		uint32_t epoll_events = 0;  /*!< What epoll is watching for */
+		uint32_t wanted_events = 0; /*!< What libslirp asked for this time */
+		bool is_watched = false;
+		bool is_wanted = false;
+	};
+
+	struct {
+		std::thread thread = {};
+		std::atomic<bool> should_quit = false;
+		std::atomic<bool> is_wake_pending = false;
+
+		int epoll_fd = -1; /*!< Waits on everything below */
+		int wake_fd = -1;  /*!< eventfd, signalled by SendPacket */
+		int timer_fd = -1; /*!< timerfd, armed for the next libslirp timer */
+		int64_t timer_expires_ns = 0;
+
+		// Sockets in the epoll set, and those epoll_wait() reported
+		std::unordered_map<int, watched_fd> watched_fds = {};
+		std::unordered_map<int, int16_t> ready_fds = {};
+	} io = {};
+
+	/** Packets between the guest and the I/O thread
+	 * The emulation thread produces into tx_packets and consumes from
+	 * rx_packets; the I/O thread does the opposite. Packets that don't
+	 * fit are dropped, just like on a congested physical network.
+	 */
+	bool is_threaded = false;
+	static constexpr size_t PacketQueueSize = 256;
+	SpscRing<slirp_packet, PacketQueueSize> rx_packets = {};
+	SpscRing<slirp_packet, PacketQueueSize> tx_packets = {};
+	int num_rx_dropped = 0; /*!< Only touched by the I/O thread */
+	int num_tx_dropped = 0; /*!< Only touched by the emulation thread */
+#endif
+
 	Slirp *slirp = nullptr;        /*!< Handle to libslirp */
 	SlirpConfig config = {};       /*!< Configuration passed to libslirp */
 	SlirpCb slirp_callbacks = {};  /*!< Callbacks used by libslirp */
@@ -20,7 +20,9 @@
 
 #include "rwqueue.h"
 
+#include "../capture/capture_video.h"
 #include "../capture/image/image_saver.h"
+#include "../hardware/voodoo.h"
 
 #include <cassert>
 
@@ -323,6 +325,27 @@ size_t RWQueue<T>::BulkDequeue(T* const into_target, const size_t num_requested)
 	return (num_requested - num_remaining);
 }
 
+template <typename T>
+size_t RWQueue<T>::NonblockingBulkDequeue(std::vector<T>& into_target,
+                                          const size_t num_requested)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	const auto num_items = std::min(queue.size(), num_requested);
+	into_target.resize(num_items);
+
+	const auto queue_end = queue.begin() + static_cast<difference_t>(num_items);
+	std::move(queue.begin(), queue_end, into_target.begin());
+	queue.erase(queue.begin(), queue_end);
+
+	lock.unlock();
+	if (num_items > 0) {
+		// notify the first waiting thread that the queue has room
+		has_room.notify_one();
+	}
+	return num_items;
+}
+
 // Explicit template instantiations
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 #include <vector>
@@ -340,6 +363,12 @@ template class RWQueue<MidiWork>;
 #include "render.h"
 template class RWQueue<SaveImageTask>;
 
+// Video capture
+template class RWQueue<VideoCaptureTask>;
+
+// Voodoo command FIFO
+template class RWQueue<VoodooWrite>;
+
 //PC Speaker
 template class RWQueue<float>;
 
@@ -0,0 +1,154 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2025  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "dma.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "mem.h"
+
+#include "dosbox_test_fixture.h"
+
+namespace {
+
+using Bytes = std::vector<uint8_t>;
+
+// Not used by any device the test fixture sets up
+constexpr uint8_t ChannelNum = 3;
+
+// The transfers start in this 64 KB page
+constexpr uint8_t Page     = 0x01;
+constexpr PhysPt PageStart = Page << 16;
+
+class DmaChannelTest : public DOSBoxTestFixture {
+protected:
+	void SetUp() override
+	{
+		DOSBoxTestFixture::SetUp();
+
+		for (PhysPt i = 0; i < 0x2000; ++i) {
+			phys_writeb(PageStart + i, static_cast<uint8_t>(i * 13));
+		}
+
+		channel = DMA_GetChannel(ChannelNum);
+		ASSERT_NE(channel, nullptr);
+	}
+
+	void Program(const uint16_t addr, const uint16_t num_bytes, const bool autoinit)
+	{
+		channel->SetPage(Page);
+		channel->base_addr      = addr;
+		channel->curr_addr      = addr;
+		channel->base_count     = num_bytes - 1;
+		channel->curr_count     = num_bytes - 1;
+		channel->is_autoiniting = autoinit;
+		channel->is_masked      = false;
+	}
+
+	Bytes ReadSpans(const size_t num_bytes, int& num_spans)
+	{
+		Bytes bytes = {};
+		num_spans   = 0;
+
+		const auto num_read = channel->ReadSpans(
+		        num_bytes, [&](const std::span<const uint8_t> span) {
+			        bytes.insert(bytes.end(), span.begin(), span.end());
+			        ++num_spans;
+		        });
+
+		EXPECT_EQ(num_read, bytes.size());
+		return bytes;
+	}
+
+	Bytes Expected(const uint16_t addr, const size_t num_bytes)
+	{
+		Bytes bytes = {};
+		for (size_t i = 0; i < num_bytes; ++i) {
+			bytes.push_back(phys_readb(PageStart + addr + i));
+		}
+		return bytes;
+	}
+
+	DmaChannel* channel = nullptr;
+};
+
+TEST_F(DmaChannelTest, ReadSpansWithinPage)
+{
+	Program(0x0100, 64, false);
+
+	int num_spans    = 0;
+	const auto bytes = ReadSpans(64, num_spans);
+
+	EXPECT_EQ(bytes, Expected(0x0100, 64));
+	EXPECT_EQ(num_spans, 1);
+	EXPECT_TRUE(channel->is_masked);
+}
+
+TEST_F(DmaChannelTest, ReadSpansSplitsAtPageBoundary)
+{
+	Program(0x0ff0, 64, false);
+
+	int num_spans    = 0;
+	const auto bytes = ReadSpans(64, num_spans);
+
+	EXPECT_EQ(bytes, Expected(0x0ff0, 64));
+	EXPECT_EQ(num_spans, 2);
+}
+
+TEST_F(DmaChannelTest, ReadSpansWrapsInAutoInit)
+{
+	Program(0x0200, 32, true);
+
+	int num_spans    = 0;
+	const auto bytes = ReadSpans(48, num_spans);
+
+	auto expected = Expected(0x0200, 32);
+	const auto restarted = Expected(0x0200, 16);
+	expected.insert(expected.end(), restarted.begin(), restarted.end());
+
+	EXPECT_EQ(bytes, expected);
+	EXPECT_EQ(num_spans, 2);
+	EXPECT_EQ(channel->curr_count, 15);
+	EXPECT_EQ(channel->curr_addr, 0x0200 + 16);
+	EXPECT_FALSE(channel->is_masked);
+}
+
+TEST_F(DmaChannelTest, ReadSpansMatchesRead)
+{
+	Program(0x0fc0, 256, true);
+
+	int num_spans       = 0;
+	const auto spans    = ReadSpans(300, num_spans);
+	const auto end_addr = channel->curr_addr;
+
+	Program(0x0fc0, 256, true);
+
+	Bytes copied(300);
+	EXPECT_EQ(channel->Read(copied.size(), copied.data()), copied.size());
+
+	EXPECT_EQ(spans, copied);
+	EXPECT_EQ(channel->curr_addr, end_addr);
+}
+
+} // namespace
@@ -39,6 +39,7 @@
 
 #include <gtest/gtest.h>
 
+#include <array>
 #include <string>
 
 std::string run_Set_Label(char const * const input, bool cdrom) {
@@ -226,4 +227,92 @@ TEST(Set_Label, InvalidCharsEndingDotCD)
     EXPECT_EQ("?*':&@(..", output);
 }
 
+static std::array<uint8_t, ISO_FRAMESIZE> make_sector(const uint8_t fill)
+{
+    std::array<uint8_t, ISO_FRAMESIZE> sector = {};
+    sector.fill(fill);
+    return sector;
+}
+
+TEST(IsoSectorCache, HitsAndMisses)
+{
+    IsoSectorCache cache(4);
+    EXPECT_EQ(cache.Find(16), nullptr);
+
+    const auto sector = make_sector(0xab);
+    cache.Insert(16, sector.data());
+
+    const auto data = cache.Find(16);
+    ASSERT_NE(data, nullptr);
+    EXPECT_EQ(data[0], 0xab);
+    EXPECT_EQ(data[ISO_FRAMESIZE - 1], 0xab);
+
+    EXPECT_EQ(cache.GetHits(), 1u);
+    EXPECT_EQ(cache.GetMisses(), 1u);
+}
+
+TEST(IsoSectorCache, InsertReturnsCachedCopy)
+{
+    IsoSectorCache cache(4);
+    const auto sector = make_sector(0x5a);
+
+    const auto data = cache.Insert(16, sector.data());
+    ASSERT_NE(data, nullptr);
+    EXPECT_NE(data, sector.data());
+    EXPECT_EQ(data[0], 0x5a);
+    EXPECT_EQ(cache.Find(16), data);
+
+    // Inserting isn't a lookup, so only the Find() above counts
+    EXPECT_EQ(cache.GetHits(), 1u);
+    EXPECT_EQ(cache.GetMisses(), 0u);
+}
+
+TEST(IsoSectorCache, EvictsLeastRecentlyUsed)
+{
+    IsoSectorCache cache(3);
+    for (uint8_t i = 0; i < 3; ++i) {
+        const auto sector = make_sector(i);
+        cache.Insert(i, sector.data());
+    }
+    // Touch sector 0 so sector 1 becomes the least-recently used
+    EXPECT_NE(cache.Find(0), nullptr);
+
+    const auto sector = make_sector(3);
+    cache.Insert(3, sector.data());
+
+    EXPECT_EQ(cache.GetSize(), 3u);
+    EXPECT_NE(cache.Find(0), nullptr);
+    EXPECT_EQ(cache.Find(1), nullptr);
+    EXPECT_NE(cache.Find(2), nullptr);
+    EXPECT_EQ(cache.Find(3)[0], 3);
+}
+
+TEST(IsoSectorCache, ReinsertUpdatesData)
+{
+    IsoSectorCache cache(2);
+    const auto old_sector = make_sector(1);
+    const auto new_sector = make_sector(2);
+    cache.Insert(7, old_sector.data());
+    cache.Insert(7, new_sector.data());
+
+    EXPECT_EQ(cache.GetSize(), 1u);
+    EXPECT_EQ(cache.Find(7)[0], 2);
+}
+
+TEST(IsoSectorCache, ShrinkKeepsMostRecent)
+{
+    IsoSectorCache cache(4);
+    for (uint8_t i = 0; i < 4; ++i) {
+        const auto sector = make_sector(i);
+        cache.Insert(i, sector.data());
+    }
+    cache.Resize(2);
+
+    EXPECT_EQ(cache.GetCapacity(), 2u);
+    EXPECT_EQ(cache.Find(0), nullptr);
+    EXPECT_EQ(cache.Find(1), nullptr);
+    EXPECT_NE(cache.Find(2), nullptr);
+    EXPECT_NE(cache.Find(3), nullptr);
+}
+
 } // namespace
@@ -0,0 +1,357 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2025  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "dosbox.h"
+
+#if C_IPX
+
+#include "ipx.h"
+#include "ipxserver.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Two sockets on the loopback interface stand in for two DOSBox instances:
+// one sending IPX datagrams and one receiving them
+class IpxLoopback : public ::testing::Test {
+protected:
+	void SetUp() override
+	{
+		ASSERT_EQ(SDLNet_Init(), 0);
+
+		receiver = SDLNet_UDP_Open(0);
+		ASSERT_NE(receiver, nullptr);
+
+		// Channel -1 gives the address the socket is bound to
+		const auto bound = SDLNet_UDP_GetPeerAddress(receiver, -1);
+		ASSERT_NE(bound, nullptr);
+
+		IPaddress receiver_addr = {};
+		ASSERT_EQ(SDLNet_ResolveHost(&receiver_addr,
+		                             "127.0.0.1",
+		                             SDLNet_Read16(&bound->port)),
+		          0);
+
+		sender = SDLNet_UDP_Open(0);
+		ASSERT_NE(sender, nullptr);
+		sender_channel = SDLNet_UDP_Bind(sender, -1, &receiver_addr);
+		ASSERT_GE(sender_channel, 0);
+	}
+
+	void TearDown() override
+	{
+		SDLNet_UDP_Close(sender);
+		SDLNet_UDP_Close(receiver);
+		SDLNet_Quit();
+	}
+
+	// Sends packets carrying consecutive sequence numbers
+	void Send(const int num_packets)
+	{
+		for (auto i = 0; i < num_packets; ++i, ++next_sent) {
+			std::vector<uint8_t> data(PacketSize, static_cast<uint8_t>(next_sent));
+			std::memcpy(data.data(), &next_sent, sizeof(next_sent));
+
+			UDPpacket packet = {};
+			packet.channel   = sender_channel;
+			packet.data      = data.data();
+			packet.len       = PacketSize;
+			packet.maxlen    = PacketSize;
+			ASSERT_EQ(SDLNet_UDP_Send(sender, sender_channel, &packet), 1);
+		}
+	}
+
+	// Receives up to max_packets, checking they arrive complete and in
+	// order
+	int Receive(const int max_packets)
+	{
+		return IPX_ReceivePendingPackets(
+		        receiver,
+		        -1,
+		        buffer,
+		        IPXBUFFERSIZE,
+		        max_packets,
+		        [this](uint8_t* data, const int len) {
+			        uint32_t seq = 0;
+			        std::memcpy(&seq, data, sizeof(seq));
+			        EXPECT_EQ(len, PacketSize);
+			        EXPECT_EQ(seq, next_received);
+			        next_received = seq + 1;
+			        return true;
+		        });
+	}
+
+	static constexpr int PacketSize = 64;
+
+	UDPsocket sender   = nullptr;
+	UDPsocket receiver = nullptr;
+	int sender_channel = -1;
+
+	uint32_t next_sent     = 0;
+	uint32_t next_received = 0;
+
+	uint8_t buffer[IPXBUFFERSIZE] = {};
+};
+
+TEST_F(IpxLoopback, ReceivesAllQueuedPacketsAtOnce)
+{
+	Send(20);
+	EXPECT_EQ(Receive(64), 20);
+	EXPECT_EQ(next_received, 20);
+
+	// Nothing left
+	EXPECT_EQ(Receive(64), 0);
+}
+
+TEST_F(IpxLoopback, KeepsToTheBudget)
+{
+	Send(20);
+	EXPECT_EQ(Receive(8), 8);
+	EXPECT_EQ(Receive(8), 8);
+	EXPECT_EQ(Receive(8), 4);
+	EXPECT_EQ(next_received, 20);
+}
+
+TEST_F(IpxLoopback, StopsWhenAPacketIsRefused)
+{
+	Send(5);
+
+	auto num_seen = 0;
+	const auto num_received = IPX_ReceivePendingPackets(
+	        receiver, -1, buffer, IPXBUFFERSIZE, 64, [&](uint8_t*, int) {
+		        return ++num_seen < 3;
+	        });
+	EXPECT_EQ(num_received, 3);
+
+	// The rest stay queued for the next call
+	next_received = 3;
+	EXPECT_EQ(Receive(64), 2);
+}
+
+TEST_F(IpxLoopback, PacketsPerSecond)
+{
+	// Stays well within the socket buffer, so none get dropped
+	constexpr int BurstSize = 32;
+	constexpr int NumBursts = 1000;
+
+	const auto start = std::chrono::steady_clock::now();
+
+	// A lost packet fails the test instead of hanging it
+	const auto deadline = start + std::chrono::seconds(30);
+
+	auto num_calls = 0;
+	for (auto burst = 0; burst < NumBursts; ++burst) {
+		Send(BurstSize);
+		while (next_received < next_sent) {
+			ASSERT_TRUE(std::chrono::steady_clock::now() < deadline)
+			        << "Timed out with " << next_received << " of "
+			        << next_sent << " packets received";
+			Receive(64);
+			++num_calls;
+		}
+	}
+
+	const auto elapsed_s = std::chrono::duration<double>(
+	                               std::chrono::steady_clock::now() - start)
+	                               .count();
+
+	EXPECT_EQ(next_received, BurstSize * NumBursts);
+
+	// With one receive call per emulated millisecond, this is how quickly
+	// the packets would reach the program
+	RecordProperty("packets_per_second",
+	               static_cast<int>(next_received / elapsed_s));
+	RecordProperty("packets_per_receive_call",
+	               static_cast<int>(next_received / num_calls));
+}
+
+// Clients registering with a relay server on the loopback interface and
+// sending each other packets through it
+class IpxServer : public ::testing::Test {
+protected:
+	void SetUp() override
+	{
+		ASSERT_EQ(SDLNet_Init(), 0);
+
+		// Any free port will do
+		for (uint16_t port = 21300; port < 21400 && !server_port; ++port) {
+			if (IPX_StartServer(port)) {
+				server_port = port;
+			}
+		}
+		ASSERT_NE(server_port, 0);
+		ASSERT_EQ(SDLNet_ResolveHost(&server_addr, "127.0.0.1", server_port), 0);
+
+		for (auto& client : clients) {
+			client.socket = SDLNet_UDP_Open(0);
+			ASSERT_NE(client.socket, nullptr);
+			Register(client);
+		}
+	}
+
+	void TearDown() override
+	{
+		IPX_StopServer();
+		for (auto& client : clients) {
+			SDLNet_UDP_Close(client.socket);
+		}
+		SDLNet_Quit();
+	}
+
+	struct Client {
+		UDPsocket socket = nullptr;
+
+		// The address the server knows the client by
+		PackedIP address = {};
+	};
+
+	void SendTo(const Client& client, const IPXHeader& header)
+	{
+		std::vector<uint8_t> data(PacketSize);
+		std::memcpy(data.data(), &header, sizeof(header));
+
+		UDPpacket packet = {};
+		packet.channel   = -1;
+		packet.data      = data.data();
+		packet.len       = PacketSize;
+		packet.maxlen    = PacketSize;
+		packet.address   = server_addr;
+		ASSERT_EQ(SDLNet_UDP_Send(client.socket, -1, &packet), 1);
+	}
+
+	// Waits a little while for a packet to arrive
+	bool Receive(const Client& client, IPXHeader& header)
+	{
+		uint8_t data[IPXBUFFERSIZE] = {};
+
+		UDPpacket packet = {};
+		packet.channel   = -1;
+		packet.data      = data;
+		packet.maxlen    = IPXBUFFERSIZE;
+
+		for (auto i = 0; i < 500; ++i) {
+			if (SDLNet_UDP_Recv(client.socket, &packet) > 0) {
+				EXPECT_GE(packet.len, static_cast<int>(sizeof(header)));
+				std::memcpy(&header, data, sizeof(header));
+				return true;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		}
+		return false;
+	}
+
+	void Register(Client& client)
+	{
+		IPXHeader header = {};
+		SDLNet_Write16(0x2, header.dest.socket);
+		SendTo(client, header);
+
+		IPXHeader ack = {};
+		ASSERT_TRUE(Receive(client, ack));
+		client.address = ack.dest.addr.byIP;
+	}
+
+	IPXHeader MakePacket(const Client& from, const PackedIP& to)
+	{
+		IPXHeader header       = {};
+		header.src.addr.byIP  = from.address;
+		header.dest.addr.byIP = to;
+		SDLNet_Write16(0x4000, header.dest.socket);
+		return header;
+	}
+
+	static constexpr int PacketSize = 128;
+
+	uint16_t server_port  = 0;
+	IPaddress server_addr = {};
+
+	Client clients[3] = {};
+};
+
+TEST_F(IpxServer, RegistersClients)
+{
+	const auto status = IPX_GetServerStatus();
+	EXPECT_EQ(status.peers.size(), 3);
+	EXPECT_EQ(status.num_received, 3);
+}
+
+TEST_F(IpxServer, RelaysToOneClient)
+{
+	SendTo(clients[0], MakePacket(clients[0], clients[2].address));
+
+	IPXHeader header = {};
+	ASSERT_TRUE(Receive(clients[2], header));
+	EXPECT_EQ(header.src.addr.byIP.port, clients[0].address.port);
+
+	EXPECT_FALSE(Receive(clients[1], header));
+
+	const auto status = IPX_GetServerStatus();
+	EXPECT_EQ(status.num_sent, 1);
+	EXPECT_EQ(status.num_dropped, 0);
+}
+
+TEST_F(IpxServer, BroadcastsToOtherClients)
+{
+	PackedIP broadcast = {};
+	broadcast.host     = 0xffffffff;
+	broadcast.port     = 0xffff;
+	SendTo(clients[1], MakePacket(clients[1], broadcast));
+
+	IPXHeader header = {};
+	EXPECT_TRUE(Receive(clients[0], header));
+	EXPECT_TRUE(Receive(clients[2], header));
+	EXPECT_FALSE(Receive(clients[1], header));
+
+	const auto status = IPX_GetServerStatus();
+	EXPECT_EQ(status.num_sent, 2);
+
+	for (const auto& peer : status.peers) {
+		const auto is_sender = peer.address.port == clients[1].address.port;
+		EXPECT_EQ(peer.num_packets, is_sender ? 1 : 0);
+		EXPECT_GE(peer.max_latency_ms, peer.average_latency_ms);
+	}
+}
+
+TEST_F(IpxServer, DropsPacketsForUnknownClients)
+{
+	PackedIP nobody = {};
+	nobody.host     = 0x0100007f;
+	nobody.port     = 1;
+	SendTo(clients[0], MakePacket(clients[0], nobody));
+
+	// Wait for the server to get to it
+	for (auto i = 0; i < 500 && IPX_GetServerStatus().num_dropped == 0; ++i) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	}
+	const auto status = IPX_GetServerStatus();
+	EXPECT_EQ(status.num_dropped, 1);
+	EXPECT_EQ(status.num_sent, 0);
+}
+
+} // namespace
+
+#endif // C_IPX
@@ -0,0 +1,341 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2025  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "../src/audio/polyphase_resampler.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <numbers>
+#include <vector>
+
+#include <speex/speex_resampler.h>
+
+namespace {
+
+using Frames = std::vector<AudioFrame>;
+
+constexpr auto Amplitude = 16000.0;
+
+constexpr auto LeftFreqHz  = 1000.0;
+constexpr auto RightFreqHz = 3000.0;
+
+Frames make_sines(const int rate_hz, const int num_frames)
+{
+	Frames frames(num_frames);
+	for (int i = 0; i < num_frames; ++i) {
+		const auto t = static_cast<double>(i) / rate_hz;
+
+		frames[i] = {static_cast<float>(
+		                     Amplitude *
+		                     std::sin(2 * std::numbers::pi * LeftFreqHz * t)),
+		             static_cast<float>(
+		                     Amplitude *
+		                     std::sin(2 * std::numbers::pi * RightFreqHz * t))};
+	}
+	return frames;
+}
+
+Frames resample(PolyphaseResampler& resampler, const Frames& in,
+                const size_t chunk_size)
+{
+	Frames out = {};
+	for (size_t i = 0; i < in.size(); i += chunk_size) {
+		const auto n = std::min(chunk_size, in.size() - i);
+		resampler.Process({in.data() + i, n}, out);
+	}
+	return out;
+}
+
+// Fits a sine at 'freq_hz' plus DC to one channel with least squares, and
+// returns everything else (distortion, aliasing, and noise) relative to the
+// fitted sine in dB
+double measure_thd_n_db(const Frames& frames, const size_t channel,
+                        const double freq_hz, const int rate_hz)
+{
+	// Skip the start-up and run-out transients
+	const size_t skip = 512;
+	assert(frames.size() > skip * 2);
+
+	double m[3][3] = {};
+	double v[3]    = {};
+
+	auto basis = [&](const size_t i, double b[3]) {
+		const auto w = 2 * std::numbers::pi * freq_hz * i / rate_hz;
+		b[0]         = std::sin(w);
+		b[1]         = std::cos(w);
+		b[2]         = 1.0;
+	};
+
+	for (size_t i = skip; i < frames.size() - skip; ++i) {
+		double b[3];
+		basis(i, b);
+		for (int r = 0; r < 3; ++r) {
+			for (int c = 0; c < 3; ++c) {
+				m[r][c] += b[r] * b[c];
+			}
+			v[r] += b[r] * frames[i][channel];
+		}
+	}
+
+	auto det = [](const double a[3][3]) {
+		return a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1]) -
+		       a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0]) +
+		       a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+	};
+
+	// Cramer's rule
+	double x[3]       = {};
+	const auto m_det = det(m);
+	for (int c = 0; c < 3; ++c) {
+		double mc[3][3];
+		std::copy(&m[0][0], &m[0][0] + 9, &mc[0][0]);
+		for (int r = 0; r < 3; ++r) {
+			mc[r][c] = v[r];
+		}
+		x[c] = det(mc) / m_det;
+	}
+
+	double signal   = 0.0;
+	double residual = 0.0;
+	for (size_t i = skip; i < frames.size() - skip; ++i) {
+		double b[3];
+		basis(i, b);
+		const auto fitted = x[0] * b[0] + x[1] * b[1] + x[2] * b[2];
+		signal += fitted * fitted;
+		residual += (frames[i][channel] - fitted) * (frames[i][channel] - fitted);
+	}
+	return 10 * std::log10(residual / signal);
+}
+
+struct Ratio {
+	int in_rate_hz;
+	int out_rate_hz;
+};
+
+// Exact phases, interpolated phases, and downsampling
+constexpr Ratio Ratios[] = {{44100, 48000}, {49716, 48000}, {22050, 48000}, {48000, 44100}};
+
+TEST(PolyphaseResampler, PassesDcThrough)
+{
+	for (const auto [in_rate_hz, out_rate_hz] : Ratios) {
+		PolyphaseResampler resampler(in_rate_hz,
+		                             out_rate_hz,
+		                             PolyphaseQuality::Medium);
+
+		const auto out = resample(resampler, Frames(4096, {1000.0f, -500.0f}), 4096);
+		ASSERT_GT(out.size(), 2048u);
+
+		// Skip the frames still blending with the primed silence
+		for (size_t i = 256; i < out.size(); ++i) {
+			EXPECT_NEAR(out[i].left, 1000.0f, 0.01f);
+			EXPECT_NEAR(out[i].right, -500.0f, 0.01f);
+		}
+	}
+}
+
+TEST(PolyphaseResampler, OutputLengthFollowsRatio)
+{
+	for (const auto [in_rate_hz, out_rate_hz] : Ratios) {
+		PolyphaseResampler resampler(in_rate_hz,
+		                             out_rate_hz,
+		                             PolyphaseQuality::Medium);
+
+		const auto out = resample(resampler, Frames(in_rate_hz), 1000);
+
+		// The last 'latency' input frames are still buffered
+		const auto expected = static_cast<double>(in_rate_hz -
+		                                          resampler.GetInputLatency()) *
+		                      out_rate_hz / in_rate_hz;
+
+		EXPECT_NEAR(static_cast<double>(out.size()), expected, 1.0);
+	}
+}
+
+TEST(PolyphaseResampler, ChunkSizeDoesNotChangeOutput)
+{
+	for (const auto [in_rate_hz, out_rate_hz] : Ratios) {
+		const auto in = make_sines(in_rate_hz, 5000);
+
+		PolyphaseResampler whole(in_rate_hz, out_rate_hz, PolyphaseQuality::High);
+		PolyphaseResampler chunked(in_rate_hz, out_rate_hz, PolyphaseQuality::High);
+
+		EXPECT_EQ(resample(whole, in, in.size()), resample(chunked, in, 37));
+	}
+}
+
+TEST(PolyphaseResampler, ResetRestartsStream)
+{
+	const auto in = make_sines(44100, 3000);
+
+	PolyphaseResampler resampler(44100, 48000, PolyphaseQuality::Low);
+
+	const auto first = resample(resampler, in, 100);
+	resampler.Reset();
+	const auto second = resample(resampler, in, 100);
+
+	EXPECT_EQ(first, second);
+}
+
+TEST(PolyphaseResampler, SharesCoefficientsBetweenEqualRatios)
+{
+	PolyphaseResampler a(44100, 48000, PolyphaseQuality::Medium);
+	PolyphaseResampler b(88200, 96000, PolyphaseQuality::Medium);
+	PolyphaseResampler c(44100, 48000, PolyphaseQuality::High);
+	PolyphaseResampler d(48000, 44100, PolyphaseQuality::Medium);
+
+	EXPECT_EQ(a.GetCoefficients(), b.GetCoefficients());
+	EXPECT_NE(a.GetCoefficients(), c.GetCoefficients());
+	EXPECT_NE(a.GetCoefficients(), d.GetCoefficients());
+
+	b.SetRates(22050, 48000);
+	EXPECT_NE(a.GetCoefficients(), b.GetCoefficients());
+}
+
+TEST(PolyphaseResampler, OversamplesLargePhaseCounts)
+{
+	PolyphaseResampler exact(44100, 48000, PolyphaseQuality::Medium);
+	PolyphaseResampler interpolated(49716, 48000, PolyphaseQuality::Medium);
+
+	EXPECT_FALSE(exact.GetCoefficients()->is_interpolated);
+	EXPECT_TRUE(interpolated.GetCoefficients()->is_interpolated);
+
+	// Downsampling lengthens the filter
+	EXPECT_GT(interpolated.GetCoefficients()->num_taps,
+	          exact.GetCoefficients()->num_taps);
+}
+
+void expect_thd_n_below(const PolyphaseQuality quality, const double max_db)
+{
+	for (const auto [in_rate_hz, out_rate_hz] : Ratios) {
+		PolyphaseResampler resampler(in_rate_hz, out_rate_hz, quality);
+
+		const auto out = resample(resampler, make_sines(in_rate_hz, in_rate_hz), 512);
+
+		EXPECT_LT(measure_thd_n_db(out, 0, LeftFreqHz, out_rate_hz), max_db)
+		        << in_rate_hz << " -> " << out_rate_hz << " Hz";
+		EXPECT_LT(measure_thd_n_db(out, 1, RightFreqHz, out_rate_hz), max_db)
+		        << in_rate_hz << " -> " << out_rate_hz << " Hz";
+	}
+}
+
+TEST(PolyphaseResampler, LowQualityDistortion)
+{
+	expect_thd_n_below(PolyphaseQuality::Low, -70.0);
+}
+
+TEST(PolyphaseResampler, MediumQualityDistortion)
+{
+	expect_thd_n_below(PolyphaseQuality::Medium, -95.0);
+}
+
+TEST(PolyphaseResampler, HighQualityDistortion)
+{
+	expect_thd_n_below(PolyphaseQuality::High, -115.0);
+}
+
+// Throughput and distortion compared with Speex, which the mixer uses by
+// default. Disabled because it takes a few seconds and only prints results;
+// run it with:
+//
+//   ./tests/polyphase_resampler --gtest_also_run_disabled_tests
+//
+TEST(PolyphaseResampler, DISABLED_BenchmarkAgainstSpeex)
+{
+	using namespace std::chrono;
+
+	constexpr auto NumSeconds = 10;
+
+	auto report = [](const char* name, const Ratio ratio,
+	                 const duration<double> elapsed, const Frames& out) {
+		const auto mframes_per_s = NumSeconds * ratio.in_rate_hz /
+		                           elapsed.count() / 1e6;
+		printf("%-18s %6d -> %6d Hz: %7.1f Mframes/s, THD+N %6.1f dB\n",
+		       name,
+		       ratio.in_rate_hz,
+		       ratio.out_rate_hz,
+		       mframes_per_s,
+		       measure_thd_n_db(out, 0, LeftFreqHz, ratio.out_rate_hz));
+	};
+
+	// The mixer feeds the resamplers roughly a millisecond at a time
+	for (const auto ratio : Ratios) {
+		const auto in = make_sines(ratio.in_rate_hz, ratio.in_rate_hz * NumSeconds);
+		const auto chunk_size = static_cast<size_t>(ratio.in_rate_hz / 1000);
+
+		for (const auto quality : {PolyphaseQuality::Low,
+		                           PolyphaseQuality::Medium,
+		                           PolyphaseQuality::High}) {
+			PolyphaseResampler resampler(ratio.in_rate_hz,
+			                             ratio.out_rate_hz,
+			                             quality);
+
+			const auto start = steady_clock::now();
+			const auto out   = resample(resampler, in, chunk_size);
+			const auto name  = quality == PolyphaseQuality::Low ? "polyphase-low"
+			                   : quality == PolyphaseQuality::Medium
+			                           ? "polyphase-medium"
+			                           : "polyphase-high";
+			report(name, ratio, steady_clock::now() - start, out);
+		}
+
+		for (const auto speex_quality : {3, 5, 8}) {
+			auto state = speex_resampler_init(2,
+			                                  ratio.in_rate_hz,
+			                                  ratio.out_rate_hz,
+			                                  speex_quality,
+			                                  nullptr);
+			ASSERT_NE(state, nullptr);
+			speex_resampler_skip_zeros(state);
+
+			Frames out  = {};
+			const auto start = steady_clock::now();
+			for (size_t i = 0; i < in.size(); i += chunk_size) {
+				spx_uint32_t in_len = static_cast<spx_uint32_t>(
+				        std::min(chunk_size, in.size() - i));
+				spx_uint32_t out_len = in_len * ratio.out_rate_hz /
+				                               ratio.in_rate_hz +
+				                       2;
+
+				const auto prev_size = out.size();
+				out.resize(prev_size + out_len);
+				speex_resampler_process_interleaved_float(
+				        state,
+				        reinterpret_cast<const float*>(in.data() + i),
+				        &in_len,
+				        reinterpret_cast<float*>(out.data() + prev_size),
+				        &out_len);
+				out.resize(prev_size + out_len);
+			}
+			const auto elapsed = steady_clock::now() - start;
+			speex_resampler_destroy(state);
+
+			char name[32];
+			snprintf(name, sizeof(name), "speex-%d", speex_quality);
+			report(name, ratio, elapsed, out);
+		}
+	}
+}
+
+} // namespace
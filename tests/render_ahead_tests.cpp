@@ -0,0 +1,137 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2025  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "../src/midi/render_ahead.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+namespace {
+
+constexpr int SampleRateHz = 48000;
+constexpr int MinFrames    = 1920; // 40 ms
+constexpr int MaxFrames    = 7680; // 160 ms
+
+constexpr int BlockFrames = 64;
+
+// The real-time duration of a block
+constexpr double BlockUs = BlockFrames * 1'000'000.0 / SampleRateHz;
+
+// Renders the given number of seconds of audio at a constant load
+void render(RenderAheadController& controller, const double seconds, const double load)
+{
+	const auto num_blocks = static_cast<int>(seconds * SampleRateHz / BlockFrames);
+	for (auto i = 0; i < num_blocks; ++i) {
+		controller.RecordBlock(BlockFrames, static_cast<int64_t>(BlockUs * load));
+	}
+}
+
+TEST(RenderAhead, StartsAtMinimum)
+{
+	RenderAheadController controller(SampleRateHz, MinFrames, MaxFrames);
+	EXPECT_EQ(controller.GetTargetFrames(), MinFrames);
+}
+
+TEST(RenderAhead, LightLoadKeepsMinimum)
+{
+	RenderAheadController controller(SampleRateHz, MinFrames, MaxFrames);
+	render(controller, 5.0, 0.1);
+
+	// A 10% load only needs 11% more, which stays close to the minimum
+	EXPECT_LE(controller.GetTargetFrames(), MinFrames * 1.15);
+}
+
+TEST(RenderAhead, HeavyLoadGrowsRenderAhead)
+{
+	RenderAheadController controller(SampleRateHz, MinFrames, MaxFrames);
+	render(controller, 2.0, 0.5);
+
+	EXPECT_NEAR(controller.GetTargetFrames(), MinFrames * 2, MinFrames * 0.1);
+
+	const auto stats = controller.GetStats();
+	EXPECT_NEAR(stats.avg_load, 0.5, 0.05);
+	EXPECT_NEAR(stats.target_ms, 80.0, 8.0);
+}
+
+TEST(RenderAhead, OverloadIsCapped)
+{
+	RenderAheadController controller(SampleRateHz, MinFrames, MaxFrames);
+	render(controller, 2.0, 1.5);
+
+	EXPECT_EQ(controller.GetTargetFrames(), MaxFrames);
+}
+
+TEST(RenderAhead, PeakDecays)
+{
+	RenderAheadController controller(SampleRateHz, MinFrames, MaxFrames);
+	render(controller, 0.1, 0.9);
+	const auto peak_target = controller.GetTargetFrames();
+	EXPECT_GT(peak_target, MinFrames * 3);
+
+	render(controller, 20.0, 0.05);
+	EXPECT_LT(controller.GetTargetFrames(), MinFrames * 1.1);
+}
+
+TEST(RenderAhead, UnderrunsGrowRenderAhead)
+{
+	RenderAheadController controller(SampleRateHz, MinFrames, MaxFrames);
+
+	for (auto i = 0; i < 3; ++i) {
+		controller.RecordUnderrun();
+		render(controller, 0.02, 0.1);
+	}
+	// Three boosts of 1.5
+	EXPECT_NEAR(controller.GetTargetFrames(), MinFrames * 3.375, MinFrames * 0.1);
+	EXPECT_EQ(controller.GetStats().num_underruns, 3);
+
+	// And falls back after a while without them
+	render(controller, 60.0, 0.1);
+	EXPECT_LT(controller.GetTargetFrames(), MinFrames * 1.2);
+}
+
+TEST(RenderAhead, ReportsTargetChanges)
+{
+	RenderAheadController controller(SampleRateHz, MinFrames, MaxFrames);
+
+	auto num_changes = 0;
+	for (auto i = 0; i < 100; ++i) {
+		if (controller.RecordBlock(BlockFrames, static_cast<int64_t>(BlockUs * 0.6))) {
+			++num_changes;
+		}
+	}
+	EXPECT_GT(num_changes, 0);
+	EXPECT_GT(controller.GetTargetFrames(), MinFrames);
+}
+
+TEST(RenderAhead, BlockStats)
+{
+	RenderAheadController controller(SampleRateHz, MinFrames, MaxFrames);
+	controller.RecordBlock(64, 100);
+	controller.RecordBlock(64, 300);
+
+	const auto stats = controller.GetStats();
+	EXPECT_EQ(stats.num_blocks, 2);
+	EXPECT_EQ(stats.num_frames, 128);
+	EXPECT_DOUBLE_EQ(stats.avg_block_us, 200.0);
+	EXPECT_EQ(stats.max_block_us, 300);
+}
+
+} // namespace
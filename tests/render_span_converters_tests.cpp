@@ -0,0 +1,336 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2025  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "render_span_converters.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+using Pixels = std::vector<uint32_t>;
+
+struct NamedConverters {
+	const char* name;
+	const RenderSpanConverters& converters;
+};
+
+// The scalar loops are checked too, as the reference values below are worked
+// out independently. The dispatched set may use the AVX2 palette lookups.
+const NamedConverters ConverterSets[] = {
+        {"scalar", RENDER_GetScalarSpanConverters()},
+        {"simd", RENDER_GetSimdSpanConverters()},
+        {"dispatched", RENDER_GetSpanConverters()},
+};
+
+// Spans start at any pixel of the line, so they're converted at every offset
+// within a vector of 16-bit source pixels. Every length up to a few vectors
+// covers the partial vectors at the end, plus a full line.
+constexpr size_t NumSpanOffsets = 8;
+constexpr size_t MaxShortSpan   = 40;
+constexpr size_t FullLine       = 640;
+
+// Fills the destination line around the span, which must be left alone
+constexpr uint32_t Untouched = 0xdeadbeef;
+
+// A 5-bit or 6-bit component is widened to 8 bits by repeating its top bits
+constexpr uint32_t widen(const uint32_t value, const int num_bits)
+{
+	return (value << (8 - num_bits)) | (value >> (2 * num_bits - 8));
+}
+
+constexpr uint32_t expand_rgb565(const uint16_t pixel)
+{
+	return widen(pixel >> 11, 5) << 16 | widen((pixel >> 5) & 0x3f, 6) << 8 |
+	       widen(pixel & 0x1f, 5);
+}
+
+// Full intensity must stay full intensity
+static_assert(expand_rgb565(0x0000) == 0x000000);
+static_assert(expand_rgb565(0xf800) == 0xff0000);
+static_assert(expand_rgb565(0x07e0) == 0x00ff00);
+static_assert(expand_rgb565(0x001f) == 0x0000ff);
+static_assert(expand_rgb565(0xffff) == 0xffffff);
+
+Pixels doubled(const Pixels& pixels)
+{
+	Pixels result = {};
+	for (const auto pixel : pixels) {
+		result.push_back(pixel);
+		result.push_back(pixel);
+	}
+	return result;
+}
+
+// Source pixels that change in every bit from one to the next
+template <typename T>
+std::vector<T> make_line(const size_t num_pixels)
+{
+	std::vector<T> line(num_pixels);
+	uint32_t value = 0x9e3779b9;
+	for (auto& pixel : line) {
+		value = value * 1664525 + 1013904223;
+		pixel = static_cast<T>(value >> (32 - 8 * sizeof(T)));
+	}
+	return line;
+}
+
+// Converts a span of the given length starting at the given pixel of a line,
+// for each converter set, and checks it against the expected pixels. The
+// conversion is given the span's source and destination pointers.
+template <typename T, typename Convert, typename Expect>
+void check_spans(const size_t num_out_per_pixel, Convert convert, Expect expect)
+{
+	auto lengths = std::vector<size_t>{FullLine};
+	for (size_t len = 0; len <= MaxShortSpan; ++len) {
+		lengths.push_back(len);
+	}
+
+	for (const auto& set : ConverterSets) {
+		for (const auto len : lengths) {
+			for (size_t offset = 0; offset < NumSpanOffsets; ++offset) {
+				const auto src = make_line<T>(offset + len);
+				Pixels line((offset + len + NumSpanOffsets) * num_out_per_pixel,
+				            Untouched);
+
+				const auto dest_offset = offset * num_out_per_pixel;
+				convert(set.converters,
+				        src.data() + offset,
+				        len,
+				        line.data() + dest_offset);
+
+				Pixels expected(dest_offset, Untouched);
+				for (const auto pixel : expect(src.data() + offset, len)) {
+					expected.push_back(pixel);
+				}
+				expected.resize(line.size(), Untouched);
+
+				EXPECT_EQ(line, expected) << set.name << " converters, span of "
+				                          << len << " pixels at offset " << offset;
+			}
+		}
+	}
+}
+
+// Every index maps to a different colour, with bits set in all four bytes
+Pixels make_lut()
+{
+	Pixels lut(256);
+	for (uint32_t i = 0; i < lut.size(); ++i) {
+		lut[i] = (i * 0x01010101) ^ 0x5a3cc3a5;
+	}
+	return lut;
+}
+
+TEST(RenderSpanConverters, PaletteTo32)
+{
+	const auto lut = make_lut();
+
+	check_spans<uint8_t>(
+	        1,
+	        [&](const auto& c, const uint8_t* src, size_t len, uint32_t* dest) {
+		        c.palette_to_32(src, len, lut.data(), dest);
+	        },
+	        [&](const uint8_t* src, const size_t len) {
+		        Pixels pixels = {};
+		        for (size_t i = 0; i < len; ++i) {
+			        pixels.push_back(lut[src[i]]);
+		        }
+		        return pixels;
+	        });
+}
+
+TEST(RenderSpanConverters, PaletteTo32Doubled)
+{
+	const auto lut = make_lut();
+
+	check_spans<uint8_t>(
+	        2,
+	        [&](const auto& c, const uint8_t* src, size_t len, uint32_t* dest) {
+		        c.palette_to_32_doubled(src, len, lut.data(), dest);
+	        },
+	        [&](const uint8_t* src, const size_t len) {
+		        Pixels pixels = {};
+		        for (size_t i = 0; i < len; ++i) {
+			        pixels.push_back(lut[src[i]]);
+		        }
+		        return doubled(pixels);
+	        });
+}
+
+TEST(RenderSpanConverters, Rgb565To32)
+{
+	check_spans<uint16_t>(
+	        1,
+	        [](const auto& c, const uint16_t* src, size_t len, uint32_t* dest) {
+		        c.rgb565_to_32(src, len, dest);
+	        },
+	        [](const uint16_t* src, const size_t len) {
+		        Pixels pixels = {};
+		        for (size_t i = 0; i < len; ++i) {
+			        pixels.push_back(expand_rgb565(src[i]));
+		        }
+		        return pixels;
+	        });
+}
+
+TEST(RenderSpanConverters, Rgb565To32Doubled)
+{
+	check_spans<uint16_t>(
+	        2,
+	        [](const auto& c, const uint16_t* src, size_t len, uint32_t* dest) {
+		        c.rgb565_to_32_doubled(src, len, dest);
+	        },
+	        [](const uint16_t* src, const size_t len) {
+		        Pixels pixels = {};
+		        for (size_t i = 0; i < len; ++i) {
+			        pixels.push_back(expand_rgb565(src[i]));
+		        }
+		        return doubled(pixels);
+	        });
+}
+
+// There are few enough RGB565 pixels to check them all in one span
+TEST(RenderSpanConverters, Rgb565To32AllPixels)
+{
+	std::vector<uint16_t> src(UINT16_MAX + 1);
+	Pixels expected(src.size());
+	for (size_t i = 0; i < src.size(); ++i) {
+		src[i]      = static_cast<uint16_t>(i);
+		expected[i] = expand_rgb565(src[i]);
+	}
+
+	for (const auto& set : ConverterSets) {
+		Pixels actual(src.size());
+		set.converters.rgb565_to_32(src.data(), src.size(), actual.data());
+		EXPECT_EQ(actual, expected) << set.name << " converters";
+	}
+}
+
+TEST(RenderSpanConverters, Double32)
+{
+	check_spans<uint32_t>(
+	        2,
+	        [](const auto& c, const uint32_t* src, size_t len, uint32_t* dest) {
+		        c.double_32(src, len, dest);
+	        },
+	        [](const uint32_t* src, const size_t len) {
+		        return doubled(Pixels(src, src + len));
+	        });
+}
+
+// Micro-benchmark
+// ~~~~~~~~~~~~~~~
+// Disabled by default as it takes a while and has nothing to assert. Run it
+// with --gtest_also_run_disabled_tests --gtest_filter='*Benchmark*'.
+
+struct Resolution {
+	size_t width  = 0;
+	size_t height = 0;
+};
+
+constexpr Resolution Resolutions[] = {{640, 480}, {1024, 768}};
+
+constexpr int NumBenchmarkFrames = 200;
+
+template <typename Convert>
+void time_converter(const char* name, const Resolution res, Convert convert)
+{
+	// Warm up the caches and the branch predictors first
+	for (size_t y = 0; y < res.height; ++y) {
+		convert(y);
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	for (auto frame = 0; frame < NumBenchmarkFrames; ++frame) {
+		for (size_t y = 0; y < res.height; ++y) {
+			convert(y);
+		}
+	}
+	const auto elapsed = std::chrono::steady_clock::now() - start;
+
+	const auto us_per_frame =
+	        std::chrono::duration<double, std::micro>(elapsed).count() /
+	        NumBenchmarkFrames;
+
+	printf("%-24s %4zux%-4zu %9.1f us/frame\n",
+	       name,
+	       res.width,
+	       res.height,
+	       us_per_frame);
+}
+
+void benchmark(const char* set_name, const RenderSpanConverters& converters)
+{
+	const auto lut = make_lut();
+
+	printf("[%s]\n", set_name);
+
+	for (const auto res : Resolutions) {
+		const auto num_pixels = res.width * res.height;
+
+		const auto src8  = make_line<uint8_t>(num_pixels);
+		const auto src16 = make_line<uint16_t>(num_pixels);
+		const auto src32 = make_line<uint32_t>(num_pixels);
+
+		Pixels dest(res.width * 2);
+
+		time_converter("palette_to_32", res, [&](const size_t y) {
+			converters.palette_to_32(src8.data() + y * res.width,
+			                         res.width,
+			                         lut.data(),
+			                         dest.data());
+		});
+		time_converter("palette_to_32_doubled", res, [&](const size_t y) {
+			converters.palette_to_32_doubled(src8.data() + y * res.width,
+			                                 res.width,
+			                                 lut.data(),
+			                                 dest.data());
+		});
+		time_converter("rgb565_to_32", res, [&](const size_t y) {
+			converters.rgb565_to_32(src16.data() + y * res.width,
+			                        res.width,
+			                        dest.data());
+		});
+		time_converter("rgb565_to_32_doubled", res, [&](const size_t y) {
+			converters.rgb565_to_32_doubled(src16.data() + y * res.width,
+			                                res.width,
+			                                dest.data());
+		});
+		time_converter("double_32", res, [&](const size_t y) {
+			converters.double_32(src32.data() + y * res.width,
+			                     res.width,
+			                     dest.data());
+		});
+	}
+}
+
+TEST(RenderSpanConverters, DISABLED_Benchmark)
+{
+	for (const auto& set : ConverterSets) {
+		benchmark(set.name, set.converters);
+	}
+}
+
+} // namespace
@@ -558,4 +558,34 @@ TEST(RWQueue, StopBulkMidway)
 	EXPECT_TRUE(items.empty());
 }
 
+TEST(RWQueue, NonblockingBulkDequeue)
+{
+	RWQueue<int> q(8);
+
+	std::vector<int> items = {1, 2, 3};
+	q.BulkEnqueue(items);
+
+	// Only the queued items are dequeued, without waiting for more
+	auto num_dequeued = q.NonblockingBulkDequeue(items, 5);
+	EXPECT_EQ(num_dequeued, 3u);
+	std::vector<int> expected_items = {1, 2, 3};
+	EXPECT_EQ(items, expected_items);
+	EXPECT_TRUE(q.IsEmpty());
+
+	num_dequeued = q.NonblockingBulkDequeue(items, 5);
+	EXPECT_EQ(num_dequeued, 0u);
+	EXPECT_TRUE(items.empty());
+
+	// Items queued before stopping can still be drained
+	items = {4, 5, 6};
+	q.BulkEnqueue(items);
+	q.Stop();
+
+	num_dequeued = q.NonblockingBulkDequeue(items, 2);
+	EXPECT_EQ(num_dequeued, 2u);
+	expected_items = {4, 5};
+	EXPECT_EQ(items, expected_items);
+	EXPECT_EQ(q.Size(), 1);
+}
+
 } // namespace
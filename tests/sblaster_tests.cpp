@@ -0,0 +1,193 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2025  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "dma.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "mem.h"
+
+#include "../src/hardware/sblaster.cpp"
+#include "dosbox_test_fixture.h"
+
+namespace {
+
+using Frames = std::vector<AudioFrame>;
+
+// Channel 1 transfers bytes and channel 5 16-bit words; page 2 starts at the
+// same address on both
+constexpr uint8_t Dma8BitChannel  = 1;
+constexpr uint8_t Dma16BitChannel = 5;
+constexpr uint8_t Page            = 0x02;
+constexpr PhysPt PageStart        = 0x20000;
+
+// Reading PCM transfers from DMA in pieces that split stereo frames, or even
+// samples, between reads and across 4 KB pages must give the same frames as
+// converting the whole transfer in one go
+class SbDmaPcmTest : public DOSBoxTestFixture {
+protected:
+	void SetUp() override
+	{
+		DOSBoxTestFixture::SetUp();
+
+		for (PhysPt i = 0; i < 0x2000; ++i) {
+			phys_writeb(PageStart + i, static_cast<uint8_t>(i * 13 + 7));
+		}
+
+		saved_chan    = sb.dma.chan;
+		saved_speaker = sb.speaker_enabled;
+		saved_warmup  = sb.dsp.warmup_remaining_ms;
+
+		sb.speaker_enabled         = true;
+		sb.dsp.warmup_remaining_ms = 0;
+		sb.dma.partial_frame_bytes = 0;
+	}
+
+	void TearDown() override
+	{
+		sb.dma.chan                = saved_chan;
+		sb.speaker_enabled         = saved_speaker;
+		sb.dsp.warmup_remaining_ms = saved_warmup;
+		sb.dma.partial_frame_bytes = 0;
+
+		DOSBoxTestFixture::TearDown();
+	}
+
+	// The count is large enough to never reach the terminal count, which
+	// would call into the Sound Blaster's DMA event handling
+	void Program(const uint8_t channel_num, const uint16_t addr)
+	{
+		sb.dma.chan = DMA_GetChannel(channel_num);
+		ASSERT_NE(sb.dma.chan, nullptr);
+
+		sb.dma.chan->SetPage(Page);
+		sb.dma.chan->base_addr      = addr;
+		sb.dma.chan->curr_addr      = addr;
+		sb.dma.chan->base_count     = 0xffff;
+		sb.dma.chan->curr_count     = 0xffff;
+		sb.dma.chan->is_autoiniting = false;
+		sb.dma.chan->is_masked      = false;
+	}
+
+	// Reads the transfer in pieces of the given numbers of DMA words
+	template <typename T>
+	Frames ReadStereo(const std::vector<uint32_t>& pieces)
+	{
+		Frames frames = {};
+		for (const auto num_words : pieces) {
+			EXPECT_EQ((read_dma_pcm<FrameType::Stereo, T>(num_words, frames)),
+			          num_words);
+		}
+		return frames;
+	}
+
+	template <typename T>
+	Frames Expected(const PhysPt start, const size_t num_bytes)
+	{
+		std::vector<uint8_t> bytes(num_bytes);
+		for (size_t i = 0; i < num_bytes; ++i) {
+			bytes[i] = phys_readb(start + check_cast<PhysPt>(i));
+		}
+		std::vector<T> samples(num_bytes / sizeof(T));
+		std::memcpy(samples.data(), bytes.data(), samples.size() * sizeof(T));
+
+		return maybe_silence<FrameType::Stereo>(samples.data(),
+		                                        check_cast<uint32_t>(
+		                                                samples.size()));
+	}
+
+private:
+	DmaChannel* saved_chan = nullptr;
+	bool saved_speaker     = false;
+	int saved_warmup       = 0;
+};
+
+TEST_F(SbDmaPcmTest, EightBitStereoSplitAtOddByteCounts)
+{
+	Program(Dma8BitChannel, 0x0100);
+
+	const auto frames = ReadStereo<uint8_t>({7, 13, 1, 3, 9, 31});
+
+	EXPECT_EQ(frames, Expected<uint8_t>(PageStart + 0x0100, 64));
+	EXPECT_EQ(sb.dma.partial_frame_bytes, 0);
+}
+
+TEST_F(SbDmaPcmTest, EightBitStereoSplitAtPageBoundary)
+{
+	// The page boundary falls between the samples of a frame
+	Program(Dma8BitChannel, 0x0ff3);
+
+	const auto frames = ReadStereo<int8_t>({9, 23});
+
+	EXPECT_EQ(frames, Expected<int8_t>(PageStart + 0x0ff3, 32));
+	EXPECT_EQ(sb.dma.partial_frame_bytes, 0);
+}
+
+TEST_F(SbDmaPcmTest, SixteenBitStereoSplitAtOddWordCounts)
+{
+	// Word address 0x07f9 is byte 0x0ff2, so the page boundary falls
+	// between the samples of a frame too
+	Program(Dma16BitChannel, 0x07f9);
+
+	const auto frames = ReadStereo<int16_t>({3, 5, 1, 7});
+
+	EXPECT_EQ(frames, Expected<int16_t>(PageStart + 0x0ff2, 32));
+	EXPECT_EQ(sb.dma.partial_frame_bytes, 0);
+}
+
+TEST_F(SbDmaPcmTest, SixteenBitStereoOnEightBitChannelSplitAtOddByteCounts)
+{
+	// The reads and the page boundary split the samples themselves
+	Program(Dma8BitChannel, 0x0ff7);
+
+	const auto frames = ReadStereo<uint16_t>({5, 11, 3, 13});
+
+	EXPECT_EQ(frames, Expected<uint16_t>(PageStart + 0x0ff7, 32));
+	EXPECT_EQ(sb.dma.partial_frame_bytes, 0);
+}
+
+TEST_F(SbDmaPcmTest, KeepsTrailingPartialFrame)
+{
+	Program(Dma8BitChannel, 0x0200);
+
+	const auto frames = ReadStereo<uint8_t>({5});
+
+	EXPECT_EQ(frames, Expected<uint8_t>(PageStart + 0x0200, 4));
+	EXPECT_EQ(sb.dma.partial_frame_bytes, 1);
+}
+
+TEST_F(SbDmaPcmTest, ReadsAtMostOneBufferOfSamples)
+{
+	Frames frames = {};
+
+	Program(Dma8BitChannel, 0x0000);
+	EXPECT_EQ((read_dma_pcm<FrameType::Stereo, uint8_t>(4000, frames)),
+	          DmaBufSize);
+
+	Program(Dma16BitChannel, 0x0000);
+	EXPECT_EQ((read_dma_pcm<FrameType::Stereo, int16_t>(4000, frames)),
+	          DmaBufSize);
+}
+
+} // namespace
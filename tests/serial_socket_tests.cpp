@@ -0,0 +1,199 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2025  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "dosbox.h"
+
+#if C_MODEM
+
+#include "../src/hardware/serialport/misc_util.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace {
+
+using Bytes = std::vector<uint8_t>;
+
+// Stands in for a TCP or ENet connection, counting the calls that would be
+// system calls on a real one
+class FakeClientSocket final : public NETClientSocket {
+public:
+	FakeClientSocket()
+	{
+		isopen = true;
+	}
+
+	bool Putchar(uint8_t val) override
+	{
+		return SendArray(&val, 1);
+	}
+
+	bool SendArray(const uint8_t* data, size_t n) override
+	{
+		++num_sends;
+		sent.insert(sent.end(), data, data + n);
+		return isopen;
+	}
+
+	bool GetRemoteAddressString(char*) override
+	{
+		return false;
+	}
+
+	void Arrive(const Bytes& data)
+	{
+		incoming.insert(incoming.end(), data.begin(), data.end());
+	}
+
+	int num_reads = 0;
+	int num_sends = 0;
+	Bytes sent    = {};
+
+protected:
+	bool ReadAvailable(uint8_t* data, size_t& n) override
+	{
+		++num_reads;
+		size_t x = 0;
+		while (x < n && !incoming.empty()) {
+			data[x++] = incoming.front();
+			incoming.pop_front();
+		}
+		n = x;
+		return isopen || x > 0;
+	}
+
+private:
+	std::deque<uint8_t> incoming = {};
+};
+
+Bytes make_bytes(const size_t n)
+{
+	Bytes bytes(n);
+	for (size_t i = 0; i < n; ++i) {
+		bytes[i] = static_cast<uint8_t>(i * 7);
+	}
+	return bytes;
+}
+
+TEST(SerialSocket, GetcharReadsInBulk)
+{
+	FakeClientSocket socket;
+	const auto data = make_bytes(1000);
+	socket.Arrive(data);
+
+	Bytes received = {};
+	uint8_t val    = 0;
+	while (socket.GetcharNonBlock(val) == SocketState::Good) {
+		received.push_back(val);
+	}
+	EXPECT_EQ(received, data);
+
+	// One read to fill the buffer and one to find the socket empty
+	EXPECT_EQ(socket.num_reads, 2);
+}
+
+TEST(SerialSocket, GetcharReportsClosed)
+{
+	FakeClientSocket socket;
+	socket.Arrive({1, 2});
+	socket.isopen = false;
+
+	uint8_t val = 0;
+	EXPECT_EQ(socket.GetcharNonBlock(val), SocketState::Good);
+	EXPECT_EQ(socket.GetcharNonBlock(val), SocketState::Good);
+	EXPECT_EQ(val, 2);
+	EXPECT_EQ(socket.GetcharNonBlock(val), SocketState::Closed);
+}
+
+TEST(SerialSocket, ReceiveArrayServesBufferedBytes)
+{
+	FakeClientSocket socket;
+	const auto data = make_bytes(100);
+	socket.Arrive(data);
+
+	Bytes received = {};
+	for (;;) {
+		uint8_t chunk[16] = {};
+		size_t n          = sizeof(chunk);
+		ASSERT_TRUE(socket.ReceiveArray(chunk, n));
+		if (n == 0) {
+			break;
+		}
+		received.insert(received.end(), chunk, chunk + n);
+	}
+	EXPECT_EQ(received, data);
+	EXPECT_EQ(socket.num_reads, 2);
+}
+
+TEST(SerialSocket, ReceiveArrayMixesWithGetchar)
+{
+	FakeClientSocket socket;
+	socket.Arrive({1, 2, 3, 4, 5});
+
+	uint8_t val = 0;
+	ASSERT_EQ(socket.GetcharNonBlock(val), SocketState::Good);
+	EXPECT_EQ(val, 1);
+
+	uint8_t chunk[8] = {};
+	size_t n         = sizeof(chunk);
+	ASSERT_TRUE(socket.ReceiveArray(chunk, n));
+	EXPECT_EQ(Bytes(chunk, chunk + n), Bytes({2, 3, 4, 5}));
+}
+
+TEST(SerialSocket, SendArrayBufferedGathersData)
+{
+	FakeClientSocket socket;
+	socket.SetSendBufferSize(64);
+
+	const auto data = make_bytes(100);
+	for (size_t i = 0; i < data.size(); i += 10) {
+		ASSERT_TRUE(socket.SendArrayBuffered(&data[i], 10));
+	}
+	// The first 60 bytes went out when the next 10 didn't fit
+	EXPECT_EQ(socket.num_sends, 1);
+	EXPECT_EQ(socket.GetBufferedSendSize(), 40);
+
+	ASSERT_TRUE(socket.FlushBuffer());
+	EXPECT_EQ(socket.num_sends, 2);
+	EXPECT_EQ(socket.GetBufferedSendSize(), 0);
+	EXPECT_EQ(socket.sent, data);
+}
+
+TEST(SerialSocket, SendArrayBufferedKeepsOrderForLargeArrays)
+{
+	FakeClientSocket socket;
+	socket.SetSendBufferSize(16);
+
+	const auto data = make_bytes(50);
+	ASSERT_TRUE(socket.SendArrayBuffered(&data[0], 5));
+	ASSERT_TRUE(socket.SendArrayBuffered(&data[5], 40));
+	ASSERT_TRUE(socket.SendArrayBuffered(&data[45], 5));
+	ASSERT_TRUE(socket.FlushBuffer());
+
+	EXPECT_EQ(socket.sent, data);
+	EXPECT_EQ(socket.num_sends, 3);
+}
+
+} // namespace
+
+#endif // C_MODEM
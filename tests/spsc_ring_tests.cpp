@@ -0,0 +1,154 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2025  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "spsc_ring.h"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstdint>
+#include <thread>
+
+namespace {
+
+TEST(SpscRing, StartsEmpty)
+{
+	SpscRing<int, 4> ring = {};
+
+	EXPECT_EQ(ring.Size(), 0);
+	EXPECT_EQ(ring.Front(), nullptr);
+
+	int item = 0;
+	EXPECT_FALSE(ring.TryPop(item));
+}
+
+TEST(SpscRing, FirstInFirstOut)
+{
+	SpscRing<int, 4> ring = {};
+
+	EXPECT_TRUE(ring.TryPush(1));
+	EXPECT_TRUE(ring.TryPush(2));
+	EXPECT_TRUE(ring.TryPush(3));
+	EXPECT_EQ(ring.Size(), 3);
+
+	int item = 0;
+	EXPECT_TRUE(ring.TryPop(item));
+	EXPECT_EQ(item, 1);
+	EXPECT_TRUE(ring.TryPop(item));
+	EXPECT_EQ(item, 2);
+	EXPECT_TRUE(ring.TryPop(item));
+	EXPECT_EQ(item, 3);
+	EXPECT_FALSE(ring.TryPop(item));
+}
+
+TEST(SpscRing, RefusesItemsWhenFull)
+{
+	SpscRing<int, 4> ring = {};
+
+	for (auto i = 0; i < 4; ++i) {
+		EXPECT_TRUE(ring.TryPush(i));
+	}
+	EXPECT_FALSE(ring.TryPush(4));
+	EXPECT_EQ(ring.BeginPush(), nullptr);
+	EXPECT_EQ(ring.Size(), 4);
+
+	// Freeing one slot makes room for exactly one more
+	ring.Pop();
+	EXPECT_TRUE(ring.TryPush(4));
+	EXPECT_FALSE(ring.TryPush(5));
+}
+
+TEST(SpscRing, WrapsAround)
+{
+	SpscRing<int, 4> ring = {};
+
+	int item = 0;
+	for (auto i = 0; i < 100; ++i) {
+		EXPECT_TRUE(ring.TryPush(i));
+		EXPECT_TRUE(ring.TryPush(i + 1000));
+
+		EXPECT_TRUE(ring.TryPop(item));
+		EXPECT_EQ(item, i);
+		EXPECT_TRUE(ring.TryPop(item));
+		EXPECT_EQ(item, i + 1000);
+	}
+	EXPECT_EQ(ring.Size(), 0);
+}
+
+TEST(SpscRing, InPlaceSlots)
+{
+	struct Packet {
+		int len = 0;
+		std::array<uint8_t, 64> data = {};
+	};
+	SpscRing<Packet, 2> ring = {};
+
+	const auto slot = ring.BeginPush();
+	ASSERT_NE(slot, nullptr);
+	slot->len     = 3;
+	slot->data[2] = 0xab;
+
+	// Not visible until committed
+	EXPECT_EQ(ring.Front(), nullptr);
+	ring.CommitPush();
+
+	const auto front = ring.Front();
+	ASSERT_NE(front, nullptr);
+	EXPECT_EQ(front->len, 3);
+	EXPECT_EQ(front->data[2], 0xab);
+
+	ring.Pop();
+	EXPECT_EQ(ring.Front(), nullptr);
+}
+
+TEST(SpscRing, ProducerAndConsumerThreads)
+{
+	constexpr uint32_t NumItems = 200'000;
+
+	SpscRing<uint32_t, 64> ring = {};
+
+	std::thread producer([&] {
+		for (uint32_t i = 0; i < NumItems;) {
+			if (ring.TryPush(i)) {
+				++i;
+			} else {
+				std::this_thread::yield();
+			}
+		}
+	});
+
+	uint32_t expected = 0;
+	bool is_in_order  = true;
+	while (expected < NumItems) {
+		uint32_t item = 0;
+		if (ring.TryPop(item)) {
+			is_in_order &= (item == expected);
+			++expected;
+		} else {
+			std::this_thread::yield();
+		}
+	}
+	producer.join();
+
+	EXPECT_TRUE(is_in_order);
+	EXPECT_EQ(ring.Size(), 0);
+}
+
+} // namespace
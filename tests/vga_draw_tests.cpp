@@ -0,0 +1,184 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2025  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "vga.h"
+
+#include <array>
+#include <cstring>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "../src/hardware/vga_draw.cpp"
+#include "dosbox_test_fixture.h"
+#include "timer.h"
+
+namespace {
+
+constexpr uint32_t NumLines = 16;
+constexpr double PerLineMs  = 0.05;
+constexpr auto LineWidth    = 4;
+constexpr uint32_t NoChange = ~0u;
+
+// Stands in for the palette or any other state the line drawing depends on
+uint8_t line_colour = 0;
+
+std::array<uint8_t, LineWidth> line_buffer = {};
+std::vector<std::array<uint8_t, LineWidth>> drawn_lines = {};
+
+uint8_t* draw_test_line(const Bitu vidstart, const Bitu line)
+{
+	line_buffer = {static_cast<uint8_t>(vidstart),
+	               static_cast<uint8_t>(vidstart >> 8),
+	               static_cast<uint8_t>(line),
+	               line_colour};
+	return line_buffer.data();
+}
+
+void capture_line(const void* src)
+{
+	auto& line = drawn_lines.emplace_back();
+	std::memcpy(line.data(), src, line.size());
+}
+
+// Like a register write the guest makes while the frame is being drawn
+void VGA_TestMidFrameChange(uint32_t /*val*/)
+{
+	VGA_StopFrameBatching();
+
+	line_colour                 = 0x55;
+	vga.draw.address_line_total = 1;
+	vga.draw.address_add        = 0x200;
+}
+
+class VgaDrawTest : public DOSBoxTestFixture {
+protected:
+	void SetUp() override
+	{
+		DOSBoxTestFixture::SetUp();
+
+		// Only the test frames are drawn
+		PIC_RemoveEvents(VGA_VerticalTimer);
+		PIC_RemoveEvents(VGA_SetupDrawing);
+		PIC_RemoveEvents(VGA_DisplayStartLatch);
+		PIC_RemoveEvents(VGA_PanningLatch);
+		PIC_RemoveEvents(VGA_VertInterrupt);
+		VGA_KillDrawing();
+
+		saved_draw_line    = VGA_DrawLine;
+		saved_rm_draw_line = ReelMagic_RENDER_DrawLine;
+
+		VGA_DrawLine              = draw_test_line;
+		ReelMagic_RENDER_DrawLine = capture_line;
+	}
+
+	void TearDown() override
+	{
+		VGA_KillDrawing();
+		frame_batching.is_enabled = false;
+
+		VGA_DrawLine              = saved_draw_line;
+		ReelMagic_RENDER_DrawLine = saved_rm_draw_line;
+
+		DOSBoxTestFixture::TearDown();
+	}
+
+	// Draws a frame the way VGA_VerticalTimer does, optionally changing the
+	// drawing state after the given number of lines and a half
+	std::vector<std::array<uint8_t, LineWidth>> DrawFrame(
+	        const bool batched, const uint32_t change_after_lines = NoChange)
+	{
+		drawn_lines.clear();
+		line_colour = 0x11;
+
+		line_skipping.is_enabled = false;
+
+		vga.draw.mode               = PART;
+		vga.draw.lines_total        = NumLines;
+		vga.draw.parts_total        = NumLines;
+		vga.draw.parts_lines        = 1;
+		vga.draw.lines_done         = 0;
+		vga.draw.parts_left         = vga.draw.parts_total;
+		vga.draw.address            = 0;
+		vga.draw.address_line       = 0;
+		vga.draw.address_line_total = 2;
+		vga.draw.address_add        = 0x100;
+		vga.draw.split_line         = 0x10000;
+		vga.draw.delay.per_line_ms  = PerLineMs;
+		vga.draw.delay.parts        = PerLineMs;
+		vga.draw.delay.vdend        = NumLines * PerLineMs;
+		vga.draw.delay.framestart   = PIC_FullIndex();
+
+		frame_batching.is_enabled = batched;
+		if (!start_frame_batching(0.0)) {
+			PIC_AddEvent(VGA_DrawPart,
+			             vga.draw.delay.parts,
+			             vga.draw.parts_lines);
+		}
+		if (change_after_lines != NoChange) {
+			PIC_AddEvent(VGA_TestMidFrameChange,
+			             (change_after_lines + 0.5) * PerLineMs);
+		}
+
+		// Let the emulated time pass while the CPU idles, with a few
+		// milliseconds to spare
+		constexpr auto MaxTicks = 5;
+		for (auto tick = 0; tick < MaxTicks; ++tick) {
+			while (PIC_RunQueue()) {
+				CPU_Cycles = 0;
+			}
+			TIMER_AddTick();
+		}
+		EXPECT_FALSE(frame_batching.is_active);
+		EXPECT_EQ(vga.draw.lines_done, NumLines);
+
+		return drawn_lines;
+	}
+
+private:
+	VGA_Line_Handler saved_draw_line                 = nullptr;
+	ReelMagic_ScalerLineHandler_t saved_rm_draw_line = nullptr;
+};
+
+TEST_F(VgaDrawTest, BatchedFrameMatchesLineByLine)
+{
+	const auto line_by_line = DrawFrame(false);
+	const auto batched      = DrawFrame(true);
+
+	ASSERT_EQ(line_by_line.size(), NumLines);
+	EXPECT_EQ(batched, line_by_line);
+}
+
+TEST_F(VgaDrawTest, BatchedFrameMatchesLineByLineWithMidFrameChange)
+{
+	constexpr uint32_t ChangeAfterLines = 5;
+
+	const auto line_by_line = DrawFrame(false, ChangeAfterLines);
+	const auto batched      = DrawFrame(true, ChangeAfterLines);
+
+	ASSERT_EQ(line_by_line.size(), NumLines);
+	EXPECT_EQ(batched, line_by_line);
+
+	// The change must be visible from the line the beam was on
+	EXPECT_EQ(line_by_line[ChangeAfterLines - 1][3], 0x11);
+	EXPECT_EQ(line_by_line[ChangeAfterLines][3], 0x55);
+}
+
+} // namespace
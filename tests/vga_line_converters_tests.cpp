@@ -0,0 +1,161 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2025  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "vga_line_converters.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace {
+
+// Covers empty lines, lines shorter than a vector, and partial vectors at the
+// end of the line
+constexpr size_t Lengths[] = {0, 1, 7, 15, 16, 17, 31, 33, 160, 333, 640};
+
+using Bytes = std::vector<uint8_t>;
+
+const auto& scalar = VGA_GetScalarLineConverters();
+const auto& simd   = VGA_GetSimdLineConverters();
+
+Bytes random_bytes(std::mt19937& rng, const size_t num_bytes, const int max_value = 255)
+{
+	std::uniform_int_distribution<int> dist(0, max_value);
+
+	Bytes bytes(num_bytes);
+	for (auto& b : bytes) {
+		b = static_cast<uint8_t>(dist(rng));
+	}
+	return bytes;
+}
+
+std::vector<Bgrx8888> random_palette(std::mt19937& rng)
+{
+	std::vector<Bgrx8888> palette(256);
+	for (auto& colour : palette) {
+		const auto bgr = random_bytes(rng, 3);
+		colour.Set(bgr[0], bgr[1], bgr[2]);
+	}
+	return palette;
+}
+
+TEST(VgaLineConverters, ExpandNibbles)
+{
+	std::mt19937 rng(1);
+	const auto palette = random_bytes(rng, 16);
+
+	for (const auto len : Lengths) {
+		const auto src = random_bytes(rng, len);
+
+		Bytes expected(len * 2);
+		Bytes actual(len * 2);
+		scalar.expand_nibbles(src.data(), len, palette.data(), expected.data());
+		simd.expand_nibbles(src.data(), len, palette.data(), actual.data());
+
+		EXPECT_EQ(actual, expected) << "Line length " << len;
+	}
+}
+
+TEST(VgaLineConverters, ExpandNibblesDoubled)
+{
+	std::mt19937 rng(2);
+	const auto palette = random_bytes(rng, 16);
+
+	for (const auto len : Lengths) {
+		const auto src = random_bytes(rng, len);
+
+		Bytes expected(len * 4);
+		Bytes actual(len * 4);
+		scalar.expand_nibbles_doubled(src.data(), len, palette.data(), expected.data());
+		simd.expand_nibbles_doubled(src.data(), len, palette.data(), actual.data());
+
+		EXPECT_EQ(actual, expected) << "Line length " << len;
+	}
+}
+
+TEST(VgaLineConverters, ExpandNibblesMatchesPalette)
+{
+	const Bytes palette = {
+	        0, 10, 20, 30, 40, 50, 60, 70, 80, 90, 100, 110, 120, 130, 140, 150};
+	const Bytes src = {0x01, 0x23, 0xfe};
+
+	Bytes actual(src.size() * 2);
+	VGA_GetLineConverters().expand_nibbles(src.data(),
+	                                       src.size(),
+	                                       palette.data(),
+	                                       actual.data());
+
+	EXPECT_EQ(actual, Bytes({0, 10, 20, 30, 150, 140}));
+}
+
+TEST(VgaLineConverters, ExpandIndices)
+{
+	std::mt19937 rng(3);
+	const auto palette = random_palette(rng);
+
+	// The 16-colour fast path, the 256-colour fallback, and a mix of both
+	for (const auto max_index : {15, 255, 17}) {
+		for (const auto len : Lengths) {
+			const auto src = random_bytes(rng, len, max_index);
+
+			Bytes expected(len * sizeof(Bgrx8888));
+			Bytes actual(len * sizeof(Bgrx8888));
+			scalar.expand_indices(src.data(), len, palette.data(), expected.data());
+			simd.expand_indices(src.data(), len, palette.data(), actual.data());
+
+			EXPECT_EQ(actual, expected)
+			        << "Line length " << len << ", max index " << max_index;
+		}
+	}
+}
+
+TEST(VgaLineConverters, ExpandTextCells)
+{
+	std::mt19937 rng(4);
+	const auto palette = random_palette(rng);
+
+	for (const uint8_t pixels_per_cell : {8, 9}) {
+		for (const size_t num_cells : {0, 1, 40, 80, 133}) {
+			std::uniform_int_distribution<int> glyph_dist(0, (1 << pixels_per_cell) - 1);
+			std::uniform_int_distribution<int> colour_dist(0, 15);
+
+			std::vector<TextCell> cells(num_cells);
+			for (auto& cell : cells) {
+				cell.glyph_bits = static_cast<uint16_t>(glyph_dist(rng));
+				cell.fg_colour  = palette[colour_dist(rng)];
+				cell.bg_colour  = palette[colour_dist(rng)];
+			}
+
+			const auto num_bytes = num_cells * pixels_per_cell *
+			                       sizeof(Bgrx8888);
+			Bytes expected(num_bytes);
+			Bytes actual(num_bytes);
+			scalar.expand_text_cells(cells.data(), num_cells, pixels_per_cell, expected.data());
+			simd.expand_text_cells(cells.data(), num_cells, pixels_per_cell, actual.data());
+
+			EXPECT_EQ(actual, expected) << num_cells << " cells of "
+			                            << int(pixels_per_cell) << " pixels";
+		}
+	}
+}
+
+} // namespace
@@ -0,0 +1,218 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2025  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "zmbv/zmbv.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace {
+
+// Not a multiple of the 16x16 block size, so we have partial blocks too
+constexpr int Width     = 324;
+constexpr int Height    = 200;
+constexpr int NumFrames = 24;
+
+// Every n-th frame is a keyframe, the rest are delta frames
+constexpr int KeyframeInterval = 10;
+
+using Frame = std::vector<uint8_t>;
+
+// Generates a sequence of frames with content scrolling in both directions
+// (exercising the motion vector search), with some noise sprinkled on top
+// (exercising the XOR blocks).
+std::vector<Frame> generate_frames(const int bytes_per_pixel)
+{
+	std::mt19937 rng(1234);
+	std::uniform_int_distribution<int> byte_dist(0, 255);
+	std::uniform_int_distribution<int> pos_dist(0, Width * Height - 1);
+
+	// Background larger than the frame so we can scroll across it
+	constexpr int Margin = 32;
+	constexpr int BgWidth  = Width + Margin;
+	constexpr int BgHeight = Height + Margin;
+
+	std::vector<uint8_t> background(BgWidth * BgHeight * bytes_per_pixel);
+	for (auto& b : background) {
+		// Blocky content so a good portion of the blocks can be matched
+		b = static_cast<uint8_t>(byte_dist(rng) & 0xf0);
+	}
+
+	std::vector<Frame> frames = {};
+	for (auto f = 0; f < NumFrames; ++f) {
+		const auto scroll_x = (f * 3) % Margin;
+		const auto scroll_y = (f * 2) % Margin;
+
+		Frame frame(Width * Height * bytes_per_pixel);
+		for (auto y = 0; y < Height; ++y) {
+			const auto src = background.data() +
+			                 ((y + scroll_y) * BgWidth + scroll_x) *
+			                         bytes_per_pixel;
+			std::copy(src,
+			          src + Width * bytes_per_pixel,
+			          frame.data() + y * Width * bytes_per_pixel);
+		}
+		for (auto i = 0; i < 500; ++i) {
+			const auto pos = pos_dist(rng) * bytes_per_pixel;
+			frame[pos] = static_cast<uint8_t>(byte_dist(rng));
+		}
+		frames.emplace_back(std::move(frame));
+	}
+	return frames;
+}
+
+std::vector<uint8_t> generate_palette()
+{
+	std::vector<uint8_t> palette(256 * 4);
+	for (auto i = 0; i < 256; ++i) {
+		palette[i * 4 + 0] = static_cast<uint8_t>(i);
+		palette[i * 4 + 1] = static_cast<uint8_t>(255 - i);
+		palette[i * 4 + 2] = static_cast<uint8_t>(i * 7);
+	}
+	return palette;
+}
+
+std::vector<Frame> encode_frames(const std::vector<Frame>& frames,
+                                 const ZMBV_FORMAT format, const int num_threads)
+{
+	const auto bytes_per_pixel = ZMBV_ToBytesPerPixel(format);
+	const auto palette         = generate_palette();
+
+	VideoCodec codec(num_threads);
+	EXPECT_TRUE(codec.SetupCompress(Width, Height));
+
+	const auto buf_size = codec.NeededSize(Width, Height, format);
+
+	std::vector<Frame> encoded = {};
+	for (size_t f = 0; f < frames.size(); ++f) {
+		Frame buf(buf_size);
+
+		const auto flags = (f % KeyframeInterval == 0) ? 1 : 0;
+		EXPECT_TRUE(codec.PrepareCompressFrame(flags,
+		                                       format,
+		                                       palette.data(),
+		                                       buf.data(),
+		                                       static_cast<uint32_t>(buf_size)));
+
+		for (auto y = 0; y < Height; ++y) {
+			const uint8_t* row = frames[f].data() + y * Width * bytes_per_pixel;
+			codec.CompressLines(1, &row);
+		}
+
+		const auto written = codec.FinishCompressFrame();
+		EXPECT_GT(written, 0);
+
+		buf.resize(static_cast<size_t>(written));
+		encoded.emplace_back(std::move(buf));
+	}
+	codec.FinishVideo();
+	return encoded;
+}
+
+// Converts the source frame to what Output_UpsideDown_24() should produce
+Frame to_bgr24_upside_down(const Frame& frame, const ZMBV_FORMAT format)
+{
+	const auto palette = generate_palette();
+	const auto pad     = Width & 3;
+
+	Frame out = {};
+	for (auto y = Height - 1; y >= 0; --y) {
+		for (auto x = 0; x < Width; ++x) {
+			if (format == ZMBV_FORMAT::BPP_8) {
+				const auto c = frame[y * Width + x];
+				out.push_back(palette[c * 4 + 2]);
+				out.push_back(palette[c * 4 + 1]);
+				out.push_back(palette[c * 4 + 0]);
+			} else {
+				const auto p = frame.data() + (y * Width + x) * 4;
+				out.push_back(p[0]);
+				out.push_back(p[1]);
+				out.push_back(p[2]);
+			}
+		}
+		out.resize(out.size() + pad);
+	}
+	return out;
+}
+
+void expect_round_trip(const ZMBV_FORMAT format, const int num_threads)
+{
+	const auto frames  = generate_frames(ZMBV_ToBytesPerPixel(format));
+	const auto encoded = encode_frames(frames, format, num_threads);
+
+	VideoCodec decoder;
+	ASSERT_TRUE(decoder.SetupDecompress(Width, Height));
+
+	for (size_t f = 0; f < frames.size(); ++f) {
+		auto data = encoded[f];
+		ASSERT_TRUE(decoder.DecompressFrame(data.data(),
+		                                    static_cast<int>(data.size())));
+
+		const auto expected = to_bgr24_upside_down(frames[f], format);
+
+		Frame decoded(expected.size());
+		decoder.Output_UpsideDown_24(decoded.data());
+
+		EXPECT_EQ(decoded, expected) << "Mismatch in frame " << f;
+	}
+}
+
+TEST(ZMBV, RoundTrip8BitSerial)
+{
+	expect_round_trip(ZMBV_FORMAT::BPP_8, 1);
+}
+
+TEST(ZMBV, RoundTrip8BitThreaded)
+{
+	expect_round_trip(ZMBV_FORMAT::BPP_8, 4);
+}
+
+TEST(ZMBV, RoundTrip32BitSerial)
+{
+	expect_round_trip(ZMBV_FORMAT::BPP_32, 1);
+}
+
+TEST(ZMBV, RoundTrip32BitThreaded)
+{
+	expect_round_trip(ZMBV_FORMAT::BPP_32, 4);
+}
+
+// The threaded motion search must produce the exact same stream as the
+// serial one
+TEST(ZMBV, ThreadedOutputMatchesSerial)
+{
+	for (const auto format :
+	     {ZMBV_FORMAT::BPP_8, ZMBV_FORMAT::BPP_16, ZMBV_FORMAT::BPP_32}) {
+		const auto frames = generate_frames(ZMBV_ToBytesPerPixel(format));
+
+		const auto serial   = encode_frames(frames, format, 1);
+		const auto threaded = encode_frames(frames, format, 3);
+
+		ASSERT_EQ(serial.size(), threaded.size());
+		for (size_t f = 0; f < serial.size(); ++f) {
+			EXPECT_EQ(serial[f], threaded[f]) << "Mismatch in frame " << f;
+		}
+	}
+}
+
+} // namespace